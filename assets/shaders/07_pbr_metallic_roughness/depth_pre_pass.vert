@@ -0,0 +1,27 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+// Position-only vertex shader used to lay down depth before the shading pass.
+// gl_Position must be computed exactly as in pbr_metallic_roughness.vert so that
+// the shading pass can use an EQUAL depth test.
+invariant gl_Position;
+
+layout(location = 0) in vec3 vertexPosition;
+
+layout(set = 0, binding = 0) uniform Camera
+{
+    mat4 projection;
+    mat4 view;
+}
+camera;
+
+layout(set = 1, binding = 0) buffer Entity
+{
+    mat4 model[];
+}
+entity;
+
+void main()
+{
+    gl_Position = camera.projection * camera.view * entity.model[gl_InstanceIndex] * vec4(vertexPosition, 1.0);
+}
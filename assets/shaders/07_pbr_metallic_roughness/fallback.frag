@@ -0,0 +1,23 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+// Shades with a default grey material and a fixed directional light until the
+// specialized pipeline of the primitive is ready.
+
+layout(location = 0) in vec3 worldNormal;
+
+layout(location = 0) out vec4 fragColor;
+
+const vec3 baseColor = vec3(0.6);
+const vec3 lightDirection = normalize(vec3(0.5, 1.0, 0.3));
+const float ambient = 0.2;
+
+void main()
+{
+    // Primitives are drawn without culling so light both faces
+    vec3 normal = normalize(worldNormal);
+    if (!gl_FrontFacing)
+        normal = -normal;
+    float diffuse = max(dot(normal, lightDirection), 0.0);
+    fragColor = vec4(baseColor * (ambient + (1.0 - ambient) * diffuse), 1.0);
+}
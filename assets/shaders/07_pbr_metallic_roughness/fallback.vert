@@ -0,0 +1,31 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+// Generic vertex shader used while the specialized pipeline of a primitive is still
+// being compiled. Only consumes the position and normal so that a single pipeline
+// covers all primitives sharing a buffer layout for them.
+
+layout(location = 0) in vec3 vertexPosition;
+layout(location = 1) in vec3 vertexNormal;
+
+layout(location = 0) out vec3 worldNormal;
+
+layout(set = 0, binding = 0) uniform Camera
+{
+    mat4 projection;
+    mat4 view;
+}
+camera;
+
+layout(set = 1, binding = 0) buffer Entity
+{
+    mat4 model[];
+}
+entity;
+
+void main()
+{
+    mat3 normalMatrix = mat3(transpose(inverse(entity.model[gl_InstanceIndex])));
+    worldNormal = normalize(normalMatrix * vertexNormal);
+    gl_Position = camera.projection * camera.view * entity.model[gl_InstanceIndex] * vec4(vertexPosition, 1.0);
+}
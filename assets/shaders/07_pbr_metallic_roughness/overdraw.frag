@@ -0,0 +1,15 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+// Overdraw heat map. Every shaded fragment adds the same amount to the color target with
+// additive blending, so the brightness of a pixel counts how often it was shaded.
+
+layout(location = 0) out vec4 fragColor;
+
+// White after 8 fragments
+const float fragmentWeight = 1.0 / 8.0;
+
+void main()
+{
+    fragColor = vec4(vec3(fragmentWeight), 1.0);
+}
@@ -3,13 +3,29 @@
 
 layout(location = 0) in vec3 worldPosition;
 layout(location = 1) in vec3 worldNormal;
-#ifdef TEXCOORD_0_ENABLED
 layout(location = 2) in vec2 texCoord;
-#endif
 layout(location = 3) in vec4 worldTangent;
 
 layout(location = 0) out vec4 fragColor;
 
+// The options are either fixed at compile time, one SPIR-V file per combination, or
+// specialization constants set per pipeline for a single shader module
+#ifdef SPECIALIZED_OPTIONS
+layout(constant_id = 0) const bool hasTexCoords = false;
+layout(constant_id = 1) const bool enableAlphaCutoff = false;
+#else
+#ifdef TEXCOORD_0_ENABLED
+const bool hasTexCoords = true;
+#else
+const bool hasTexCoords = false;
+#endif
+#ifdef ALPHA_CUTOFF_ENABLED
+const bool enableAlphaCutoff = true;
+#else
+const bool enableAlphaCutoff = false;
+#endif
+#endif
+
 layout(set = 0, binding = 0) uniform Camera
 {
     mat4 projection;
@@ -388,28 +404,25 @@ vec3 reinhartTonemap(in vec3 color, in float gamma) {
 
 void main()
 {
-#ifdef TEXCOORD_0_ENABLED
-    vec4 baseColor = texture(baseColorMap, texCoord) * material.baseColorFactor;
-    vec2 metallicRoughness = texture(metalRoughMap, texCoord).zy;
-    float metalness = metallicRoughness.x * material.metallicFactor;
-    float roughness = metallicRoughness.y * material.roughnessFactor;
-    float ambientOcclusion = texture(ambientOcclusionMap, texCoord).r;
-    vec4 emissive = texture(emissiveMap, texCoord).rgba * material.emissiveFactor;
-    vec3 normal = normalize(texture(normalMap, texCoord).rgb * float(2.0) - vec3(1.0,1.0,1.0));
-    normal = normalize(normal * calcWorldSpaceToTangentSpaceMatrix(worldNormal, worldTangent));
-#else
     vec4 baseColor = material.baseColorFactor;
     float metalness = material.metallicFactor;
     float roughness = material.roughnessFactor;
     float ambientOcclusion = 1.0f;
     vec4 emissive = material.emissiveFactor;
     vec3 normal = worldNormal;
-#endif
+    if (hasTexCoords) {
+        baseColor *= texture(baseColorMap, texCoord);
+        vec2 metallicRoughness = texture(metalRoughMap, texCoord).zy;
+        metalness *= metallicRoughness.x;
+        roughness *= metallicRoughness.y;
+        ambientOcclusion = texture(ambientOcclusionMap, texCoord).r;
+        emissive *= texture(emissiveMap, texCoord).rgba;
+        normal = normalize(texture(normalMap, texCoord).rgb * float(2.0) - vec3(1.0,1.0,1.0));
+        normal = normalize(normal * calcWorldSpaceToTangentSpaceMatrix(worldNormal, worldTangent));
+    }
 
-#ifdef ALPHA_CUTOFF_ENABLED
-    if (baseColor.a < material.alphaCutoff)
+    if (enableAlphaCutoff && baseColor.a < material.alphaCutoff)
         discard;
-#endif
     mat4 inverseView = inverse(camera.view); // TODO: Send the inverse or position directly
     vec3 cameraPosition = inverseView[3].xyz;
     vec3 worldView = normalize(cameraPosition - worldPosition);
@@ -1,6 +1,9 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
 
+// Must match depth_pre_pass.vert for the EQUAL depth test of the pre-pass mode
+invariant gl_Position;
+
 layout(location = 0) in vec3 vertexPosition;
 layout(location = 1) in vec3 vertexNormal;
 #ifdef TEXCOORD_0_ENABLED
@@ -10,9 +13,9 @@ layout(location = 3) in vec4 vertexTangent;
 
 layout(location = 0) out vec3 worldPosition;
 layout(location = 1) out vec3 worldNormal;
-#ifdef TEXCOORD_0_ENABLED
+// Always written so that the fragment shader built with specialization constants can be
+// used with either vertex shader variant
 layout(location = 2) out vec2 texCoord;
-#endif
 layout(location = 3) out vec4 worldTangent;
 
 layout(set = 0, binding = 0) uniform Camera
@@ -32,6 +35,8 @@ void main()
 {
 #ifdef TEXCOORD_0_ENABLED
     texCoord = vertexTexCoord;
+#else
+    texCoord = vec2(0.0);
 #endif
     worldPosition = (entity.model[gl_InstanceIndex] * vec4(vertexPosition, 1.0)).xyz;
     mat3 normalMatrix = mat3(transpose(inverse(entity.model[gl_InstanceIndex])));
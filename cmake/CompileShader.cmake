@@ -19,7 +19,14 @@ if(NOT Vulkan_GLSLANG_VALIDATOR_EXECUTABLE)
 endif()
 
 # Compile shader variants
+#
+# If TABLE_NAMESPACE is given, a header <TABLE_NAMESPACE>.h is generated at build time that
+# embeds the SPIR-V of all variants and, per shader, maps a bitmask of the variant options
+# to the matching SPIR-V. Link against the ${target}VariantTable interface target to use it.
+# Only options that are either defined or not (no explicit "values") can be part of a table.
 function(CompileShaderVariants target variants_filename)
+    cmake_parse_arguments(ARG "" "TABLE_NAMESPACE" "" ${ARGN})
+
     # Run the helper script to generate json data for all configured shader variants
     execute_process(
         COMMAND ruby ${CMAKE_SOURCE_DIR}/generate_shader_variants.rb ${variants_filename}
@@ -53,6 +60,11 @@ function(CompileShaderVariants target variants_filename)
             ${SHADER_TARGET_NAME}ShaderVariant ALL
             DEPENDS ${SHADER_TARGET_NAME}
         )
+
+        # A variant table already embeds the SPIR-V uncompressed
+        if(NOT ARG_TABLE_NAMESPACE)
+            EmbedShader(${SHADER_TARGET_NAME} ${CMAKE_CURRENT_BINARY_DIR}/${CURRENT_OUTPUT_FILENAME})
+        endif()
     endforeach(VARIANT_INDEX RANGE ${VARIANT_COUNT})
 
     # Re-run cmake configure step if the variants file changes
@@ -61,4 +73,129 @@ function(CompileShaderVariants target variants_filename)
         APPEND
         PROPERTY CMAKE_CONFIGURE_DEPENDS ${variants_filename}
     )
+
+    if(ARG_TABLE_NAMESPACE)
+        GenerateShaderVariantTable(${target} ${variants_filename} ${ARG_TABLE_NAMESPACE} "${SHADER_VARIANTS}")
+    endif()
+endfunction()
+
+# Helper for CompileShaderVariants(... TABLE_NAMESPACE ...). Resolves which variant
+# each option mask maps to at configure time, so that a variants file the table cannot
+# represent fails early, and leaves embedding the SPIR-V to a build step.
+function(GenerateShaderVariantTable target variants_filename table_namespace shader_variants)
+    file(READ ${CMAKE_CURRENT_SOURCE_DIR}/${variants_filename} VARIANTS_CONFIG)
+
+    # Each option becomes one bit of the mask, in the order of the variants file
+    string(JSON OPTION_COUNT LENGTH ${VARIANTS_CONFIG} options)
+    set(OPTION_NAMES)
+    set(OPTION_DEFINES)
+    MATH(EXPR LAST_OPTION_INDEX "${OPTION_COUNT} - 1")
+    foreach(OPTION_INDEX RANGE ${LAST_OPTION_INDEX})
+        string(JSON OPTION_NAME GET ${VARIANTS_CONFIG} options ${OPTION_INDEX} name)
+        string(JSON OPTION_DEFINE GET ${VARIANTS_CONFIG} options ${OPTION_INDEX} define)
+        string(JSON OPTION_VALUES ERROR_VARIABLE NO_VALUES GET ${VARIANTS_CONFIG} options ${OPTION_INDEX} values)
+        if(NOT NO_VALUES)
+            message(FATAL_ERROR "Shader variant option ${OPTION_NAME} in ${variants_filename} has explicit values and cannot be part of a variant table")
+        endif()
+        list(APPEND OPTION_NAMES ${OPTION_NAME})
+        list(APPEND OPTION_DEFINES ${OPTION_DEFINE})
+    endforeach()
+    MATH(EXPR MASK_COUNT "1 << ${OPTION_COUNT}")
+    MATH(EXPR LAST_MASK "${MASK_COUNT} - 1")
+
+    # Option mask of every generated variant, derived from its defines
+    string(JSON VARIANT_COUNT LENGTH ${shader_variants} variants)
+    MATH(EXPR LAST_VARIANT_INDEX "${VARIANT_COUNT} - 1")
+    set(VARIANT_INPUTS)
+    set(VARIANT_OUTPUTS)
+    set(VARIANT_MASKS)
+    foreach(VARIANT_INDEX RANGE ${LAST_VARIANT_INDEX})
+        string(JSON VARIANT_INPUT GET ${shader_variants} variants ${VARIANT_INDEX} input)
+        string(JSON VARIANT_OUTPUT GET ${shader_variants} variants ${VARIANT_INDEX} output)
+        string(JSON VARIANT_DEFINES GET ${shader_variants} variants ${VARIANT_INDEX} defines)
+        set(VARIANT_MASK 0)
+        foreach(OPTION_INDEX RANGE ${LAST_OPTION_INDEX})
+            list(GET OPTION_DEFINES ${OPTION_INDEX} OPTION_DEFINE)
+            if("-D${OPTION_DEFINE}" IN_LIST VARIANT_DEFINES)
+                MATH(EXPR VARIANT_MASK "${VARIANT_MASK} | (1 << ${OPTION_INDEX})")
+            endif()
+        endforeach()
+        list(APPEND VARIANT_INPUTS ${VARIANT_INPUT})
+        list(APPEND VARIANT_OUTPUTS ${VARIANT_OUTPUT})
+        list(APPEND VARIANT_MASKS ${VARIANT_MASK})
+    endforeach()
+
+    # For each shader find the variant for every possible mask. Options the shader does not
+    # use are masked out so that any key can be looked up directly.
+    string(JSON SHADER_COUNT LENGTH ${VARIANTS_CONFIG} shaders)
+    MATH(EXPR LAST_SHADER_INDEX "${SHADER_COUNT} - 1")
+    set(MANIFEST "set(TABLE_NAMESPACE ${table_namespace})\n")
+    string(APPEND MANIFEST "set(VARIANTS_FILENAME ${variants_filename})\n")
+    string(APPEND MANIFEST "set(OPTION_NAMES ${OPTION_NAMES})\n")
+    string(APPEND MANIFEST "set(VARIANT_OUTPUTS ${VARIANT_OUTPUTS})\n")
+    set(SHADER_NAMES)
+    foreach(SHADER_INDEX RANGE ${LAST_SHADER_INDEX})
+        string(JSON SHADER_FILENAME GET ${VARIANTS_CONFIG} shaders ${SHADER_INDEX} filename)
+        string(JSON SHADER_OPTION_COUNT LENGTH ${VARIANTS_CONFIG} shaders ${SHADER_INDEX} options)
+        set(USED_MASK 0)
+        if(SHADER_OPTION_COUNT GREATER 0)
+            MATH(EXPR LAST_SHADER_OPTION_INDEX "${SHADER_OPTION_COUNT} - 1")
+            foreach(SHADER_OPTION_INDEX RANGE ${LAST_SHADER_OPTION_INDEX})
+                string(JSON OPTION_INDEX GET ${VARIANTS_CONFIG} shaders ${SHADER_INDEX} options ${SHADER_OPTION_INDEX})
+                MATH(EXPR USED_MASK "${USED_MASK} | (1 << ${OPTION_INDEX})")
+            endforeach()
+        endif()
+
+        set(SHADER_TABLE)
+        foreach(MASK RANGE ${LAST_MASK})
+            MATH(EXPR VARIANT_MASK "${MASK} & ${USED_MASK}")
+            set(FOUND_OUTPUT)
+            foreach(VARIANT_INDEX RANGE ${LAST_VARIANT_INDEX})
+                list(GET VARIANT_INPUTS ${VARIANT_INDEX} VARIANT_INPUT)
+                list(GET VARIANT_MASKS ${VARIANT_INDEX} CANDIDATE_MASK)
+                if(VARIANT_INPUT STREQUAL SHADER_FILENAME AND CANDIDATE_MASK EQUAL VARIANT_MASK)
+                    list(GET VARIANT_OUTPUTS ${VARIANT_INDEX} FOUND_OUTPUT)
+                    break()
+                endif()
+            endforeach()
+            if(NOT FOUND_OUTPUT)
+                message(FATAL_ERROR "No variant of ${SHADER_FILENAME} for option mask ${VARIANT_MASK} in ${variants_filename}")
+            endif()
+            list(APPEND SHADER_TABLE ${FOUND_OUTPUT})
+        endforeach()
+
+        string(MAKE_C_IDENTIFIER ${SHADER_FILENAME} SHADER_NAME)
+        list(APPEND SHADER_NAMES ${SHADER_NAME})
+        string(APPEND MANIFEST "set(SHADER_TABLE_${SHADER_NAME} ${SHADER_TABLE})\n")
+    endforeach()
+    string(APPEND MANIFEST "set(SHADER_NAMES ${SHADER_NAMES})\n")
+
+    set(MANIFEST_FILENAME ${CMAKE_CURRENT_BINARY_DIR}/${table_namespace}_manifest.cmake)
+    file(WRITE ${MANIFEST_FILENAME} "${MANIFEST}")
+
+    set(SPIRV_FILES)
+    foreach(VARIANT_OUTPUT ${VARIANT_OUTPUTS})
+        list(APPEND SPIRV_FILES ${CMAKE_CURRENT_BINARY_DIR}/${VARIANT_OUTPUT})
+    endforeach()
+
+    set(TABLE_INCLUDE_DIR ${CMAKE_CURRENT_BINARY_DIR}/variant_tables)
+    set(TABLE_HEADER ${TABLE_INCLUDE_DIR}/${table_namespace}.h)
+    add_custom_command(
+        OUTPUT ${TABLE_HEADER}
+        COMMENT "Generating shader variant table ${table_namespace}.h"
+        COMMAND ${CMAKE_COMMAND}
+            -DMANIFEST_FILENAME=${MANIFEST_FILENAME}
+            -DSPIRV_DIR=${CMAKE_CURRENT_BINARY_DIR}
+            -DOUTPUT_FILENAME=${TABLE_HEADER}
+            -P ${CMAKE_SOURCE_DIR}/cmake/GenerateShaderVariantTable.cmake
+        DEPENDS ${SPIRV_FILES} ${MANIFEST_FILENAME} ${CMAKE_SOURCE_DIR}/cmake/GenerateShaderVariantTable.cmake
+    )
+    add_custom_target(${target}VariantTableHeader DEPENDS ${TABLE_HEADER})
+    foreach(VARIANT_OUTPUT ${VARIANT_OUTPUTS})
+        add_dependencies(${target}VariantTableHeader ${target}_${VARIANT_OUTPUT})
+    endforeach()
+
+    add_library(${target}VariantTable INTERFACE)
+    target_include_directories(${target}VariantTable INTERFACE ${TABLE_INCLUDE_DIR})
+    add_dependencies(${target}VariantTable ${target}VariantTableHeader)
 endfunction()
@@ -0,0 +1,43 @@
+# This file is part of KDGpu Examples.
+#
+# SPDX-FileCopyrightText: 2023 Klarälvdalens Datakonsult AB, a KDAB Group company <info@kdab.com>
+#
+# SPDX-License-Identifier: MIT
+#
+# Contact KDAB at <info@kdab.com> for commercial licensing options.
+#
+# Script mode helper for AddEmbeddedShaderLibrary(). Writes a source file holding the gzip
+# compressed contents of INPUT_FILENAME as the array SYMBOL.
+#
+# Usage: cmake -DINPUT_FILENAME=<spv> -DOUTPUT_FILENAME=<cpp> -DSYMBOL=<name> -P EmbedShaderFile.cmake
+#
+get_filename_component(INPUT_NAME ${INPUT_FILENAME} NAME)
+set(COMPRESSED_FILENAME ${OUTPUT_FILENAME}.gz)
+file(ARCHIVE_CREATE
+    OUTPUT ${COMPRESSED_FILENAME}
+    PATHS ${INPUT_FILENAME}
+    FORMAT raw
+    COMPRESSION GZip
+    COMPRESSION_LEVEL 9
+)
+
+file(READ ${COMPRESSED_FILENAME} COMPRESSED_HEX HEX)
+file(REMOVE ${COMPRESSED_FILENAME})
+string(LENGTH "${COMPRESSED_HEX}" COMPRESSED_HEX_LENGTH)
+MATH(EXPR COMPRESSED_SIZE "${COMPRESSED_HEX_LENGTH} / 2")
+string(REGEX REPLACE "(..)" "0x\\1, " COMPRESSED_BYTES "${COMPRESSED_HEX}")
+string(REGEX REPLACE "((0x.., ){16})" "\\1\n    " COMPRESSED_BYTES "${COMPRESSED_BYTES}")
+string(STRIP "${COMPRESSED_BYTES}" COMPRESSED_BYTES)
+
+file(WRITE ${OUTPUT_FILENAME}.tmp
+    "// Generated from ${INPUT_NAME} by EmbedShaderFile.cmake. Do not edit.\n\n"
+    "#include <cstddef>\n#include <cstdint>\n\n"
+    "namespace kdgpu_ext::graphics::shader::embedded {\n\n"
+    "extern const uint8_t ${SYMBOL}[];\n"
+    "extern const size_t ${SYMBOL}_size;\n\n"
+    "const uint8_t ${SYMBOL}[] = {\n    ${COMPRESSED_BYTES}\n};\n"
+    "const size_t ${SYMBOL}_size = ${COMPRESSED_SIZE};\n\n"
+    "} // namespace kdgpu_ext::graphics::shader::embedded\n"
+)
+configure_file(${OUTPUT_FILENAME}.tmp ${OUTPUT_FILENAME} COPYONLY)
+file(REMOVE ${OUTPUT_FILENAME}.tmp)
@@ -0,0 +1,123 @@
+# This file is part of KDGpu Examples.
+#
+# SPDX-FileCopyrightText: 2023 Klarälvdalens Datakonsult AB, a KDAB Group company <info@kdab.com>
+#
+# SPDX-License-Identifier: MIT
+#
+# Contact KDAB at <info@kdab.com> for commercial licensing options.
+#
+# Embedding of compiled shaders into the kdgpu_example_shaders shared library. Embedded
+# shaders are gzip compressed at build time and looked up at runtime with
+# kdgpu_ext::graphics::shader::embeddedShader() by their path relative to the asset directory
+# (e.g. "shaders/compute_n_body/particle_calculate.comp.spv").
+
+option(KDGPU_EXAMPLES_EMBED_SHADERS "Embed compiled shaders into the binaries instead of loading them from the asset directory" ON)
+
+# ARCHIVE_CREATE with a compression level needs CMake 3.19
+if(KDGPU_EXAMPLES_EMBED_SHADERS AND CMAKE_VERSION VERSION_LESS 3.19)
+    message(WARNING "Embedding shaders requires CMake 3.19 or newer. Shaders will be loaded from the asset directory.")
+    set(KDGPU_EXAMPLES_EMBED_SHADERS OFF)
+endif()
+
+# Registers the SPIR-V file produced by target for embedding. It is looked up by its path
+# relative to ${CMAKE_BINARY_DIR}/assets, or by the optional third argument for shaders
+# built outside of the asset directory.
+function(EmbedShader target spirv_filename)
+    if(NOT KDGPU_EXAMPLES_EMBED_SHADERS)
+        return()
+    endif()
+
+    if(ARGC GREATER 2)
+        set(SHADER_PATH ${ARGV2})
+    else()
+        file(RELATIVE_PATH SHADER_PATH ${CMAKE_BINARY_DIR}/assets ${spirv_filename})
+    endif()
+
+    set_property(GLOBAL APPEND PROPERTY KDGPU_EMBEDDED_SHADER_FILES ${spirv_filename})
+    set_property(GLOBAL APPEND PROPERTY KDGPU_EMBEDDED_SHADER_PATHS ${SHADER_PATH})
+    set_property(GLOBAL APPEND PROPERTY KDGPU_EMBEDDED_SHADER_TARGETS ${target})
+endfunction()
+
+# Registers the vertex and fragment shader compiled by KDGpu_CompileShaderSet(target name)
+# in the current binary directory
+function(EmbedShaderSet target name)
+    EmbedShader(${target}Shaders ${CMAKE_CURRENT_BINARY_DIR}/${name}.vert.spv)
+    EmbedShader(${target}Shaders ${CMAKE_CURRENT_BINARY_DIR}/${name}.frag.spv)
+endfunction()
+
+# Creates the shared library holding all shaders registered with EmbedShader(). Has to be
+# called after all shaders have been registered.
+function(AddEmbeddedShaderLibrary name)
+    get_property(SHADER_FILES GLOBAL PROPERTY KDGPU_EMBEDDED_SHADER_FILES)
+    get_property(SHADER_PATHS GLOBAL PROPERTY KDGPU_EMBEDDED_SHADER_PATHS)
+    get_property(SHADER_TARGETS GLOBAL PROPERTY KDGPU_EMBEDDED_SHADER_TARGETS)
+
+    set(GENERATED_DIR ${CMAKE_CURRENT_BINARY_DIR}/${name})
+    set(SOURCES)
+    set(SHADER_DECLARATIONS "")
+    set(SHADER_ENTRIES "")
+    list(LENGTH SHADER_FILES SHADER_COUNT)
+    set(SHADER_INDEX 0)
+    foreach(SHADER_FILE ${SHADER_FILES})
+        list(GET SHADER_PATHS ${SHADER_INDEX} SHADER_PATH)
+        math(EXPR SHADER_INDEX "${SHADER_INDEX} + 1")
+        string(MAKE_C_IDENTIFIER ${SHADER_PATH} SHADER_SYMBOL)
+        set(SHADER_SOURCE ${GENERATED_DIR}/${SHADER_SYMBOL}.cpp)
+
+        add_custom_command(
+            OUTPUT ${SHADER_SOURCE}
+            COMMENT "Embedding shader ${SHADER_PATH}"
+            COMMAND ${CMAKE_COMMAND}
+                -DINPUT_FILENAME=${SHADER_FILE}
+                -DOUTPUT_FILENAME=${SHADER_SOURCE}
+                -DSYMBOL=${SHADER_SYMBOL}
+                -P ${CMAKE_SOURCE_DIR}/cmake/EmbedShaderFile.cmake
+            DEPENDS ${SHADER_FILE} ${CMAKE_SOURCE_DIR}/cmake/EmbedShaderFile.cmake
+        )
+        list(APPEND SOURCES ${SHADER_SOURCE})
+
+        string(APPEND SHADER_DECLARATIONS "extern const uint8_t ${SHADER_SYMBOL}[];\nextern const size_t ${SHADER_SYMBOL}_size;\n")
+        string(APPEND SHADER_ENTRIES "    EmbeddedShaderData{ \"${SHADER_PATH}\", ${SHADER_SYMBOL}, ${SHADER_SYMBOL}_size },\n")
+    endforeach()
+
+    # The table of all embedded shaders, the only symbol exported by the library
+    set(TABLE_SOURCE ${GENERATED_DIR}/embedded_shader_table.cpp)
+    string(TOUPPER ${name}_EXPORT EXPORT_MACRO)
+    file(WRITE ${TABLE_SOURCE}.tmp
+        "// Generated by EmbedShaders.cmake. Do not edit.\n\n"
+        "#include <${name}_export.h>\n"
+        "#define KDGPU_EMBEDDED_SHADER_TABLE_EXPORT ${EXPORT_MACRO}\n"
+        "#include <shader/embedded_shaders.h>\n\n"
+        "#include <array>\n#include <cstdint>\n\n"
+        "namespace kdgpu_ext::graphics::shader {\n\n"
+        "namespace embedded {\n${SHADER_DECLARATIONS}} // namespace embedded\n\n"
+        "namespace {\nusing namespace embedded;\n"
+        "const std::array<EmbeddedShaderData, ${SHADER_COUNT}> shaders = {\n${SHADER_ENTRIES}};\n"
+        "} // namespace\n\n"
+        "std::span<const EmbeddedShaderData> embeddedShaderTable()\n{\n    return shaders;\n}\n\n"
+        "} // namespace kdgpu_ext::graphics::shader\n"
+    )
+    configure_file(${TABLE_SOURCE}.tmp ${TABLE_SOURCE} COPYONLY)
+    file(REMOVE ${TABLE_SOURCE}.tmp)
+
+    add_library(${name} SHARED ${TABLE_SOURCE} ${SOURCES})
+    if(SHADER_TARGETS)
+        list(REMOVE_DUPLICATES SHADER_TARGETS)
+        add_dependencies(${name} ${SHADER_TARGETS})
+    endif()
+
+    # Only the declarations in embedded_shaders.h are needed, not the whole graphics library
+    target_include_directories(
+        ${name}
+        PRIVATE ${CMAKE_SOURCE_DIR}/lib/kdgpu_ext/KDGpuGraphics/src ${CMAKE_CURRENT_BINARY_DIR}
+    )
+    target_compile_features(${name} PUBLIC cxx_std_20)
+    set_target_properties(
+        ${name}
+        PROPERTIES CXX_VISIBILITY_PRESET hidden
+                   VISIBILITY_INLINES_HIDDEN 1
+    )
+
+    include(GenerateExportHeader)
+    generate_export_header(${name} BASE_NAME ${name})
+endfunction()
@@ -0,0 +1,71 @@
+# This file is part of KDGpu Examples.
+#
+# SPDX-FileCopyrightText: 2023 Klarälvdalens Datakonsult AB, a KDAB Group company <info@kdab.com>
+#
+# SPDX-License-Identifier: MIT
+#
+# Contact KDAB at <info@kdab.com> for commercial licensing options.
+#
+# Script mode helper for CompileShaderVariants(... TABLE_NAMESPACE ...). Embeds the compiled
+# SPIR-V variants listed in MANIFEST_FILENAME into a header of constexpr lookup tables.
+#
+# Usage: cmake -DMANIFEST_FILENAME=<manifest> -DSPIRV_DIR=<dir> -DOUTPUT_FILENAME=<header> -P GenerateShaderVariantTable.cmake
+#
+include(${MANIFEST_FILENAME})
+
+list(LENGTH OPTION_NAMES OPTION_COUNT)
+
+set(HEADER "// Generated from ${VARIANTS_FILENAME} by GenerateShaderVariantTable.cmake. Do not edit.\n\n")
+string(APPEND HEADER "#pragma once\n\n#include <array>\n#include <cstdint>\n#include <span>\n\n")
+string(APPEND HEADER "namespace ${TABLE_NAMESPACE} {\n\n")
+string(APPEND HEADER "inline constexpr uint32_t optionCount = ${OPTION_COUNT};\n\n")
+
+# One bit per option, named as in the variants file
+string(APPEND HEADER "namespace options {\n")
+set(OPTION_INDEX 0)
+foreach(OPTION_NAME ${OPTION_NAMES})
+    string(APPEND HEADER "inline constexpr uint32_t ${OPTION_NAME} = 1u << ${OPTION_INDEX};\n")
+    MATH(EXPR OPTION_INDEX "${OPTION_INDEX} + 1")
+endforeach()
+string(APPEND HEADER "} // namespace options\n\n")
+
+# SPIR-V is a stream of 32 bit little endian words
+string(APPEND HEADER "namespace spirv {\n")
+foreach(VARIANT_OUTPUT ${VARIANT_OUTPUTS})
+    file(READ ${SPIRV_DIR}/${VARIANT_OUTPUT} SPIRV_HEX HEX)
+    string(LENGTH "${SPIRV_HEX}" SPIRV_HEX_LENGTH)
+    MATH(EXPR SPIRV_REMAINDER "${SPIRV_HEX_LENGTH} % 8")
+    if(SPIRV_HEX_LENGTH EQUAL 0 OR NOT SPIRV_REMAINDER EQUAL 0)
+        message(FATAL_ERROR "${VARIANT_OUTPUT} is not a valid SPIR-V module")
+    endif()
+    string(REGEX REPLACE "(..)(..)(..)(..)" "0x\\4\\3\\2\\1, " SPIRV_WORDS "${SPIRV_HEX}")
+    string(REGEX REPLACE "((0x........, ){8})" "\\1\n    " SPIRV_WORDS "${SPIRV_WORDS}")
+    string(STRIP "${SPIRV_WORDS}" SPIRV_WORDS)
+
+    string(MAKE_C_IDENTIFIER ${VARIANT_OUTPUT} VARIANT_NAME)
+    string(APPEND HEADER "inline constexpr uint32_t ${VARIANT_NAME}[] = {\n    ${SPIRV_WORDS}\n};\n")
+endforeach()
+string(APPEND HEADER "} // namespace spirv\n\n")
+
+string(APPEND HEADER "// All variants of one shader indexed by a mask of the above options. Options the\n")
+string(APPEND HEADER "// shader does not use are ignored.\n")
+string(APPEND HEADER "struct ShaderVariantTable {\n")
+string(APPEND HEADER "    std::array<std::span<const uint32_t>, 1u << optionCount> variants;\n\n")
+string(APPEND HEADER "    constexpr std::span<const uint32_t> operator[](uint32_t optionMask) const { return variants[optionMask]; }\n")
+string(APPEND HEADER "};\n\n")
+
+foreach(SHADER_NAME ${SHADER_NAMES})
+    string(APPEND HEADER "inline constexpr ShaderVariantTable ${SHADER_NAME} = { {\n")
+    foreach(VARIANT_OUTPUT ${SHADER_TABLE_${SHADER_NAME}})
+        string(MAKE_C_IDENTIFIER ${VARIANT_OUTPUT} VARIANT_NAME)
+        string(APPEND HEADER "    spirv::${VARIANT_NAME},\n")
+    endforeach()
+    string(APPEND HEADER "} };\n\n")
+endforeach()
+
+string(APPEND HEADER "} // namespace ${TABLE_NAMESPACE}\n")
+
+# Only touch the header if it changed to avoid needless rebuilds
+file(WRITE ${OUTPUT_FILENAME}.tmp "${HEADER}")
+configure_file(${OUTPUT_FILENAME}.tmp ${OUTPUT_FILENAME} COPYONLY)
+file(REMOVE ${OUTPUT_FILENAME}.tmp)
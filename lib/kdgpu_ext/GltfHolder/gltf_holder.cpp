@@ -3,16 +3,32 @@
 #include <GltfHolder/gltf_holder_global.h>
 
 #include <tinygltf_helper/tinygltf_helper.h>
+#include <tinygltf_helper/vertex_layout_analyzer.h>
 #include <KDGpu/device.h>
 
 #include <GltfHolder/buffer_view_helper/buffer_view_helper.h>
 
 #include <GltfHolder/render_permutation/gltf_render_permutation.h>
 
+#include <KDGpu/buffer_options.h>
 #include <KDGpu/graphics_pipeline_options.h>
 #include <glm/gtc/type_ptr.hpp>
 #include <global_resources.h>
 
+#include <texture/mip_generation.h>
+#include <texture/texture_array_packer.h>
+#include <threading/thread_pool.h>
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <iterator>
+#include <optional>
+
 using namespace KDGpu;
 namespace kdgpu_ext::gltf_holder {
 
@@ -64,6 +80,9 @@ void GltfHolder::load(const std::string &filename, KDGpu::Queue& queue)
         }
     }
 
+    // Simplify the triangle meshes to get cheaper versions for distant nodes
+    generateLods();
+
     // Find every node with a mesh and create a bind group containing the node's transform.
     uint32_t nodeIndex = 0;
     for (const auto &node : m_model.nodes) {
@@ -83,19 +102,241 @@ void GltfHolder::load(const std::string &filename, KDGpu::Queue& queue)
     calculateWorldTransforms();
 
     // Load textures
-    m_textures.reserve(m_model.images.size());
-    for (auto& image : m_model.images) {
+    if (!m_textureUploader.isInitialized())
+        m_textureUploader.initialize(graphics::GlobalResources::instance().graphicsDevice(), queue);
+    loadTextures(filename);
+
+    // Note the textures of each material, the streamed levels are picked per material
+    m_materialTextures.clear();
+    for (const auto &material : m_model.materials) {
+        std::vector<uint32_t> textures;
+        for (const int textureIndex : { material.pbrMetallicRoughness.baseColorTexture.index,
+                                        material.pbrMetallicRoughness.metallicRoughnessTexture.index,
+                                        material.normalTexture.index,
+                                        material.occlusionTexture.index,
+                                        material.emissiveTexture.index }) {
+            if (textureIndex == -1)
+                continue;
+            if (const auto imageIndex = TinyGltfHelper::imageIndexForTexture(m_model, textureIndex))
+                textures.push_back(m_texturePlacements.at(*imageIndex).textureIndex);
+        }
+        m_materialTextures.push_back(std::move(textures));
+    }
+
+    if (m_textureStreamingOptions.enabled)
+        m_textureStreamer.initialize(m_textureStreamingOptions, m_textures);
+
+    // The vertex buffers and LOD indices are written through mappings and the streamed
+    // textures keep their own levels, so only the texture uploads are waited for
+    if (m_trimAfterUpload)
+        m_trimUploadValue = m_textureUploader.submittedValue();
+}
+
+void GltfHolder::loadTextures(const std::string &filename)
+{
+    using namespace graphics::texture;
+
+    // KTX2 images (KHR_texture_basisu) are always transcoded, to the best format of the
+    // device unless a target has been set
+    const BlockCompression target = m_textureCompression.target;
+    const BlockCompression ktx2Target = target != BlockCompression::None
+            ? target
+            : selectBlockCompression(graphics::GlobalResources::instance().graphicsDevice());
+    const bool encodeAtImport = m_textureCompression.encodeAtImport;
+    const bool streaming = m_textureStreamingOptions.enabled;
+
+    // Transcode (and read or encode) the compressed images and build the mip chains of the
+    // others on worker threads, and upload them on this one in image order
+    auto &threadPool = graphics::threading::ThreadPool::instance();
+    std::vector<std::future<std::optional<CompressedImage>>> compressedImages(m_model.images.size());
+    for (size_t imageIndex = 0; imageIndex < m_model.images.size(); ++imageIndex) {
+        const auto &image = m_model.images[imageIndex];
+        if (TinyGltfHelper::isKtx2Image(image)) {
+            compressedImages[imageIndex] = threadPool.submit([&image, ktx2Target] {
+                return transcodeBasisKtx2(image.image.data(), image.image.size(), ktx2Target);
+            });
+        } else if (target != BlockCompression::None) {
+            const std::string bakedPath = bakedImagePath(filename, m_model, imageIndex);
+            compressedImages[imageIndex] = threadPool.submit([&image, bakedPath, target, encodeAtImport]() -> std::optional<CompressedImage> {
+                // prefer the baked file, encoding is far slower than transcoding
+                std::vector<uint8_t> basisKtx2;
+                std::ifstream bakedFile(bakedPath, std::ios::binary);
+                if (bakedFile) {
+                    basisKtx2.assign(std::istreambuf_iterator<char>(bakedFile), std::istreambuf_iterator<char>());
+                } else if (encodeAtImport && image.component == 4 && image.bits == 8) {
+                    // the images are already encoded in parallel
+                    basisKtx2 = encodeBasisKtx2(image.image.data(), image.width, image.height, { .threadCount = 1 });
+                }
+                if (basisKtx2.empty())
+                    return std::nullopt;
+                return transcodeBasisKtx2(basisKtx2.data(), basisKtx2.size(), target);
+            });
+        }
+        if (!compressedImages[imageIndex].valid() && image.component == 4 && image.bits == 8) {
+            compressedImages[imageIndex] = threadPool.submit([&image]() -> std::optional<CompressedImage> {
+                const uint32_t width = static_cast<uint32_t>(image.width);
+                const uint32_t height = static_cast<uint32_t>(image.height);
+                MipChain mipChain = generateMipChain(image.image.data(), width, height, 4, mipLevelCount(width, height));
+                return CompressedImage{ .format = Format::R8G8B8A8_UNORM,
+                                        .extent = { .width = width, .height = height, .depth = 1 },
+                                        .mipLevels = static_cast<uint32_t>(mipChain.regions.size()),
+                                        .data = std::move(mipChain.data),
+                                        .regions = std::move(mipChain.regions) };
+            });
+        }
+    }
+
+    std::vector<std::optional<CompressedImage>> images(m_model.images.size());
+    for (size_t imageIndex = 0; imageIndex < m_model.images.size(); ++imageIndex) {
+        if (compressedImages[imageIndex].valid())
+            images[imageIndex] = compressedImages[imageIndex].get();
+    }
+
+    // Pack the small images into arrays, whose textures follow those of the images
+    TextureArrayPack pack;
+    pack.placements.resize(images.size());
+    if (m_texturePacking.enabled) {
+        std::vector<const CompressedImage *> packableImages(images.size(), nullptr);
+        for (size_t imageIndex = 0; imageIndex < images.size(); ++imageIndex) {
+            if (images[imageIndex])
+                packableImages[imageIndex] = &*images[imageIndex];
+        }
+        // The shaders repeat packed images inside their UV rectangle, whatever the sampler says
+        for (size_t textureIndex = 0; textureIndex < m_model.textures.size(); ++textureIndex) {
+            const auto imageIndex = TinyGltfHelper::imageIndexForTexture(m_model, static_cast<int>(textureIndex));
+            const SamplerOptions samplerOptions = TinyGltfHelper::samplerOptionsForTexture(m_model, static_cast<int>(textureIndex));
+            if (imageIndex && (samplerOptions.u != AddressMode::Repeat || samplerOptions.v != AddressMode::Repeat))
+                packableImages[*imageIndex] = nullptr;
+        }
+        pack = packTextureArrays(packableImages, { .maxSize = m_texturePacking.maxSize,
+                                                   .minImagesPerArray = m_texturePacking.minImagesPerArray });
+    }
+
+    size_t compressedCount = 0;
+    size_t packedCount = 0;
+    m_textures.reserve(m_model.images.size() + pack.arrays.size());
+    m_texturePlacements.assign(m_model.images.size(), {});
+    for (size_t imageIndex = 0; imageIndex < m_model.images.size(); ++imageIndex) {
+        const auto &image = m_model.images[imageIndex];
+        std::optional<CompressedImage> &compressedImage = images[imageIndex];
         GltfTexture texture;
-        texture.initialize(image, queue);
+        texture.setArrayView(m_texturePacking.enabled);
+        m_texturePlacements[imageIndex].textureIndex = static_cast<uint32_t>(imageIndex);
+
+        if (compressedImage && compressedImage->format != Format::R8G8B8A8_UNORM)
+            ++compressedCount;
+
+        if (const auto &placement = pack.placements[imageIndex]) {
+            // the image's own texture stays empty to keep the indices intact
+            m_texturePlacements[imageIndex] = { .textureIndex = static_cast<uint32_t>(m_model.images.size() + placement->arrayIndex),
+                                                .layer = placement->layer,
+                                                .uvRect = placement->uvRect };
+            ++packedCount;
+        } else if (compressedImage) {
+            if (streaming) {
+                const uint32_t tailLevel = texture_streaming::mipTailLevel(*compressedImage, m_textureStreamingOptions.mipTailSize);
+                texture.initializeStreamed(std::move(*compressedImage), tailLevel, m_textureUploader);
+            } else {
+                texture.initializeCompressed(*compressedImage, m_textureUploader);
+            }
+        } else if (!TinyGltfHelper::isKtx2Image(image)) {
+            texture.initialize(image, m_textureUploader);
+        } else {
+            // keep the indices intact with a white placeholder
+            spdlog::error("Failed to transcode KTX2 image {} of {}", imageIndex, filename);
+            tinygltf::Image placeholder;
+            placeholder.width = 1;
+            placeholder.height = 1;
+            placeholder.component = 4;
+            placeholder.bits = 8;
+            placeholder.image = { 255, 255, 255, 255 };
+            texture.initialize(placeholder, m_textureUploader);
+        }
         m_textures.push_back(std::move(texture));
     }
+
+    // the arrays are small, they are never streamed
+    for (const CompressedImage &array : pack.arrays) {
+        GltfTexture texture;
+        texture.setArrayView(true);
+        texture.initializeCompressed(array, m_textureUploader);
+        m_textures.push_back(std::move(texture));
+    }
+
+    // one submission for all images, unless they did not fit the staging ring together
+    m_textureUploader.flush();
+
+    if (compressedCount != 0)
+        spdlog::info("{} of {} images of {} uploaded block compressed", compressedCount, m_model.images.size(), filename);
+    if (packedCount != 0)
+        spdlog::info("{} small images of {} packed into {} texture arrays", packedCount, filename, pack.arrays.size());
+    spdlog::info("{} images of {} uploaded in {} batches", m_model.images.size(), filename, m_textureUploader.stats().batchCount);
+}
+
+std::string GltfHolder::bakedImagePath(const std::string &gltfFilename, const tinygltf::Model &model, size_t imageIndex)
+{
+    const std::filesystem::path gltfPath(gltfFilename);
+    const std::string &uri = model.images.at(imageIndex).uri;
+    if (!uri.empty() && uri.rfind("data:", 0) != 0)
+        return (gltfPath.parent_path() / (uri + ".ktx2")).string();
+    return (gltfPath.parent_path() / (gltfPath.stem().string() + "_image" + std::to_string(imageIndex) + ".ktx2")).string();
+}
+
+void GltfHolder::trimModelPayloads()
+{
+    size_t trimmedBytes = 0;
+    for (auto &buffer : m_model.buffers) {
+        trimmedBytes += buffer.data.capacity();
+        std::vector<unsigned char>().swap(buffer.data);
+    }
+    for (auto &image : m_model.images) {
+        trimmedBytes += image.image.capacity();
+        std::vector<unsigned char>().swap(image.image);
+    }
+    spdlog::info("Released {} MiB of glTF buffers and images after upload", trimmedBytes >> 20);
+}
+
+void GltfHolder::generateLods()
+{
+    std::vector<uint32_t> lodIndices;
+    m_meshLods.clear();
+    m_meshLods.reserve(m_model.meshes.size());
+    for (const auto &mesh : m_model.meshes) {
+        std::vector<mesh_lod::PrimitiveLods> primitiveLods;
+        primitiveLods.reserve(mesh.primitives.size());
+        for (const auto &primitive : mesh.primitives)
+            primitiveLods.push_back(mesh_lod::generatePrimitiveLods(m_model, primitive, lodIndices));
+        m_meshLods.push_back(std::move(primitiveLods));
+    }
+
+    if (lodIndices.empty())
+        return;
+
+    // All levels share a single index buffer
+    const KDGpu::BufferOptions bufferOptions = {
+        .size = lodIndices.size() * sizeof(uint32_t),
+        .usage = KDGpu::BufferUsageFlagBits::IndexBufferBit,
+        .memoryUsage = KDGpu::MemoryUsage::CpuToGpu // So we can map it to CPU address space
+    };
+    m_lodIndexBuffer = kdgpu_ext::graphics::GlobalResources::instance().graphicsDevice().createBuffer(bufferOptions);
+    auto bufferData = m_lodIndexBuffer.map();
+    std::memcpy(bufferData, lodIndices.data(), lodIndices.size() * sizeof(uint32_t));
+    m_lodIndexBuffer.unmap();
 }
 
 void GltfHolder::deinitialize()
 {
     m_nodeRenderTasks.clear();
     m_buffers.clear();
+    m_meshLods.clear();
+    m_lodIndexBuffer = {};
+    m_trimUploadValue.reset();
+    m_textureStreamer.deinitialize();
+    m_textureUploader.deinitialize();
+    m_materialTextures.clear();
     m_textures.clear();
+    m_texturePlacements.clear();
+    m_retiredResources.clear();
 }
 
 void GltfHolder::setNodeTransformShaderBinding(size_t nodeTransformUniformBinding)
@@ -112,20 +353,36 @@ void GltfHolder::createGraphicsRenderingPipelinesForMeshSet(
         // shader info
         std::vector<ShaderStage> &shaderStages,
         const GltfShaderVertexInput& shaderVertexInput,
-        PipelineLayout &pipelineLayout)
+        PipelineLayout &pipelineLayout,
+        GraphicsPipelineCache &pipelineCache)
 {
-    // Loop through each primitive of each mesh and create pipelines
+    // Map the glTF attributes to the shader vertex input locations, attributes the shader
+    // does not consume are left out of the vertex layouts
+    std::unordered_map<std::string, uint32_t> shaderLocations;
+    if (shaderVertexInput.positionLocation.has_value())
+        shaderLocations.insert({ "POSITION", shaderVertexInput.positionLocation.value() });
+    if (shaderVertexInput.normalLocation.has_value())
+        shaderLocations.insert({ "NORMAL", shaderVertexInput.normalLocation.value() });
+    if (shaderVertexInput.textureCoord0Location.has_value())
+        shaderLocations.insert({ "TEXCOORD_0", shaderVertexInput.textureCoord0Location.value() });
+    if (shaderVertexInput.tangentLocation.has_value())
+        shaderLocations.insert({ "TANGENT", shaderVertexInput.tangentLocation.value() });
+    TinyGltfHelper::VertexLayoutAnalyzer vertexLayouts(m_model, std::move(shaderLocations));
+
+    // Loop through each primitive of each mesh and look up or create their pipelines
     uint32_t index = 0;
-    for (const auto &mesh : m_model.meshes) {
+    for (size_t meshIndex = 0; meshIndex < m_model.meshes.size(); ++meshIndex) {
+        const auto &mesh = m_model.meshes[meshIndex];
         MeshPrimitives meshPrimitives;
-        for (const auto &primitive : mesh.primitives) {
+        for (size_t primitiveIndex = 0; primitiveIndex < mesh.primitives.size(); ++primitiveIndex) {
             auto primitive_data = setupPrimitive(
                     shaderStages,
-                    shaderVertexInput,
-                    renderMeshSet.graphicsPipelines,
+                    vertexLayouts,
+                    pipelineCache,
                     pipelineLayout,
                     renderTarget,
-                    primitive);
+                    mesh.primitives[primitiveIndex],
+                    m_meshLods.at(meshIndex).at(primitiveIndex));
             renderMeshSet.primitiveData.push_back(primitive_data);
             meshPrimitives.primitiveIndices.push_back(index++);
         }
@@ -135,16 +392,84 @@ void GltfHolder::createGraphicsRenderingPipelinesForMeshSet(
 
 void GltfHolder::update()
 {
+    m_retiredResources.nextFrame();
+    m_textureUploader.update();
+
+    if (m_trimUploadValue.has_value() && m_textureUploader.isComplete(m_trimUploadValue.value())) {
+        trimModelPayloads();
+        m_trimUploadValue.reset();
+    }
+
     for (auto& texture: m_textures)
-        texture.update();
+        texture.update(m_textureUploader, m_retiredResources);
+
+    if (m_textureStreamingOptions.enabled) {
+        requestStreamedLevels();
+        m_textureStreamer.update(m_textureUploader);
+    }
+
+    // submit the uploads of this frame together
+    m_textureUploader.flush();
+}
+
+void GltfHolder::requestStreamedLevels()
+{
+    m_textureStreamer.beginFrame();
+
+    // nothing is known about the view before the first setLodView()
+    if (m_lodSelection.pixelsPerUnitAtUnitDistance <= 0.0f)
+        return;
+
+    for (const auto &renderTask : m_nodeRenderTasks) {
+        const glm::mat4 &worldMatrix = renderTask.transformUniformBufferObject.data.nodeTransformMatrix;
+        const float worldScale = std::max({ glm::length(glm::vec3(worldMatrix[0])),
+                                            glm::length(glm::vec3(worldMatrix[1])),
+                                            glm::length(glm::vec3(worldMatrix[2])) });
+
+        const auto &mesh = m_model.meshes.at(renderTask.meshIndex);
+        for (size_t primitiveIndex = 0; primitiveIndex < mesh.primitives.size(); ++primitiveIndex) {
+            const int materialIndex = mesh.primitives[primitiveIndex].material;
+            if (materialIndex == -1 || m_materialTextures.at(materialIndex).empty())
+                continue;
+
+            const auto &primitiveLods = m_meshLods.at(renderTask.meshIndex).at(primitiveIndex);
+            const glm::vec3 viewCenter = glm::vec3(m_lodSelection.viewMatrix * worldMatrix * glm::vec4(primitiveLods.boundingSphere.center, 1.0f));
+            const float radius = primitiveLods.boundingSphere.radius * worldScale;
+
+            // primitives behind the camera are not requested, the camera looks down -z
+            if (viewCenter.z > radius)
+                continue;
+
+            // screen pixels per unit of texture coordinates at the closest point of the bounds.
+            // Without float texture coordinates assume they span the bounds once.
+            const float distance = std::max(glm::length(viewCenter) - radius, 1.0e-3f);
+            const float pixelsPerUnit = m_lodSelection.pixelsPerUnitAtUnitDistance * worldScale / distance;
+            const float texcoordDensity = primitiveLods.texcoordDensity > 0.0f
+                    ? primitiveLods.texcoordDensity
+                    : 1.0f / std::max(2.0f * primitiveLods.boundingSphere.radius, 1.0e-6f);
+            const float pixelsPerTexcoord = pixelsPerUnit / texcoordDensity;
+
+            for (const uint32_t textureIndex : m_materialTextures[materialIndex])
+                m_textureStreamer.request(textureIndex, pixelsPerTexcoord);
+        }
+    }
+}
+
+void GltfHolder::setLodView(const glm::mat4 &viewMatrix, const glm::mat4 &projectionMatrix, float viewportHeight)
+{
+    m_lodSelection.viewMatrix = viewMatrix;
+    m_lodSelection.pixelsPerUnitAtUnitDistance = 0.5f * std::abs(projectionMatrix[1][1]) * viewportHeight;
 }
 
 void GltfHolder::renderAllNodes(
-    RenderPassCommandRecorder &renderPassCommandRecorder,
+    graphics::command::StateFilteringRenderPassRecorder &renderPassCommandRecorder,
     GltfRenderPermutation& renderPermutation,
-    const PipelineLayout& pipelineLayout)
+    const PipelineLayout& pipelineLayout,
+    GltfLodStats& lodStats)
 {
     for (const auto &render_task : m_nodeRenderTasks) {
+        const glm::mat4 &worldMatrix = render_task.transformUniformBufferObject.data.nodeTransformMatrix;
+
         // Set the bind group for the world transform of this node
         // The group index (descriptor set index) comes from the render permutation
         renderPassCommandRecorder.setBindGroup(renderPermutation.nodeTransformUniformSet, render_task.transformUniformBufferObject.bindGroup(), pipelineLayout);
@@ -161,6 +486,9 @@ void GltfHolder::renderAllNodes(
                     // the mesh dictates what material to use
                     if (primitiveData.materialIndex.has_value()) {
                         auto &material = renderPermutation.materials.materialByIndex(primitiveData.materialIndex.value());
+                        // streamed textures replace their view when levels come and go
+                        if (material.isOutdated())
+                            material.recreateBindGroup(m_retiredResources);
                         auto &pass_material_bind_group = material.bindGroup();
                         if (material.areAllTexturesValidForUse())
                             renderPassCommandRecorder.setBindGroup(shading_material.bindGroup, pass_material_bind_group, pipelineLayout);
@@ -171,6 +499,16 @@ void GltfHolder::renderAllNodes(
             // Set the pipeline for this primitive
             renderPassCommandRecorder.setPipeline(primitiveData.pipeline);
 
+            // Push the layers and rectangles of the material's images in packed textures,
+            // after the pipeline whose layout they are pushed with
+            if (renderPermutation.materials.has_shader_material() && primitiveData.materialIndex.has_value()) {
+                const auto &shading_material = renderPermutation.materials.get_shader_material();
+                if (shading_material.texturePlacementPushConstantRange.has_value()) {
+                    const auto &placements = renderPermutation.materials.placementByIndex(primitiveData.materialIndex.value());
+                    renderPassCommandRecorder.pushConstant(shading_material.texturePlacementPushConstantRange.value(), &placements);
+                }
+            }
+
             // Bind the vertex buffers
             uint32_t vertexBufferBinding = 0;
             for (const auto &vertexBuffer : primitiveData.vertexBuffers) {
@@ -184,146 +522,45 @@ void GltfHolder::renderAllNodes(
                 continue;
             }
 
-            // draw indexed
-            const IndexedDraw &indexedDraw = primitiveData.drawData.indexedDraw;
+            // draw indexed, using the coarsest level of detail that is indistinguishable at this distance.
+            // Every pass picks the same level as the selection only depends on the node and the camera.
+            const uint32_t lod = mesh_lod::selectLod(m_lodSelection,
+                                                     worldMatrix,
+                                                     primitiveData.boundingSphere,
+                                                     std::span<const float>(primitiveData.lodErrors.data(), primitiveData.lodCount));
+            const IndexedDraw &indexedDraw = primitiveData.drawData.indexedDraws[lod];
             renderPassCommandRecorder.setIndexBuffer(indexedDraw.indexBuffer,
                                                      indexedDraw.offset,
                                                      indexedDraw.indexType);
             renderPassCommandRecorder.drawIndexed(DrawIndexedCommand{ .indexCount = indexedDraw.indexCount });
+            ++lodStats.drawCounts[lod];
+            lodStats.triangleCounts[lod] += indexedDraw.indexCount / 3;
         }
     }
 }
 
 PrimitiveData GltfHolder::setupPrimitive(
         std::vector<ShaderStage> &shaderStages,
-        const GltfShaderVertexInput& shaderVertexInput,
-        std::vector<GraphicsPipeline> &pipelines,
+        TinyGltfHelper::VertexLayoutAnalyzer &vertexLayouts,
+        GraphicsPipelineCache &pipelineCache,
         PipelineLayout &pipelineLayout,
         const RenderTarget &renderTarget,
-        const tinygltf::Primitive &primitive)
+        const tinygltf::Primitive &primitive,
+        const mesh_lod::PrimitiveLods &primitiveLods)
 {
-    std::vector<BufferAndOffset> buffers;
-    VertexOptions vertexOptions{};
-    uint32_t nextBinding{ 0 };
-    uint32_t currentBinding{ 0 };
-    uint32_t vertexCount{ 0 };
-
-    // Used to keep track of which bindings are used for each buffer view and
-    // which attributes use each vertex buffer layout
-    std::map<int, std::vector<uint32_t>> bufferViewToLayoutMap;
-    std::map<uint32_t, std::vector<uint32_t>> layoutToAttributeMap;
-
-    // Iterate over each attribute in the primitive to build up a description of the
-    // vertex layout needed to create the pipeline.
-    for (const auto &attribute : primitive.attributes) {
-        const auto &accessor = m_model.accessors.at(attribute.second);
-        const uint32_t bufferIndex = accessor.bufferView;
-        const auto &bufferView = m_model.bufferViews.at(accessor.bufferView);
-
-        // Find the [shader vertex input location] for this attribute (if any)
-        std::optional<uint32_t> possible_location;
-        {
-            if (attribute.first == "POSITION") {
-                if (shaderVertexInput.positionLocation.has_value())
-                    possible_location = shaderVertexInput.positionLocation.value();
-            }
-            if (attribute.first == "NORMAL") {
-                if (shaderVertexInput.normalLocation.has_value())
-                    possible_location = shaderVertexInput.normalLocation.value();
-            }
-            if (attribute.first == "TEXCOORD_0") {
-                if (shaderVertexInput.textureCoord0Location.has_value())
-                    possible_location = shaderVertexInput.textureCoord0Location.value();
-            }
-            if (attribute.first == "TANGENT") {
-                if (shaderVertexInput.tangentLocation.has_value())
-                    possible_location = shaderVertexInput.tangentLocation.value();
-            }
-
-            if (!possible_location.has_value())
-                continue;
-        }
-
-        bool foundCompatibleLayout = false;
-        const auto layoutIt = bufferViewToLayoutMap.find(accessor.bufferView);
-        if (layoutIt != bufferViewToLayoutMap.end()) {
-            // We already have one or more bindings (buffer layouts) for this buffer view. Are any
-            // of them compatible with this use of the buffer view? Are the offsets within limits?
-            const std::vector<uint32_t> &layoutIndices = layoutIt->second;
-
-            for (const auto &layoutIndex : layoutIndices) {
-                // Loop over attributes for this buffer layout
-                VertexBufferLayout &bufferLayout = vertexOptions.buffers[layoutIndex];
-                const std::vector<uint32_t> &attributeIndices = layoutToAttributeMap.at(layoutIndex);
-
-                for (const auto &attributeIndex : attributeIndices) {
-                    const DeviceSize attributeOffsetDelta = std::abs(
-                            int32_t(accessor.byteOffset) - int32_t(vertexOptions.attributes[attributeIndex].offset));
-                    if (attributeOffsetDelta < vertexOptions.buffers[layoutIndex].stride) {
-                        // Found a compatible vertex buffer layout
-                        foundCompatibleLayout = true;
-                        currentBinding = layoutIndex;
-
-                        // Track the minimum offset across all attributes that share a buffer layout
-                        BufferAndOffset &buffer = buffers.at(layoutIndex);
-                        buffer.offset = std::min(buffer.offset, static_cast<DeviceSize>(accessor.byteOffset));
-
-                        break;
-                    }
-                }
-            }
-        }
+    const TinyGltfHelper::PrimitiveVertexLayout &vertexLayout = vertexLayouts.analyze(primitive);
+    const VertexOptions &vertexOptions = vertexLayouts.vertexOptions(vertexLayout.layoutId);
+    const uint32_t vertexCount = vertexLayout.vertexCount;
 
-        if (!foundCompatibleLayout) {
-            // Add a buffer layout and binding for this buffer view
-            const VertexBufferLayout bufferLayout = {
-                .binding = nextBinding,
-                .stride = bufferView.byteStride ? static_cast<uint32_t>(bufferView.byteStride)
-                                                : TinyGltfHelper::packedArrayStrideForAccessor(accessor)
-            };
-            vertexOptions.buffers.push_back(bufferLayout);
-
-            // Note that this buffer view maps to this binding
-            bufferViewToLayoutMap.insert({ accessor.bufferView, { nextBinding } });
-            layoutToAttributeMap.insert({ nextBinding, {} });
-
-            // Store the buffer and offset to be used with this buffer layout.
-            // NB: The index in the vector is equal to the buffer layout binding
-            buffers.push_back({ .buffer = m_buffers.at(bufferIndex), .offset = accessor.byteOffset });
-
-            currentBinding = nextBinding;
-            ++nextBinding;
-        }
-
-        // Set up the vertex attribute using the current binding
-        const VertexAttribute vertexAttribute = { .location = possible_location.value(),
-                                                  .binding = currentBinding,
-                                                  .format = TinyGltfHelper::formatForAccessor(accessor),
-                                                  .offset = accessor.byteOffset };
-        vertexOptions.attributes.push_back(vertexAttribute);
-
-        uint32_t attributeIndex = static_cast<uint32_t>(vertexOptions.attributes.size() - 1);
-        layoutToAttributeMap.at(currentBinding).push_back(attributeIndex);
-
-        vertexCount = accessor.count;
-    }
-
-    // Normalize attribute offsets by subtracting off the buffer layout offset. By nature of the
-    // way in which we create the buffer layouts they are already sorted by binding number.
-    const uint32_t bufferLayoutCount = vertexOptions.buffers.size();
-    for (uint32_t bufferLayoutIndex = 0; bufferLayoutIndex < bufferLayoutCount; ++bufferLayoutIndex) {
-        const BufferAndOffset &buffer = buffers.at(bufferLayoutIndex);
-        const std::vector<uint32_t> &attributeIndices = layoutToAttributeMap.at(bufferLayoutIndex);
-        for (const auto &attributeIndex : attributeIndices)
-            vertexOptions.attributes[attributeIndex].offset -= buffer.offset;
-    }
-
-    // Sort the attributes to be in order of their location. This normalizes the data so that we can
-    // compare them to remove duplicates.
-    std::sort(vertexOptions.attributes.begin(), vertexOptions.attributes.end(),
-              [](const VertexAttribute &a, const VertexAttribute &b) { return a.location < b.location; });
+    // NB: The index in the vector is equal to the buffer layout binding
+    std::vector<BufferAndOffset> buffers;
+    buffers.reserve(vertexLayout.bindings.size());
+    for (const auto &binding : vertexLayout.bindings)
+        buffers.push_back({ .buffer = m_buffers.at(binding.bufferView), .offset = binding.offset });
 
-    // Create pipeline for rendering
+    // Find or create the pipeline for rendering. Primitives with the same vertex layout and
+    // topology share one, also across the models rendered by the pass.
+    Handle<GraphicsPipeline_t> pipeline;
     {
         // Create a pipeline compatible with the above vertex buffer and attribute layout
         GraphicsPipelineOptions regularPipelineOptions = {
@@ -341,6 +578,11 @@ PrimitiveData GltfHolder::setupPrimitive(
                 regularPipelineOptions.renderTargets = {
                     possibleRenderTargetOptions.value()
                 };
+            if (possibleRenderTargetOptions && renderTarget.additiveBlending)
+                regularPipelineOptions.renderTargets[0].blending = {
+                    .blendingEnabled = true,
+                    .color = { .srcFactor = BlendFactor::One, .dstFactor = BlendFactor::One }
+                };
         }
 
         if (renderTarget.hasDepthTarget()) {
@@ -355,14 +597,13 @@ PrimitiveData GltfHolder::setupPrimitive(
 
         auto& device = kdgpu_ext::graphics::GlobalResources::instance().graphicsDevice();
 
-        GraphicsPipeline pipeline = device.createGraphicsPipeline(regularPipelineOptions);
-        pipelines.emplace_back(std::move(pipeline));
+        pipeline = pipelineCache.findOrCreate(device, regularPipelineOptions);
     }
 
     // Determine draw type and cache enough information for render time
     if (primitive.indices == -1) {
         return PrimitiveData{
-            .pipeline = pipelines.back(),
+            .pipeline = pipeline,
             .vertexBuffers = buffers,
             .drawType = PrimitiveData::DrawType::NonIndexed,
             .drawData = { .vertexCount = vertexCount }
@@ -370,30 +611,51 @@ PrimitiveData GltfHolder::setupPrimitive(
     }
 
     const auto &accessor = m_model.accessors.at(primitive.indices);
-    const IndexedDraw indexedDraw = {
+    std::array<IndexedDraw, mesh_lod::MaxLodCount> indexedDraws;
+    indexedDraws[0] = {
         .indexBuffer = m_buffers.at(accessor.bufferView),
         .offset = accessor.byteOffset,
         .indexCount = static_cast<uint32_t>(accessor.count),
         .indexType = TinyGltfHelper::indexTypeForComponentType(accessor.componentType)
     };
 
+    // the simplified levels index into the shared LOD index buffer
+    std::array<float, mesh_lod::MaxLodCount> lodErrors{};
+    uint32_t lodCount = 1;
+    for (const auto &lod : primitiveLods.lods) {
+        indexedDraws[lodCount] = {
+            .indexBuffer = m_lodIndexBuffer,
+            .offset = lod.firstIndex * sizeof(uint32_t),
+            .indexCount = lod.indexCount,
+            .indexType = IndexType::Uint32
+        };
+        lodErrors[lodCount] = lod.error;
+        ++lodCount;
+    }
+
     // when primitive has no material at all
     if (primitive.material == -1) {
         return PrimitiveData{
-            .pipeline = pipelines.back(),
+            .pipeline = pipeline,
             .vertexBuffers = buffers,
             .drawType = PrimitiveData::DrawType::Indexed,
-            .drawData = { .indexedDraw = indexedDraw }
+            .drawData = { .indexedDraws = indexedDraws },
+            .lodCount = lodCount,
+            .lodErrors = lodErrors,
+            .boundingSphere = primitiveLods.boundingSphere
         };
     }
 
     return PrimitiveData{
-        .pipeline = pipelines.back(),
+        .pipeline = pipeline,
         // .depthOnlyPipeline = m_depthOnlyPipelines.back(),
         .vertexBuffers = buffers,
         .materialIndex = primitive.material,
         .drawType = PrimitiveData::DrawType::Indexed,
-        .drawData = { .indexedDraw = indexedDraw }
+        .drawData = { .indexedDraws = indexedDraws },
+        .lodCount = lodCount,
+        .lodErrors = lodErrors,
+        .boundingSphere = primitiveLods.boundingSphere
     };
 }
 
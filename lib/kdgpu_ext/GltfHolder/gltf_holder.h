@@ -1,15 +1,22 @@
 #pragma once
 
 #include <render_mesh_set/render_mesh_set.h>
+#include <render_mesh_set/graphics_pipeline_cache.h>
 
 #include <model/node_render_task.h>
+#include <tinygltf_helper/vertex_layout_analyzer.h>
 
 #include <GltfHolder/texture/gltf_texture.h>
+#include <GltfHolder/texture_streaming/texture_streamer.h>
 
 #include <GltfHolder/shader_specification/gltf_shader_vertex_input.h>
 
+#include <GltfHolder/mesh_lod/mesh_lod.h>
+
 #include <texture_target/texture_target.h>
 #include <render_target/render_target.h>
+#include <command/state_filtering_render_pass_recorder.h>
+#include <resource/deferred_release.h>
 
 #include <tiny_gltf.h>
 
@@ -18,9 +25,37 @@
 #include <KDGpu/graphics_pipeline_options.h>
 #include <KDGpu/pipeline_layout.h>
 
+#include <optional>
+
 namespace kdgpu_ext::gltf_holder {
 struct GltfRenderPermutation;
 
+// how the images of a model are uploaded, has to be set before GltfHolder::load()
+struct GltfTextureCompression {
+  // block compressed format the images are transcoded to, None uploads them as RGBA8
+  graphics::texture::BlockCompression target = graphics::texture::BlockCompression::None;
+  // encode images that have no baked KTX2 file next to the model while loading,
+  // which takes seconds per large image. Otherwise such images are uploaded as RGBA8.
+  bool encodeAtImport = false;
+};
+
+// packs small images into 2D arrays, has to be set before GltfHolder::load(). All textures
+// then have array views, so every pass sampling them needs a shader declaring sampler2DArray
+// and the texture placement push constants, see GltfShaderTexturePlacements.
+struct GltfTexturePacking {
+  bool enabled = false;
+  // images with both sides up to this size are packed
+  uint32_t maxSize = 256;
+  // smaller groups of images of a format and size stay separate textures
+  uint32_t minImagesPerArray = 2;
+};
+
+// number of draws and triangles rendered per level of detail by one pass
+struct GltfLodStats {
+  std::array<uint32_t, mesh_lod::MaxLodCount> drawCounts{};
+  std::array<uint32_t, mesh_lod::MaxLodCount> triangleCounts{};
+};
+
 class GltfHolder
 {
   friend struct GltfRenderPermutation;
@@ -28,6 +63,42 @@ public:
   void load(const std::string& filename, Queue& queue);
   void deinitialize();
 
+  void setTextureCompression(const GltfTextureCompression &textureCompression)
+  {
+    m_textureCompression = textureCompression;
+  }
+
+  // uploads only the mip tails at load and streams in finer levels as the textures are
+  // seen closer, has to be set before load()
+  void setTextureStreaming(const texture_streaming::TextureStreamingOptions &textureStreaming)
+  {
+    m_textureStreamingOptions = textureStreaming;
+  }
+
+  void setTexturePacking(const GltfTexturePacking &texturePacking)
+  {
+    m_texturePacking = texturePacking;
+  }
+
+  // drops the buffer data and decoded pixels of the model once everything made from them
+  // is on the GPU, has to be set before load(). Only the metadata is kept, so model() can
+  // not be used to create more GPU resources from the payloads after that.
+  void setTrimAfterUpload(bool trimAfterUpload)
+  {
+    m_trimAfterUpload = trimAfterUpload;
+  }
+
+  texture_streaming::TextureStreamer &textureStreamer()
+  {
+    return m_textureStreamer;
+  }
+
+  /**
+   * Where the Basis Universal KTX2 file baked from an image of the model is looked for:
+   * next to the image with .ktx2 appended, or next to the model for embedded images.
+   */
+  static std::string bakedImagePath(const std::string &gltfFilename, const tinygltf::Model &model, size_t imageIndex);
+
   tinygltf::Model &model()
   {
     return m_model;
@@ -38,6 +109,12 @@ public:
     return m_textures;
   }
 
+  // where each image of the model is, indexed as per model().images
+  const std::vector<GltfTexturePlacement>& texturePlacements() const
+  {
+    return m_texturePlacements;
+  }
+
   /**
    * Shader binding id of the uniform buffer object containing the per-node transform.
    * This has to be the same across all shaders wanting to transform the nodes.
@@ -50,31 +127,67 @@ public:
     const RenderTarget &renderTarget,
     std::vector<ShaderStage>& shaderStages,
     const shader_specification::GltfShaderVertexInput& shaderVertexInput,
-    PipelineLayout& pipelineLayout
+    PipelineLayout& pipelineLayout,
+    render_mesh_set::GraphicsPipelineCache& pipelineCache
   );
 
   void update();
 
+  /**
+   * Camera used to pick the level of detail of each node from its projected size.
+   * Has to be set before rendering every frame for the LOD selection to follow the camera.
+   */
+  void setLodView(const glm::mat4 &viewMatrix, const glm::mat4 &projectionMatrix, float viewportHeight);
+
+  mesh_lod::LodSelection &lodSelection()
+  {
+    return m_lodSelection;
+  }
+
+  // redundant pipeline, bind group and buffer bindings between primitives are dropped by the recorder.
+  // The draws are added to lodStats, which the caller keeps per pass as every pass picks the same levels.
   void renderAllNodes(
-    RenderPassCommandRecorder& renderPassCommandRecorder,
+    graphics::command::StateFilteringRenderPassRecorder& renderPassCommandRecorder,
     GltfRenderPermutation& renderPermutation,
-    const PipelineLayout& pipelineLayout);
+    const PipelineLayout& pipelineLayout,
+    GltfLodStats& lodStats);
 
 private:
 
   void calculateWorldTransforms();
+  void generateLods();
+  void loadTextures(const std::string &filename);
+  void requestStreamedLevels();
+  void trimModelPayloads();
   render_mesh_set::PrimitiveData setupPrimitive(
     std::vector<ShaderStage>& shaderStages,
-    const shader_specification::GltfShaderVertexInput& shaderVertexInput,
-    std::vector<GraphicsPipeline>& pipelines,
+    TinyGltfHelper::VertexLayoutAnalyzer& vertexLayouts,
+    render_mesh_set::GraphicsPipelineCache& pipelineCache,
     PipelineLayout& pipelineLayout,
     const RenderTarget &renderTarget,
-    const tinygltf::Primitive &primitive
+    const tinygltf::Primitive &primitive,
+    const mesh_lod::PrimitiveLods &primitiveLods
   );
 
   tinygltf::Model m_model;
+  bool m_trimAfterUpload = false;
+  // batch of the uploader holding the load uploads, the payloads are dropped once it completes
+  std::optional<uint64_t> m_trimUploadValue;
+
+  std::vector<GltfTexture> m_textures; // one per image, followed by the packed arrays
+  std::vector<GltfTexturePlacement> m_texturePlacements;
+  GltfTextureCompression m_textureCompression;
+  GltfTexturePacking m_texturePacking;
+  // all texture uploads, at load and when streaming, go through its staging ring
+  graphics::texture::TextureUploader m_textureUploader;
+
+  // texture streaming
+  texture_streaming::TextureStreamingOptions m_textureStreamingOptions;
+  texture_streaming::TextureStreamer m_textureStreamer;
+  std::vector<std::vector<uint32_t>> m_materialTextures; // textures used by each material
 
-  std::vector<GltfTexture> m_textures;
+  // textures and bind groups replaced while frames may still use them
+  graphics::resource::DeferredRelease m_retiredResources;
 
   // the set can differ between passes but the binding should be the same
   uint32_t m_nodeTransformUniformBinding = 0;
@@ -84,6 +197,12 @@ private:
 
   // mesh data buffers
   std::vector<Buffer> m_buffers;
+
+  // simplified levels of detail, indexed as per model.meshes[].primitives[]
+  std::vector<std::vector<mesh_lod::PrimitiveLods>> m_meshLods;
+  Buffer m_lodIndexBuffer; // uint32 indices of all simplified levels
+
+  mesh_lod::LodSelection m_lodSelection;
 };
 
 }
@@ -3,6 +3,11 @@
 #include <GltfHolder/shader_specification/gltf_shader_texture_channels.h>
 #include <GltfHolder/material/rendering/gltf_render_pass_texture_bindings.h>
 
+#include <tinygltf_helper/tinygltf_helper.h>
+
+#include <algorithm>
+#include <iterator>
+
 namespace gltf_holder::material::rendering {
 class GltfMaterialsForAPass
 {
@@ -13,8 +18,11 @@ public:
     void initialize(
             tinygltf::Model &model,
             std::vector<GltfTexture> &textures,
+            const std::vector<GltfTexturePlacement> &texturePlacements,
             const kdgpu_ext::gltf_holder::shader_specification::GltfShaderTextureChannels &shaderMaterial)
     {
+        using kdgpu_ext::gltf_holder::shader_specification::GltfTextureChannel;
+
         if (!shaderMaterial.anyTextureChannelsFromGltfEnabled)
             return;
 
@@ -22,38 +30,59 @@ public:
 
         // for each material in the gltf model,
         // - set up which textures to use based on the requirements in the shader material
+        // - map the glTF textures to their images and the images to the texture holding them,
+        //   which is shared by the layers of a packed array
         for (auto &material : model.materials) {
             GltfRenderPassTextureBindings renderMaterial;
+            kdgpu_ext::gltf_holder::shader_specification::GltfShaderTexturePlacements placements;
+            auto bindChannel = [&](int textureIndex, GltfTextureChannel channel, GltfTexture *&texture, KDGpu::Handle<KDGpu::Sampler_t> &sampler) {
+                // textures without an image leave the channel unbound, as if there was no texture
+                const auto imageIndex = TinyGltfHelper::imageIndexForTexture(model, textureIndex);
+                if (!imageIndex)
+                    return;
+                const GltfTexturePlacement &placement = texturePlacements.at(*imageIndex);
+                texture = &textures[placement.textureIndex];
+                sampler = samplerForTexture(model, textureIndex);
+                placements.set(channel, placement.layer, placement.uvRect);
+            };
+
             if (material.pbrMetallicRoughness.baseColorTexture.index != -1) {
-                if (shaderMaterial.baseColorFragmentShaderBinding.has_value()) {
-                    renderMaterial.baseColorTexture = &textures[material.pbrMetallicRoughness.baseColorTexture.index];
-                }
+                if (shaderMaterial.baseColorFragmentShaderBinding.has_value())
+                    bindChannel(material.pbrMetallicRoughness.baseColorTexture.index, GltfTextureChannel::BaseColor, renderMaterial.baseColorTexture, renderMaterial.baseColorSampler);
             }
             if (material.normalTexture.index != -1) {
-                if (shaderMaterial.baseColorFragmentShaderBinding.has_value()) {
-                    renderMaterial.normalMapTexture = &textures[material.normalTexture.index];
-                }
+                if (shaderMaterial.baseColorFragmentShaderBinding.has_value())
+                    bindChannel(material.normalTexture.index, GltfTextureChannel::Normal, renderMaterial.normalMapTexture, renderMaterial.normalMapSampler);
             }
             if (material.pbrMetallicRoughness.metallicRoughnessTexture.index != -1) {
-                if (shaderMaterial.metallicRoughnessFragmentShaderBinding.has_value()) {
-                    renderMaterial.metallicRoughnessTexture = &textures[material.pbrMetallicRoughness.metallicRoughnessTexture.index];
-                }
+                if (shaderMaterial.metallicRoughnessFragmentShaderBinding.has_value())
+                    bindChannel(material.pbrMetallicRoughness.metallicRoughnessTexture.index, GltfTextureChannel::MetallicRoughness, renderMaterial.metallicRoughnessTexture, renderMaterial.metallicRoughnessSampler);
             }
             if (material.occlusionTexture.index != -1) {
-                if (shaderMaterial.occlusionFragmentShaderBinding.has_value()) {
-                    renderMaterial.occlusionTexture = &textures[material.occlusionTexture.index];
-                }
+                if (shaderMaterial.occlusionFragmentShaderBinding.has_value())
+                    bindChannel(material.occlusionTexture.index, GltfTextureChannel::Occlusion, renderMaterial.occlusionTexture, renderMaterial.occlusionSampler);
             }
             if (material.emissiveTexture.index != -1) {
-                if (shaderMaterial.emissionFragmentShaderBinding.has_value()) {
-                    renderMaterial.emissionTexture = &textures[material.emissiveTexture.index];
-                }
+                if (shaderMaterial.emissionFragmentShaderBinding.has_value())
+                    bindChannel(material.emissiveTexture.index, GltfTextureChannel::Emission, renderMaterial.emissionTexture, renderMaterial.emissionSampler);
+            }
+            m_placements.push_back(placements);
+
+            // materials whose images share the same arrays only differ in their placements,
+            // which are pushed per draw, so they share a bind group
+            const auto shared = std::find_if(m_renderMaterials.begin(), m_renderMaterials.end(), [&renderMaterial](const auto &other) {
+                return other.bindsSameTextures(renderMaterial);
+            });
+            if (shared != m_renderMaterials.end()) {
+                m_materialBindings.push_back(static_cast<size_t>(std::distance(m_renderMaterials.begin(), shared)));
+                continue;
             }
 
             // initialize the material (creates a bind group for it)
             renderMaterial.initialize(shaderMaterial);
 
             // add the material to the list
+            m_materialBindings.push_back(m_renderMaterials.size());
             m_renderMaterials.push_back(std::move(renderMaterial));
         }
     }
@@ -65,17 +94,33 @@ public:
         }
     }
 
+    // materials can share their bindings, indexed as per the glTF materials
     GltfRenderPassTextureBindings &materialByIndex(size_t index)
     {
-        return m_renderMaterials[index];
+        return m_renderMaterials[m_materialBindings[index]];
     }
 
+    // where the images of the material's texture channels are in their textures
+    const kdgpu_ext::gltf_holder::shader_specification::GltfShaderTexturePlacements &placementByIndex(size_t index) const
+    {
+        return m_placements[index];
+    }
+
+    size_t bindGroupCount() const { return m_renderMaterials.size(); }
+
     bool has_shader_material() { return m_shaderMaterial != nullptr; }
     const kdgpu_ext::gltf_holder::shader_specification::GltfShaderTextureChannels &get_shader_material() const { return *m_shaderMaterial; }
 
 private:
+    static KDGpu::Handle<KDGpu::Sampler_t> samplerForTexture(const tinygltf::Model &model, int textureIndex)
+    {
+        return kdgpu_ext::graphics::GlobalResources::instance().sampler(TinyGltfHelper::samplerOptionsForTexture(model, textureIndex));
+    }
+
     const kdgpu_ext::gltf_holder::shader_specification::GltfShaderTextureChannels* m_shaderMaterial = nullptr;
 
     std::vector<GltfRenderPassTextureBindings> m_renderMaterials;
+    std::vector<size_t> m_materialBindings; // index into m_renderMaterials per glTF material
+    std::vector<kdgpu_ext::gltf_holder::shader_specification::GltfShaderTexturePlacements> m_placements;
 };
 }
@@ -7,6 +7,8 @@
 #include <GltfHolder/shader_specification/gltf_shader_texture_channels.h>
 #include <GltfHolder/texture/gltf_texture.h>
 
+#include <resource/deferred_release.h>
+
 namespace gltf_holder::material::rendering {
 /**
  * Holds the glue between what texture channels a shader has specified
@@ -46,8 +48,41 @@ struct GltfRenderPassTextureBindings {
     GltfTexture *occlusionTexture = nullptr;
     GltfTexture *emissionTexture = nullptr;
 
+    // samplers of the glTF textures, owned by the sampler cache. The texture's own sampler is used if not set.
+    KDGpu::Handle<KDGpu::Sampler_t> baseColorSampler;
+    KDGpu::Handle<KDGpu::Sampler_t> normalMapSampler;
+    KDGpu::Handle<KDGpu::Sampler_t> metallicRoughnessSampler;
+    KDGpu::Handle<KDGpu::Sampler_t> occlusionSampler;
+    KDGpu::Handle<KDGpu::Sampler_t> emissionSampler;
+
+    // whether the bind group of the other bindings can be used instead of creating one
+    bool bindsSameTextures(const GltfRenderPassTextureBindings &other) const
+    {
+        return baseColorTexture == other.baseColorTexture && baseColorSampler == other.baseColorSampler
+                && normalMapTexture == other.normalMapTexture && normalMapSampler == other.normalMapSampler
+                && metallicRoughnessTexture == other.metallicRoughnessTexture && metallicRoughnessSampler == other.metallicRoughnessSampler
+                && occlusionTexture == other.occlusionTexture && occlusionSampler == other.occlusionSampler
+                && emissionTexture == other.emissionTexture && emissionSampler == other.emissionSampler;
+    }
+
+    // streamed textures swap their view when levels are streamed in or evicted
+    bool isOutdated() const
+    {
+        return m_textureChannels != nullptr && m_textureGeneration != textureGeneration();
+    }
+
+    // the old bind group may still be used by frames in flight
+    void recreateBindGroup(kdgpu_ext::graphics::resource::DeferredRelease &retiredResources)
+    {
+        retiredResources.retire(std::move(m_bindGroup));
+        initialize(*m_textureChannels);
+    }
+
     void initialize(const kdgpu_ext::gltf_holder::shader_specification::GltfShaderTextureChannels &textureChannels)
     {
+        m_textureChannels = &textureChannels;
+        m_textureGeneration = textureGeneration();
+
         KDGpu::BindGroupOptions bindGroupOptions;
         // the layout is re-used
         bindGroupOptions.layout = textureChannels.materialBindGroupLayout;
@@ -60,7 +95,7 @@ struct GltfRenderPassTextureBindings {
                             .binding = static_cast<uint32_t>(textureChannels.baseColorFragmentShaderBinding.value()),
                             .resource = KDGpu::TextureViewSamplerBinding{
                                     .textureView = baseColorTexture->textureViewHandle(),
-                                    .sampler = baseColorTexture->samplerHandle() } });
+                                    .sampler = baseColorSampler.isValid() ? baseColorSampler : baseColorTexture->samplerHandle() } });
         }
         if (textureChannels.normalMapFragmentShaderBinding.has_value() && normalMapTexture != nullptr) {
             bindGroupOptions.resources.push_back(
@@ -70,7 +105,7 @@ struct GltfRenderPassTextureBindings {
                             .binding = static_cast<uint32_t>(textureChannels.normalMapFragmentShaderBinding.value()),
                             .resource = KDGpu::TextureViewSamplerBinding{
                                     .textureView = normalMapTexture->textureViewHandle(),
-                                    .sampler = normalMapTexture->samplerHandle() } });
+                                    .sampler = normalMapSampler.isValid() ? normalMapSampler : normalMapTexture->samplerHandle() } });
         }
         if (textureChannels.metallicRoughnessFragmentShaderBinding.has_value() && metallicRoughnessTexture != nullptr) {
             bindGroupOptions.resources.push_back(
@@ -80,7 +115,7 @@ struct GltfRenderPassTextureBindings {
                             .binding = static_cast<uint32_t>(textureChannels.metallicRoughnessFragmentShaderBinding.value()),
                             .resource = KDGpu::TextureViewSamplerBinding{
                                     .textureView = metallicRoughnessTexture->textureViewHandle(),
-                                    .sampler = metallicRoughnessTexture->samplerHandle() } });
+                                    .sampler = metallicRoughnessSampler.isValid() ? metallicRoughnessSampler : metallicRoughnessTexture->samplerHandle() } });
         }
         if (textureChannels.occlusionFragmentShaderBinding.has_value() && occlusionTexture != nullptr) {
             bindGroupOptions.resources.push_back(
@@ -90,7 +125,7 @@ struct GltfRenderPassTextureBindings {
                             .binding = static_cast<uint32_t>(textureChannels.occlusionFragmentShaderBinding.value()),
                             .resource = KDGpu::TextureViewSamplerBinding{
                                     .textureView = occlusionTexture->textureViewHandle(),
-                                    .sampler = occlusionTexture->samplerHandle() } });
+                                    .sampler = occlusionSampler.isValid() ? occlusionSampler : occlusionTexture->samplerHandle() } });
         }
         if (textureChannels.emissionFragmentShaderBinding.has_value() && emissionTexture != nullptr) {
             bindGroupOptions.resources.push_back(
@@ -100,7 +135,7 @@ struct GltfRenderPassTextureBindings {
                             .binding = static_cast<uint32_t>(textureChannels.emissionFragmentShaderBinding.value()),
                             .resource = KDGpu::TextureViewSamplerBinding{
                                     .textureView = emissionTexture->textureViewHandle(),
-                                    .sampler = emissionTexture->samplerHandle() } });
+                                    .sampler = emissionSampler.isValid() ? emissionSampler : emissionTexture->samplerHandle() } });
         }
 
         m_bindGroup = kdgpu_ext::graphics::GlobalResources::instance().graphicsDevice().createBindGroup(bindGroupOptions);
@@ -109,8 +144,20 @@ struct GltfRenderPassTextureBindings {
     void deinitialize()
     {
         m_bindGroup = {};
+        m_textureChannels = nullptr;
+    }
+
+    uint64_t textureGeneration() const
+    {
+        uint64_t generation = 0;
+        for (const GltfTexture *texture : { baseColorTexture, normalMapTexture, metallicRoughnessTexture, occlusionTexture, emissionTexture })
+            if (texture)
+                generation += texture->generation();
+        return generation;
     }
 
     KDGpu::BindGroup m_bindGroup{};
+    const kdgpu_ext::gltf_holder::shader_specification::GltfShaderTextureChannels *m_textureChannels = nullptr;
+    uint64_t m_textureGeneration = 0;
 };
 } // namespace gltf_holder::material::rendering
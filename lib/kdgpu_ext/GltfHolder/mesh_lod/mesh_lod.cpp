@@ -0,0 +1,299 @@
+#include "mesh_lod.h"
+
+#include <tinygltf_helper/tinygltf_helper.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace kdgpu_ext::gltf_holder::mesh_lod {
+
+namespace {
+
+// Grid resolution (cells across the bounding sphere diameter) of the simplified levels
+constexpr std::array<float, MaxLodCount - 1> LodGridResolutions = { 96.0f, 32.0f, 12.0f };
+
+// A level has to drop at least this share of the indices of the previous one to be kept
+constexpr float MinLodReduction = 0.25f;
+
+const uint8_t *accessorData(const tinygltf::Model &model, const tinygltf::Accessor &accessor, size_t &stride)
+{
+    const auto &bufferView = model.bufferViews.at(accessor.bufferView);
+    const auto &buffer = model.buffers.at(bufferView.buffer);
+    stride = bufferView.byteStride ? bufferView.byteStride : TinyGltfHelper::packedArrayStrideForAccessor(accessor);
+    return buffer.data.data() + bufferView.byteOffset + accessor.byteOffset;
+}
+
+bool readPositions(const tinygltf::Model &model, const tinygltf::Primitive &primitive, std::vector<glm::vec3> &positions)
+{
+    const auto positionIt = primitive.attributes.find("POSITION");
+    if (positionIt == primitive.attributes.end())
+        return false;
+
+    const auto &accessor = model.accessors.at(positionIt->second);
+    if (accessor.bufferView == -1 || accessor.sparse.isSparse ||
+        accessor.componentType != TINYGLTF_COMPONENT_TYPE_FLOAT || accessor.type != TINYGLTF_TYPE_VEC3)
+        return false;
+
+    size_t stride = 0;
+    const uint8_t *data = accessorData(model, accessor, stride);
+    positions.resize(accessor.count);
+    for (size_t i = 0; i < accessor.count; ++i)
+        std::memcpy(&positions[i], data + i * stride, sizeof(glm::vec3));
+    return true;
+}
+
+bool readTexcoords(const tinygltf::Model &model, const tinygltf::Primitive &primitive, std::vector<glm::vec2> &texcoords)
+{
+    const auto texcoordIt = primitive.attributes.find("TEXCOORD_0");
+    if (texcoordIt == primitive.attributes.end())
+        return false;
+
+    // Normalized integer coordinates are rare enough to not be worth decoding here
+    const auto &accessor = model.accessors.at(texcoordIt->second);
+    if (accessor.bufferView == -1 || accessor.sparse.isSparse ||
+        accessor.componentType != TINYGLTF_COMPONENT_TYPE_FLOAT || accessor.type != TINYGLTF_TYPE_VEC2)
+        return false;
+
+    size_t stride = 0;
+    const uint8_t *data = accessorData(model, accessor, stride);
+    texcoords.resize(accessor.count);
+    for (size_t i = 0; i < accessor.count; ++i)
+        std::memcpy(&texcoords[i], data + i * stride, sizeof(glm::vec2));
+    return true;
+}
+
+bool readIndices(const tinygltf::Model &model, const tinygltf::Primitive &primitive, std::vector<uint32_t> &indices)
+{
+    const auto &accessor = model.accessors.at(primitive.indices);
+    if (accessor.bufferView == -1 || accessor.sparse.isSparse)
+        return false;
+
+    size_t stride = 0;
+    const uint8_t *data = accessorData(model, accessor, stride);
+    indices.resize(accessor.count);
+    for (size_t i = 0; i < accessor.count; ++i) {
+        const uint8_t *element = data + i * stride;
+        switch (accessor.componentType) {
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+            indices[i] = *element;
+            break;
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT: {
+            uint16_t index;
+            std::memcpy(&index, element, sizeof(index));
+            indices[i] = index;
+            break;
+        }
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:
+            std::memcpy(&indices[i], element, sizeof(uint32_t));
+            break;
+        default:
+            return false;
+        }
+    }
+    return true;
+}
+
+BoundingSphere boundingSphereForPositions(std::span<const glm::vec3> positions, glm::vec3 &boundsMin)
+{
+    boundsMin = glm::vec3(std::numeric_limits<float>::max());
+    glm::vec3 boundsMax(std::numeric_limits<float>::lowest());
+    for (const auto &position : positions) {
+        boundsMin = glm::min(boundsMin, position);
+        boundsMax = glm::max(boundsMax, position);
+    }
+
+    BoundingSphere sphere;
+    sphere.center = 0.5f * (boundsMin + boundsMax);
+    for (const auto &position : positions)
+        sphere.radius = std::max(sphere.radius, glm::length(position - sphere.center));
+    return sphere;
+}
+
+} // namespace
+
+std::vector<uint32_t> simplifyByVertexClustering(std::span<const glm::vec3> positions,
+                                                 std::span<const uint32_t> indices,
+                                                 const glm::vec3 &gridOrigin,
+                                                 float cellSize)
+{
+    struct Cell {
+        glm::vec3 positionSum{ 0.0f };
+        uint32_t vertexCount{ 0 };
+        uint32_t representative{ 0 };
+        float representativeDistance{ std::numeric_limits<float>::max() };
+    };
+
+    auto cellKey = [&](const glm::vec3 &position) {
+        const glm::uvec3 cell = glm::uvec3(glm::max((position - gridOrigin) / cellSize, glm::vec3(0.0f)));
+        return (uint64_t(cell.x & 0x1fffff) << 42) | (uint64_t(cell.y & 0x1fffff) << 21) | uint64_t(cell.z & 0x1fffff);
+    };
+
+    // Average the referenced vertices of each cell
+    std::unordered_map<uint64_t, Cell> cells;
+    std::vector<uint64_t> vertexCells(positions.size());
+    std::vector<bool> referenced(positions.size(), false);
+    for (const uint32_t index : indices) {
+        if (index >= positions.size() || referenced[index])
+            continue;
+        referenced[index] = true;
+        vertexCells[index] = cellKey(positions[index]);
+        Cell &cell = cells[vertexCells[index]];
+        cell.positionSum += positions[index];
+        ++cell.vertexCount;
+    }
+
+    // Pick the vertex closest to the average as the cell's representative
+    for (uint32_t vertex = 0; vertex < positions.size(); ++vertex) {
+        if (!referenced[vertex])
+            continue;
+        Cell &cell = cells[vertexCells[vertex]];
+        const float distance = glm::length(positions[vertex] - cell.positionSum / float(cell.vertexCount));
+        if (distance < cell.representativeDistance) {
+            cell.representativeDistance = distance;
+            cell.representative = vertex;
+        }
+    }
+
+    struct TriangleHash {
+        size_t operator()(const glm::uvec3 &t) const
+        {
+            return std::hash<uint64_t>()((uint64_t(t.x) << 32) ^ (uint64_t(t.y) << 16) ^ uint64_t(t.z));
+        }
+    };
+    std::unordered_set<glm::uvec3, TriangleHash> emittedTriangles;
+
+    std::vector<uint32_t> simplified;
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        if (indices[i] >= positions.size() || indices[i + 1] >= positions.size() || indices[i + 2] >= positions.size())
+            continue;
+
+        const uint32_t a = cells[vertexCells[indices[i]]].representative;
+        const uint32_t b = cells[vertexCells[indices[i + 1]]].representative;
+        const uint32_t c = cells[vertexCells[indices[i + 2]]].representative;
+        if (a == b || b == c || a == c)
+            continue;
+
+        // Rotate (keeping the winding) so that the smallest index comes first
+        glm::uvec3 triangle(a, b, c);
+        if (b < a && b < c)
+            triangle = glm::uvec3(b, c, a);
+        else if (c < a && c < b)
+            triangle = glm::uvec3(c, a, b);
+        if (!emittedTriangles.insert(triangle).second)
+            continue;
+
+        simplified.insert(simplified.end(), { triangle.x, triangle.y, triangle.z });
+    }
+    return simplified;
+}
+
+PrimitiveLods generatePrimitiveLods(const tinygltf::Model &model,
+                                    const tinygltf::Primitive &primitive,
+                                    std::vector<uint32_t> &lodIndices)
+{
+    PrimitiveLods primitiveLods;
+
+    std::vector<glm::vec3> positions;
+    if (!readPositions(model, primitive, positions) || positions.empty())
+        return primitiveLods;
+
+    glm::vec3 boundsMin;
+    primitiveLods.boundingSphere = boundingSphereForPositions(positions, boundsMin);
+
+    const bool isTriangleList = primitive.mode == -1 || primitive.mode == TINYGLTF_MODE_TRIANGLES;
+    std::vector<uint32_t> indices;
+    const bool hasIndices = isTriangleList && primitive.indices != -1 && readIndices(model, primitive, indices);
+
+    // Texture streaming picks mip levels from the density
+    std::vector<glm::vec2> texcoords;
+    if (isTriangleList && (hasIndices || primitive.indices == -1) &&
+        readTexcoords(model, primitive, texcoords) && texcoords.size() == positions.size())
+        primitiveLods.texcoordDensity = texcoordDensity(positions, texcoords, indices);
+
+    if (!isTriangleList || !hasIndices)
+        return primitiveLods;
+
+    const float diameter = 2.0f * primitiveLods.boundingSphere.radius;
+    if (diameter <= 0.0f)
+        return primitiveLods;
+
+    size_t previousIndexCount = indices.size();
+    for (const float gridResolution : LodGridResolutions) {
+        const float cellSize = diameter / gridResolution;
+        std::vector<uint32_t> simplified = simplifyByVertexClustering(positions, indices, boundsMin, cellSize);
+        if (simplified.empty())
+            break;
+        if (float(simplified.size()) > (1.0f - MinLodReduction) * float(previousIndexCount))
+            continue;
+
+        primitiveLods.lods.push_back(LodIndexRange{
+                .firstIndex = static_cast<uint32_t>(lodIndices.size()),
+                .indexCount = static_cast<uint32_t>(simplified.size()),
+                .error = cellSize * 1.7320508f }); // a vertex moves at most one cell diagonal
+        lodIndices.insert(lodIndices.end(), simplified.begin(), simplified.end());
+        previousIndexCount = simplified.size();
+    }
+
+    return primitiveLods;
+}
+
+float texcoordDensity(std::span<const glm::vec3> positions,
+                      std::span<const glm::vec2> texcoords,
+                      std::span<const uint32_t> indices)
+{
+    const size_t indexCount = indices.empty() ? positions.size() : indices.size();
+    auto vertex = [&](size_t i) { return indices.empty() ? uint32_t(i) : indices[i]; };
+
+    double surfaceArea = 0.0;
+    double texcoordArea = 0.0;
+    for (size_t i = 0; i + 2 < indexCount; i += 3) {
+        const uint32_t a = vertex(i);
+        const uint32_t b = vertex(i + 1);
+        const uint32_t c = vertex(i + 2);
+        if (a >= positions.size() || b >= positions.size() || c >= positions.size())
+            continue;
+
+        surfaceArea += 0.5 * glm::length(glm::cross(positions[b] - positions[a], positions[c] - positions[a]));
+        const glm::vec2 ab = texcoords[b] - texcoords[a];
+        const glm::vec2 ac = texcoords[c] - texcoords[a];
+        texcoordArea += 0.5 * std::abs(double(ab.x) * ac.y - double(ab.y) * ac.x);
+    }
+
+    if (surfaceArea <= 0.0 || texcoordArea <= 0.0)
+        return 0.0f;
+    return static_cast<float>(std::sqrt(texcoordArea / surfaceArea));
+}
+
+uint32_t selectLod(const LodSelection &selection,
+                   const glm::mat4 &worldMatrix,
+                   const BoundingSphere &boundingSphere,
+                   std::span<const float> lodErrors)
+{
+    if (!selection.enabled || lodErrors.size() <= 1)
+        return 0;
+
+    const float worldScale = std::max({ glm::length(glm::vec3(worldMatrix[0])),
+                                        glm::length(glm::vec3(worldMatrix[1])),
+                                        glm::length(glm::vec3(worldMatrix[2])) });
+    const glm::vec3 viewCenter = glm::vec3(selection.viewMatrix * worldMatrix * glm::vec4(boundingSphere.center, 1.0f));
+    const float distance = glm::length(viewCenter);
+
+    // Always use the full detail when the camera is inside the bounds
+    if (distance <= boundingSphere.radius * worldScale)
+        return 0;
+
+    const float pixelsPerUnit = selection.pixelsPerUnitAtUnitDistance * worldScale / distance;
+    uint32_t lod = 0;
+    for (uint32_t level = 1; level < lodErrors.size(); ++level) {
+        if (lodErrors[level] * pixelsPerUnit > selection.maxPixelError)
+            break;
+        lod = level;
+    }
+    return lod;
+}
+
+} // namespace kdgpu_ext::gltf_holder::mesh_lod
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <tiny_gltf.h>
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace kdgpu_ext::gltf_holder::mesh_lod {
+
+// LOD 0 (the original indices) plus up to three simplified levels
+constexpr size_t MaxLodCount = 4;
+
+struct BoundingSphere {
+    glm::vec3 center{ 0.0f };
+    float radius{ 0.0f };
+};
+
+// One simplified level of a primitive, stored in a shared uint32 index list
+struct LodIndexRange {
+    uint32_t firstIndex{ 0 };
+    uint32_t indexCount{ 0 };
+    float error{ 0.0f }; // maximum displacement of a vertex in model space
+};
+
+struct PrimitiveLods {
+    BoundingSphere boundingSphere;
+    // TEXCOORD_0 units per model space unit, averaged over the triangles. 0 when the
+    // primitive has no float texture coordinates.
+    float texcoordDensity{ 0.0f };
+    std::vector<LodIndexRange> lods; // coarser levels only, ordered from fine to coarse
+};
+
+// Controls which LOD gets picked for a node from its projected size
+struct LodSelection {
+    bool enabled = true;
+    float maxPixelError = 1.0f;
+
+    glm::mat4 viewMatrix{ 1.0f };
+    float pixelsPerUnitAtUnitDistance = 0.0f; // projection[1][1] * viewport height / 2
+};
+
+/**
+ * Simplifies an indexed triangle list by snapping every vertex onto the vertex of its
+ * grid cell that is closest to the cell's average position. Triangles collapsing to a
+ * line or point and duplicated triangles are dropped. As the result references the
+ * original vertices it can be drawn with the primitive's vertex buffers.
+ */
+std::vector<uint32_t> simplifyByVertexClustering(std::span<const glm::vec3> positions,
+                                                 std::span<const uint32_t> indices,
+                                                 const glm::vec3 &gridOrigin,
+                                                 float cellSize);
+
+/**
+ * Generates up to MaxLodCount - 1 coarser levels for an indexed triangle list primitive,
+ * appending their indices to lodIndices. Levels which do not remove a meaningful amount
+ * of triangles are skipped. Returns no levels for other primitives.
+ */
+PrimitiveLods generatePrimitiveLods(const tinygltf::Model &model,
+                                    const tinygltf::Primitive &primitive,
+                                    std::vector<uint32_t> &lodIndices);
+
+/**
+ * Square root of the ratio of the texture coordinate area to the model space area of an
+ * indexed or non-indexed triangle list, i.e. how many TEXCOORD_0 units a unit of the
+ * surface spans. 0 for degenerate primitives.
+ */
+float texcoordDensity(std::span<const glm::vec3> positions,
+                      std::span<const glm::vec2> texcoords,
+                      std::span<const uint32_t> indices);
+
+/**
+ * Picks the coarsest level whose error, projected to the screen, stays below the allowed
+ * pixel error. lodErrors[0] is the error of the original geometry (0).
+ */
+uint32_t selectLod(const LodSelection &selection,
+                   const glm::mat4 &worldMatrix,
+                   const BoundingSphere &boundingSphere,
+                   std::span<const float> lodErrors);
+
+} // namespace kdgpu_ext::gltf_holder::mesh_lod
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <KDGpu/device.h>
+#include <KDGpu/graphics_pipeline.h>
+#include <KDGpu/graphics_pipeline_options.h>
+#include <KDGpu/utils/hash_utils.h>
+
+#include <unordered_map>
+
+namespace kdgpu_ext::gltf_holder::render_mesh_set {
+
+/**
+ * What differs between the pipelines of the primitives of a pass: the vertex layout and the topology.
+ * Shader stages, pipeline layout and render target are the same for all of them.
+ */
+struct GraphicsPipelineKey {
+    KDGpu::PrimitiveTopology topology{ KDGpu::PrimitiveTopology::TriangleList };
+    KDGpu::VertexOptions vertexOptions;
+
+    bool operator==(const GraphicsPipelineKey &other) const noexcept
+    {
+        if (topology != other.topology)
+            return false;
+
+        if (vertexOptions.buffers.size() != other.vertexOptions.buffers.size() ||
+            vertexOptions.attributes.size() != other.vertexOptions.attributes.size())
+            return false;
+
+        for (size_t i = 0; i < vertexOptions.buffers.size(); ++i) {
+            const auto &buffer = vertexOptions.buffers[i];
+            const auto &otherBuffer = other.vertexOptions.buffers[i];
+            if (buffer.binding != otherBuffer.binding || buffer.stride != otherBuffer.stride ||
+                buffer.inputRate != otherBuffer.inputRate)
+                return false;
+        }
+
+        for (size_t i = 0; i < vertexOptions.attributes.size(); ++i) {
+            const auto &attribute = vertexOptions.attributes[i];
+            const auto &otherAttribute = other.vertexOptions.attributes[i];
+            if (attribute.location != otherAttribute.location || attribute.binding != otherAttribute.binding ||
+                attribute.format != otherAttribute.format || attribute.offset != otherAttribute.offset)
+                return false;
+        }
+
+        return true;
+    }
+};
+
+struct GraphicsPipelineKeyHash {
+    size_t operator()(const GraphicsPipelineKey &key) const
+    {
+        uint64_t hash = 0;
+        KDGpu::hash_combine(hash, key.topology);
+        for (const auto &buffer : key.vertexOptions.buffers) {
+            KDGpu::hash_combine(hash, buffer.binding);
+            KDGpu::hash_combine(hash, buffer.stride);
+            KDGpu::hash_combine(hash, buffer.inputRate);
+        }
+        for (const auto &attribute : key.vertexOptions.attributes) {
+            KDGpu::hash_combine(hash, attribute.location);
+            KDGpu::hash_combine(hash, attribute.binding);
+            KDGpu::hash_combine(hash, attribute.format);
+            KDGpu::hash_combine(hash, attribute.offset);
+        }
+        return hash;
+    }
+};
+
+/**
+ * Owns the pipelines of one pass, one per distinct vertex layout and topology instead of one per primitive.
+ * Only valid for a single combination of shader stages, pipeline layout and render target, so it has to be
+ * cleared whenever one of those changes. Can be shared by all models rendered with that combination.
+ */
+class GraphicsPipelineCache
+{
+public:
+    KDGpu::Handle<KDGpu::GraphicsPipeline_t> findOrCreate(KDGpu::Device &device, const KDGpu::GraphicsPipelineOptions &options)
+    {
+        GraphicsPipelineKey key{ .topology = options.primitive.topology, .vertexOptions = options.vertex };
+
+        const auto pipelineIt = m_pipelines.find(key);
+        if (pipelineIt != m_pipelines.end())
+            return pipelineIt->second.handle();
+
+        KDGpu::GraphicsPipeline pipeline = device.createGraphicsPipeline(options);
+        const auto pipelineHandle = pipeline.handle();
+        m_pipelines.insert({ std::move(key), std::move(pipeline) });
+        return pipelineHandle;
+    }
+
+    size_t size() const { return m_pipelines.size(); }
+
+    void clear() { m_pipelines.clear(); }
+
+private:
+    std::unordered_map<GraphicsPipelineKey, KDGpu::GraphicsPipeline, GraphicsPipelineKeyHash> m_pipelines;
+};
+
+} // namespace kdgpu_ext::gltf_holder::render_mesh_set
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <array>
 #include <optional>
 
 #include <KDGpu/graphics_pipeline.h>
@@ -8,6 +9,8 @@
 #include "buffer_and_offset.h"
 #include "indexed_draw.h"
 
+#include <GltfHolder/mesh_lod/mesh_lod.h>
+
 namespace kdgpu_ext::gltf_holder::render_mesh_set {
 struct PrimitiveData {
     KDGpu::Handle<KDGpu::GraphicsPipeline_t> pipeline;
@@ -23,7 +26,13 @@ struct PrimitiveData {
 
     union {
         uint32_t vertexCount;
-        IndexedDraw indexedDraw;
+        // one index range per level of detail, [0] being the original indices of the primitive
+        std::array<IndexedDraw, mesh_lod::MaxLodCount> indexedDraws;
     } drawData;
+
+    // levels of detail generated at load (indexed triangle lists only)
+    uint32_t lodCount{ 1 };
+    std::array<float, mesh_lod::MaxLodCount> lodErrors{};
+    mesh_lod::BoundingSphere boundingSphere;
 };
 }
@@ -32,6 +32,7 @@ struct GltfRenderPermutation {
         materials.initialize(
             holder->model(),
             holder->textures(),
+            holder->texturePlacements(),
             shadingMaterial
             );
     }
@@ -46,14 +47,16 @@ struct GltfRenderPermutation {
             const RenderTarget &renderTarget,
             std::vector<ShaderStage> shaderStages,
             const shader_specification::GltfShaderVertexInput & shaderVertexInput,
-            PipelineLayout& pipelineLayout)
+            PipelineLayout& pipelineLayout,
+            render_mesh_set::GraphicsPipelineCache& pipelineCache)
     {
         holder->createGraphicsRenderingPipelinesForMeshSet(
                 meshSet,
                 renderTarget,
                 shaderStages,
                 shaderVertexInput,
-                pipelineLayout);
+                pipelineLayout,
+                pipelineCache);
     }
 };
 }
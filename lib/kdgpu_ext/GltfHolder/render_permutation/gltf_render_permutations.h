@@ -3,6 +3,8 @@
 #include <GltfHolder/gltf_holder_global.h>
 #include <GltfHolder/render_permutation/gltf_render_permutation.h>
 
+#include <spdlog/spdlog.h>
+
 namespace kdgpu_ext::gltf_holder {
 
 struct GltfRenderPermutations {
@@ -10,6 +12,14 @@ struct GltfRenderPermutations {
 
     PipelineLayout pipelineLayout;
 
+    // pipelines of all permutations, they share the pipeline layout, shader stages and render target
+    render_mesh_set::GraphicsPipelineCache pipelineCache;
+
+    // state changes recorded and filtered out by the last call to render()
+    graphics::command::StateFilterStats lastRenderStateStats;
+    // draws per level of detail of the last call to render()
+    GltfLodStats lastLodStats;
+
     void initialize_pipeline_layout(
             const shader_specification::GltfShaderTextureChannels &shaderTextureChannels,
             const std::vector<PushConstantRange> pushConstantRanges)
@@ -38,6 +48,8 @@ struct GltfRenderPermutations {
 
         for (auto &push_constant_range : pushConstantRanges)
             pipelineLayoutOptions.pushConstantRanges.push_back(push_constant_range);
+        if (shaderTextureChannels.texturePlacementPushConstantRange.has_value())
+            pipelineLayoutOptions.pushConstantRanges.push_back(shaderTextureChannels.texturePlacementPushConstantRange.value());
 
         pipelineLayout = graphics::GlobalResources::instance().graphicsDevice().createPipelineLayout(pipelineLayoutOptions);
     }
@@ -52,8 +64,28 @@ struct GltfRenderPermutations {
                     renderTarget,
                     shaderStages,
                     shaderVertexInput,
-                    pipelineLayout);
+                    pipelineLayout,
+                    pipelineCache);
         }
+
+        size_t primitiveCount = 0;
+        for (const auto &permutation : permutations)
+            primitiveCount += permutation.meshSet.primitiveData.size();
+        spdlog::debug("{} primitives in {} permutations use {} pipelines", primitiveCount, permutations.size(), pipelineCache.size());
+    }
+
+    // drops the pipelines of all permutations and creates them again, e.g. after the
+    // depth state of the render target changed. The caller makes sure the GPU is idle.
+    void recreate_pipelines(const RenderTarget& renderTarget,
+        const std::vector<ShaderStage>& shaderStages,
+        const shader_specification::GltfShaderVertexInput& shaderVertexInput
+        )
+    {
+        for (auto &permutation : permutations)
+            permutation.meshSet.deinitialize();
+        pipelineCache.clear();
+
+        create_pipelines(renderTarget, shaderStages, shaderVertexInput);
     }
 
     void add_permutation(
@@ -74,13 +106,23 @@ struct GltfRenderPermutations {
         for (auto &permutation : permutations)
             permutation.deinitialize();
 
+        pipelineCache.clear();
         pipelineLayout = {};
     }
 
     void render(RenderPassCommandRecorder& renderPass)
     {
+        // the pass binds its own bind groups directly, so only track state from here on
+        graphics::command::StateFilteringRenderPassRecorder filteringRenderPass(renderPass);
+        render(filteringRenderPass);
+        lastRenderStateStats = filteringRenderPass.stats();
+    }
+
+    void render(graphics::command::StateFilteringRenderPassRecorder& renderPass)
+    {
+        lastLodStats = {};
         for (auto &permutation : permutations)
-            permutation.holder->renderAllNodes(renderPass, permutation, pipelineLayout);
+            permutation.holder->renderAllNodes(renderPass, permutation, pipelineLayout, lastLodStats);
     }
 };
 } // namespace kdgpu_ext::gltf_holder
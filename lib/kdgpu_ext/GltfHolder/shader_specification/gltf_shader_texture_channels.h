@@ -4,6 +4,7 @@
 #include <KDGpu/bind_group_layout_options.h>
 
 #include <GltfHolder/shader_specification/gltf_shader_bind_group_set.h>
+#include <GltfHolder/shader_specification/gltf_shader_texture_placement.h>
 
 namespace kdgpu_ext::gltf_holder::shader_specification {
 
@@ -30,6 +31,10 @@ struct GltfShaderTextureChannels
     std::optional<size_t> occlusionFragmentShaderBinding = std::nullopt;
     std::optional<size_t> emissionFragmentShaderBinding = std::nullopt;
 
+    // set by shaders that sample the channels as sampler2DArray, which models loaded with
+    // texture packing need. The placement of each channel's image is pushed per material.
+    std::optional<KDGpu::PushConstantRange> texturePlacementPushConstantRange = std::nullopt;
+
     void initializeBindGroupLayout()
     {
         KDGpu::BindGroupLayoutOptions bindGroupLayoutOptions;
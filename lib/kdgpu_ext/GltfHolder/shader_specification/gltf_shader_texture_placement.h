@@ -0,0 +1,52 @@
+#pragma once
+
+#include <KDGpu/pipeline_layout_options.h>
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstdint>
+
+namespace kdgpu_ext::gltf_holder::shader_specification {
+
+// index of each texture channel in GltfShaderTexturePlacements
+enum class GltfTextureChannel : uint32_t {
+    BaseColor = 0,
+    MetallicRoughness = 1,
+    Normal = 2,
+    Occlusion = 3,
+    Emission = 4
+};
+
+// Where the image of each texture channel of a material is, for models loaded with texture
+// packing. Matches this push constant block, which the shader samples sampler2DArray with:
+//
+// layout(push_constant) uniform TexturePlacements {
+//     vec4 uv_rect[5]; // xy offset, zw scale of the image in its layer
+//     float layer[5];
+// } placements;
+struct GltfShaderTexturePlacements {
+    std::array<glm::vec4, 5> uvRects{ glm::vec4(0.0f, 0.0f, 1.0f, 1.0f), glm::vec4(0.0f, 0.0f, 1.0f, 1.0f),
+                                      glm::vec4(0.0f, 0.0f, 1.0f, 1.0f), glm::vec4(0.0f, 0.0f, 1.0f, 1.0f),
+                                      glm::vec4(0.0f, 0.0f, 1.0f, 1.0f) };
+    std::array<float, 5> layers{};
+
+    void set(GltfTextureChannel channel, uint32_t layer, const glm::vec4 &uvRect)
+    {
+        uvRects[static_cast<uint32_t>(channel)] = uvRect;
+        layers[static_cast<uint32_t>(channel)] = static_cast<float>(layer);
+    }
+
+    bool operator==(const GltfShaderTexturePlacements &other) const = default;
+};
+
+inline KDGpu::PushConstantRange texturePlacementPushConstantRange()
+{
+    return {
+        .offset = 0,
+        .size = sizeof(GltfShaderTexturePlacements),
+        .shaderStages = KDGpu::ShaderStageFlags(KDGpu::ShaderStageFlagBits::FragmentBit)
+    };
+}
+
+} // namespace kdgpu_ext::gltf_holder::shader_specification
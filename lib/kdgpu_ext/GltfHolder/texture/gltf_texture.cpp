@@ -5,10 +5,18 @@
 #include <KDGpu/texture_options.h>
 
 #include <global_resources.h>
+#include <texture/mip_generation.h>
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include <utility>
 
 using namespace KDGpu;
 
-void GltfTexture::initialize(const tinygltf::Image &gltfImage, Queue &queue)
+void GltfTexture::initialize(const tinygltf::Image &gltfImage, kdgpu_ext::graphics::texture::TextureUploader &uploader)
 {
     using namespace kdgpu_ext::graphics;
 
@@ -23,13 +31,18 @@ void GltfTexture::initialize(const tinygltf::Image &gltfImage, Queue &queue)
         .type = TextureType::TextureType2D,
         .format = Format::R8G8B8A8_UNORM,
         .extent = extent,
-        .mipLevels = 1,
+        .mipLevels = texture::mipLevelCount(extent.width, extent.height),
         .usage = TextureUsageFlagBits::SampledBit | TextureUsageFlagBits::TransferDstBit,
         .memoryUsage = MemoryUsage::GpuOnly
     };
     // clang-format on
 
-    m_texture = GlobalResources::instance().graphicsDevice().createTexture(textureOptions);
+    Device &device = GlobalResources::instance().graphicsDevice();
+    m_texture = device.createTexture(textureOptions);
+
+    // Build the mip chain on the CPU and upload all levels at once, a blit chain would need
+    // a submission of its own after the upload batch
+    const texture::MipChain mipChain = texture::generateMipChain(gltfImage.image.data(), extent.width, extent.height, 4, textureOptions.mipLevels);
 
     // Upload the texture data and transition to ShaderReadOnlyOptimal
     // clang-format off
@@ -37,14 +50,11 @@ void GltfTexture::initialize(const tinygltf::Image &gltfImage, Queue &queue)
         .destinationTexture = m_texture,
         .dstStages = PipelineStageFlagBit::AllGraphicsBit,
         .dstMask = AccessFlagBit::MemoryReadBit,
-        .data = gltfImage.image.data(),
-        .byteSize = gltfImage.image.size(),
+        .data = mipChain.data.data(),
+        .byteSize = mipChain.data.size(),
         .oldLayout = TextureLayout::Undefined,
         .newLayout = TextureLayout::ShaderReadOnlyOptimal,
-        .regions = {{
-            .textureSubResource = { .aspectMask = TextureAspectFlagBits::ColorBit },
-            .textureExtent = extent
-        }}
+        .regions = mipChain.regions
     };
 
     // clang-format on
@@ -53,12 +63,148 @@ void GltfTexture::initialize(const tinygltf::Image &gltfImage, Queue &queue)
     m_validForUse = false;
 
     // queue the upload
-    m_stagingBuffer = queue.uploadTextureData(uploadOptions);
+    m_uploadValue = uploader.upload(uploadOptions);
+    m_textureView = createTextureView(m_texture);
+
+    createSampler();
+}
+
+void GltfTexture::initializeCompressed(const kdgpu_ext::graphics::texture::CompressedImage &image, kdgpu_ext::graphics::texture::TextureUploader &uploader)
+{
+    using namespace kdgpu_ext::graphics;
+
+    // clang-format off
+    const TextureOptions textureOptions = {
+        .type = TextureType::TextureType2D,
+        .format = image.format,
+        .extent = image.extent,
+        .mipLevels = image.mipLevels,
+        .arrayLayers = image.arrayLayers,
+        .usage = TextureUsageFlagBits::SampledBit | TextureUsageFlagBits::TransferDstBit,
+        .memoryUsage = MemoryUsage::GpuOnly
+    };
+    // clang-format on
+
+    Device &device = GlobalResources::instance().graphicsDevice();
+    m_texture = device.createTexture(textureOptions);
+
+    // Upload all levels and transition to ShaderReadOnlyOptimal
+    // clang-format off
+    const TextureUploadOptions uploadOptions = {
+        .destinationTexture = m_texture,
+        .dstStages = PipelineStageFlagBit::AllGraphicsBit,
+        .dstMask = AccessFlagBit::MemoryReadBit,
+        .data = image.data.data(),
+        .byteSize = image.data.size(),
+        .oldLayout = TextureLayout::Undefined,
+        .newLayout = TextureLayout::ShaderReadOnlyOptimal,
+        .regions = image.regions
+    };
+    // clang-format on
+
+    // while texture is uploaded it can not be used
+    m_validForUse = false;
+    m_uploadValue = uploader.upload(uploadOptions);
+    m_textureView = createTextureView(m_texture);
+    createSampler();
+}
+
+void GltfTexture::initializeStreamed(kdgpu_ext::graphics::texture::CompressedImage levels, uint32_t firstResidentLevel, kdgpu_ext::graphics::texture::TextureUploader &uploader)
+{
+    m_streamedLevels = std::move(levels);
+
+    // levels are stored largest (mip chains) or smallest (KTX2) first, with padding in between
+    std::vector<uint32_t> levelsByOffset(m_streamedLevels.regions.size());
+    std::iota(levelsByOffset.begin(), levelsByOffset.end(), 0);
+    std::sort(levelsByOffset.begin(), levelsByOffset.end(), [this](uint32_t a, uint32_t b) {
+        return m_streamedLevels.regions[a].bufferOffset < m_streamedLevels.regions[b].bufferOffset;
+    });
+    m_levelByteSizes.assign(m_streamedLevels.regions.size(), 0);
+    for (size_t i = 0; i < levelsByOffset.size(); ++i) {
+        const DeviceSize end = i + 1 < levelsByOffset.size() ? m_streamedLevels.regions[levelsByOffset[i + 1]].bufferOffset : m_streamedLevels.data.size();
+        m_levelByteSizes[levelsByOffset[i]] = end - m_streamedLevels.regions[levelsByOffset[i]].bufferOffset;
+    }
+
+    // the first upload is used directly, like the one of a regular texture
+    uploadLevels(firstResidentLevel, uploader);
+    m_texture = std::exchange(m_pendingTexture, {});
+    m_textureView = std::exchange(m_pendingTextureView, {});
+    m_uploadValue = m_pendingUploadValue;
+    m_residentLevel = firstResidentLevel;
+    m_validForUse = false;
+    createSampler();
+}
+
+uint32_t GltfTexture::levelSize(uint32_t level) const
+{
+    const Extent3D &extent = m_streamedLevels.regions.at(level).textureExtent;
+    return std::max(extent.width, extent.height);
+}
+
+size_t GltfTexture::levelsByteSize(uint32_t firstLevel) const
+{
+    return std::accumulate(m_levelByteSizes.begin() + std::min<size_t>(firstLevel, m_levelByteSizes.size()), m_levelByteSizes.end(), size_t(0));
+}
+
+void GltfTexture::streamLevels(uint32_t firstLevel, kdgpu_ext::graphics::texture::TextureUploader &uploader)
+{
+    if (!isStreamed() || isStreaming() || firstLevel == m_residentLevel || firstLevel >= levelCount())
+        return;
+    uploadLevels(firstLevel, uploader);
+}
+
+void GltfTexture::uploadLevels(uint32_t firstLevel, kdgpu_ext::graphics::texture::TextureUploader &uploader)
+{
+    using namespace kdgpu_ext::graphics;
+
+    // clang-format off
+    const TextureOptions textureOptions = {
+        .type = TextureType::TextureType2D,
+        .format = m_streamedLevels.format,
+        .extent = m_streamedLevels.regions[firstLevel].textureExtent,
+        .mipLevels = m_streamedLevels.mipLevels - firstLevel,
+        .usage = TextureUsageFlagBits::SampledBit | TextureUsageFlagBits::TransferDstBit,
+        .memoryUsage = MemoryUsage::GpuOnly
+    };
+    // clang-format on
+
+    Device &device = GlobalResources::instance().graphicsDevice();
+    m_pendingTexture = device.createTexture(textureOptions);
 
-    // create a view
-    m_textureView = m_texture.createView();
+    // the levels from firstLevel on are next to each other whichever way round they are stored
+    DeviceSize rangeBegin = std::numeric_limits<DeviceSize>::max();
+    DeviceSize rangeEnd = 0;
+    for (uint32_t level = firstLevel; level < m_streamedLevels.mipLevels; ++level) {
+        rangeBegin = std::min(rangeBegin, m_streamedLevels.regions[level].bufferOffset);
+        rangeEnd = std::max(rangeEnd, m_streamedLevels.regions[level].bufferOffset + m_levelByteSizes[level]);
+    }
+
+    std::vector<BufferTextureCopyRegion> regions(m_streamedLevels.regions.begin() + firstLevel, m_streamedLevels.regions.end());
+    for (auto &region : regions) {
+        region.bufferOffset -= rangeBegin;
+        region.textureSubResource.mipLevel -= firstLevel;
+    }
 
-    // create sampler
+    // clang-format off
+    const TextureUploadOptions uploadOptions = {
+        .destinationTexture = m_pendingTexture,
+        .dstStages = PipelineStageFlagBit::AllGraphicsBit,
+        .dstMask = AccessFlagBit::MemoryReadBit,
+        .data = m_streamedLevels.data.data() + rangeBegin,
+        .byteSize = rangeEnd - rangeBegin,
+        .oldLayout = TextureLayout::Undefined,
+        .newLayout = TextureLayout::ShaderReadOnlyOptimal,
+        .regions = regions
+    };
+    // clang-format on
+
+    m_pendingUploadValue = uploader.upload(uploadOptions);
+    m_pendingTextureView = createTextureView(m_pendingTexture);
+    m_pendingLevel = firstLevel;
+}
+
+void GltfTexture::createSampler()
+{
     SamplerOptions samplerOptions = {
         .magFilter = FilterMode::Linear,
         .minFilter = FilterMode::Linear,
@@ -66,23 +212,40 @@ void GltfTexture::initialize(const tinygltf::Image &gltfImage, Queue &queue)
         .u = AddressMode::Repeat,
         .v = AddressMode::Repeat
     };
-    m_sampler = GlobalResources::instance().graphicsDevice().createSampler(samplerOptions);
+    m_sampler = kdgpu_ext::graphics::GlobalResources::instance().sampler(samplerOptions);
+}
+
+TextureView GltfTexture::createTextureView(Texture &texture) const
+{
+    if (!m_arrayView)
+        return texture.createView();
+    return texture.createView({ .viewType = ViewType::ViewType2DArray });
 }
 
 void GltfTexture::deinitialize()
 {
     m_texture = {};
     m_textureView = {};
-    m_stagingBuffer = {};
+    m_uploadValue = 0;
     m_sampler = {};
+    m_pendingTextureView = {};
+    m_pendingTexture = {};
+    m_pendingUploadValue = 0;
+    m_streamedLevels = {};
+    m_levelByteSizes.clear();
 }
 
-void GltfTexture::update()
+void GltfTexture::update(const kdgpu_ext::graphics::texture::TextureUploader &uploader, kdgpu_ext::graphics::resource::DeferredRelease &retiredResources)
 {
-    if (!m_validForUse) {
-        if (m_stagingBuffer.fence.status() == FenceStatus::Signalled) {
-            m_validForUse = true;
-            m_stagingBuffer = {};
-        }
+    // images packed into an array keep an empty texture
+    if (!m_validForUse && m_texture.isValid() && uploader.isComplete(m_uploadValue))
+        m_validForUse = true;
+
+    // swap in the streamed levels, frames recorded before may still sample the old texture
+    if (m_pendingTexture.isValid() && uploader.isComplete(m_pendingUploadValue)) {
+        retiredResources.retire(std::exchange(m_textureView, std::exchange(m_pendingTextureView, {})));
+        retiredResources.retire(std::exchange(m_texture, std::exchange(m_pendingTexture, {})));
+        m_residentLevel = m_pendingLevel;
+        ++m_generation;
     }
 }
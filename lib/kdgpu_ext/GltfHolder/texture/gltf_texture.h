@@ -5,24 +5,85 @@
 #include <KDGpu/sampler.h>
 #include <KDGpu/texture.h>
 
+#include <resource/deferred_release.h>
+#include <texture/block_compression.h>
+#include <texture/texture_uploader.h>
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+// The texture holding the pixels of a glTF image, which may be shared with other images as
+// layers of a packed array
+struct GltfTexturePlacement {
+  uint32_t textureIndex = 0; // into GltfHolder::textures()
+  uint32_t layer = 0;
+  // xy offset and zw scale of the image's texture coordinates in the layer
+  glm::vec4 uvRect{ 0.0f, 0.0f, 1.0f, 1.0f };
+};
+
 class GltfTexture
 {
 public:
-  void initialize(const tinygltf::Image &image, KDGpu::Queue &queue);
+  // the uploads are recorded into the current batch of the uploader, which has to be flushed
+  void initialize(const tinygltf::Image &image, kdgpu_ext::graphics::texture::TextureUploader &uploader);
+  // uploads all levels (and layers) of a transcoded KTX2 image, of a mip chain built on the
+  // CPU or of packed texture arrays
+  void initializeCompressed(const kdgpu_ext::graphics::texture::CompressedImage &image, kdgpu_ext::graphics::texture::TextureUploader &uploader);
+  // keeps all levels on the CPU and only uploads the levels from firstResidentLevel on,
+  // more or fewer levels are made resident with streamLevels()
+  void initializeStreamed(kdgpu_ext::graphics::texture::CompressedImage levels, uint32_t firstResidentLevel, kdgpu_ext::graphics::texture::TextureUploader &uploader);
   void deinitialize();
-  void update();
+  // creates 2D array views, as shaders sampling packed textures declare sampler2DArray.
+  // Has to be set before initializing.
+  void setArrayView(bool arrayView) { m_arrayView = arrayView; }
+  // replaced textures and views are handed to retiredResources as frames may still use them
+  void update(const kdgpu_ext::graphics::texture::TextureUploader &uploader, kdgpu_ext::graphics::resource::DeferredRelease &retiredResources);
   bool isValid() { return m_validForUse; }
+  // trilinear and repeating, for users that do not know the glTF sampler of the texture
   KDGpu::Handle<KDGpu::Sampler_t> samplerHandle() { return m_sampler;}
   KDGpu::Handle<KDGpu::TextureView_t> textureViewHandle() { return m_textureView;}
-  KDGpu::Sampler& sampler() { return m_sampler;}
   KDGpu::TextureView& textureView() { return m_textureView;}
   KDGpu::Texture& texture() { return m_texture; }
 
+  // streaming
+  bool isStreamed() const { return !m_streamedLevels.regions.empty(); }
+  uint32_t levelCount() const { return m_streamedLevels.mipLevels; }
+  // largest side of a level of the full image
+  uint32_t levelSize(uint32_t level) const;
+  // first level of the full image the current texture holds
+  uint32_t residentLevel() const { return m_residentLevel; }
+  // whether a texture with other levels is being uploaded
+  bool isStreaming() const { return m_pendingTexture.isValid(); }
+  // the level being uploaded if streaming, otherwise the resident one
+  uint32_t requestedLevel() const { return isStreaming() ? m_pendingLevel : m_residentLevel; }
+  // GPU memory taken by the levels from firstLevel on
+  size_t levelsByteSize(uint32_t firstLevel) const;
+  // uploads a texture holding the levels from firstLevel on, which replaces the current
+  // one in update() once uploaded. Ignored while another upload is in flight.
+  void streamLevels(uint32_t firstLevel, kdgpu_ext::graphics::texture::TextureUploader &uploader);
+  // changes whenever the view does, bind groups using an older one have to be recreated
+  uint32_t generation() const { return m_generation; }
 
 private:
+  void createSampler();
+  KDGpu::TextureView createTextureView(KDGpu::Texture &texture) const;
+  void uploadLevels(uint32_t firstLevel, kdgpu_ext::graphics::texture::TextureUploader &uploader);
+
   bool m_validForUse = false;
+  bool m_arrayView = false;
   KDGpu::Texture m_texture;
   KDGpu::TextureView m_textureView;
-  KDGpu::UploadStagingBuffer m_stagingBuffer;
-  KDGpu::Sampler m_sampler;
+  uint64_t m_uploadValue = 0; // of the uploader batch holding the upload
+  KDGpu::Handle<KDGpu::Sampler_t> m_sampler; // owned by the sampler cache
+
+  // streaming: all levels on the CPU and the texture with other levels being uploaded
+  kdgpu_ext::graphics::texture::CompressedImage m_streamedLevels;
+  std::vector<size_t> m_levelByteSizes;
+  uint32_t m_residentLevel = 0;
+  uint32_t m_generation = 0;
+  KDGpu::Texture m_pendingTexture;
+  KDGpu::TextureView m_pendingTextureView;
+  uint64_t m_pendingUploadValue = 0;
+  uint32_t m_pendingLevel = 0;
 };
@@ -0,0 +1,160 @@
+#include "texture_streamer.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace kdgpu_ext::gltf_holder::texture_streaming {
+
+uint32_t mipTailLevel(const graphics::texture::CompressedImage &image, uint32_t mipTailSize)
+{
+    for (uint32_t level = 0; level < image.regions.size(); ++level) {
+        const auto &extent = image.regions[level].textureExtent;
+        if (std::max(extent.width, extent.height) <= mipTailSize)
+            return level;
+    }
+    return image.regions.empty() ? 0 : static_cast<uint32_t>(image.regions.size() - 1);
+}
+
+void TextureStreamer::initialize(const TextureStreamingOptions &options, std::vector<GltfTexture> &textures)
+{
+    m_options = options;
+    m_stats = {};
+    m_textures = &textures;
+    m_frame = 1;
+
+    m_states.assign(textures.size(), {});
+    for (size_t textureIndex = 0; textureIndex < textures.size(); ++textureIndex) {
+        const GltfTexture &texture = textures[textureIndex];
+        if (!texture.isStreamed())
+            continue;
+        // the tail is what got uploaded at load
+        m_states[textureIndex].tailLevel = texture.residentLevel();
+        m_states[textureIndex].wantedLevel = texture.residentLevel();
+    }
+}
+
+void TextureStreamer::deinitialize()
+{
+    m_textures = nullptr;
+    m_states.clear();
+}
+
+void TextureStreamer::beginFrame()
+{
+    ++m_frame;
+}
+
+void TextureStreamer::request(size_t textureIndex, float pixelsPerTexcoord)
+{
+    if (m_textures == nullptr || !(*m_textures)[textureIndex].isStreamed())
+        return;
+
+    // one unit of texture coordinates spans the whole image, so the level whose size is
+    // closest to the pixels covered gives about one texel per pixel
+    const GltfTexture &texture = (*m_textures)[textureIndex];
+    TextureState &state = m_states[textureIndex];
+    uint32_t level = state.tailLevel;
+    if (pixelsPerTexcoord > 0.0f) {
+        const float exactLevel = std::log2(float(texture.levelSize(0)) / pixelsPerTexcoord) + m_options.lodBias;
+        level = static_cast<uint32_t>(std::clamp(std::floor(exactLevel), 0.0f, float(state.tailLevel)));
+    }
+
+    // the finest level wins when a texture is used more than once
+    if (state.lastRequestedFrame != m_frame)
+        state.wantedLevel = level;
+    else
+        state.wantedLevel = std::min(state.wantedLevel, level);
+    state.lastRequestedFrame = m_frame;
+}
+
+void TextureStreamer::update(graphics::texture::TextureUploader &uploader)
+{
+    if (m_textures == nullptr)
+        return;
+    auto &textures = *m_textures;
+
+    // requested textures want the level they are seen at, the others keep theirs for now
+    std::vector<uint32_t> targetLevels(textures.size(), 0);
+    std::vector<size_t> streamedIndices;
+    size_t totalBytes = 0;
+    for (size_t textureIndex = 0; textureIndex < textures.size(); ++textureIndex) {
+        if (!textures[textureIndex].isStreamed())
+            continue;
+        const TextureState &state = m_states[textureIndex];
+        targetLevels[textureIndex] = state.lastRequestedFrame == m_frame ? state.wantedLevel : textures[textureIndex].requestedLevel();
+        totalBytes += textures[textureIndex].levelsByteSize(targetLevels[textureIndex]);
+        streamedIndices.push_back(textureIndex);
+    }
+    m_stats.wantedBytes = totalBytes;
+
+    auto dropLevel = [&](size_t textureIndex) {
+        const GltfTexture &texture = textures[textureIndex];
+        uint32_t &level = targetLevels[textureIndex];
+        totalBytes -= texture.levelsByteSize(level) - texture.levelsByteSize(level + 1);
+        ++level;
+    };
+
+    if (totalBytes > m_options.budgetBytes) {
+        // least recently seen first, the larger ones first among those seen in the same frame
+        std::sort(streamedIndices.begin(), streamedIndices.end(), [&](size_t a, size_t b) {
+            if (m_states[a].lastRequestedFrame != m_states[b].lastRequestedFrame)
+                return m_states[a].lastRequestedFrame < m_states[b].lastRequestedFrame;
+            return textures[a].levelsByteSize(targetLevels[a]) > textures[b].levelsByteSize(targetLevels[b]);
+        });
+
+        // textures out of view go down to their mip tail
+        for (const size_t textureIndex : streamedIndices) {
+            if (m_states[textureIndex].lastRequestedFrame == m_frame)
+                break;
+            while (totalBytes > m_options.budgetBytes && targetLevels[textureIndex] < m_states[textureIndex].tailLevel)
+                dropLevel(textureIndex);
+        }
+
+        // the visible ones lose a level each in turn, like a coarser LOD bias
+        bool dropped = true;
+        while (totalBytes > m_options.budgetBytes && dropped) {
+            dropped = false;
+            for (const size_t textureIndex : streamedIndices) {
+                if (m_states[textureIndex].lastRequestedFrame != m_frame || targetLevels[textureIndex] >= m_states[textureIndex].tailLevel)
+                    continue;
+                dropLevel(textureIndex);
+                dropped = true;
+                if (totalBytes <= m_options.budgetBytes)
+                    break;
+            }
+        }
+    }
+
+    // evict first as that frees memory, the largest improvements are streamed in first
+    std::vector<size_t> streamIns;
+    for (const size_t textureIndex : streamedIndices) {
+        GltfTexture &texture = textures[textureIndex];
+        if (texture.isStreaming() || targetLevels[textureIndex] == texture.residentLevel())
+            continue;
+        if (targetLevels[textureIndex] > texture.residentLevel()) {
+            texture.streamLevels(targetLevels[textureIndex], uploader);
+            ++m_stats.evictedCount;
+        } else {
+            streamIns.push_back(textureIndex);
+        }
+    }
+    std::sort(streamIns.begin(), streamIns.end(), [&](size_t a, size_t b) {
+        return textures[a].residentLevel() - targetLevels[a] > textures[b].residentLevel() - targetLevels[b];
+    });
+    for (size_t i = 0; i < streamIns.size() && i < m_options.maxUploadsPerFrame; ++i) {
+        textures[streamIns[i]].streamLevels(targetLevels[streamIns[i]], uploader);
+        ++m_stats.streamedInCount;
+    }
+
+    m_stats.residentBytes = 0;
+    m_stats.uploadsInFlight = 0;
+    for (const auto &texture : textures) {
+        if (!texture.isStreamed())
+            continue;
+        m_stats.residentBytes += texture.levelsByteSize(std::min(texture.residentLevel(), texture.requestedLevel()));
+        if (texture.isStreaming())
+            ++m_stats.uploadsInFlight;
+    }
+}
+
+} // namespace kdgpu_ext::gltf_holder::texture_streaming
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <GltfHolder/texture/gltf_texture.h>
+
+#include <texture/texture_uploader.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace kdgpu_ext::gltf_holder::texture_streaming {
+
+// has to be set before GltfHolder::load()
+struct TextureStreamingOptions {
+    bool enabled = false;
+    // GPU memory the textures of a model may take together, the mip tails are always resident
+    size_t budgetBytes = size_t(256) << 20;
+    // levels no larger than this are uploaded at load and never evicted
+    uint32_t mipTailSize = 64;
+    // added to the level picked from the texel density, negative values stream in sharper levels
+    float lodBias = 0.0f;
+    // spreads the uploads of a camera cut over several frames
+    uint32_t maxUploadsPerFrame = 4;
+};
+
+struct TextureStreamingStats {
+    size_t residentBytes = 0; // of the levels in use or being uploaded
+    size_t wantedBytes = 0;   // if every texture had the levels it is seen at
+    uint32_t uploadsInFlight = 0;
+    uint32_t streamedInCount = 0; // since load
+    uint32_t evictedCount = 0;    // since load
+};
+
+// first level no larger than mipTailSize, or the smallest level
+uint32_t mipTailLevel(const graphics::texture::CompressedImage &image, uint32_t mipTailSize);
+
+/**
+ * Picks the resident levels of streamed textures. Every frame the renderer reports how many
+ * screen pixels a unit of texture coordinates covers wherever a texture is used, which gives
+ * the finest level worth having. Textures not reported keep their levels until the budget
+ * runs out, then the least recently seen ones are reduced to their mip tail first.
+ */
+class TextureStreamer
+{
+public:
+    void initialize(const TextureStreamingOptions &options, std::vector<GltfTexture> &textures);
+    void deinitialize();
+
+    void setBudget(size_t budgetBytes) { m_options.budgetBytes = budgetBytes; }
+    const TextureStreamingOptions &options() const { return m_options; }
+    const TextureStreamingStats &stats() const { return m_stats; }
+
+    // starts collecting the requests of a frame
+    void beginFrame();
+    void request(size_t textureIndex, float pixelsPerTexcoord);
+    // fits the requests into the budget and records the uploads into the uploader's batch
+    void update(graphics::texture::TextureUploader &uploader);
+
+private:
+    struct TextureState {
+        uint32_t tailLevel = 0;
+        uint32_t wantedLevel = 0;
+        uint64_t lastRequestedFrame = 0;
+    };
+
+    TextureStreamingOptions m_options;
+    TextureStreamingStats m_stats;
+    std::vector<GltfTexture> *m_textures = nullptr;
+    std::vector<TextureState> m_states; // indexed as per the textures
+    uint64_t m_frame = 0;
+};
+
+} // namespace kdgpu_ext::gltf_holder::texture_streaming
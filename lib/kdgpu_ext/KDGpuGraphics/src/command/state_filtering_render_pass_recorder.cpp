@@ -0,0 +1,98 @@
+#include "state_filtering_render_pass_recorder.h"
+
+namespace kdgpu_ext::graphics::command {
+
+void StateFilterStats::add(const StateFilterStats &other)
+{
+    setPipelineCount += other.setPipelineCount;
+    setBindGroupCount += other.setBindGroupCount;
+    setVertexBufferCount += other.setVertexBufferCount;
+    setIndexBufferCount += other.setIndexBufferCount;
+    filteredSetPipelineCount += other.filteredSetPipelineCount;
+    filteredSetBindGroupCount += other.filteredSetBindGroupCount;
+    filteredSetVertexBufferCount += other.filteredSetVertexBufferCount;
+    filteredSetIndexBufferCount += other.filteredSetIndexBufferCount;
+}
+
+StateFilteringRenderPassRecorder::StateFilteringRenderPassRecorder(KDGpu::RenderPassCommandRecorder &recorder)
+    : m_recorder(recorder)
+{
+}
+
+void StateFilteringRenderPassRecorder::setPipeline(const KDGpu::Handle<KDGpu::GraphicsPipeline_t> &pipeline)
+{
+    if (pipeline.isValid() && pipeline == m_pipeline) {
+        ++m_stats.filteredSetPipelineCount;
+        return;
+    }
+
+    m_recorder.setPipeline(pipeline);
+    ++m_stats.setPipelineCount;
+    m_pipeline = pipeline;
+
+    // Bind groups set with an implicit layout may be disturbed by the new pipeline layout
+    for (auto &bound : m_bindGroups) {
+        if (!bound.pipelineLayout.isValid())
+            bound = {};
+    }
+}
+
+void StateFilteringRenderPassRecorder::setBindGroup(uint32_t group,
+                                                    const KDGpu::Handle<KDGpu::BindGroup_t> &bindGroup,
+                                                    const KDGpu::Handle<KDGpu::PipelineLayout_t> &pipelineLayout,
+                                                    std::span<const uint32_t> dynamicBufferOffsets)
+{
+    const bool tracked = group < MaxBindGroups && dynamicBufferOffsets.empty();
+    if (tracked && bindGroup.isValid()) {
+        const BoundBindGroup &bound = m_bindGroups[group];
+        if (bound.bindGroup == bindGroup && bound.pipelineLayout == pipelineLayout) {
+            ++m_stats.filteredSetBindGroupCount;
+            return;
+        }
+    }
+
+    m_recorder.setBindGroup(group, bindGroup, pipelineLayout, dynamicBufferOffsets);
+    ++m_stats.setBindGroupCount;
+    if (group < MaxBindGroups)
+        m_bindGroups[group] = tracked ? BoundBindGroup{ bindGroup, pipelineLayout } : BoundBindGroup{};
+}
+
+void StateFilteringRenderPassRecorder::setVertexBuffer(uint32_t index, const KDGpu::Handle<KDGpu::Buffer_t> &buffer, KDGpu::DeviceSize offset)
+{
+    if (index < MaxVertexBuffers && buffer.isValid()) {
+        const BoundBuffer &bound = m_vertexBuffers[index];
+        if (bound.buffer == buffer && bound.offset == offset) {
+            ++m_stats.filteredSetVertexBufferCount;
+            return;
+        }
+    }
+
+    m_recorder.setVertexBuffer(index, buffer, offset);
+    ++m_stats.setVertexBufferCount;
+    if (index < MaxVertexBuffers)
+        m_vertexBuffers[index] = { buffer, offset };
+}
+
+void StateFilteringRenderPassRecorder::setIndexBuffer(const KDGpu::Handle<KDGpu::Buffer_t> &buffer, KDGpu::DeviceSize offset, KDGpu::IndexType indexType)
+{
+    if (buffer.isValid() && m_indexBuffer.buffer == buffer && m_indexBuffer.offset == offset && m_indexType == indexType) {
+        ++m_stats.filteredSetIndexBufferCount;
+        return;
+    }
+
+    m_recorder.setIndexBuffer(buffer, offset, indexType);
+    ++m_stats.setIndexBufferCount;
+    m_indexBuffer = { buffer, offset };
+    m_indexType = indexType;
+}
+
+void StateFilteringRenderPassRecorder::invalidate()
+{
+    m_pipeline = {};
+    m_bindGroups = {};
+    m_vertexBuffers = {};
+    m_indexBuffer = {};
+    m_indexType = KDGpu::IndexType::Uint32;
+}
+
+} // namespace kdgpu_ext::graphics::command
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <KDGpu/render_pass_command_recorder.h>
+
+#include <array>
+#include <span>
+
+namespace kdgpu_ext::graphics::command {
+
+/**
+ * Number of state changes a StateFilteringRenderPassRecorder forwarded to the
+ * underlying recorder and the number it dropped because they were no-ops.
+ */
+struct StateFilterStats {
+    uint32_t setPipelineCount = 0;
+    uint32_t setBindGroupCount = 0;
+    uint32_t setVertexBufferCount = 0;
+    uint32_t setIndexBufferCount = 0;
+
+    uint32_t filteredSetPipelineCount = 0;
+    uint32_t filteredSetBindGroupCount = 0;
+    uint32_t filteredSetVertexBufferCount = 0;
+    uint32_t filteredSetIndexBufferCount = 0;
+
+    uint32_t filteredCount() const
+    {
+        return filteredSetPipelineCount + filteredSetBindGroupCount + filteredSetVertexBufferCount + filteredSetIndexBufferCount;
+    }
+
+    void add(const StateFilterStats &other);
+};
+
+/**
+ * Thin wrapper around a RenderPassCommandRecorder which remembers the currently bound
+ * pipeline, bind groups, vertex buffers and index buffer and drops calls which would
+ * bind the same state again. Draw loops can keep setting the full state per draw and
+ * still only record the changes.
+ *
+ * Bind groups are only considered identical if they were set with the same pipeline
+ * layout and without dynamic offsets. Bind groups set without an explicit layout use the
+ * layout of the bound pipeline and are therefore forgotten when the pipeline changes.
+ */
+class StateFilteringRenderPassRecorder
+{
+public:
+    static constexpr size_t MaxBindGroups = 8;
+    static constexpr size_t MaxVertexBuffers = 16;
+
+    explicit StateFilteringRenderPassRecorder(KDGpu::RenderPassCommandRecorder &recorder);
+
+    void setPipeline(const KDGpu::Handle<KDGpu::GraphicsPipeline_t> &pipeline);
+    void setBindGroup(uint32_t group,
+                      const KDGpu::Handle<KDGpu::BindGroup_t> &bindGroup,
+                      const KDGpu::Handle<KDGpu::PipelineLayout_t> &pipelineLayout = KDGpu::Handle<KDGpu::PipelineLayout_t>(),
+                      std::span<const uint32_t> dynamicBufferOffsets = {});
+    void setVertexBuffer(uint32_t index, const KDGpu::Handle<KDGpu::Buffer_t> &buffer, KDGpu::DeviceSize offset = 0);
+    void setIndexBuffer(const KDGpu::Handle<KDGpu::Buffer_t> &buffer,
+                        KDGpu::DeviceSize offset = 0,
+                        KDGpu::IndexType indexType = KDGpu::IndexType::Uint32);
+
+    // not filtered, push constants are cheap to record and usually change per draw
+    void pushConstant(const KDGpu::PushConstantRange &constantRange, const void *data) { m_recorder.pushConstant(constantRange, data); }
+
+    void draw(const KDGpu::DrawCommand &drawCommand) { m_recorder.draw(drawCommand); }
+    void drawIndexed(const KDGpu::DrawIndexedCommand &drawCommand) { m_recorder.drawIndexed(drawCommand); }
+
+    // Forget all tracked state, e.g. after recording directly into the underlying recorder
+    void invalidate();
+
+    KDGpu::RenderPassCommandRecorder &recorder() { return m_recorder; }
+    const StateFilterStats &stats() const { return m_stats; }
+
+private:
+    struct BoundBindGroup {
+        KDGpu::Handle<KDGpu::BindGroup_t> bindGroup;
+        KDGpu::Handle<KDGpu::PipelineLayout_t> pipelineLayout;
+    };
+
+    struct BoundBuffer {
+        KDGpu::Handle<KDGpu::Buffer_t> buffer;
+        KDGpu::DeviceSize offset = 0;
+    };
+
+    KDGpu::RenderPassCommandRecorder &m_recorder;
+    StateFilterStats m_stats;
+
+    KDGpu::Handle<KDGpu::GraphicsPipeline_t> m_pipeline;
+    std::array<BoundBindGroup, MaxBindGroups> m_bindGroups;
+    std::array<BoundBuffer, MaxVertexBuffers> m_vertexBuffers;
+    BoundBuffer m_indexBuffer;
+    KDGpu::IndexType m_indexType = KDGpu::IndexType::Uint32;
+};
+
+} // namespace kdgpu_ext::graphics::command
@@ -0,0 +1,223 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace kdgpu_ext::graphics::container {
+
+/**
+ * Hash map with open addressing for the lookup tables built during scene setup.
+ *
+ * The entries are stored contiguously in insertion order and a power of two sized slot
+ * table with linear probing maps hashes to them. Compared to std::unordered_map this
+ * avoids one allocation per entry and pointer chasing on lookup. The hash of every entry
+ * is kept so growing never calls the hash function again and most mismatches are
+ * rejected without comparing the keys.
+ *
+ * Unlike std::unordered_map, inserting or erasing invalidates iterators and references to
+ * all entries, and erasing changes the order of the remaining entries.
+ */
+template<typename Key, typename Value, typename Hash = std::hash<Key>, typename KeyEqual = std::equal_to<Key>>
+class FlatHashMap
+{
+public:
+    using key_type = Key;
+    using mapped_type = Value;
+    using value_type = std::pair<Key, Value>;
+    using iterator = typename std::vector<value_type>::iterator;
+    using const_iterator = typename std::vector<value_type>::const_iterator;
+
+    iterator begin() { return m_entries.begin(); }
+    iterator end() { return m_entries.end(); }
+    const_iterator begin() const { return m_entries.begin(); }
+    const_iterator end() const { return m_entries.end(); }
+
+    size_t size() const { return m_entries.size(); }
+    bool empty() const { return m_entries.empty(); }
+
+    void clear()
+    {
+        m_entries.clear();
+        m_entryHashes.clear();
+        m_slots.clear();
+    }
+
+    void reserve(size_t count)
+    {
+        m_entries.reserve(count);
+        m_entryHashes.reserve(count);
+        if (slotCountFor(count) > m_slots.size())
+            rehash(slotCountFor(count));
+    }
+
+    iterator find(const Key &key)
+    {
+        const size_t slot = findSlot(key, Hash{}(key));
+        return slot == NotFound ? end() : begin() + m_slots[slot].entryIndex;
+    }
+
+    const_iterator find(const Key &key) const
+    {
+        const size_t slot = findSlot(key, Hash{}(key));
+        return slot == NotFound ? end() : begin() + m_slots[slot].entryIndex;
+    }
+
+    bool contains(const Key &key) const { return findSlot(key, Hash{}(key)) != NotFound; }
+
+    Value &at(const Key &key)
+    {
+        const auto it = find(key);
+        if (it == end())
+            throw std::out_of_range("FlatHashMap::at");
+        return it->second;
+    }
+
+    const Value &at(const Key &key) const
+    {
+        const auto it = find(key);
+        if (it == end())
+            throw std::out_of_range("FlatHashMap::at");
+        return it->second;
+    }
+
+    Value &operator[](const Key &key) { return try_emplace(key).first->second; }
+
+    template<typename K, typename... Args>
+    std::pair<iterator, bool> try_emplace(K &&key, Args &&...args)
+    {
+        const size_t hash = Hash{}(key);
+        const size_t existingSlot = findSlot(key, hash);
+        if (existingSlot != NotFound)
+            return { begin() + m_slots[existingSlot].entryIndex, false };
+
+        if (slotCountFor(m_entries.size() + 1) > m_slots.size())
+            rehash(slotCountFor(m_entries.size() + 1));
+
+        const uint32_t entryIndex = static_cast<uint32_t>(m_entries.size());
+        m_entries.emplace_back(std::piecewise_construct,
+                               std::forward_as_tuple(std::forward<K>(key)),
+                               std::forward_as_tuple(std::forward<Args>(args)...));
+        m_entryHashes.push_back(hash);
+        insertSlot(hash, entryIndex);
+        return { begin() + entryIndex, true };
+    }
+
+    std::pair<iterator, bool> insert(const value_type &value) { return try_emplace(value.first, value.second); }
+    std::pair<iterator, bool> insert(value_type &&value) { return try_emplace(std::move(value.first), std::move(value.second)); }
+
+    size_t erase(const Key &key)
+    {
+        size_t slot = findSlot(key, Hash{}(key));
+        if (slot == NotFound)
+            return 0;
+
+        // Keep the entries dense by moving the last one into the hole
+        const uint32_t entryIndex = m_slots[slot].entryIndex;
+        const uint32_t lastEntryIndex = static_cast<uint32_t>(m_entries.size() - 1);
+        if (entryIndex != lastEntryIndex) {
+            m_slots[findEntrySlot(lastEntryIndex)].entryIndex = entryIndex;
+            m_entries[entryIndex] = std::move(m_entries[lastEntryIndex]);
+            m_entryHashes[entryIndex] = m_entryHashes[lastEntryIndex];
+        }
+        m_entries.pop_back();
+        m_entryHashes.pop_back();
+
+        // Backward shift deletion: pull following entries of the probe sequence into the
+        // freed slot so that lookups never need tombstones
+        const size_t mask = m_slots.size() - 1;
+        size_t next = (slot + 1) & mask;
+        while (m_slots[next].entryIndex != EmptySlot) {
+            const size_t home = homeSlot(m_entryHashes[m_slots[next].entryIndex]);
+            if (((next - home) & mask) >= ((next - slot) & mask)) {
+                m_slots[slot] = m_slots[next];
+                slot = next;
+            }
+            next = (next + 1) & mask;
+        }
+        m_slots[slot] = Slot{};
+        return 1;
+    }
+
+private:
+    static constexpr uint32_t EmptySlot = std::numeric_limits<uint32_t>::max();
+    static constexpr size_t NotFound = std::numeric_limits<size_t>::max();
+
+    struct Slot {
+        uint32_t entryIndex{ EmptySlot };
+        uint32_t hashFragment{ 0 };
+    };
+
+    // Spreads hashes that only differ in their high bits (or are identities such as
+    // std::hash of integers on some standard libraries) over the slot table
+    static uint64_t mix(size_t hash) { return static_cast<uint64_t>(hash) * 0x9e3779b97f4a7c15ull; }
+    static uint32_t fragment(size_t hash) { return static_cast<uint32_t>(mix(hash)); }
+    size_t homeSlot(size_t hash) const { return static_cast<size_t>(mix(hash) >> m_shift); }
+
+    // Keeps the load factor at or below 3/4
+    static size_t slotCountFor(size_t entryCount)
+    {
+        size_t slotCount = 8;
+        while (slotCount * 3 < entryCount * 4)
+            slotCount *= 2;
+        return slotCount;
+    }
+
+    size_t findSlot(const Key &key, size_t hash) const
+    {
+        if (m_slots.empty())
+            return NotFound;
+
+        const size_t mask = m_slots.size() - 1;
+        const uint32_t hashFragment = fragment(hash);
+        for (size_t slot = homeSlot(hash);; slot = (slot + 1) & mask) {
+            const Slot &candidate = m_slots[slot];
+            if (candidate.entryIndex == EmptySlot)
+                return NotFound;
+            if (candidate.hashFragment == hashFragment && m_entryHashes[candidate.entryIndex] == hash &&
+                KeyEqual{}(m_entries[candidate.entryIndex].first, key))
+                return slot;
+        }
+    }
+
+    size_t findEntrySlot(uint32_t entryIndex) const
+    {
+        const size_t mask = m_slots.size() - 1;
+        size_t slot = homeSlot(m_entryHashes[entryIndex]);
+        while (m_slots[slot].entryIndex != entryIndex)
+            slot = (slot + 1) & mask;
+        return slot;
+    }
+
+    void insertSlot(size_t hash, uint32_t entryIndex)
+    {
+        const size_t mask = m_slots.size() - 1;
+        size_t slot = homeSlot(hash);
+        while (m_slots[slot].entryIndex != EmptySlot)
+            slot = (slot + 1) & mask;
+        m_slots[slot] = Slot{ .entryIndex = entryIndex, .hashFragment = fragment(hash) };
+    }
+
+    void rehash(size_t slotCount)
+    {
+        m_slots.assign(slotCount, Slot{});
+        m_shift = 64;
+        for (size_t count = slotCount; count > 1; count /= 2)
+            --m_shift;
+
+        for (uint32_t entryIndex = 0; entryIndex < m_entries.size(); ++entryIndex)
+            insertSlot(m_entryHashes[entryIndex], entryIndex);
+    }
+
+    std::vector<value_type> m_entries;
+    std::vector<size_t> m_entryHashes; // Parallel to m_entries
+    std::vector<Slot> m_slots;
+    uint32_t m_shift{ 64 }; // 64 - log2(m_slots.size())
+};
+
+} // namespace kdgpu_ext::graphics::container
@@ -0,0 +1,126 @@
+#include "mapped_file.h"
+
+#include <spdlog/spdlog.h>
+
+#include <utility>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace kdgpu_ext::graphics::file {
+
+#if defined(_WIN32)
+
+MappedFile::MappedFile(const std::string &path)
+{
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        spdlog::error("Failed to open {} for mapping", path);
+        return;
+    }
+
+    LARGE_INTEGER fileSize{};
+    const bool hasSize = GetFileSizeEx(file, &fileSize);
+    if (hasSize && fileSize.QuadPart == 0)
+        spdlog::error("{} is empty", path);
+    if (hasSize && fileSize.QuadPart > 0) {
+        // the view keeps the mapping alive, the file handle is not needed once it exists
+        m_mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (m_mapping != nullptr) {
+            m_data = static_cast<const uint8_t *>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+            m_size = static_cast<size_t>(fileSize.QuadPart);
+        }
+        if (m_data == nullptr) {
+            spdlog::error("Failed to map {}", path);
+            close();
+        }
+    }
+    CloseHandle(file);
+}
+
+void MappedFile::close()
+{
+    if (m_data != nullptr)
+        UnmapViewOfFile(m_data);
+    if (m_mapping != nullptr)
+        CloseHandle(m_mapping);
+    m_data = nullptr;
+    m_size = 0;
+    m_mapping = nullptr;
+}
+
+#else
+
+MappedFile::MappedFile(const std::string &path)
+{
+    const int file = ::open(path.c_str(), O_RDONLY);
+    if (file == -1) {
+        spdlog::error("Failed to open {} for mapping", path);
+        return;
+    }
+
+    struct stat fileStatus{};
+    const bool hasStatus = fstat(file, &fileStatus) == 0;
+    if (hasStatus && fileStatus.st_size == 0)
+        spdlog::error("{} is empty", path);
+    if (hasStatus && fileStatus.st_size > 0) {
+        void *data = mmap(nullptr, static_cast<size_t>(fileStatus.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+        if (data != MAP_FAILED) {
+            // the files are read front to back once
+            madvise(data, static_cast<size_t>(fileStatus.st_size), MADV_SEQUENTIAL);
+            m_data = static_cast<const uint8_t *>(data);
+            m_size = static_cast<size_t>(fileStatus.st_size);
+        } else {
+            spdlog::error("Failed to map {}", path);
+        }
+    }
+    // the mapping stays valid after closing the descriptor
+    ::close(file);
+}
+
+void MappedFile::close()
+{
+    if (m_data != nullptr)
+        munmap(const_cast<uint8_t *>(m_data), m_size);
+    m_data = nullptr;
+    m_size = 0;
+}
+
+#endif
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+MappedFile::MappedFile(MappedFile &&other) noexcept
+    : m_data(std::exchange(other.m_data, nullptr))
+    , m_size(std::exchange(other.m_size, 0))
+#if defined(_WIN32)
+    , m_mapping(std::exchange(other.m_mapping, nullptr))
+#endif
+{
+}
+
+MappedFile &MappedFile::operator=(MappedFile &&other) noexcept
+{
+    if (this != &other) {
+        close();
+        m_data = std::exchange(other.m_data, nullptr);
+        m_size = std::exchange(other.m_size, 0);
+#if defined(_WIN32)
+        m_mapping = std::exchange(other.m_mapping, nullptr);
+#endif
+    }
+    return *this;
+}
+
+} // namespace kdgpu_ext::graphics::file
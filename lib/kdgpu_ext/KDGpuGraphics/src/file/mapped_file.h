@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+
+namespace kdgpu_ext::graphics::file {
+
+/**
+ * Read-only memory mapping of a whole file. The pages are read by the OS as they are
+ * touched, so decoding or copying from data() into a staging buffer reads the file once
+ * without an intermediate copy in a vector.
+ */
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    // check isOpen(), empty files are not mapped
+    explicit MappedFile(const std::string &path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    MappedFile(MappedFile &&other) noexcept;
+    MappedFile &operator=(MappedFile &&other) noexcept;
+
+    bool isOpen() const { return m_data != nullptr; }
+    const uint8_t *data() const { return m_data; }
+    size_t size() const { return m_size; }
+    std::span<const uint8_t> bytes() const { return { m_data, m_size }; }
+
+    void close();
+
+private:
+    const uint8_t *m_data = nullptr;
+    size_t m_size = 0;
+#if defined(_WIN32)
+    void *m_mapping = nullptr;
+#endif
+};
+
+} // namespace kdgpu_ext::graphics::file
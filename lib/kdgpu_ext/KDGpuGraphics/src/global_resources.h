@@ -2,6 +2,8 @@
 
 #include <KDGpu/device.h>
 
+#include <sampler/sampler_cache.h>
+
 namespace kdgpu_ext::graphics {
 class GlobalResources
 {
@@ -17,6 +19,18 @@ public:
         return *m_graphicsDevice;
     }
 
+    // samplers shared by everything rendering with the graphics device, has to be cleared
+    // before the device is destroyed
+    sampler::SamplerCache &samplerCache()
+    {
+        return m_samplerCache;
+    }
+
+    KDGpu::Handle<KDGpu::Sampler_t> sampler(const KDGpu::SamplerOptions &options = {})
+    {
+        return m_samplerCache.findOrCreate(graphicsDevice(), options);
+    }
+
     static GlobalResources &instance()
     {
         static GlobalResources inst;
@@ -25,5 +39,6 @@ public:
 
 private:
     KDGpu::Device *m_graphicsDevice = nullptr;
+    sampler::SamplerCache m_samplerCache;
 };
 } // namespace kdgpu_ext::graphics
@@ -0,0 +1,187 @@
+#include "pipeline_cache_file.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+
+namespace kdgpu_ext::graphics::pipeline_cache {
+
+namespace {
+
+constexpr uint32_t FileMagic = 0x4B504348; // "KPCH"
+
+// Guards against allocating absurd amounts of memory for corrupt files
+constexpr uint32_t MaxVertexLayoutEntries = 64;
+
+struct FileHeader {
+    uint32_t magic = FileMagic;
+    uint32_t formatVersion = 0;
+    DeviceIdentity deviceIdentity;
+    uint64_t recordsSize = 0;
+};
+
+// Field by field, the struct has padding before recordsSize
+void writeHeader(BinaryWriter &writer, const FileHeader &header)
+{
+    writer.write(header.magic);
+    writer.write(header.formatVersion);
+    writer.write(header.deviceIdentity.vendorId);
+    writer.write(header.deviceIdentity.deviceId);
+    writer.write(header.deviceIdentity.driverVersion);
+    writer.write(header.recordsSize);
+}
+
+bool readHeader(BinaryReader &reader, FileHeader &header)
+{
+    return reader.read(header.magic) && reader.read(header.formatVersion) &&
+            reader.read(header.deviceIdentity.vendorId) && reader.read(header.deviceIdentity.deviceId) &&
+            reader.read(header.deviceIdentity.driverVersion) && reader.read(header.recordsSize);
+}
+
+std::filesystem::path environmentPath(const char *name)
+{
+    const char *value = std::getenv(name);
+    if (value == nullptr || value[0] == '\0')
+        return {};
+    return value;
+}
+
+std::filesystem::path userCacheDirectory()
+{
+#if defined(_WIN32)
+    return environmentPath("LOCALAPPDATA");
+#elif defined(__APPLE__)
+    const std::filesystem::path home = environmentPath("HOME");
+    return home.empty() ? home : home / "Library" / "Caches";
+#else
+    // relative paths are invalid as per the XDG base directory specification
+    const std::filesystem::path xdgCacheHome = environmentPath("XDG_CACHE_HOME");
+    if (xdgCacheHome.is_absolute())
+        return xdgCacheHome;
+    const std::filesystem::path home = environmentPath("HOME");
+    return home.empty() ? home : home / ".cache";
+#endif
+}
+
+} // namespace
+
+DeviceIdentity DeviceIdentity::fromAdapter(const KDGpu::Adapter &adapter)
+{
+    const auto &properties = adapter.properties();
+    return DeviceIdentity{
+        .vendorId = properties.vendorID,
+        .deviceId = properties.deviceID,
+        .driverVersion = properties.driverVersion
+    };
+}
+
+void writeVertexOptions(BinaryWriter &writer, const KDGpu::VertexOptions &vertexOptions)
+{
+    writer.write(static_cast<uint32_t>(vertexOptions.buffers.size()));
+    for (const auto &buffer : vertexOptions.buffers) {
+        writer.write(buffer.binding);
+        writer.write(buffer.stride);
+        writer.write(buffer.inputRate);
+    }
+
+    writer.write(static_cast<uint32_t>(vertexOptions.attributes.size()));
+    for (const auto &attribute : vertexOptions.attributes) {
+        writer.write(attribute.location);
+        writer.write(attribute.binding);
+        writer.write(attribute.format);
+        writer.write(attribute.offset);
+    }
+}
+
+bool readVertexOptions(BinaryReader &reader, KDGpu::VertexOptions &vertexOptions)
+{
+    uint32_t bufferCount = 0;
+    if (!reader.read(bufferCount) || bufferCount > MaxVertexLayoutEntries)
+        return false;
+    vertexOptions.buffers.resize(bufferCount);
+    for (auto &buffer : vertexOptions.buffers) {
+        if (!reader.read(buffer.binding) || !reader.read(buffer.stride) || !reader.read(buffer.inputRate))
+            return false;
+    }
+
+    uint32_t attributeCount = 0;
+    if (!reader.read(attributeCount) || attributeCount > MaxVertexLayoutEntries)
+        return false;
+    vertexOptions.attributes.resize(attributeCount);
+    for (auto &attribute : vertexOptions.attributes) {
+        if (!reader.read(attribute.location) || !reader.read(attribute.binding) ||
+            !reader.read(attribute.format) || !reader.read(attribute.offset))
+            return false;
+    }
+    return true;
+}
+
+PipelineCacheFile::PipelineCacheFile(std::filesystem::path path, uint32_t formatVersion)
+    : m_path(std::move(path))
+    , m_formatVersion(formatVersion)
+{
+}
+
+std::optional<std::vector<uint8_t>> PipelineCacheFile::load(const DeviceIdentity &deviceIdentity) const
+{
+    std::ifstream file(m_path, std::ios::binary);
+    if (!file)
+        return {};
+
+    const std::vector<uint8_t> contents{ std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>() };
+    BinaryReader reader(contents);
+    FileHeader header;
+    if (!readHeader(reader, header) || header.magic != FileMagic || header.formatVersion != m_formatVersion)
+        return {};
+    if (header.deviceIdentity != deviceIdentity)
+        return {};
+    if (contents.size() - reader.position() != header.recordsSize)
+        return {};
+
+    return std::vector<uint8_t>(contents.begin() + reader.position(), contents.end());
+}
+
+bool PipelineCacheFile::save(const DeviceIdentity &deviceIdentity, std::span<const uint8_t> records) const
+{
+    std::error_code error;
+    std::filesystem::create_directories(m_path.parent_path(), error);
+
+    // Write to a temporary file first so that an interrupted write never leaves a
+    // truncated cache behind
+    const std::filesystem::path temporaryPath = m_path.string() + ".tmp";
+    {
+        std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+        if (!file)
+            return false;
+
+        const FileHeader header = {
+            .formatVersion = m_formatVersion,
+            .deviceIdentity = deviceIdentity,
+            .recordsSize = records.size()
+        };
+        BinaryWriter headerWriter;
+        writeHeader(headerWriter, header);
+        file.write(reinterpret_cast<const char *>(headerWriter.data().data()), static_cast<std::streamsize>(headerWriter.data().size()));
+        file.write(reinterpret_cast<const char *>(records.data()), static_cast<std::streamsize>(records.size()));
+        if (!file)
+            return false;
+    }
+
+    std::filesystem::rename(temporaryPath, m_path, error);
+    return !error;
+}
+
+std::filesystem::path PipelineCacheFile::defaultPath(const std::string &name)
+{
+    // the OS may clean up the temporary directory, it is only used without a cache directory
+    std::filesystem::path directory = userCacheDirectory();
+    if (directory.empty()) {
+        std::error_code error;
+        directory = std::filesystem::temp_directory_path(error);
+        if (error)
+            directory = std::filesystem::current_path();
+    }
+    return directory / "kdgpu_examples" / (name + ".pipelines");
+}
+
+} // namespace kdgpu_ext::graphics::pipeline_cache
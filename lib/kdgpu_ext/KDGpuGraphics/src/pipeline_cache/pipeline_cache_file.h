@@ -0,0 +1,107 @@
+#pragma once
+
+#include <KDGpu/adapter.h>
+#include <KDGpu/graphics_pipeline_options.h>
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace kdgpu_ext::graphics::pipeline_cache {
+
+// Identifies the adapter and driver a cache file was written with. The contents of a
+// file written with any other device or driver version are discarded.
+struct DeviceIdentity {
+    uint32_t vendorId = 0;
+    uint32_t deviceId = 0;
+    uint32_t driverVersion = 0;
+
+    bool operator==(const DeviceIdentity &other) const = default;
+
+    static DeviceIdentity fromAdapter(const KDGpu::Adapter &adapter);
+};
+
+// Serializes the records stored in a cache file
+class BinaryWriter
+{
+public:
+    template<typename T>
+    void write(const T &value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        const auto *bytes = reinterpret_cast<const uint8_t *>(&value);
+        m_data.insert(m_data.end(), bytes, bytes + sizeof(T));
+    }
+
+    const std::vector<uint8_t> &data() const { return m_data; }
+
+private:
+    std::vector<uint8_t> m_data;
+};
+
+// Reads back what a BinaryWriter wrote. Every read fails once the data is exhausted.
+class BinaryReader
+{
+public:
+    explicit BinaryReader(std::span<const uint8_t> data)
+        : m_data(data)
+    {
+    }
+
+    template<typename T>
+    bool read(T &value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        if (m_data.size() - m_position < sizeof(T))
+            return false;
+        std::memcpy(&value, m_data.data() + m_position, sizeof(T));
+        m_position += sizeof(T);
+        return true;
+    }
+
+    bool atEnd() const { return m_position == m_data.size(); }
+    size_t position() const { return m_position; }
+
+private:
+    std::span<const uint8_t> m_data;
+    size_t m_position = 0;
+};
+
+// Helpers for the vertex layout which is part of most pipeline keys
+void writeVertexOptions(BinaryWriter &writer, const KDGpu::VertexOptions &vertexOptions);
+bool readVertexOptions(BinaryReader &reader, KDGpu::VertexOptions &vertexOptions);
+
+/**
+ * A file holding the pipeline (and shader module) keys an application created in a
+ * previous run so that it can create them up front on the next start. The file starts with
+ * a header (magic, format version, device identity) followed by the records written by
+ * the application. Bump the format version whenever the layout of the records changes.
+ */
+class PipelineCacheFile
+{
+public:
+    PipelineCacheFile(std::filesystem::path path, uint32_t formatVersion);
+
+    // Returns the stored records or nothing if the file is missing, corrupt or was
+    // written by another format version, device or driver
+    std::optional<std::vector<uint8_t>> load(const DeviceIdentity &deviceIdentity) const;
+    bool save(const DeviceIdentity &deviceIdentity, std::span<const uint8_t> records) const;
+
+    const std::filesystem::path &path() const { return m_path; }
+
+    // <user cache dir>/kdgpu_examples/<name>.pipelines, the user cache dir being
+    // %LOCALAPPDATA% on Windows, ~/Library/Caches on macOS and $XDG_CACHE_HOME or
+    // ~/.cache elsewhere
+    static std::filesystem::path defaultPath(const std::string &name);
+
+private:
+    std::filesystem::path m_path;
+    uint32_t m_formatVersion = 0;
+};
+
+} // namespace kdgpu_ext::graphics::pipeline_cache
@@ -22,6 +22,8 @@ public:
     bool depthTestEnabled = true;
     bool depthWriteEnabled = true;
     CompareOperation depthCompareOperation = CompareOperation::Less;
+    // adds the fragment color to the color target, e.g. to count the shaded fragments
+    bool additiveBlending = false;
 
 private:
     TextureTarget* m_colorTarget = nullptr;
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace kdgpu_ext::graphics::resource {
+
+/**
+ * Keeps resources that got replaced alive until the frames that may still use them have
+ * finished on the GPU, e.g. a texture swapped for a larger one while command buffers
+ * referencing the old one are in flight.
+ *
+ * nextFrame() has to be called once per frame. Resources are destroyed frameLatency
+ * frames after they were retired, which has to be more than the number of frames the
+ * engine keeps in flight.
+ */
+class DeferredRelease
+{
+public:
+    explicit DeferredRelease(uint32_t frameLatency = 3)
+        : m_frameLatency(frameLatency)
+    {
+    }
+
+    template<typename Resource>
+    void retire(Resource &&resource)
+    {
+        using ResourceType = std::remove_cvref_t<Resource>;
+        m_retired.push_back({ m_frame + m_frameLatency, std::make_shared<ResourceType>(std::forward<Resource>(resource)) });
+    }
+
+    void nextFrame()
+    {
+        ++m_frame;
+        while (!m_retired.empty() && m_retired.front().releaseFrame <= m_frame)
+            m_retired.pop_front();
+    }
+
+    // Only safe once the GPU is idle
+    void clear() { m_retired.clear(); }
+
+    size_t size() const { return m_retired.size(); }
+
+private:
+    struct Retired {
+        uint64_t releaseFrame;
+        std::shared_ptr<void> resource;
+    };
+
+    uint32_t m_frameLatency;
+    uint64_t m_frame{ 0 };
+    std::deque<Retired> m_retired;
+};
+
+} // namespace kdgpu_ext::graphics::resource
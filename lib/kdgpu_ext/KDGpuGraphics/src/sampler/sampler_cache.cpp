@@ -0,0 +1,73 @@
+#include "sampler_cache.h"
+
+#include <KDGpu/adapter.h>
+#include <KDGpu/utils/hash_utils.h>
+
+#include <algorithm>
+
+using namespace KDGpu;
+
+namespace kdgpu_ext::graphics::sampler {
+
+SamplerKey SamplerKey::fromOptions(const SamplerOptions &options)
+{
+    return {
+        .magFilter = options.magFilter,
+        .minFilter = options.minFilter,
+        .mipmapFilter = options.mipmapFilter,
+        .u = options.u,
+        .v = options.v,
+        .w = options.w,
+        .lodMinClamp = options.lodMinClamp,
+        .lodMaxClamp = options.lodMaxClamp,
+        .anisotropyEnabled = options.anisotropyEnabled,
+        .maxAnisotropy = options.maxAnisotropy,
+        .compareEnabled = options.compareEnabled,
+        .compare = options.compare,
+        .normalizedCoordinates = options.normalizedCoordinates
+    };
+}
+
+size_t SamplerKeyHash::operator()(const SamplerKey &key) const
+{
+    uint64_t hash = 0;
+    KDGpu::hash_combine(hash, key.magFilter);
+    KDGpu::hash_combine(hash, key.minFilter);
+    KDGpu::hash_combine(hash, key.mipmapFilter);
+    KDGpu::hash_combine(hash, key.u);
+    KDGpu::hash_combine(hash, key.v);
+    KDGpu::hash_combine(hash, key.w);
+    KDGpu::hash_combine(hash, key.lodMinClamp);
+    KDGpu::hash_combine(hash, key.lodMaxClamp);
+    KDGpu::hash_combine(hash, key.anisotropyEnabled);
+    KDGpu::hash_combine(hash, key.maxAnisotropy);
+    KDGpu::hash_combine(hash, key.compareEnabled);
+    KDGpu::hash_combine(hash, key.compare);
+    KDGpu::hash_combine(hash, key.normalizedCoordinates);
+    return hash;
+}
+
+Handle<Sampler_t> SamplerCache::findOrCreate(Device &device, const SamplerOptions &options)
+{
+    SamplerOptions samplerOptions = options;
+    if (m_maxAnisotropy > 1.0f && !samplerOptions.anisotropyEnabled &&
+        samplerOptions.minFilter == FilterMode::Linear && samplerOptions.mipmapFilter == MipmapFilterMode::Linear) {
+        const Adapter *adapter = device.adapter();
+        if (adapter->features().samplerAnisotropy) {
+            samplerOptions.anisotropyEnabled = true;
+            samplerOptions.maxAnisotropy = std::min(m_maxAnisotropy, adapter->properties().limits.maxSamplerAnisotropy);
+        }
+    }
+
+    const SamplerKey key = SamplerKey::fromOptions(samplerOptions);
+    const auto samplerIt = m_samplers.find(key);
+    if (samplerIt != m_samplers.end())
+        return samplerIt->second.handle();
+
+    Sampler sampler = device.createSampler(samplerOptions);
+    const auto samplerHandle = sampler.handle();
+    m_samplers.insert({ key, std::move(sampler) });
+    return samplerHandle;
+}
+
+} // namespace kdgpu_ext::graphics::sampler
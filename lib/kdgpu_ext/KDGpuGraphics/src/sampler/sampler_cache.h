@@ -0,0 +1,65 @@
+#pragma once
+
+#include <container/flat_hash_map.h>
+
+#include <KDGpu/device.h>
+#include <KDGpu/sampler.h>
+#include <KDGpu/sampler_options.h>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace kdgpu_ext::graphics::sampler {
+
+// Everything in SamplerOptions apart from the debug label
+struct SamplerKey {
+    KDGpu::FilterMode magFilter;
+    KDGpu::FilterMode minFilter;
+    KDGpu::MipmapFilterMode mipmapFilter;
+    KDGpu::AddressMode u;
+    KDGpu::AddressMode v;
+    KDGpu::AddressMode w;
+    float lodMinClamp;
+    float lodMaxClamp;
+    bool anisotropyEnabled;
+    float maxAnisotropy;
+    bool compareEnabled;
+    KDGpu::CompareOperation compare;
+    bool normalizedCoordinates;
+
+    static SamplerKey fromOptions(const KDGpu::SamplerOptions &options);
+
+    bool operator==(const SamplerKey &other) const = default;
+};
+
+struct SamplerKeyHash {
+    size_t operator()(const SamplerKey &key) const;
+};
+
+/**
+ * Owns one sampler per distinct SamplerOptions, so that all textures of a device sampled the
+ * same way share a sampler object instead of creating one each. The returned handles stay
+ * valid until clear(), which has to happen before the device is destroyed.
+ *
+ * With an anisotropy level set, trilinear samplers get anisotropic filtering unless their
+ * options already configure it, clamped to what the adapter supports.
+ */
+class SamplerCache
+{
+public:
+    KDGpu::Handle<KDGpu::Sampler_t> findOrCreate(KDGpu::Device &device, const KDGpu::SamplerOptions &options = {});
+
+    // Only applies to samplers requested afterwards. 1 disables anisotropic filtering.
+    void setMaxAnisotropy(float maxAnisotropy) { m_maxAnisotropy = maxAnisotropy; }
+    float maxAnisotropy() const { return m_maxAnisotropy; }
+
+    size_t size() const { return m_samplers.size(); }
+
+    void clear() { m_samplers.clear(); }
+
+private:
+    float m_maxAnisotropy{ 1.0f };
+    container::FlatHashMap<SamplerKey, KDGpu::Sampler, SamplerKeyHash> m_samplers;
+};
+
+} // namespace kdgpu_ext::graphics::sampler
@@ -0,0 +1,110 @@
+#include "embedded_shaders.h"
+
+#include <KDGpuExample/kdgpuexample.h>
+
+#include <stb_image.h>
+
+#include <spdlog/spdlog.h>
+
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+
+namespace kdgpu_ext::graphics::shader {
+
+namespace {
+
+// Locates the deflate stream in a gzip member (RFC 1952) and returns the uncompressed size
+// stored in its trailer
+std::optional<size_t> deflateStreamOffset(std::span<const uint8_t> gzip, uint32_t &uncompressedSize)
+{
+    constexpr uint8_t FlagHeaderCrc = 0x02;
+    constexpr uint8_t FlagExtra = 0x04;
+    constexpr uint8_t FlagName = 0x08;
+    constexpr uint8_t FlagComment = 0x10;
+    constexpr size_t HeaderSize = 10;
+    constexpr size_t TrailerSize = 8;
+
+    if (gzip.size() < HeaderSize + TrailerSize || gzip[0] != 0x1f || gzip[1] != 0x8b || gzip[2] != 8)
+        return std::nullopt;
+
+    const uint8_t flags = gzip[3];
+    const size_t end = gzip.size() - TrailerSize;
+    size_t offset = HeaderSize;
+    if (flags & FlagExtra) {
+        if (offset + 2 > end)
+            return std::nullopt;
+        offset += 2 + (gzip[offset] | (gzip[offset + 1] << 8));
+    }
+    for (const uint8_t flag : { FlagName, FlagComment }) {
+        if (!(flags & flag))
+            continue;
+        while (offset < end && gzip[offset] != 0)
+            ++offset;
+        ++offset; // Terminating zero
+    }
+    if (flags & FlagHeaderCrc)
+        offset += 2;
+    if (offset >= end)
+        return std::nullopt;
+
+    const uint8_t *trailer = gzip.data() + end;
+    uncompressedSize = trailer[4] | (trailer[5] << 8) | (trailer[6] << 16) | (uint32_t(trailer[7]) << 24);
+    return offset;
+}
+
+std::vector<uint32_t> decompress(const EmbeddedShaderData &shader)
+{
+    const std::span<const uint8_t> gzip(shader.compressedData, shader.compressedSize);
+    uint32_t uncompressedSize = 0;
+    const auto offset = deflateStreamOffset(gzip, uncompressedSize);
+    if (!offset || uncompressedSize == 0 || uncompressedSize % sizeof(uint32_t) != 0) {
+        SPDLOG_CRITICAL("Embedded shader {} is corrupt", shader.path);
+        return {};
+    }
+
+    std::vector<uint32_t> spirv(uncompressedSize / sizeof(uint32_t));
+    const int decodedSize = stbi_zlib_decode_noheader_buffer(reinterpret_cast<char *>(spirv.data()),
+                                                             static_cast<int>(uncompressedSize),
+                                                             reinterpret_cast<const char *>(gzip.data() + *offset),
+                                                             static_cast<int>(gzip.size() - *offset));
+    if (decodedSize != static_cast<int>(uncompressedSize)) {
+        SPDLOG_CRITICAL("Failed to decompress embedded shader {}", shader.path);
+        return {};
+    }
+    return spirv;
+}
+
+} // namespace
+
+std::span<const uint32_t> embeddedShader(std::string_view path)
+{
+    static std::mutex mutex;
+    static std::unordered_map<std::string_view, const EmbeddedShaderData *> shaders;
+    static std::unordered_map<const EmbeddedShaderData *, std::vector<uint32_t>> decompressedShaders;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (shaders.empty()) {
+        for (const auto &shader : embeddedShaderTable())
+            shaders.emplace(shader.path, &shader);
+    }
+
+    const auto shaderIt = shaders.find(path);
+    if (shaderIt == shaders.end())
+        return {};
+
+    auto decompressedIt = decompressedShaders.find(shaderIt->second);
+    if (decompressedIt == decompressedShaders.end())
+        decompressedIt = decompressedShaders.emplace(shaderIt->second, decompress(*shaderIt->second)).first;
+    return decompressedIt->second;
+}
+
+std::vector<uint32_t> loadShader(const std::string &path)
+{
+    const std::span<const uint32_t> spirv = embeddedShader(path);
+    if (!spirv.empty())
+        return { spirv.begin(), spirv.end() };
+    return KDGpuExample::readShaderFile(KDGpuExample::assetDir().file(path));
+}
+
+} // namespace kdgpu_ext::graphics::shader
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#ifndef KDGPU_EMBEDDED_SHADER_TABLE_EXPORT
+#define KDGPU_EMBEDDED_SHADER_TABLE_EXPORT
+#endif
+
+namespace kdgpu_ext::graphics::shader {
+
+// A gzip compressed SPIR-V module embedded at build time, see cmake/EmbedShaders.cmake
+struct EmbeddedShaderData {
+    std::string_view path; // Relative to the asset directory
+    const uint8_t *compressedData = nullptr;
+    size_t compressedSize = 0;
+};
+
+// All embedded shaders. Provided by the generated kdgpu_example_shaders library and empty
+// if shader embedding is disabled.
+KDGPU_EMBEDDED_SHADER_TABLE_EXPORT std::span<const EmbeddedShaderData> embeddedShaderTable();
+
+// SPIR-V of the embedded shader at path (relative to the asset directory, e.g.
+// "shaders/compute_n_body/particle.vert.spv"). It is decompressed on first use and stays
+// valid for the lifetime of the process. Returns an empty span if the shader is not embedded.
+std::span<const uint32_t> embeddedShader(std::string_view path);
+
+// SPIR-V of the shader at path, taken from the embedded shaders if possible and read from
+// the asset directory otherwise
+std::vector<uint32_t> loadShader(const std::string &path);
+
+} // namespace kdgpu_ext::graphics::shader
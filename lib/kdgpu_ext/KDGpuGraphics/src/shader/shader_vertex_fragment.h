@@ -3,6 +3,7 @@
 #include <KDGpu/graphics_pipeline_options.h>
 
 #include <KDGpuExample/kdgpuexample.h>
+#include <shader/embedded_shaders.h>
 #include <shader/shader_base.h>
 
 #include <global_resources.h>
@@ -21,15 +22,13 @@ public:
     void loadVertexShader(const std::string &filename)
     {
         auto &device = GlobalResources::instance().graphicsDevice();
-        auto shaderFile = KDGpuExample::assetDir().file(m_baseDirectory + filename);
-        m_vertexShader = device.createShaderModule(KDGpuExample::readShaderFile(shaderFile));
+        m_vertexShader = device.createShaderModule(loadShader(m_baseDirectory + filename));
     }
 
     void loadFragmentShader(const std::string &filename)
     {
         auto &device = GlobalResources::instance().graphicsDevice();
-        auto shaderFile = KDGpuExample::assetDir().file(m_baseDirectory + filename);
-        m_fragmentShader = device.createShaderModule(KDGpuExample::readShaderFile(shaderFile));
+        m_fragmentShader = device.createShaderModule(loadShader(m_baseDirectory + filename));
     }
 
     std::vector<ShaderStage> shaderStages() override
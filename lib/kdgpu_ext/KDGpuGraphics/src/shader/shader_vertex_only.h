@@ -0,0 +1,48 @@
+#pragma once
+
+#include <KDGpu/graphics_pipeline_options.h>
+
+#include <KDGpuExample/kdgpuexample.h>
+#include <shader/embedded_shaders.h>
+#include <shader/shader_base.h>
+
+#include <global_resources.h>
+
+namespace kdgpu_ext::graphics::shader {
+/**
+ * Shader without a fragment stage, e.g. for depth-only passes.
+ */
+class ShaderVertexOnly : public ShaderBase
+{
+public:
+    void setBaseDirectory(const std::string &base_directory)
+    {
+        m_baseDirectory = base_directory;
+        if (m_baseDirectory.back() != '/')
+            m_baseDirectory.push_back('/');
+    }
+
+    void loadVertexShader(const std::string &filename)
+    {
+        auto &device = GlobalResources::instance().graphicsDevice();
+        m_vertexShader = device.createShaderModule(loadShader(m_baseDirectory + filename));
+    }
+
+    std::vector<ShaderStage> shaderStages() override
+    {
+        return {
+            { .shaderModule = m_vertexShader,
+              .stage = ShaderStageFlagBits::VertexBit }
+        };
+    }
+
+    void deinitialize()
+    {
+        m_vertexShader = {};
+    }
+
+private:
+    std::string m_baseDirectory;
+    ShaderModule m_vertexShader;
+};
+} // namespace kdgpu_ext::graphics::shader
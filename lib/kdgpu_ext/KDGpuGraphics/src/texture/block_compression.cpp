@@ -0,0 +1,232 @@
+#include "block_compression.h"
+#include "mip_generation.h"
+
+#include <KDGpu/adapter.h>
+#include <KDGpu/vulkan/vulkan_enums.h>
+
+#include <ktx.h>
+#include <ktxvulkan.h>
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+
+using namespace KDGpu;
+
+namespace kdgpu_ext::graphics::texture {
+
+namespace {
+
+struct KtxTexture2Deleter {
+    void operator()(ktxTexture2 *texture) const { ktxTexture_Destroy(ktxTexture(texture)); }
+};
+using KtxTexture2Ptr = std::unique_ptr<ktxTexture2, KtxTexture2Deleter>;
+
+ktx_transcode_fmt_e transcodeFormat(BlockCompression compression)
+{
+    switch (compression) {
+    case BlockCompression::BC7:
+        return KTX_TTF_BC7_RGBA;
+    case BlockCompression::ASTC4x4:
+        return KTX_TTF_ASTC_4x4_RGBA;
+    case BlockCompression::ETC2:
+        return KTX_TTF_ETC2_RGBA;
+    case BlockCompression::None:
+        break;
+    }
+    // Uncompressed R8G8B8A8 for devices without any of the block compressed formats
+    return KTX_TTF_RGBA32;
+}
+
+// PNG and JPEG images are uploaded as R8G8B8A8_UNORM and the shaders do not linearize the
+// texels, so the sRGB formats KTX2 files are tagged with are sampled as UNORM as well
+Format unormFormat(Format format)
+{
+    switch (format) {
+    case Format::BC1_RGB_SRGB_BLOCK:
+        return Format::BC1_RGB_UNORM_BLOCK;
+    case Format::BC1_RGBA_SRGB_BLOCK:
+        return Format::BC1_RGBA_UNORM_BLOCK;
+    case Format::BC2_SRGB_BLOCK:
+        return Format::BC2_UNORM_BLOCK;
+    case Format::BC3_SRGB_BLOCK:
+        return Format::BC3_UNORM_BLOCK;
+    case Format::BC7_SRGB_BLOCK:
+        return Format::BC7_UNORM_BLOCK;
+    case Format::ETC2_R8G8B8_SRGB_BLOCK:
+        return Format::ETC2_R8G8B8_UNORM_BLOCK;
+    case Format::ETC2_R8G8B8A1_SRGB_BLOCK:
+        return Format::ETC2_R8G8B8A1_UNORM_BLOCK;
+    case Format::ETC2_R8G8B8A8_SRGB_BLOCK:
+        return Format::ETC2_R8G8B8A8_UNORM_BLOCK;
+    case Format::ASTC_4x4_SRGB_BLOCK:
+        return Format::ASTC_4x4_UNORM_BLOCK;
+    case Format::R8G8B8A8_SRGB:
+        return Format::R8G8B8A8_UNORM;
+    case Format::B8G8R8A8_SRGB:
+        return Format::B8G8R8A8_UNORM;
+    default:
+        return format;
+    }
+}
+
+} // namespace
+
+BlockCompression selectBlockCompression(Device &device)
+{
+    for (const BlockCompression compression : { BlockCompression::BC7, BlockCompression::ASTC4x4, BlockCompression::ETC2 }) {
+        const FormatProperties formatProperties = device.adapter()->formatProperties(blockCompressionFormat(compression));
+        const auto features = formatProperties.optimalTilingFeatures;
+        if ((features & FormatFeatureFlagBit::SampledImageBit) && (features & FormatFeatureFlagBit::SampledImageFilterLinearBit))
+            return compression;
+    }
+    return BlockCompression::None;
+}
+
+Format blockCompressionFormat(BlockCompression compression)
+{
+    switch (compression) {
+    case BlockCompression::BC7:
+        return Format::BC7_UNORM_BLOCK;
+    case BlockCompression::ASTC4x4:
+        return Format::ASTC_4x4_UNORM_BLOCK;
+    case BlockCompression::ETC2:
+        return Format::ETC2_R8G8B8A8_UNORM_BLOCK;
+    case BlockCompression::None:
+        break;
+    }
+    return Format::R8G8B8A8_UNORM;
+}
+
+const char *blockCompressionName(BlockCompression compression)
+{
+    switch (compression) {
+    case BlockCompression::BC7:
+        return "BC7";
+    case BlockCompression::ASTC4x4:
+        return "ASTC 4x4";
+    case BlockCompression::ETC2:
+        return "ETC2";
+    case BlockCompression::None:
+        break;
+    }
+    return "none";
+}
+
+std::vector<uint8_t> encodeBasisKtx2(const uint8_t *pixels, uint32_t width, uint32_t height, const BasisEncodeOptions &options)
+{
+    // Basis Universal needs every level up front, box filter them like uncompressed uploads
+    const MipChain mipChain = generateMipChain(pixels, width, height, 4, mipLevelCount(width, height));
+
+    ktxTextureCreateInfo createInfo = {};
+    createInfo.vkFormat = VK_FORMAT_R8G8B8A8_UNORM;
+    createInfo.baseWidth = width;
+    createInfo.baseHeight = height;
+    createInfo.baseDepth = 1;
+    createInfo.numDimensions = 2;
+    createInfo.numLevels = static_cast<ktx_uint32_t>(mipChain.regions.size());
+    createInfo.numLayers = 1;
+    createInfo.numFaces = 1;
+    createInfo.isArray = KTX_FALSE;
+    createInfo.generateMipmaps = KTX_FALSE;
+
+    ktxTexture2 *createdTexture{ nullptr };
+    ktxResult result = ktxTexture2_Create(&createInfo, KTX_TEXTURE_CREATE_ALLOC_STORAGE, &createdTexture);
+    if (result != KTX_SUCCESS) {
+        spdlog::error("Failed to create KTX2 texture: {}", ktxErrorString(result));
+        return {};
+    }
+    KtxTexture2Ptr texture(createdTexture);
+
+    for (size_t level = 0; level < mipChain.regions.size(); ++level) {
+        const auto &region = mipChain.regions[level];
+        const size_t levelSize = size_t(region.textureExtent.width) * region.textureExtent.height * 4;
+        ktxTexture_SetImageFromMemory(ktxTexture(texture.get()), static_cast<ktx_uint32_t>(level), 0, 0,
+                                      mipChain.data.data() + region.bufferOffset, levelSize);
+    }
+
+    ktxBasisParams basisParams = {};
+    basisParams.structSize = sizeof(basisParams);
+    basisParams.uastc = options.uastc ? KTX_TRUE : KTX_FALSE;
+    basisParams.qualityLevel = options.etc1sQuality;
+    basisParams.threadCount = options.threadCount != 0 ? options.threadCount : std::max(1u, std::thread::hardware_concurrency());
+    basisParams.uastcFlags = KTX_PACK_UASTC_LEVEL_DEFAULT;
+    result = ktxTexture2_CompressBasisEx(texture.get(), &basisParams);
+    if (result != KTX_SUCCESS) {
+        spdlog::error("Failed to encode {}x{} image with Basis Universal: {}", width, height, ktxErrorString(result));
+        return {};
+    }
+
+    // UASTC is not supercompressed by Basis itself
+    if (options.uastc) {
+        result = ktxTexture2_DeflateZstd(texture.get(), 18);
+        if (result != KTX_SUCCESS)
+            spdlog::warn("Failed to supercompress KTX2 texture: {}", ktxErrorString(result));
+    }
+
+    ktx_uint8_t *fileData{ nullptr };
+    ktx_size_t fileSize{ 0 };
+    result = ktxTexture_WriteToMemory(ktxTexture(texture.get()), &fileData, &fileSize);
+    if (result != KTX_SUCCESS) {
+        spdlog::error("Failed to write KTX2 texture: {}", ktxErrorString(result));
+        return {};
+    }
+    std::vector<uint8_t> file(fileData, fileData + fileSize);
+    std::free(fileData);
+    return file;
+}
+
+std::optional<CompressedImage> transcodeBasisKtx2(const uint8_t *data, size_t byteSize, BlockCompression compression)
+{
+    ktxTexture2 *createdTexture{ nullptr };
+    ktxResult result = ktxTexture2_CreateFromMemory(data, byteSize, KTX_TEXTURE_CREATE_LOAD_IMAGE_DATA_BIT, &createdTexture);
+    if (result != KTX_SUCCESS) {
+        spdlog::error("Failed to read KTX2 texture: {}", ktxErrorString(result));
+        return std::nullopt;
+    }
+    KtxTexture2Ptr texture(createdTexture);
+
+    // Files that are not Basis Universal encoded are uploaded in the format they were written in
+    if (ktxTexture2_NeedsTranscoding(texture.get())) {
+        result = ktxTexture2_TranscodeBasis(texture.get(), transcodeFormat(compression), 0);
+        if (result != KTX_SUCCESS) {
+            spdlog::error("Failed to transcode KTX2 texture to {}: {}", blockCompressionName(compression), ktxErrorString(result));
+            return std::nullopt;
+        }
+    }
+
+    CompressedImage image;
+    image.format = unormFormat(vkFormatToFormat(static_cast<VkFormat>(texture->vkFormat)));
+    image.extent = { .width = texture->baseWidth, .height = texture->baseHeight, .depth = 1 };
+    image.mipLevels = texture->numLevels;
+
+    const ktx_uint8_t *textureData = ktxTexture_GetData(ktxTexture(texture.get()));
+    image.data.assign(textureData, textureData + ktxTexture_GetDataSize(ktxTexture(texture.get())));
+
+    image.regions.reserve(texture->numLevels);
+    for (uint32_t level = 0; level < texture->numLevels; ++level) {
+        ktx_size_t offset{ 0 };
+        ktxTexture_GetImageOffset(ktxTexture(texture.get()), level, 0, 0, &offset);
+        // clang-format off
+        image.regions.push_back({
+            .bufferOffset = offset,
+            .textureSubResource = {
+                .aspectMask = TextureAspectFlagBits::ColorBit,
+                .mipLevel = level
+            },
+            .textureExtent = {
+                .width = std::max(1u, texture->baseWidth >> level),
+                .height = std::max(1u, texture->baseHeight >> level),
+                .depth = 1
+            }
+        });
+        // clang-format on
+    }
+
+    return image;
+}
+
+} // namespace kdgpu_ext::graphics::texture
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <KDGpu/device.h>
+#include <KDGpu/gpu_core.h>
+#include <KDGpu/texture_options.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace kdgpu_ext::graphics::texture {
+
+// Block compressed formats RGBA images can be transcoded to from Basis Universal
+enum class BlockCompression {
+    None,
+    BC7,
+    ASTC4x4,
+    ETC2
+};
+
+// The first of BC7, ASTC 4x4 and ETC2 that the device can sample with linear filtering,
+// None if it supports neither
+BlockCompression selectBlockCompression(KDGpu::Device &device);
+
+KDGpu::Format blockCompressionFormat(BlockCompression compression);
+const char *blockCompressionName(BlockCompression compression);
+
+struct BasisEncodeOptions {
+    // UASTC transcodes to BC7 and ASTC with little loss, ETC1S is much smaller but blurrier
+    bool uastc{ true };
+    // ETC1S quality, 1 to 255
+    uint32_t etc1sQuality{ 128 };
+    // 0 uses all cores
+    uint32_t threadCount{ 0 };
+};
+
+/**
+ * Encodes width * height tightly packed RGBA8 pixels and their mip chain to a zstd
+ * supercompressed Basis Universal KTX2 file. Takes seconds for large images, so meant for
+ * baking textures offline. Returns an empty vector on failure.
+ */
+std::vector<uint8_t> encodeBasisKtx2(const uint8_t *pixels, uint32_t width, uint32_t height, const BasisEncodeOptions &options = {});
+
+// All levels of a transcoded image, packed one after the other with one copy region per level
+// (and layer for arrays)
+struct CompressedImage {
+    KDGpu::Format format{ KDGpu::Format::UNDEFINED };
+    KDGpu::Extent3D extent;
+    uint32_t mipLevels{ 0 };
+    uint32_t arrayLayers{ 1 };
+    std::vector<uint8_t> data;
+    std::vector<KDGpu::BufferTextureCopyRegion> regions;
+};
+
+/**
+ * Transcodes a Basis Universal KTX2 file such as the ones encodeBasisKtx2() writes to the
+ * block compressed format, or to R8G8B8A8 for None. Cheap compared to encoding, so can be
+ * done at load time, and thread safe. KTX2 files that are not Basis Universal encoded are
+ * returned in the format they hold. sRGB formats are returned as their UNORM equivalent,
+ * like the PNG and JPEG images uploaded as R8G8B8A8_UNORM.
+ */
+std::optional<CompressedImage> transcodeBasisKtx2(const uint8_t *data, size_t byteSize, BlockCompression compression);
+
+} // namespace kdgpu_ext::graphics::texture
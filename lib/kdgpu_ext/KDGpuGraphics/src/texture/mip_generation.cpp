@@ -0,0 +1,95 @@
+#include "mip_generation.h"
+
+#include <KDGpu/adapter.h>
+
+#include <algorithm>
+#include <cstring>
+
+using namespace KDGpu;
+
+namespace kdgpu_ext::graphics::texture {
+
+uint32_t mipLevelCount(uint32_t width, uint32_t height)
+{
+    uint32_t levelCount = 1;
+    for (uint32_t size = std::max(width, height); size > 1; size /= 2)
+        ++levelCount;
+    return levelCount;
+}
+
+bool supportsBlitMipGeneration(Device &device, Format format)
+{
+    const FormatProperties formatProperties = device.adapter()->formatProperties(format);
+    const auto features = formatProperties.optimalTilingFeatures;
+    return (features & FormatFeatureFlagBit::BlitSrcBit) &&
+            (features & FormatFeatureFlagBit::BlitDstBit) &&
+            (features & FormatFeatureFlagBit::SampledImageFilterLinearBit);
+}
+
+uint32_t boxFilterChannelCount(Format format)
+{
+    switch (format) {
+    case Format::R8_UNORM:
+        return 1;
+    case Format::R8G8_UNORM:
+        return 2;
+    case Format::R8G8B8_UNORM:
+    case Format::B8G8R8_UNORM:
+        return 3;
+    case Format::R8G8B8A8_UNORM:
+    case Format::B8G8R8A8_UNORM:
+        return 4;
+    default:
+        return 0;
+    }
+}
+
+MipChain generateMipChain(const uint8_t *pixels, uint32_t width, uint32_t height, uint32_t channelCount, uint32_t levelCount)
+{
+    MipChain chain;
+
+    // Size everything up front so the previous level can be read while writing the next
+    DeviceSize byteSize = 0;
+    for (uint32_t level = 0; level < levelCount; ++level) {
+        const uint32_t levelWidth = std::max(1u, width >> level);
+        const uint32_t levelHeight = std::max(1u, height >> level);
+        // clang-format off
+        chain.regions.push_back({
+            .bufferOffset = byteSize,
+            .textureSubResource = {
+                .aspectMask = TextureAspectFlagBits::ColorBit,
+                .mipLevel = level
+            },
+            .textureExtent = { .width = levelWidth, .height = levelHeight, .depth = 1 }
+        });
+        // clang-format on
+        byteSize += DeviceSize(levelWidth) * levelHeight * channelCount;
+    }
+    chain.data.resize(byteSize);
+    std::memcpy(chain.data.data(), pixels, DeviceSize(width) * height * channelCount);
+
+    for (uint32_t level = 1; level < levelCount; ++level) {
+        const auto &sourceExtent = chain.regions[level - 1].textureExtent;
+        const auto &targetExtent = chain.regions[level].textureExtent;
+        const uint8_t *source = chain.data.data() + chain.regions[level - 1].bufferOffset;
+        uint8_t *target = chain.data.data() + chain.regions[level].bufferOffset;
+        const size_t sourceRowSize = size_t(sourceExtent.width) * channelCount;
+
+        for (uint32_t y = 0; y < targetExtent.height; ++y) {
+            const uint8_t *row0 = source + std::min(2 * y, sourceExtent.height - 1) * sourceRowSize;
+            const uint8_t *row1 = source + std::min(2 * y + 1, sourceExtent.height - 1) * sourceRowSize;
+            for (uint32_t x = 0; x < targetExtent.width; ++x) {
+                const size_t x0 = size_t(std::min(2 * x, sourceExtent.width - 1)) * channelCount;
+                const size_t x1 = size_t(std::min(2 * x + 1, sourceExtent.width - 1)) * channelCount;
+                for (uint32_t channel = 0; channel < channelCount; ++channel) {
+                    const uint32_t sum = row0[x0 + channel] + row0[x1 + channel] + row1[x0 + channel] + row1[x1 + channel];
+                    *target++ = static_cast<uint8_t>((sum + 2) / 4);
+                }
+            }
+        }
+    }
+
+    return chain;
+}
+
+} // namespace kdgpu_ext::graphics::texture
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <KDGpu/device.h>
+#include <KDGpu/gpu_core.h>
+#include <KDGpu/texture_options.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace kdgpu_ext::graphics::texture {
+
+// Number of levels of a full mip chain down to 1x1
+uint32_t mipLevelCount(uint32_t width, uint32_t height);
+
+// Whether Texture::generateMipMaps() can build the mip chain of a format on the GPU. The
+// blit chain needs linear filtered blits from and to optimally tiled images of the format.
+bool supportsBlitMipGeneration(KDGpu::Device &device, KDGpu::Format format);
+
+// Number of 8 bit unsigned normalized channels of the formats generateMipChain() can
+// filter, 0 for any other format. sRGB formats are excluded as averaging the encoded
+// values would darken the smaller levels.
+uint32_t boxFilterChannelCount(KDGpu::Format format);
+
+// The levels of a mip chain packed one after the other, with one copy region per level
+struct MipChain {
+    std::vector<uint8_t> data;
+    std::vector<KDGpu::BufferTextureCopyRegion> regions;
+};
+
+/**
+ * Builds a mip chain on the CPU with a 2x2 box filter, for formats that can not be blitted.
+ * Level 0 is a copy of pixels, which holds width * height tightly packed pixels of
+ * channelCount 8 bit channels. Odd sizes clamp the last row and column.
+ */
+MipChain generateMipChain(const uint8_t *pixels, uint32_t width, uint32_t height, uint32_t channelCount, uint32_t levelCount);
+
+} // namespace kdgpu_ext::graphics::texture
@@ -9,100 +9,187 @@
 #include <KDGpu/texture_options.h>
 #include <global_resources.h>
 #include <KDGpu/vulkan/vulkan_enums.h>
+#include <texture/mip_generation.h>
+#include <file/mapped_file.h>
+
+#include <spdlog/spdlog.h>
 
 using namespace KDGpu;
 
+namespace kdgpu_ext::graphics::texture {
+
 namespace {
-kdgpu_ext::graphics::texture::internal::ImageData loadImage(const KDUtils::File &file)
+// The mip chain is blitted on the GPU when the format allows it, otherwise box filtered on
+// the CPU. Formats that can do neither and data textures keep a single level.
+uint32_t mipLevelsFor(Device &device, const DecodedTextureFile &decoded, bool &blitMipMaps)
+{
+    const internal::ImageData &image = decoded.image;
+    blitMipMaps = false;
+    if (!decoded.mipMapped)
+        return 1;
+    blitMipMaps = supportsBlitMipGeneration(device, image.format);
+    const bool boxFilter = boxFilterChannelCount(image.format) != 0;
+    return (blitMipMaps || boxFilter) ? mipLevelCount(image.width, image.height) : 1;
+}
+
+// Builds the levels that can not be blitted, the format support is queried without recording
+void generateCpuMipChain(DecodedTextureFile &decoded)
+{
+    bool blitMipMaps = false;
+    const uint32_t mipLevels = mipLevelsFor(GlobalResources::instance().graphicsDevice(), decoded, blitMipMaps);
+    if (!blitMipMaps && mipLevels > 1)
+        decoded.mipChain = generateMipChain(decoded.image.pixelData, decoded.image.width, decoded.image.height, boxFilterChannelCount(decoded.image.format), mipLevels);
+}
+} // namespace
+
+DecodedTextureFile SingleTexture::decodeImage(const std::string &path)
 {
-    kdgpu_ext::graphics::texture::internal::ImageData result;
+    DecodedTextureFile decoded;
+    decoded.path = path;
     int channel_count;
     int width;
     int height;
 
-    if (!file.isOpen()) {
-        const_cast<KDUtils::File*>(&file)->open(std::ios::in | std::ios::binary);
+    // decode straight from the mapped file, without reading it into a buffer first
+    const file::MappedFile mappedFile(path);
+    if (!mappedFile.isOpen())
+        return decoded;
+
+    stbi_uc *pixels = stbi_load_from_memory(mappedFile.data(), static_cast<int>(mappedFile.size()), &width, &height, &channel_count, STBI_rgb_alpha);
+    if (pixels == nullptr) {
+        SPDLOG_ERROR("Failed to load texture {}: {}", path, stbi_failure_reason());
+        return decoded;
     }
+    decoded.decodedPixels = std::shared_ptr<const uint8_t>(pixels, [](const uint8_t *data) { stbi_image_free(const_cast<uint8_t *>(data)); });
 
-    auto bytes = const_cast<KDUtils::File*>(&file)->readAll();
+    // STBI_rgb_alpha expands every image to 4 channels, whatever channel_count the file has
+    decoded.image.pixelData = decoded.decodedPixels.get();
+    decoded.image.format = KDGpu::Format::R8G8B8A8_UNORM;
+    decoded.image.width = static_cast<uint32_t>(width);
+    decoded.image.height = static_cast<uint32_t>(height);
+    decoded.image.byteSize = 4 * static_cast<DeviceSize>(width) * static_cast<DeviceSize>(height);
+    generateCpuMipChain(decoded);
+    return decoded;
+}
 
-    result.pixelData = stbi_load_from_memory(bytes.data(), bytes.size(), &width, &height, &channel_count, STBI_rgb_alpha);
+DecodedTextureFile SingleTexture::decodeKtx(const std::string &path, KDGpu::ViewType viewType)
+{
+    DecodedTextureFile decoded;
+    decoded.path = path;
+    decoded.viewType = viewType;
+    decoded.mappedFile = file::MappedFile(path);
+    if (!decoded.mappedFile.isOpen())
+        return decoded;
 
-    if (result.pixelData == nullptr) {
-        fprintf(stderr, "Failed to load texture %hs %hs", file.path().c_str(), stbi_failure_reason());
-        return result;
+    // Only the header and level index are read here, the levels are loaded from the mapped
+    // file straight into the staging ring when uploading
+    ktxTexture *texture{ nullptr };
+    const ktxResult result = ktxTexture_CreateFromMemory(decoded.mappedFile.data(), decoded.mappedFile.size(), KTX_TEXTURE_CREATE_NO_FLAGS, &texture);
+    if (result != KTX_SUCCESS) {
+        SPDLOG_ERROR("Failed to load KTX texture {}: {}", path, ktxErrorString(result));
+        return decoded;
     }
+    decoded.ktx = std::shared_ptr<ktxTexture>(texture, [](ktxTexture *ktx) { ktxTexture_Destroy(ktx); });
+    return decoded;
+}
 
-    if (channel_count == 3)
-        result.format = KDGpu::Format::R8G8B8_UNORM;
-    if (channel_count == 4)
-        result.format = KDGpu::Format::R8G8B8A8_UNORM;
+DecodedTextureFile SingleTexture::decodeBinary(const std::string &path, size_t width, size_t height, size_t channelCount, size_t channelSizeInBytes, KDGpu::Format format)
+{
+    DecodedTextureFile decoded;
+    decoded.path = path;
+    decoded.mappedFile = file::MappedFile(path);
+    if (!decoded.mappedFile.isOpen())
+        return decoded;
+
+    const size_t expectedSize = width * height * channelCount * channelSizeInBytes;
+    if (decoded.mappedFile.size() < expectedSize) {
+        SPDLOG_ERROR("{} holds {} bytes, {} are needed for a {}x{} texture", path, decoded.mappedFile.size(), expectedSize, width, height);
+        return decoded;
+    }
 
-    result.width = static_cast<uint32_t>(width);
-    result.height = static_cast<uint32_t>(height);
-    result.byteSize = channel_count * static_cast<DeviceSize>(width) * static_cast<DeviceSize>(height);
-    return result;
+    // the texels are copied from the mapping to the staging ring as they are
+    decoded.image.width = static_cast<uint32_t>(width);
+    decoded.image.height = static_cast<uint32_t>(height);
+    decoded.image.format = format;
+    decoded.image.byteSize = expectedSize;
+    decoded.image.pixelData = decoded.mappedFile.data();
+    decoded.mipMapped = false;
+    return decoded;
 }
 
-} // namespace
+void SingleTexture::upload(TextureUploader &uploader, DecodedTextureFile &decoded)
+{
+    if (decoded.ktx != nullptr)
+        uploadKtx(uploader, decoded);
+    else if (decoded.isValid())
+        uploadImage(uploader, decoded);
 
-namespace kdgpu_ext::graphics::texture {
-void SingleTexture::uploadImage(KDGpuExample::ExampleEngineLayer &engine, internal::ImageData image)
+    // the reason was logged when decoding, keep the binding of the texture valid
+    if (!m_textureView.isValid()) {
+        SPDLOG_ERROR("Binding a white placeholder for texture {}", decoded.path);
+        uploadPlaceholder(uploader, decoded.viewType);
+    }
+}
+
+void SingleTexture::uploadImage(TextureUploader &uploader, const DecodedTextureFile &decoded)
 {
-    const TextureOptions textureOptions = {
+    Device &device = GlobalResources::instance().graphicsDevice();
+    const internal::ImageData &image = decoded.image;
+
+    bool blitMipMaps = false;
+    const uint32_t mipLevels = mipLevelsFor(device, decoded, blitMipMaps);
+
+    TextureOptions textureOptions = {
         .type = TextureType::TextureType2D,
         .format = image.format,
         .extent = { .width = image.width, .height = image.height, .depth = 1 },
-        .mipLevels = 1,
-        .usage = TextureUsageFlagBits::SampledBit | TextureUsageFlagBits::TransferDstBit,
+        .mipLevels = mipLevels,
+        .usage = TextureUsageFlagBits::SampledBit | TextureUsageFlagBits::TransferSrcBit | TextureUsageFlagBits::TransferDstBit,
         .memoryUsage = MemoryUsage::GpuOnly,
         .initialLayout = TextureLayout::Undefined
     };
-    m_texture = GlobalResources::instance().graphicsDevice().createTexture(textureOptions);
+    uploader.setTextureSharing(textureOptions);
+    m_texture = device.createTexture(textureOptions);
+
+    // Only the base level is uploaded if the mip chain is blitted or not built at all
+    std::vector<BufferTextureCopyRegion> regions = decoded.mipChain.regions;
+    if (regions.empty()) {
+        regions = { { .textureSubResource = { .aspectMask = TextureAspectFlagBits::ColorBit },
+                      .textureExtent = { .width = image.width, .height = image.height, .depth = 1 } } };
+    }
+
     // Upload the texture data and transition to ShaderReadOnlyOptimal
-    const std::vector<BufferTextureCopyRegion> regions = { { .textureSubResource = { .aspectMask = TextureAspectFlagBits::ColorBit },
-                                                             .textureExtent = { .width = image.width, .height = image.height, .depth = 1 } } };
     const TextureUploadOptions uploadOptions = {
         .destinationTexture = m_texture,
         .dstStages = PipelineStageFlagBit::AllGraphicsBit,
         .dstMask = AccessFlagBit::MemoryReadBit,
-        .data = image.pixelData,
-        .byteSize = image.byteSize,
+        .data = decoded.mipChain.data.empty() ? image.pixelData : decoded.mipChain.data.data(),
+        .byteSize = decoded.mipChain.data.empty() ? image.byteSize : decoded.mipChain.data.size(),
         .oldLayout = TextureLayout::Undefined,
         .newLayout = TextureLayout::ShaderReadOnlyOptimal,
-        .regions = regions
+        .regions = std::move(regions)
     };
 
-    // TODO: this could benefit from using an uploader decoupled from the example class
-    engine.uploadTextureData(uploadOptions);
+    // the texels are copied from the decoded image or the mapped file to the staging ring
+    m_uploadValue = uploader.upload(uploadOptions);
 
-    // Create a view and sampler
+    if (blitMipMaps && mipLevels > 1)
+        m_blitMipMapsOptions = textureOptions;
     m_textureView = m_texture.createView();
-    m_sampler = GlobalResources::instance().graphicsDevice().createSampler();
-}
-
-void SingleTexture::load(KDGpuExample::ExampleEngineLayer &engine, const KDUtils::File &file)
-{
-    auto image = loadImage(file);
-    uploadImage(engine, image);
+    m_sampler = GlobalResources::instance().sampler();
 }
 
-void SingleTexture::loadKtx(KDGpuExample::ExampleEngineLayer &engine, const KDUtils::File &file)
+void SingleTexture::uploadKtx(TextureUploader &uploader, const DecodedTextureFile &decoded)
 {
-    ktxTexture *texture{ nullptr };
-    ktxResult result = KTX_SUCCESS;
-    if (!file.isOpen()) {
-        const_cast<KDUtils::File*>(&file)->open(std::ios::in | std::ios::binary);
+    ktxTexture *texture = decoded.ktx.get();
+    if (texture->isCubemap != (decoded.viewType == KDGpu::ViewType::ViewTypeCube)) {
+        SPDLOG_ERROR("KTX texture {} is {}a cube map, unlike its binding", decoded.path, texture->isCubemap ? "" : "not ");
+        return;
     }
-
-    auto bytes = const_cast<KDUtils::File*>(&file)->readAll();
-
-    result = ktxTexture_CreateFromMemory(bytes.data(), bytes.size(),KTX_TEXTURE_CREATE_LOAD_IMAGE_DATA_BIT, &texture);
-    ktx_uint8_t *ktxTextureData = ktxTexture_GetData(texture);
-    ktx_size_t ktxTextureSize = texture->dataSize;
+    const ktx_size_t ktxTextureSize = ktxTexture_GetDataSizeUncompressed(texture);
     const auto format = ktxTexture_GetVkFormat(texture);
 
-    const TextureOptions options = {
+    TextureOptions options = {
         .type = texture->isCubemap ? TextureType::TextureTypeCube : TextureType::TextureType2D,
         .format = KDGpu::vkFormatToFormat(format),
         .extent = { .width = texture->baseWidth, .height = texture->baseHeight, .depth = 1 },
@@ -112,6 +199,7 @@ void SingleTexture::loadKtx(KDGpuExample::ExampleEngineLayer &engine, const KDUt
         .memoryUsage = MemoryUsage::GpuOnly,
         .initialLayout = TextureLayout::Undefined
     };
+    uploader.setTextureSharing(options);
     const TextureViewOptions viewOptions = {
         .viewType = texture->isCubemap ? KDGpu::ViewType::ViewTypeCube : KDGpu::ViewType::ViewType2D,
         .format = vkFormatToFormat(format),
@@ -155,7 +243,6 @@ void SingleTexture::loadKtx(KDGpuExample::ExampleEngineLayer &engine, const KDUt
         .destinationTexture = m_texture,
         .dstStages = PipelineStageFlagBit::AllGraphicsBit,
         .dstMask = AccessFlagBit::MemoryReadBit,
-        .data = ktxTextureData,
         .byteSize = ktxTextureSize,
         .oldLayout = TextureLayout::Undefined,
         .newLayout = TextureLayout::ShaderReadOnlyOptimal,
@@ -163,30 +250,96 @@ void SingleTexture::loadKtx(KDGpuExample::ExampleEngineLayer &engine, const KDUt
     };
     // clang-format on
 
-    // TODO: this could benefit from using an uploader decoupled from the example class
-    engine.uploadTextureData(uploadOptions);
+    // the only copy of the texels, from the mapped file (inflated if supercompressed)
+    const StagingAllocation staging = uploader.allocate(ktxTextureSize);
+    const ktxResult result = ktxTexture_LoadImageData(texture, staging.data, staging.byteSize);
+    if (result != KTX_SUCCESS) {
+        SPDLOG_ERROR("Failed to load the levels of KTX texture {}: {}", decoded.path, ktxErrorString(result));
+        m_texture = {};
+        return;
+    }
+    m_uploadValue = uploader.upload(staging, uploadOptions);
 
     // Create a view and sampler
     m_textureView = m_texture.createView(viewOptions);
-    m_sampler = GlobalResources::instance().graphicsDevice().createSampler();
+    m_sampler = GlobalResources::instance().sampler();
 }
 
-void SingleTexture::loadBinary(KDGpuExample::ExampleEngineLayer &engine, const KDUtils::File &file, size_t width, size_t height, size_t channelCount, size_t channelSizeInBytes, KDGpu::Format format)
+void SingleTexture::uploadPlaceholder(TextureUploader &uploader, KDGpu::ViewType viewType)
 {
-    if (!file.isOpen()) {
-        const_cast<KDUtils::File*>(&file)->open(std::ios::in | std::ios::binary);
-    }
+    // a white texel for each face of cube maps
+    static constexpr uint8_t whiteTexels[6 * 4] = { 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+                                                    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255 };
+    const bool cube = viewType == KDGpu::ViewType::ViewTypeCube;
+    const uint32_t layerCount = cube ? 6 : 1;
+
+    TextureOptions textureOptions = {
+        .type = cube ? TextureType::TextureTypeCube : TextureType::TextureType2D,
+        .format = Format::R8G8B8A8_UNORM,
+        .extent = { .width = 1, .height = 1, .depth = 1 },
+        .mipLevels = 1,
+        .arrayLayers = layerCount,
+        .usage = TextureUsageFlagBits::SampledBit | TextureUsageFlagBits::TransferDstBit,
+        .memoryUsage = MemoryUsage::GpuOnly,
+        .initialLayout = TextureLayout::Undefined
+    };
+    uploader.setTextureSharing(textureOptions);
+    m_texture = GlobalResources::instance().graphicsDevice().createTexture(textureOptions);
+
+    // clang-format off
+    const TextureUploadOptions uploadOptions = {
+        .destinationTexture = m_texture,
+        .dstStages = PipelineStageFlagBit::AllGraphicsBit,
+        .dstMask = AccessFlagBit::MemoryReadBit,
+        .data = whiteTexels,
+        .byteSize = 4 * layerCount,
+        .oldLayout = TextureLayout::Undefined,
+        .newLayout = TextureLayout::ShaderReadOnlyOptimal,
+        .regions = {
+            { .textureSubResource = { .aspectMask = TextureAspectFlagBits::ColorBit, .layerCount = layerCount },
+              .textureExtent = { .width = 1, .height = 1, .depth = 1 } }
+        }
+    };
+    // clang-format on
+    m_uploadValue = uploader.upload(uploadOptions);
+    m_blitMipMapsOptions.reset();
+
+    m_textureView = m_texture.createView({ .viewType = viewType,
+                                           .range = { .aspectMask = TextureAspectFlagBits::ColorBit, .levelCount = 1, .layerCount = layerCount } });
+    m_sampler = GlobalResources::instance().sampler();
+}
+
+void SingleTexture::load(TextureUploader &uploader, const KDUtils::File &file)
+{
+    DecodedTextureFile decoded = decodeImage(file.path());
+    upload(uploader, decoded);
+}
 
-    auto bytes = const_cast<KDUtils::File*>(&file)->readAll();
+void SingleTexture::loadKtx(TextureUploader &uploader, const KDUtils::File &file, KDGpu::ViewType viewType)
+{
+    DecodedTextureFile decoded = decodeKtx(file.path(), viewType);
+    upload(uploader, decoded);
+}
 
-    internal::ImageData image;
-    image.width = width;
-    image.height = height;
-    image.format = format;
-    image.byteSize = bytes.size();
-    image.pixelData = new uint8_t[bytes.size()];
-    memcpy(image.pixelData, bytes.data(), bytes.size());
-    uploadImage(engine, image);
+void SingleTexture::loadBinary(TextureUploader &uploader, const KDUtils::File &file, size_t width, size_t height, size_t channelCount, size_t channelSizeInBytes, KDGpu::Format format)
+{
+    DecodedTextureFile decoded = decodeBinary(file.path(), width, height, channelCount, channelSizeInBytes, format);
+    upload(uploader, decoded);
+}
+
+void SingleTexture::finishUpload()
+{
+    if (!m_blitMipMapsOptions.has_value())
+        return;
+
+    // Limit the view to the base level if the mip chain could not be generated
+    Device &device = GlobalResources::instance().graphicsDevice();
+    const TextureOptions &textureOptions = m_blitMipMapsOptions.value();
+    if (!m_texture.generateMipMaps(device, device.queues()[0], textureOptions, TextureLayout::ShaderReadOnlyOptimal, TextureLayout::ShaderReadOnlyOptimal)) {
+        SPDLOG_ERROR("Failed to generate mip maps for a {}x{} texture", textureOptions.extent.width, textureOptions.extent.height);
+        m_textureView = m_texture.createView({ .range = { .aspectMask = TextureAspectFlagBits::ColorBit, .levelCount = 1 } });
+    }
+    m_blitMipMapsOptions.reset();
 }
 
 void SingleTexture::deinitialize()
@@ -194,6 +347,8 @@ void SingleTexture::deinitialize()
     m_texture = {};
     m_textureView = {};
     m_sampler = {};
+    m_uploadValue = 0;
+    m_blitMipMapsOptions.reset();
 }
 
 } // namespace kdgpu_ext::graphics
@@ -2,23 +2,80 @@
 
 #include <KDUtils/file.h>
 
+#include <KDGpu/sampler.h>
 #include <KDGpu/texture.h>
-#include <KDGpuExample/example_engine_layer.h>
+#include <KDGpu/texture_options.h>
+#include <KDGpu/texture_view.h>
+#include <file/mapped_file.h>
 #include <texture/internal/image_data.h>
+#include <texture/mip_generation.h>
+#include <texture/texture_uploader.h>
+
+#include <memory>
+#include <optional>
+#include <string>
+
+struct ktxTexture;
 
 namespace kdgpu_ext::graphics::texture {
+
+/**
+ * A texture file read on the CPU without recording anything, so that files can be decoded
+ * on worker threads while the uploads are recorded on the thread owning the uploader.
+ */
+struct DecodedTextureFile {
+    std::string path;
+    // KTX files only have their header and level index read, the levels are loaded from
+    // the mapping straight into the staging ring when uploading
+    file::MappedFile mappedFile;
+    std::shared_ptr<ktxTexture> ktx;
+    // other files: the base level, decoded by stb_image or in the mapping of a raw file,
+    // and the levels box filtered on the CPU for formats that can not be blitted
+    internal::ImageData image;
+    std::shared_ptr<const uint8_t> decodedPixels;
+    MipChain mipChain;
+    // raw binary files hold data such as lookup tables, whose averaged texels would be
+    // meaningless, so they keep a single level
+    bool mipMapped = true;
+    // how the texture is bound, files that could not be loaded get a placeholder of that type
+    KDGpu::ViewType viewType = KDGpu::ViewType::ViewType2D;
+
+    bool isValid() const { return ktx != nullptr || image.pixelData != nullptr; }
+};
+
 /**
  * Just one texture, for one "set" in GLSL.
+ *
+ * The files are memory mapped and decoded, or for KTX and raw files copied, straight into
+ * the staging ring of the uploader. The uploads are recorded into its current batch, once
+ * that batch is complete finishUpload() generates the mip maps that are blitted on the GPU.
  */
 class SingleTexture
 {
 public:
-    void load(KDGpuExample::ExampleEngineLayer &engine, const KDUtils::File &file);
+    // read the files, from any thread
+    static DecodedTextureFile decodeImage(const std::string &path);
+    static DecodedTextureFile decodeKtx(const std::string &path, KDGpu::ViewType viewType = KDGpu::ViewType::ViewType2D);
+    static DecodedTextureFile decodeBinary(
+            const std::string &path,
+            size_t width,
+            size_t height,
+            size_t channelCount,
+            size_t channelSizeInBytes,
+            KDGpu::Format format);
 
-    void loadKtx(KDGpuExample::ExampleEngineLayer &engine, const KDUtils::File &file);
+    // creates the texture and records its upload, on the thread owning the uploader. Files
+    // that could not be loaded get a 1x1 white texture of their view type, so that their
+    // binding stays valid
+    void upload(TextureUploader &uploader, DecodedTextureFile &decoded);
+
+    // decode and upload in one go
+    void load(TextureUploader &uploader, const KDUtils::File &file);
+
+    void loadKtx(TextureUploader &uploader, const KDUtils::File &file, KDGpu::ViewType viewType = KDGpu::ViewType::ViewType2D);
 
     void loadBinary(
-            KDGpuExample::ExampleEngineLayer &engine,
+            TextureUploader &uploader,
             const KDUtils::File &file,
             size_t width,
             size_t height,
@@ -26,15 +83,26 @@ public:
             size_t channelSizeInBytes,
             KDGpu::Format format);
 
+    // blits the mip chain on the graphics queue, once the upload is complete
+    void finishUpload();
+
     void deinitialize();
 
-    TextureView &view() { return m_textureView; }
-    Sampler &sampler() { return m_sampler; }
+    KDGpu::TextureView &view() { return m_textureView; }
+    const KDGpu::Handle<KDGpu::Sampler_t> &sampler() const { return m_sampler; }
+    // of the uploader batch holding the upload
+    uint64_t uploadValue() const { return m_uploadValue; }
 
 private:
-    void uploadImage(KDGpuExample::ExampleEngineLayer &engine, internal::ImageData image);
-    Texture m_texture;
-    TextureView m_textureView;
-    Sampler m_sampler;
+    void uploadImage(TextureUploader &uploader, const DecodedTextureFile &decoded);
+    void uploadKtx(TextureUploader &uploader, const DecodedTextureFile &decoded);
+    void uploadPlaceholder(TextureUploader &uploader, KDGpu::ViewType viewType);
+
+    KDGpu::Texture m_texture;
+    KDGpu::TextureView m_textureView;
+    KDGpu::Handle<KDGpu::Sampler_t> m_sampler; // owned by the sampler cache
+    uint64_t m_uploadValue = 0;
+    // set while the levels after the first still have to be blitted
+    std::optional<KDGpu::TextureOptions> m_blitMipMapsOptions;
 };
 } // namespace kdgpu_ext::graphics::texture
@@ -0,0 +1,190 @@
+#include "texture_array_packer.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <map>
+#include <tuple>
+
+using namespace KDGpu;
+
+namespace kdgpu_ext::graphics::texture {
+
+namespace {
+
+constexpr DeviceSize LayerAlignment = 16;
+
+// format, then the size class for R8G8B8A8 or the exact extent for block compressed images
+using GroupKey = std::tuple<Format, uint32_t, uint32_t>;
+
+GroupKey groupKey(const CompressedImage &image)
+{
+    if (image.format == Format::R8G8B8A8_UNORM)
+        return { image.format, std::bit_ceil(std::max(image.extent.width, image.extent.height)), 0 };
+    return { image.format, image.extent.width, image.extent.height };
+}
+
+// Appends a level of width * height RGBA8 texels, padded to layerWidth * layerHeight by
+// repeating the last column and row
+void appendPaddedLevel(std::vector<uint8_t> &data, const uint8_t *texels, uint32_t width, uint32_t height, uint32_t layerWidth, uint32_t layerHeight)
+{
+    constexpr size_t texelSize = 4;
+    const size_t start = data.size();
+    data.resize(start + size_t(layerWidth) * layerHeight * texelSize);
+    uint8_t *destination = data.data() + start;
+    for (uint32_t y = 0; y < layerHeight; ++y) {
+        const uint8_t *sourceRow = texels + size_t(std::min(y, height - 1)) * width * texelSize;
+        uint8_t *destinationRow = destination + size_t(y) * layerWidth * texelSize;
+        std::memcpy(destinationRow, sourceRow, size_t(width) * texelSize);
+        for (uint32_t x = width; x < layerWidth; ++x)
+            std::memcpy(destinationRow + size_t(x) * texelSize, sourceRow + size_t(width - 1) * texelSize, texelSize);
+    }
+}
+
+// Extent of the layers and number of levels of an array holding the images
+struct ArrayShape {
+    Extent3D extent{ .width = 1, .height = 1, .depth = 1 };
+    uint32_t mipLevels{ ~0u };
+};
+
+ArrayShape arrayShape(std::span<const CompressedImage *const> images, std::span<const size_t> imageIndices)
+{
+    ArrayShape shape;
+    for (const size_t imageIndex : imageIndices) {
+        const CompressedImage &image = *images[imageIndex];
+        shape.extent.width = std::max(shape.extent.width, image.extent.width);
+        shape.extent.height = std::max(shape.extent.height, image.extent.height);
+        shape.mipLevels = std::min(shape.mipLevels, image.mipLevels);
+    }
+    return shape;
+}
+
+// Whether each level of the image covers the same share of the layer as the base level,
+// which the single UV rectangle of the image relies on. Rounding the odd sides of non power
+// of two images or clamping a side at 1 before the layer's moves the image in lower levels.
+bool scalesEvenly(const CompressedImage &image, const ArrayShape &shape)
+{
+    for (uint32_t level = 1; level < shape.mipLevels; ++level) {
+        const uint64_t width = std::max(1u, image.extent.width >> level);
+        const uint64_t height = std::max(1u, image.extent.height >> level);
+        const uint64_t layerWidth = std::max(1u, shape.extent.width >> level);
+        const uint64_t layerHeight = std::max(1u, shape.extent.height >> level);
+        if (width * shape.extent.width != layerWidth * image.extent.width ||
+            height * shape.extent.height != layerHeight * image.extent.height)
+            return false;
+    }
+    return true;
+}
+
+CompressedImage packArray(std::span<const CompressedImage *const> images, std::span<const size_t> imageIndices)
+{
+    const ArrayShape shape = arrayShape(images, imageIndices);
+    CompressedImage array;
+    array.format = images[imageIndices.front()]->format;
+    array.arrayLayers = static_cast<uint32_t>(imageIndices.size());
+    array.extent = shape.extent;
+    array.mipLevels = shape.mipLevels;
+
+    const bool padded = array.format == Format::R8G8B8A8_UNORM;
+    uint32_t layer = 0;
+    for (const size_t imageIndex : imageIndices) {
+        const CompressedImage &image = *images[imageIndex];
+        for (uint32_t level = 0; level < array.mipLevels; ++level) {
+            const BufferTextureCopyRegion &imageRegion = image.regions[level];
+
+            // clang-format off
+            BufferTextureCopyRegion region = {
+                .textureSubResource = {
+                    .aspectMask = TextureAspectFlagBits::ColorBit,
+                    .mipLevel = level,
+                    .baseArrayLayer = layer,
+                    .layerCount = 1
+                },
+                .textureExtent = imageRegion.textureExtent
+            };
+            // clang-format on
+
+            array.data.resize((array.data.size() + LayerAlignment - 1) / LayerAlignment * LayerAlignment);
+            region.bufferOffset = array.data.size();
+            if (padded) {
+                region.textureExtent.width = std::max(1u, array.extent.width >> level);
+                region.textureExtent.height = std::max(1u, array.extent.height >> level);
+                appendPaddedLevel(array.data, image.data.data() + imageRegion.bufferOffset,
+                                  imageRegion.textureExtent.width, imageRegion.textureExtent.height,
+                                  region.textureExtent.width, region.textureExtent.height);
+            } else {
+                // same extent, so the level is as large as up to the next level or the end
+                DeviceSize levelEnd = image.data.size();
+                for (const auto &other : image.regions) {
+                    if (other.bufferOffset > imageRegion.bufferOffset)
+                        levelEnd = std::min(levelEnd, other.bufferOffset);
+                }
+                array.data.insert(array.data.end(), image.data.begin() + imageRegion.bufferOffset, image.data.begin() + levelEnd);
+            }
+            array.regions.push_back(region);
+        }
+        ++layer;
+    }
+
+    return array;
+}
+
+} // namespace
+
+TextureArrayPack packTextureArrays(std::span<const CompressedImage *const> images, const TextureArrayPackingOptions &options)
+{
+    TextureArrayPack pack;
+    pack.placements.resize(images.size());
+
+    std::map<GroupKey, std::vector<size_t>> groups;
+    for (size_t imageIndex = 0; imageIndex < images.size(); ++imageIndex) {
+        const CompressedImage *image = images[imageIndex];
+        if (image == nullptr || image->arrayLayers != 1 || image->regions.size() != image->mipLevels || image->mipLevels == 0)
+            continue;
+        if (std::max(image->extent.width, image->extent.height) > options.maxSize)
+            continue;
+        groups[groupKey(*image)].push_back(imageIndex);
+    }
+
+    const size_t maxLayers = std::max(1u, options.maxLayers);
+    const size_t minImagesPerArray = std::max(2u, options.minImagesPerArray);
+    for (const auto &[key, imageIndices] : groups) {
+        if (imageIndices.size() < minImagesPerArray)
+            continue;
+
+        for (size_t first = 0; first < imageIndices.size(); first += maxLayers) {
+            std::vector<size_t> arrayImages(imageIndices.begin() + first, imageIndices.begin() + first + std::min(maxLayers, imageIndices.size() - first));
+
+            // images whose levels would drift in their layer stay separate textures. Leaving
+            // them out can shrink the layers or add levels, so check the others again.
+            for (;;) {
+                const ArrayShape shape = arrayShape(images, arrayImages);
+                const auto unevenImages = std::remove_if(arrayImages.begin(), arrayImages.end(), [&](size_t imageIndex) {
+                    return !scalesEvenly(*images[imageIndex], shape);
+                });
+                if (unevenImages == arrayImages.end())
+                    break;
+                arrayImages.erase(unevenImages, arrayImages.end());
+            }
+            if (arrayImages.size() < minImagesPerArray)
+                continue;
+
+            CompressedImage array = packArray(images, arrayImages);
+            for (uint32_t layer = 0; layer < arrayImages.size(); ++layer) {
+                const CompressedImage &image = *images[arrayImages[layer]];
+                pack.placements[arrayImages[layer]] = ArrayPlacement{
+                    .arrayIndex = static_cast<uint32_t>(pack.arrays.size()),
+                    .layer = layer,
+                    .uvRect = { 0.0f, 0.0f,
+                                float(image.extent.width) / float(array.extent.width),
+                                float(image.extent.height) / float(array.extent.height) }
+                };
+            }
+            pack.arrays.push_back(std::move(array));
+        }
+    }
+
+    return pack;
+}
+
+} // namespace kdgpu_ext::graphics::texture
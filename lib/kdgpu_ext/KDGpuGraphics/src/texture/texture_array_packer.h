@@ -0,0 +1,55 @@
+#pragma once
+
+#include <texture/block_compression.h>
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace kdgpu_ext::graphics::texture {
+
+struct TextureArrayPackingOptions {
+    // images with both sides up to this size are packed
+    uint32_t maxSize{ 256 };
+    // groups with fewer images stay separate textures
+    uint32_t minImagesPerArray{ 2 };
+    // larger groups are split over several arrays
+    uint32_t maxLayers{ 256 };
+};
+
+// Where an image ended up in the packed arrays
+struct ArrayPlacement {
+    uint32_t arrayIndex{ 0 };
+    uint32_t layer{ 0 };
+    // xy offset and zw scale mapping the image's texture coordinates into its layer
+    glm::vec4 uvRect{ 0.0f, 0.0f, 1.0f, 1.0f };
+};
+
+struct TextureArrayPack {
+    std::vector<CompressedImage> arrays;
+    std::vector<std::optional<ArrayPlacement>> placements; // indexed as per the images
+};
+
+/**
+ * Groups small images of the same format into 2D arrays, so that they take one texture,
+ * view and bind group entry between them. Images without an entry (nullptr) or too large
+ * are left out.
+ *
+ * R8G8B8A8 images of up to twice the size of each other share an array. Each layer is as
+ * large as the largest image, smaller images sit in its corner and are padded by repeating
+ * their edge texels, so filtering across the edge of their UV rectangle stays in the
+ * image. Block compressed images are only packed with images of the same extent, as block
+ * copies can not end inside a layer. The arrays have as many levels as the image with the
+ * fewest of them. Images whose lower levels would not cover the same share of the layer as
+ * their base level, e.g. non power of two images, are left out.
+ *
+ * Images smaller than their layer are repeated inside their UV rectangle by the shaders, so
+ * images sampled with another wrap mode than REPEAT have to be left out by the caller.
+ */
+TextureArrayPack packTextureArrays(std::span<const CompressedImage *const> images, const TextureArrayPackingOptions &options = {});
+
+} // namespace kdgpu_ext::graphics::texture
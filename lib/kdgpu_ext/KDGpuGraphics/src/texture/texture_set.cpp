@@ -1,27 +1,55 @@
 #include "texture_set.h"
 
 #include <global_resources.h>
+
+#include <KDGpu/bind_group_layout_options.h>
+#include <KDGpu/bind_group_options.h>
+
+#include <threading/thread_pool.h>
+
+#include <algorithm>
+#include <chrono>
 #include <filesystem>
 
+using namespace KDGpu;
+
 namespace kdgpu_ext::graphics::texture {
 
-void TextureUniformSet::loadAddTexture(KDGpuExample::ExampleEngineLayer &engine, const KDUtils::File &file)
+namespace {
+bool isKtxFile(const KDUtils::File &file)
+{
+    const std::string extension = std::filesystem::path(file.path()).extension().string();
+    return extension == ".ktx" || extension == ".ktx2";
+}
+
+// holds most LUTs and environment maps at once, larger files get their own staging buffer
+constexpr DeviceSize StagingRingSize = DeviceSize(16) << 20;
+} // namespace
+
+TextureUploader &TextureUniformSet::uploader()
+{
+    if (!m_uploader.isInitialized()) {
+        Device &device = GlobalResources::instance().graphicsDevice();
+        m_uploader.initialize(device, selectUploadQueue(device), StagingRingSize);
+    }
+    return m_uploader;
+}
+
+void TextureUniformSet::loadAddTexture(const KDUtils::File &file, KDGpu::ViewType viewType)
 {
     SingleTexture new_texture;
-    std::filesystem::path p = file.path();
-    std::string ext = p.extension().string();
-    if (ext == ".ktx" || ext == ".ktx2")
-        new_texture.loadKtx(engine, file);
+    if (isKtxFile(file))
+        new_texture.loadKtx(uploader(), file, viewType);
     else
-        new_texture.load(engine, file);
+        new_texture.load(uploader(), file);
     m_textures.push_back(std::move(new_texture));
 }
 
-void TextureUniformSet::loadBinaryTexture(KDGpuExample::ExampleEngineLayer &engine, const KDUtils::File &file, size_t width, size_t height, size_t channelCount, size_t channelSizeInBytes, KDGpu::Format format)
+void TextureUniformSet::loadBinaryTexture(const KDUtils::File &file, size_t width, size_t height, size_t channelCount, size_t channelSizeInBytes, KDGpu::Format format)
 {
     SingleTexture new_texture;
     new_texture.loadBinary(
-            engine,
+            uploader(),
             file,
             width,
             height,
@@ -32,7 +60,88 @@ void TextureUniformSet::loadBinaryTexture(KDGpuExample::ExampleEngineLayer &engi
 
 }
 
+void TextureUniformSet::loadAddTextureAsync(const KDUtils::File &file, KDGpu::ViewType viewType)
+{
+    const std::string path = file.path();
+    DecodingFile decodingFile{ .textureIndex = m_textures.size() };
+    if (isKtxFile(file))
+        decodingFile.decoded = threading::ThreadPool::instance().submit([path, viewType] { return SingleTexture::decodeKtx(path, viewType); });
+    else
+        decodingFile.decoded = threading::ThreadPool::instance().submit([path] { return SingleTexture::decodeImage(path); });
+    m_decodingFiles.push_back(std::move(decodingFile));
+    // filled in once decoded, keeps the bindings in order
+    m_textures.emplace_back();
+}
+
+void TextureUniformSet::loadBinaryTextureAsync(const KDUtils::File &file, size_t width, size_t height, size_t channelCount, size_t channelSizeInBytes, KDGpu::Format format)
+{
+    const std::string path = file.path();
+    m_decodingFiles.push_back({ .textureIndex = m_textures.size(),
+                                .decoded = threading::ThreadPool::instance().submit([=] {
+                                    return SingleTexture::decodeBinary(path, width, height, channelCount, channelSizeInBytes, format);
+                                }) });
+    m_textures.emplace_back();
+}
+
+bool TextureUniformSet::isDecoded() const
+{
+    return std::all_of(m_decodingFiles.begin(), m_decodingFiles.end(), [](const DecodingFile &decodingFile) {
+        return decodingFile.decoded.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    });
+}
+
 void TextureUniformSet::initializeCreateBindGroups()
+{
+    TextureUniformSet *const set = this;
+    initializeCreateBindGroups(std::span(&set, 1));
+}
+
+void TextureUniformSet::initializeCreateBindGroups(std::span<TextureUniformSet *const> sets)
+{
+    if (sets.empty())
+        return;
+
+    struct PendingFile {
+        TextureUniformSet *set;
+        DecodingFile *decodingFile;
+    };
+    std::vector<PendingFile> pendingFiles;
+    for (TextureUniformSet *set : sets) {
+        for (auto &decodingFile : set->m_decodingFiles)
+            pendingFiles.push_back({ set, &decodingFile });
+    }
+
+    // the files are uploaded as they finish decoding, whichever set they belong to
+    TextureUploader &sharedUploader = sets.front()->uploader();
+    while (!pendingFiles.empty()) {
+        const auto decodedFile = std::find_if(pendingFiles.begin(), pendingFiles.end(), [](const PendingFile &pendingFile) {
+            return pendingFile.decodingFile->decoded.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+        });
+        if (decodedFile == pendingFiles.end()) {
+            pendingFiles.front().decodingFile->decoded.wait_for(std::chrono::milliseconds(1));
+            continue;
+        }
+        DecodedTextureFile decoded = decodedFile->decodingFile->decoded.get();
+        decodedFile->set->m_textures[decodedFile->decodingFile->textureIndex].upload(sharedUploader, decoded);
+        pendingFiles.erase(decodedFile);
+    }
+
+    // everything is submitted before waiting, sets loaded synchronously have their own uploader
+    for (TextureUniformSet *set : sets)
+        set->m_uploader.flush();
+    for (TextureUniformSet *set : sets) {
+        set->m_decodingFiles.clear();
+        set->m_uploader.deinitialize();
+    }
+
+    for (TextureUniformSet *set : sets) {
+        for (auto &texture : set->m_textures)
+            texture.finishUpload();
+        set->createBindGroups();
+    }
+}
+
+void TextureUniformSet::createBindGroups()
 {
     BindGroupLayoutOptions bind_group_layout_options;
     {
@@ -65,8 +174,14 @@ void TextureUniformSet::initializeCreateBindGroups()
 }
 void TextureUniformSet::deinitialize()
 {
+    // nothing is uploaded from files still being decoded
+    for (auto &decodingFile : m_decodingFiles)
+        decodingFile.decoded.wait();
+    m_decodingFiles.clear();
+
     for (auto &texture : m_textures)
         texture.deinitialize();
+    m_uploader.deinitialize();
 
     m_bindGroupLayout = {};
     m_textureBindGroup = {};
@@ -1,23 +1,34 @@
 #pragma once
 
+#include <future>
+#include <span>
 #include <vector>
 
 #include <KDUtils/file.h>
 
+#include <KDGpu/bind_group.h>
+#include <KDGpu/bind_group_layout.h>
+
 #include <texture/single_texture.h>
+#include <texture/texture_uploader.h>
 
 namespace kdgpu_ext::graphics::texture {
 
 /**
  * Supports one or more textures to be used in a shader under a specific bind group or set.
+ *
+ * The textures are bound in the order they are added. Files added with the async functions
+ * are decoded on worker threads, so the files of all sets can be read at once while the
+ * caller carries on. The static initializeCreateBindGroups() then uploads the files of all
+ * sets through one staging ring and waits for them once.
  */
 class TextureUniformSet
 {
 public:
-    void loadAddTexture(KDGpuExample::ExampleEngineLayer &engine, const KDUtils::File &file);
+    // viewType is how KTX files are bound, e.g. ViewTypeCube for environment maps
+    void loadAddTexture(const KDUtils::File &file, KDGpu::ViewType viewType = KDGpu::ViewType::ViewType2D);
 
     void loadBinaryTexture(
-            KDGpuExample::ExampleEngineLayer &engine,
             const KDUtils::File &file,
             size_t width,
             size_t height,
@@ -25,16 +36,45 @@ public:
             size_t channelSizeInBytes,
             KDGpu::Format format);
 
+    void loadAddTextureAsync(const KDUtils::File &file, KDGpu::ViewType viewType = KDGpu::ViewType::ViewType2D);
+
+    void loadBinaryTextureAsync(
+            const KDUtils::File &file,
+            size_t width,
+            size_t height,
+            size_t channelCount,
+            size_t channelSizeInBytes,
+            KDGpu::Format format);
+
+    // whether the files added with the async functions have been decoded
+    bool isDecoded() const;
+
+    // waits for the files being decoded and uploads them on a transfer queue if the device
+    // has one. Submits the uploads of the loaded textures and waits for them, the staging memory
+    // is released once they are complete
     void initializeCreateBindGroups();
+    // the same for several sets at once, their files share the staging ring of the first set
+    static void initializeCreateBindGroups(std::span<TextureUniformSet *const> sets);
     void deinitialize();
 
-    BindGroup &bindGroup() { return m_textureBindGroup; }
-    BindGroupLayout &bindGroupLayout() { return m_bindGroupLayout; }
+    KDGpu::BindGroup &bindGroup() { return m_textureBindGroup; }
+    KDGpu::BindGroupLayout &bindGroupLayout() { return m_bindGroupLayout; }
 
 private:
+    struct DecodingFile {
+        size_t textureIndex = 0;
+        std::future<DecodedTextureFile> decoded;
+    };
+
+    TextureUploader &uploader();
+    void createBindGroups();
+
     std::vector<SingleTexture> m_textures;
-    BindGroup m_textureBindGroup;
-    BindGroupLayout m_bindGroupLayout;
+    std::vector<DecodingFile> m_decodingFiles;
+    // only alive while loading, the files are mapped and copied into its staging ring
+    TextureUploader m_uploader;
+    KDGpu::BindGroup m_textureBindGroup;
+    KDGpu::BindGroupLayout m_bindGroupLayout;
 };
 
 } // namespace kdgpu_ext::graphics::texture
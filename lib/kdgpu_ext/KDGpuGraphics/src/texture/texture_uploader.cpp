@@ -0,0 +1,267 @@
+#include "texture_uploader.h"
+
+#include <KDGpu/buffer_options.h>
+#include <KDGpu/texture_options.h>
+
+#include <cassert>
+#include <cstring>
+
+using namespace KDGpu;
+
+namespace kdgpu_ext::graphics::texture {
+
+namespace {
+// covers the texel blocks of the 4 and 16 byte formats uploaded through the ring
+constexpr DeviceSize StagingAlignment = 16;
+
+DeviceSize alignUp(DeviceSize value, DeviceSize alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+} // namespace
+
+Queue &selectUploadQueue(Device &device)
+{
+    auto &queues = device.queues();
+    for (auto &queue : queues) {
+        if (queue.flags().testFlag(QueueFlagBits::TransferBit) && !queue.flags().testFlag(QueueFlagBits::GraphicsBit))
+            return queue;
+    }
+    return queues.front();
+}
+
+void TextureUploader::initialize(Device &device, Queue &queue, DeviceSize ringSize)
+{
+    m_device = &device;
+    m_queue = &queue;
+    m_graphicsQueue = queue.flags().testFlag(QueueFlagBits::GraphicsBit);
+    m_ringSize = alignUp(ringSize, StagingAlignment);
+
+    // clang-format off
+    const BufferOptions ringOptions = {
+        .label = "Texture Staging Ring",
+        .size = m_ringSize,
+        .usage = BufferUsageFlagBits::TransferSrcBit,
+        .memoryUsage = MemoryUsage::CpuToGpu
+    };
+    // clang-format on
+    m_ring = device.createBuffer(ringOptions);
+    // stays mapped for the lifetime of the uploader
+    m_ringData = static_cast<uint8_t *>(m_ring.map());
+
+    m_ringHead = 0;
+    m_ringTail = 0;
+    m_completedValue = 0;
+    m_submittedValue = 0;
+    m_stats = {};
+}
+
+void TextureUploader::deinitialize()
+{
+    if (m_device == nullptr)
+        return;
+
+    flush();
+    while (!m_batches.empty()) {
+        m_batches.front().fence.wait();
+        retireFront();
+    }
+
+    m_ring.unmap();
+    m_ring = {};
+    m_ringData = nullptr;
+    m_device = nullptr;
+    m_queue = nullptr;
+}
+
+void TextureUploader::setTextureSharing(TextureOptions &options) const
+{
+    const uint32_t graphicsQueueTypeIndex = m_device->queues().front().queueTypeIndex();
+    if (m_queue->queueTypeIndex() == graphicsQueueTypeIndex)
+        return;
+    options.sharingMode = SharingMode::Concurrent;
+    options.queueTypeIndices = { m_queue->queueTypeIndex(), graphicsQueueTypeIndex };
+}
+
+bool TextureUploader::fits(DeviceSize byteSize) const
+{
+    // an allocation never wraps around the end of the ring, the rest of the ring is skipped
+    const DeviceSize offset = m_ringHead % m_ringSize;
+    const DeviceSize padding = offset + byteSize > m_ringSize ? m_ringSize - offset : 0;
+    return m_ringHead + padding + byteSize - m_ringTail <= m_ringSize;
+}
+
+StagingAllocation TextureUploader::allocate(DeviceSize byteSize)
+{
+    assert(m_device != nullptr);
+    const DeviceSize alignedSize = alignUp(byteSize, StagingAlignment);
+
+    // too large for the ring, give it a buffer of its own which is released with its batch
+    if (alignedSize > m_ringSize) {
+        // clang-format off
+        const BufferOptions bufferOptions = {
+            .size = byteSize,
+            .usage = BufferUsageFlagBits::TransferSrcBit,
+            .memoryUsage = MemoryUsage::CpuToGpu
+        };
+        // clang-format on
+        Buffer buffer = m_device->createBuffer(bufferOptions);
+        StagingAllocation staging = {
+            .data = static_cast<uint8_t *>(buffer.map()),
+            .byteSize = byteSize,
+            .buffer = buffer,
+            .offset = 0
+        };
+        m_ownBuffers.push_back(std::move(buffer));
+        return staging;
+    }
+
+    // wait for the oldest batches to free their space, submitting the current one if it
+    // holds the space needed itself
+    update();
+    while (!fits(alignedSize)) {
+        ++m_stats.ringStalls;
+        if (m_batches.empty()) {
+            if (m_recorder.has_value()) {
+                flush();
+            } else {
+                // nothing in flight or recorded, the ring is empty
+                m_ringHead = 0;
+                m_ringTail = 0;
+            }
+            continue;
+        }
+        m_batches.front().fence.wait();
+        retireFront();
+    }
+
+    const DeviceSize offset = m_ringHead % m_ringSize;
+    if (offset + alignedSize > m_ringSize)
+        m_ringHead += m_ringSize - offset;
+    const DeviceSize ringOffset = m_ringHead % m_ringSize;
+    m_ringHead += alignedSize;
+
+    return {
+        .data = m_ringData + ringOffset,
+        .byteSize = byteSize,
+        .buffer = m_ring,
+        .offset = ringOffset
+    };
+}
+
+uint64_t TextureUploader::upload(const TextureUploadOptions &options)
+{
+    StagingAllocation staging = allocate(options.byteSize);
+    std::memcpy(staging.data, options.data, options.byteSize);
+    return upload(staging, options);
+}
+
+uint64_t TextureUploader::upload(const StagingAllocation &staging, const TextureUploadOptions &options)
+{
+    CommandRecorder &commandRecorder = recorder();
+
+    // clang-format off
+    commandRecorder.textureMemoryBarrier(TextureMemoryBarrierOptions{
+        .srcStages = PipelineStageFlagBit::TopOfPipeBit,
+        .srcMask = AccessFlagBit::None,
+        .dstStages = PipelineStageFlagBit::TransferBit,
+        .dstMask = AccessFlagBit::TransferWriteBit,
+        .oldLayout = options.oldLayout,
+        .newLayout = TextureLayout::TransferDstOptimal,
+        .texture = options.destinationTexture,
+        .range = { .aspectMask = TextureAspectFlagBits::ColorBit }
+    });
+    // clang-format on
+
+    // the regions are relative to the start of the upload's data
+    std::vector<BufferTextureCopyRegion> regions = options.regions;
+    for (auto &region : regions)
+        region.bufferOffset += staging.offset;
+
+    // clang-format off
+    commandRecorder.copyBufferToTexture(BufferToTextureCopy{
+        .srcBuffer = staging.buffer,
+        .dstTexture = options.destinationTexture,
+        .dstImageLayout = TextureLayout::TransferDstOptimal,
+        .regions = std::move(regions)
+    });
+
+    // graphics stages can not be named on a transfer queue, the users wait for the batch instead
+    commandRecorder.textureMemoryBarrier(TextureMemoryBarrierOptions{
+        .srcStages = PipelineStageFlagBit::TransferBit,
+        .srcMask = AccessFlagBit::TransferWriteBit,
+        .dstStages = m_graphicsQueue ? options.dstStages : PipelineStageFlags(PipelineStageFlagBit::BottomOfPipeBit),
+        .dstMask = m_graphicsQueue ? options.dstMask : AccessFlags(AccessFlagBit::None),
+        .oldLayout = TextureLayout::TransferDstOptimal,
+        .newLayout = options.newLayout,
+        .texture = options.destinationTexture,
+        .range = { .aspectMask = TextureAspectFlagBits::ColorBit }
+    });
+    // clang-format on
+
+    ++m_stats.uploadCount;
+    m_stats.uploadedBytes += staging.byteSize;
+    return m_submittedValue + 1;
+}
+
+CommandRecorder &TextureUploader::recorder()
+{
+    if (!m_recorder.has_value())
+        m_recorder.emplace(m_device->createCommandRecorder());
+    return *m_recorder;
+}
+
+void TextureUploader::flush()
+{
+    if (!m_recorder.has_value())
+        return;
+
+    Batch batch;
+    batch.value = ++m_submittedValue;
+    batch.ringEnd = m_ringHead;
+    batch.commandBuffer = m_recorder->finish();
+    batch.fence = m_device->createFence();
+    batch.ownBuffers = std::move(m_ownBuffers);
+    m_ownBuffers.clear();
+    m_recorder.reset();
+
+    for (auto &buffer : batch.ownBuffers)
+        buffer.unmap();
+
+    // clang-format off
+    m_queue->submit(SubmitOptions{
+        .commandBuffers = { batch.commandBuffer },
+        .signalFence = batch.fence
+    });
+    // clang-format on
+
+    m_batches.push_back(std::move(batch));
+    ++m_stats.batchCount;
+}
+
+void TextureUploader::retireFront()
+{
+    Batch &batch = m_batches.front();
+    m_completedValue = batch.value;
+    m_ringTail = batch.ringEnd;
+    m_batches.pop_front();
+}
+
+void TextureUploader::update()
+{
+    // batches finish in submission order on the queue
+    while (!m_batches.empty() && m_batches.front().fence.status() == FenceStatus::Signalled)
+        retireFront();
+}
+
+void TextureUploader::waitFor(uint64_t value)
+{
+    if (value > m_submittedValue)
+        flush();
+    while (!m_batches.empty() && m_completedValue < value) {
+        m_batches.front().fence.wait();
+        retireFront();
+    }
+}
+
+} // namespace kdgpu_ext::graphics::texture
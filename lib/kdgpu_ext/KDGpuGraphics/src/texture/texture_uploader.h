@@ -0,0 +1,119 @@
+#pragma once
+
+#include <KDGpu/buffer.h>
+#include <KDGpu/command_buffer.h>
+#include <KDGpu/command_recorder.h>
+#include <KDGpu/device.h>
+#include <KDGpu/fence.h>
+#include <KDGpu/queue.h>
+#include <KDGpu/texture_options.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <vector>
+
+namespace kdgpu_ext::graphics::texture {
+
+// Space in the staging ring the caller writes the texels of one upload to
+struct StagingAllocation {
+    uint8_t *data{ nullptr };
+    KDGpu::DeviceSize byteSize{ 0 };
+    KDGpu::Handle<KDGpu::Buffer_t> buffer;
+    KDGpu::DeviceSize offset{ 0 };
+};
+
+struct TextureUploaderStats {
+    uint64_t batchCount{ 0 };
+    uint64_t uploadCount{ 0 };
+    uint64_t uploadedBytes{ 0 };
+    uint64_t ringStalls{ 0 }; // waits for the GPU to free ring space
+};
+
+// A queue of a transfer only family if the device was created with one, whose copies run
+// alongside the graphics work, otherwise the first queue
+KDGpu::Queue &selectUploadQueue(KDGpu::Device &device);
+
+/**
+ * Batches texture uploads into few queue submissions. The texels of all uploads are packed
+ * into one persistently mapped staging ring and the copies, with the layout transitions
+ * around them, are recorded into a single command buffer per batch.
+ *
+ * Every batch gets the next value of a counter, which completedValue() reaches once the
+ * GPU has finished the batch, so users poll one number instead of a fence per upload.
+ * Uploads larger than the ring get a staging buffer of their own in the batch.
+ *
+ * On a queue without graphics support the textures are left for the graphics queue without
+ * a barrier to its stages, users have to wait for completedValue() before sampling them.
+ */
+class TextureUploader
+{
+public:
+    void initialize(KDGpu::Device &device, KDGpu::Queue &queue, KDGpu::DeviceSize ringSize = KDGpu::DeviceSize(64) << 20);
+    // waits for the batches in flight
+    void deinitialize();
+    bool isInitialized() const { return m_device != nullptr; }
+
+    // Textures uploaded on another queue family than the first queue's are shared between
+    // both, as their ownership is not transferred
+    void setTextureSharing(KDGpu::TextureOptions &options) const;
+
+    // Copies the data to the ring and records the copy into the current batch. Returns
+    // the value completedValue() reaches once the texture can be used.
+    uint64_t upload(const KDGpu::TextureUploadOptions &options);
+
+    // Reserves space for the caller to write to directly, e.g. when reading a file, and
+    // uploads it with the regions of the options, whose data pointer is ignored. Reserving
+    // may submit the current batch to free space.
+    StagingAllocation allocate(KDGpu::DeviceSize byteSize);
+    uint64_t upload(const StagingAllocation &staging, const KDGpu::TextureUploadOptions &options);
+
+    // Submits the current batch, if anything was recorded
+    void flush();
+
+    // Retires the finished batches and frees their ring space, once per frame
+    void update();
+    uint64_t completedValue() const { return m_completedValue; }
+    // value of the last submitted batch
+    uint64_t submittedValue() const { return m_submittedValue; }
+    bool isComplete(uint64_t value) const { return value <= m_completedValue; }
+    // flushes if the value is in the current batch
+    void waitFor(uint64_t value);
+
+    const TextureUploaderStats &stats() const { return m_stats; }
+
+private:
+    struct Batch {
+        uint64_t value{ 0 };
+        uint64_t ringEnd{ 0 }; // ring position freed by finishing this batch
+        KDGpu::CommandBuffer commandBuffer;
+        KDGpu::Fence fence;
+        std::vector<KDGpu::Buffer> ownBuffers; // staging of uploads larger than the ring
+    };
+
+    bool fits(KDGpu::DeviceSize byteSize) const;
+    void retireFront();
+    KDGpu::CommandRecorder &recorder();
+
+    KDGpu::Device *m_device{ nullptr };
+    KDGpu::Queue *m_queue{ nullptr };
+    bool m_graphicsQueue{ true };
+
+    KDGpu::Buffer m_ring;
+    uint8_t *m_ringData{ nullptr };
+    KDGpu::DeviceSize m_ringSize{ 0 };
+    // positions grow without wrapping, the ring offset is the position modulo its size
+    uint64_t m_ringHead{ 0 };
+    uint64_t m_ringTail{ 0 };
+
+    std::optional<KDGpu::CommandRecorder> m_recorder;
+    std::vector<KDGpu::Buffer> m_ownBuffers;
+    std::deque<Batch> m_batches; // submitted, oldest first
+    uint64_t m_completedValue{ 0 };
+    uint64_t m_submittedValue{ 0 };
+
+    TextureUploaderStats m_stats;
+};
+
+} // namespace kdgpu_ext::graphics::texture
@@ -0,0 +1,54 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+
+namespace kdgpu_ext::graphics::threading {
+
+ThreadPool::ThreadPool(size_t workerCount)
+{
+    if (workerCount == 0)
+        workerCount = std::max(1u, std::thread::hardware_concurrency());
+
+    m_workers.reserve(workerCount);
+    for (size_t i = 0; i < workerCount; ++i)
+        m_workers.emplace_back([this]() { workerLoop(); });
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_condition.notify_all();
+
+    for (auto &worker : m_workers)
+        worker.join();
+}
+
+ThreadPool &ThreadPool::instance()
+{
+    static ThreadPool inst;
+    return inst;
+}
+
+void ThreadPool::workerLoop()
+{
+    for (;;) {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_condition.wait(lock, [this]() { return m_stopping || !m_jobs.empty(); });
+
+            // finish the queued jobs before stopping, their futures may be waited on
+            if (m_jobs.empty())
+                return;
+
+            job = std::move(m_jobs.front());
+            m_jobs.pop();
+        }
+        job();
+    }
+}
+
+} // namespace kdgpu_ext::graphics::threading
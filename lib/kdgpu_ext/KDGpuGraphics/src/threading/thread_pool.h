@@ -0,0 +1,58 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace kdgpu_ext::graphics::threading {
+
+/**
+ * Fixed set of worker threads executing submitted jobs in FIFO order.
+ * Used to move CPU heavy work (pipeline creation, image transcoding, texture decoding) off
+ * the render thread and spread it over the available cores.
+ */
+class ThreadPool
+{
+public:
+    // 0 means one worker per hardware thread
+    explicit ThreadPool(size_t workerCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    size_t workerCount() const { return m_workers.size(); }
+
+    template<typename Job>
+    auto submit(Job &&job) -> std::future<std::invoke_result_t<Job>>
+    {
+        using Result = std::invoke_result_t<Job>;
+        auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<Job>(job));
+        std::future<Result> result = task->get_future();
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_jobs.emplace([task]() { (*task)(); });
+        }
+        m_condition.notify_one();
+        return result;
+    }
+
+    // shared pool for code that has no natural owner for one
+    static ThreadPool &instance();
+
+private:
+    void workerLoop();
+
+    std::vector<std::thread> m_workers;
+    std::queue<std::function<void()>> m_jobs;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    bool m_stopping = false;
+};
+
+} // namespace kdgpu_ext::graphics::threading
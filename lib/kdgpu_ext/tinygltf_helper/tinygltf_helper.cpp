@@ -20,6 +20,9 @@
 #include <glm/gtx/quaternion.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include <array>
+#include <cstring>
+
 #ifdef ANDROID
 #include <KDUtils/dir.h>
 #include <KDGui/platform/android/android_platform_integration.h>
@@ -368,20 +371,107 @@ KDGpu::AddressMode addressModeForSamplerAddressMode(int addressMode)
     }
 }
 
+KDGpu::SamplerOptions samplerOptionsForTexture(const tinygltf::Model &model, int textureIndex)
+{
+    KDGpu::SamplerOptions options = {
+        .magFilter = KDGpu::FilterMode::Linear,
+        .minFilter = KDGpu::FilterMode::Linear,
+        .mipmapFilter = KDGpu::MipmapFilterMode::Linear,
+        .u = KDGpu::AddressMode::Repeat,
+        .v = KDGpu::AddressMode::Repeat
+    };
+
+    const int samplerIndex = model.textures.at(textureIndex).sampler;
+    if (samplerIndex < 0)
+        return options;
+
+    const tinygltf::Sampler &sampler = model.samplers.at(samplerIndex);
+    if (sampler.magFilter != -1)
+        options.magFilter = filterModeForSamplerFilter(sampler.magFilter);
+    if (sampler.minFilter != -1) {
+        options.minFilter = filterModeForSamplerFilter(sampler.minFilter);
+        options.mipmapFilter = mipmapFilterModeForSamplerFilter(sampler.minFilter);
+        // Filters without a mipmap mode only sample the base level
+        if (sampler.minFilter == TINYGLTF_TEXTURE_FILTER_NEAREST || sampler.minFilter == TINYGLTF_TEXTURE_FILTER_LINEAR)
+            options.lodMaxClamp = 0.25f;
+    }
+    options.u = addressModeForSamplerAddressMode(sampler.wrapS);
+    options.v = addressModeForSamplerAddressMode(sampler.wrapT);
+    return options;
+}
+
+namespace {
+
+constexpr std::array<uint8_t, 12> ktx2Identifier = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+
+bool hasKtx2Identifier(const unsigned char *bytes, size_t size)
+{
+    return size >= ktx2Identifier.size() && std::memcmp(bytes, ktx2Identifier.data(), ktx2Identifier.size()) == 0;
+}
+
+// Keeps KTX2 files as they are for transcoding by the renderer and decodes everything else with stb
+bool loadImageData(tinygltf::Image *image, const int imageIndex, std::string *err, std::string *warn,
+                   int requestedWidth, int requestedHeight, const unsigned char *bytes, int size, void *userData)
+{
+    if (!hasKtx2Identifier(bytes, size))
+        return tinygltf::LoadImageData(image, imageIndex, err, warn, requestedWidth, requestedHeight, bytes, size, userData);
+
+    // The identifier is followed by vkFormat, typeSize, pixelWidth and pixelHeight
+    constexpr size_t headerSize = 12 + 4 * sizeof(uint32_t);
+    if (static_cast<size_t>(size) < headerSize) {
+        if (err)
+            *err += "Truncated KTX2 image " + std::to_string(imageIndex) + "\n";
+        return false;
+    }
+    uint32_t extent[2];
+    std::memcpy(extent, bytes + 20, sizeof(extent));
+
+    image->width = static_cast<int>(extent[0]);
+    image->height = static_cast<int>(extent[1]);
+    image->component = 0;
+    image->bits = 0;
+    image->mimeType = "image/ktx2";
+    image->image.assign(bytes, bytes + size);
+    return true;
+}
+
+} // namespace
+
+bool isKtx2Image(const tinygltf::Image &image)
+{
+    return hasKtx2Identifier(image.image.data(), image.image.size());
+}
+
+std::optional<int> imageIndexForTexture(const tinygltf::Model &model, int textureIndex)
+{
+    const tinygltf::Texture &texture = model.textures.at(textureIndex);
+    const auto basisuIt = texture.extensions.find("KHR_texture_basisu");
+    if (basisuIt != texture.extensions.end() && basisuIt->second.Has("source"))
+        return basisuIt->second.Get("source").GetNumberAsInt();
+    if (texture.source == -1)
+        return std::nullopt;
+    return texture.source;
+}
+
 bool loadModel(tinygltf::Model &model, const std::string &filename)
 {
     tinygltf::TinyGLTF loader;
+    loader.SetImageLoader(loadImageData, nullptr);
     std::string err;
     std::string warn;
 
 #ifdef ANDROID
     auto dir = KDUtils::Dir{ KDGui::AndroidPlatformIntegration::s_androidApp->activity->externalDataPath };
-    auto androidFilename = dir.absoluteFilePath(filename);
-    bool result = loader.LoadASCIIFromFile(&model, &err, &warn, androidFilename.data());
+    const std::string path = dir.absoluteFilePath(filename);
 #else
-    bool result = loader.LoadASCIIFromFile(&model, &err, &warn, filename.data());
+    const std::string &path = filename;
 #endif
 
+    // Binary glTF (.glb) files carry the json and the buffers in a single container
+    const bool isBinary = path.size() >= 4 && path.compare(path.size() - 4, 4, ".glb") == 0;
+    bool result = isBinary ? loader.LoadBinaryFromFile(&model, &err, &warn, path)
+                           : loader.LoadASCIIFromFile(&model, &err, &warn, path);
+
 
 
     if (!warn.empty())
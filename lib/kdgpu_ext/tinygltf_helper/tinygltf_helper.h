@@ -13,11 +13,13 @@
 #include <tinygltf_helper/tinygltf_helper_export.h>
 
 #include <KDGpu/gpu_core.h>
+#include <KDGpu/sampler_options.h>
 
 #include <tiny_gltf.h>
 
 #include <glm/glm.hpp>
 
+#include <optional>
 #include <stdint.h>
 #include <string>
 
@@ -56,6 +58,18 @@ TINYGLTF_HELPER_EXPORT uint32_t packedArrayStrideForAccessor(const tinygltf::Acc
 TINYGLTF_HELPER_EXPORT KDGpu::FilterMode filterModeForSamplerFilter(int filter);
 TINYGLTF_HELPER_EXPORT KDGpu::MipmapFilterMode mipmapFilterModeForSamplerFilter(int filter);
 TINYGLTF_HELPER_EXPORT KDGpu::AddressMode addressModeForSamplerAddressMode(int addressMode);
+
+// The filter and wrap modes of a glTF texture's sampler. Filters left to the implementation
+// are trilinear and textures without a sampler repeat, as the specification suggests.
+TINYGLTF_HELPER_EXPORT KDGpu::SamplerOptions samplerOptionsForTexture(const tinygltf::Model &model, int textureIndex);
 TINYGLTF_HELPER_EXPORT bool loadModel(tinygltf::Model &model, const std::string &filename);
 
+// KTX2 images (KHR_texture_basisu) are not decoded by loadModel(). Their image data holds the
+// file contents and width and height are read from its header.
+TINYGLTF_HELPER_EXPORT bool isKtx2Image(const tinygltf::Image &image);
+
+// The image a texture samples, preferring the KTX2 source of KHR_texture_basisu over the
+// fallback PNG or JPEG one. Nothing if the texture has no source, which is valid glTF.
+TINYGLTF_HELPER_EXPORT std::optional<int> imageIndexForTexture(const tinygltf::Model &model, int textureIndex);
+
 } // namespace TinyGltfHelper
@@ -0,0 +1,170 @@
+/*
+  This file is part of KDGpu Examples.
+
+  SPDX-FileCopyrightText: 2023 Klarälvdalens Datakonsult AB, a KDAB Group company <info@kdab.com>
+
+  SPDX-License-Identifier: MIT
+
+  Contact KDAB at <info@kdab.com> for commercial licensing options.
+*/
+
+#include "vertex_layout_analyzer.h"
+#include "tinygltf_helper.h"
+
+#include <KDGpu/utils/hash_utils.h>
+
+#include <algorithm>
+#include <map>
+
+using namespace KDGpu;
+
+namespace TinyGltfHelper {
+
+namespace {
+
+uint32_t strideForAccessor(const tinygltf::Model &model, const tinygltf::Accessor &accessor)
+{
+    const auto &bufferView = model.bufferViews.at(accessor.bufferView);
+    return bufferView.byteStride ? static_cast<uint32_t>(bufferView.byteStride)
+                                 : packedArrayStrideForAccessor(accessor);
+}
+
+} // namespace
+
+size_t VertexLayoutAnalyzer::SignatureHash::operator()(const std::vector<uint64_t> &signature) const
+{
+    uint64_t hash = 0;
+    for (const uint64_t value : signature)
+        KDGpu::hash_combine(hash, value);
+    return hash;
+}
+
+VertexLayoutAnalyzer::VertexLayoutAnalyzer(const tinygltf::Model &model, std::unordered_map<std::string, uint32_t> shaderLocations)
+    : m_model(model)
+    , m_shaderLocations(std::move(shaderLocations))
+{
+}
+
+const PrimitiveVertexLayout &VertexLayoutAnalyzer::analyze(const tinygltf::Primitive &primitive)
+{
+    ++m_lookupCount;
+
+    // Everything analyzeUncached() reads from the consumed attributes. The attributes
+    // are always visited in the same (name) order so equal primitives give equal keys.
+    m_signature.clear();
+    for (const auto &attribute : primitive.attributes) {
+        const auto locationIt = m_shaderLocations.find(attribute.first);
+        if (locationIt == m_shaderLocations.end())
+            continue;
+        const auto &accessor = m_model.accessors.at(attribute.second);
+        m_signature.insert(m_signature.end(), { locationIt->second,
+                                                static_cast<uint64_t>(accessor.bufferView),
+                                                strideForAccessor(m_model, accessor),
+                                                accessor.byteOffset,
+                                                static_cast<uint64_t>(formatForAccessor(accessor)),
+                                                accessor.count });
+    }
+
+    const auto layoutIt = m_primitiveLayouts.find(m_signature);
+    if (layoutIt != m_primitiveLayouts.end())
+        return layoutIt->second;
+
+    return m_primitiveLayouts.emplace(m_signature, analyzeUncached(primitive)).first->second;
+}
+
+bool VertexLayoutAnalyzer::hasLocation(uint32_t layoutId, uint32_t location) const
+{
+    const auto &attributes = m_layouts.at(layoutId).attributes;
+    return std::any_of(attributes.begin(), attributes.end(),
+                       [location](const VertexAttribute &attribute) { return attribute.location == location; });
+}
+
+PrimitiveVertexLayout VertexLayoutAnalyzer::analyzeUncached(const tinygltf::Primitive &primitive)
+{
+    PrimitiveVertexLayout layout;
+    VertexOptions vertexOptions{};
+
+    // Used to keep track of which bindings are used for each buffer view and
+    // which attributes use each vertex buffer layout
+    std::map<int, std::vector<uint32_t>> bufferViewToLayoutMap;
+    std::vector<std::vector<uint32_t>> layoutToAttributeMap; // Indexed by binding
+
+    // Iterate over each attribute in the primitive to build up a description of the
+    // vertex layout needed to create the pipeline.
+    for (const auto &attribute : primitive.attributes) {
+        // Find the location for this attribute (if any)
+        const auto locationIt = m_shaderLocations.find(attribute.first);
+        if (locationIt == m_shaderLocations.end())
+            continue;
+        const auto &accessor = m_model.accessors.at(attribute.second);
+
+        // Do we already have a binding for this buffer view that is compatible with this use
+        // of it? That is, is the attribute less than a stride away from one of its attributes?
+        std::vector<uint32_t> &layoutIndices = bufferViewToLayoutMap[accessor.bufferView];
+        const auto compatibleLayoutIt = std::find_if(layoutIndices.begin(), layoutIndices.end(), [&](uint32_t layoutIndex) {
+            const auto &attributeIndices = layoutToAttributeMap.at(layoutIndex);
+            return std::any_of(attributeIndices.begin(), attributeIndices.end(), [&](uint32_t attributeIndex) {
+                const DeviceSize attributeOffsetDelta = std::abs(
+                        int64_t(accessor.byteOffset) - int64_t(vertexOptions.attributes[attributeIndex].offset));
+                return attributeOffsetDelta < vertexOptions.buffers[layoutIndex].stride;
+            });
+        });
+
+        uint32_t binding = 0;
+        if (compatibleLayoutIt != layoutIndices.end()) {
+            // Track the minimum offset across all attributes that share a buffer layout
+            binding = *compatibleLayoutIt;
+            VertexBufferBinding &bufferBinding = layout.bindings.at(binding);
+            bufferBinding.offset = std::min(bufferBinding.offset, static_cast<DeviceSize>(accessor.byteOffset));
+        } else {
+            // Add a buffer layout and binding for this buffer view
+            binding = static_cast<uint32_t>(vertexOptions.buffers.size());
+            vertexOptions.buffers.push_back({ .binding = binding, .stride = strideForAccessor(m_model, accessor) });
+            layoutIndices.push_back(binding);
+            layoutToAttributeMap.emplace_back();
+            layout.bindings.push_back({ .bufferView = accessor.bufferView, .offset = accessor.byteOffset });
+        }
+
+        // Set up the vertex attribute using the binding
+        layoutToAttributeMap.at(binding).push_back(static_cast<uint32_t>(vertexOptions.attributes.size()));
+        vertexOptions.attributes.push_back({ .location = locationIt->second,
+                                             .binding = binding,
+                                             .format = formatForAccessor(accessor),
+                                             .offset = accessor.byteOffset });
+
+        layout.vertexCount = static_cast<uint32_t>(accessor.count);
+    }
+
+    // Normalize attribute offsets by subtracting off the buffer layout offset. By nature of the
+    // way in which we create the buffer layouts they are already sorted by binding number.
+    for (uint32_t binding = 0; binding < layoutToAttributeMap.size(); ++binding) {
+        for (const auto &attributeIndex : layoutToAttributeMap[binding])
+            vertexOptions.attributes[attributeIndex].offset -= layout.bindings[binding].offset;
+    }
+
+    // Sort the attributes to be in order of their location. This normalizes the data so that we can
+    // compare them to remove duplicates.
+    std::sort(vertexOptions.attributes.begin(), vertexOptions.attributes.end(),
+              [](const VertexAttribute &a, const VertexAttribute &b) { return a.location < b.location; });
+
+    layout.layoutId = layoutIdFor(vertexOptions);
+    return layout;
+}
+
+uint32_t VertexLayoutAnalyzer::layoutIdFor(const VertexOptions &vertexOptions)
+{
+    std::vector<uint64_t> key;
+    key.reserve(1 + 3 * vertexOptions.buffers.size() + 4 * vertexOptions.attributes.size());
+    key.push_back(vertexOptions.buffers.size());
+    for (const auto &buffer : vertexOptions.buffers)
+        key.insert(key.end(), { buffer.binding, buffer.stride, static_cast<uint64_t>(buffer.inputRate) });
+    for (const auto &attribute : vertexOptions.attributes)
+        key.insert(key.end(), { attribute.location, attribute.binding, static_cast<uint64_t>(attribute.format), attribute.offset });
+
+    const auto [layoutIt, inserted] = m_layoutIds.try_emplace(std::move(key), static_cast<uint32_t>(m_layouts.size()));
+    if (inserted)
+        m_layouts.push_back(vertexOptions);
+    return layoutIt->second;
+}
+
+} // namespace TinyGltfHelper
@@ -0,0 +1,90 @@
+/*
+  This file is part of KDGpu Examples.
+
+  SPDX-FileCopyrightText: 2023 Klarälvdalens Datakonsult AB, a KDAB Group company <info@kdab.com>
+
+  SPDX-License-Identifier: MIT
+
+  Contact KDAB at <info@kdab.com> for commercial licensing options.
+*/
+
+#pragma once
+
+#include <tinygltf_helper/tinygltf_helper_export.h>
+
+#include <KDGpu/gpu_core.h>
+#include <KDGpu/graphics_pipeline_options.h>
+
+#include <tiny_gltf.h>
+
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace TinyGltfHelper {
+
+// The buffer view a vertex buffer binding reads from and the offset to bind it at
+struct VertexBufferBinding {
+    int bufferView{ -1 };
+    KDGpu::DeviceSize offset{ 0 };
+};
+
+struct PrimitiveVertexLayout {
+    // Index of the vertex options in the analyzer. Primitives with equal vertex options
+    // share the id, whatever buffer views they read from.
+    uint32_t layoutId{ 0 };
+    std::vector<VertexBufferBinding> bindings; // Indexed by binding
+    uint32_t vertexCount{ 0 };
+};
+
+// Works out the vertex buffer layouts and attributes a primitive needs for the attributes
+// consumed by a shader. Attributes of one buffer view whose offsets are less than a stride
+// apart share a binding, their offsets are made relative to the binding offset and they are
+// sorted by location so that equal layouts compare equal.
+//
+// The result only depends on the location, buffer view, stride, offset, format and count of
+// the consumed attributes, so it is memoized on those and primitives reusing accessors or
+// buffer views are only analyzed once. Not thread safe.
+class TINYGLTF_HELPER_EXPORT VertexLayoutAnalyzer
+{
+public:
+    // Maps glTF attribute names (POSITION, NORMAL, ...) to shader locations. Attributes
+    // that are not listed are ignored.
+    VertexLayoutAnalyzer(const tinygltf::Model &model, std::unordered_map<std::string, uint32_t> shaderLocations);
+
+    // Finds the vertex buffer layouts and attributes the primitive needs for the attributes
+    // the shader consumes. Primitives sharing accessors or buffer views are only analyzed
+    // once. The returned reference stays valid for the lifetime of the analyzer.
+    const PrimitiveVertexLayout &analyze(const tinygltf::Primitive &primitive);
+
+    const KDGpu::VertexOptions &vertexOptions(uint32_t layoutId) const { return m_layouts.at(layoutId); }
+    bool hasLocation(uint32_t layoutId, uint32_t location) const;
+
+    size_t layoutCount() const { return m_layouts.size(); }
+    size_t analyzedCount() const { return m_primitiveLayouts.size(); }
+    size_t lookupCount() const { return m_lookupCount; }
+
+private:
+    struct SignatureHash {
+        size_t operator()(const std::vector<uint64_t> &signature) const;
+    };
+
+    PrimitiveVertexLayout analyzeUncached(const tinygltf::Primitive &primitive);
+    uint32_t layoutIdFor(const KDGpu::VertexOptions &vertexOptions);
+
+    const tinygltf::Model &m_model;
+    std::unordered_map<std::string, uint32_t> m_shaderLocations;
+
+    // Keyed by the consumed attributes of a primitive
+    std::unordered_map<std::vector<uint64_t>, PrimitiveVertexLayout, SignatureHash> m_primitiveLayouts;
+    std::vector<uint64_t> m_signature; // Reused to build the keys without allocating
+
+    // Keyed by the flattened vertex options
+    std::unordered_map<std::vector<uint64_t>, uint32_t, SignatureHash> m_layoutIds;
+    std::vector<KDGpu::VertexOptions> m_layouts; // Indexed by layout id
+
+    size_t m_lookupCount{ 0 };
+};
+
+} // namespace TinyGltfHelper
@@ -93,6 +93,9 @@ void GaussianBlurEngineLayer::cleanupScene()
 
     // deinitialize command buffer
     m_commandBuffer = {};
+
+    // release the shared samplers while the device is still alive
+    kdgpu_ext::graphics::GlobalResources::instance().samplerCache().clear();
 }
 
 void GaussianBlurEngineLayer::updateScene()
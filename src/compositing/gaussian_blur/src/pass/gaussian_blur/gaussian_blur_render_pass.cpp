@@ -15,6 +15,8 @@ This file is part of KDGpu Examples.
 #include <KDGpuExample/kdgpuexample.h>
 #include <KDUtils/dir.h>
 
+#include <global_resources.h>
+
 void GaussianBlurRenderPass::initialize(
     Device &device,
     TextureTarget *targetTexture,
@@ -45,7 +47,7 @@ void GaussianBlurRenderPass::initialize(
     }
 
     // Create a sampler to sample from the color texture
-    m_colorOutputSampler = device.createSampler();
+    m_colorOutputSampler = kdgpu_ext::graphics::GlobalResources::instance().sampler();
 
     // Load vertex shader and fragment shader (spir-v only for now)
     m_shader.setBaseDirectory("compositing/gaussian_blur/shader");
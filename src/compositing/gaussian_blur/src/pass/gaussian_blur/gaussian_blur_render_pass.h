@@ -61,7 +61,7 @@ private:
 
     // Internal Render Pass setup
     kdgpu_ext::graphics::shader::ShaderVertexFragment m_shader;
-    Sampler m_colorOutputSampler;
+    Handle<Sampler_t> m_colorOutputSampler; // owned by the sampler cache
     Buffer m_fullScreenQuad;
     PipelineLayout m_pipelineLayout;
     GraphicsPipeline m_graphicsPipeline;
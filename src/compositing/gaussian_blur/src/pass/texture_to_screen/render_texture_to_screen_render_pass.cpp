@@ -15,6 +15,8 @@ This file is part of KDGpu Examples.
 #include <KDGpuExample/kdgpuexample.h>
 #include <KDUtils/dir.h>
 
+#include <global_resources.h>
+
 void RenderTextureToScreenRenderPass::initialize(
     Device &device,
     Format depthFormat,
@@ -43,7 +45,7 @@ void RenderTextureToScreenRenderPass::initialize(
     }
 
     // Create a sampler to sample from the color texture in the final pass
-    m_colorOutputSampler = device.createSampler();
+    m_colorOutputSampler = kdgpu_ext::graphics::GlobalResources::instance().sampler();
 
     // Load vertex shader and fragment shader (spir-v only for now)
     m_shader.setBaseDirectory("compositing/gaussian_blur/shader");
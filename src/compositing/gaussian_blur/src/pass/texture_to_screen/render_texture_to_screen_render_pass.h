@@ -35,7 +35,7 @@ private:
     kdgpu_ext::graphics::shader::ShaderVertexFragment m_shader;
 
     // Internal Render Pass setup
-    Sampler m_colorOutputSampler;
+    Handle<Sampler_t> m_colorOutputSampler; // owned by the sampler cache
     Buffer m_fullScreenQuad;
     PipelineLayout m_pipelineLayout;
     GraphicsPipeline m_graphicsPipeline;
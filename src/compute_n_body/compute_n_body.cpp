@@ -21,8 +21,12 @@
 #include <KDGpu/texture_options.h>
 #include <KDGpu/vulkan/vulkan_enums.h>
 
+#include <KDGui/gui_events.h>
+
 #include <KDUtils/file.h>
 
+#include <shader/embedded_shaders.h>
+
 #include <glm/gtx/transform.hpp>
 
 #include <ktx.h>
@@ -200,11 +204,9 @@ void ComputeNBody::initializeParticles()
 void ComputeNBody::initializeGraphicsPipeline()
 {
     // Create a vertex shader and fragment shader (spir-v only for now)
-    const auto vertexShaderPath = ExampleUtility::assetPath() + "/shaders/compute_n_body/particle.vert.spv";
-    auto vertexShader = m_device.createShaderModule(KDGpuExample::readShaderFile(vertexShaderPath));
+    auto vertexShader = m_device.createShaderModule(kdgpu_ext::graphics::shader::loadShader("shaders/compute_n_body/particle.vert.spv"));
 
-    const auto fragmentShaderPath = ExampleUtility::assetPath() + "/shaders/compute_n_body/particle.frag.spv";
-    auto fragmentShader = m_device.createShaderModule(KDGpuExample::readShaderFile(fragmentShaderPath));
+    auto fragmentShader = m_device.createShaderModule(kdgpu_ext::graphics::shader::loadShader("shaders/compute_n_body/particle.frag.spv"));
 
     // Create bind group layout consisting of a single binding holding a UBO
     // clang-format off
@@ -335,8 +337,7 @@ void ComputeNBody::initializeComputePipelines()
     m_computeBindGroup = m_device.createBindGroup(bindGroupOptions);
 
     {
-        const auto calculateShaderPath = ExampleUtility::assetPath() + "/shaders/compute_n_body/particle_calculate.comp.spv";
-        auto calculateShader = m_device.createShaderModule(KDGpuExample::readShaderFile(calculateShaderPath));
+        auto calculateShader = m_device.createShaderModule(kdgpu_ext::graphics::shader::loadShader("shaders/compute_n_body/particle_calculate.comp.spv"));
         const ComputePipelineOptions pipelineOptions{
             .layout = m_computePipelineLayout,
             .shaderStage = { .shaderModule = calculateShader }
@@ -345,8 +346,7 @@ void ComputeNBody::initializeComputePipelines()
     }
 
     {
-        const auto integrateShaderPath = ExampleUtility::assetPath() + "/shaders/compute_n_body/particle_integrate.comp.spv";
-        auto integrateShader = m_device.createShaderModule(KDGpuExample::readShaderFile(integrateShaderPath));
+        auto integrateShader = m_device.createShaderModule(kdgpu_ext::graphics::shader::loadShader("shaders/compute_n_body/particle_integrate.comp.spv"));
         const ComputePipelineOptions pipelineOptions{
             .layout = m_computePipelineLayout,
             .shaderStage = { .shaderModule = integrateShader }
@@ -452,6 +452,7 @@ void ComputeNBody::cleanupScene()
     m_msaaTexture = {};
     m_graphicsPipeline = {};
     m_graphicsPipelineLayout = {};
+    m_commandBuffers.clear();
     m_commandBuffer = {};
     m_graphicsBindGroup = {};
 
@@ -483,9 +484,15 @@ void ComputeNBody::resize()
     m_passOptions.depthStencilAttachment.view = m_depthTextureView;
 
     m_graphicsUboData.screenDim = glm::vec2(m_window->width(), m_window->height());
+
+    // The cached command buffers reference the old attachments
+    if (!m_commandBuffers.empty()) {
+        m_device.waitUntilIdle();
+        m_commandBuffers.clear();
+    }
 }
 
-void ComputeNBody::render()
+CommandBuffer ComputeNBody::recordCommandBuffer(uint32_t swapchainImageIndex)
 {
     auto commandRecorder = m_device.createCommandRecorder();
 
@@ -507,8 +514,8 @@ void ComputeNBody::render()
     // Ensure the compute integration shader is finished before the vertex shader reads from it.
     commandRecorder.bufferMemoryBarrier(m_computeGraphicsBufferBarrierOptions);
 
-    // Update the resolveView to use the current swapchain image
-    m_passOptions.colorAttachments[0].resolveView = m_swapchainViews.at(m_currentSwapchainImageIndex);
+    // Update the resolveView to use the given swapchain image
+    m_passOptions.colorAttachments[0].resolveView = m_swapchainViews.at(swapchainImageIndex);
 
     // Record the graphics commands
     auto renderPass = commandRecorder.beginRenderPass(m_passOptions);
@@ -518,10 +525,42 @@ void ComputeNBody::render()
     renderPass.draw(DrawCommand{ .vertexCount = static_cast<uint32_t>(m_computeUboData.particleCount) });
     renderPass.end();
 
-    m_commandBuffer = commandRecorder.finish();
+    return commandRecorder.finish();
+}
+
+void ComputeNBody::event(KDFoundation::EventReceiver *target, KDFoundation::Event *ev)
+{
+    if (ev->type() == KDFoundation::Event::Type::KeyPress) {
+        auto keyPressEvent = static_cast<KDGui::KeyPressEvent *>(ev);
+        if (keyPressEvent->key() == KDGui::Key_C) {
+            m_useCachedCommandBuffers = !m_useCachedCommandBuffers;
+            SPDLOG_INFO("Cached command buffers {}", m_useCachedCommandBuffers ? "enabled" : "disabled");
+            keyPressEvent->setAccepted(true);
+        }
+    }
+
+    SimpleExampleEngineLayer::event(target, ev);
+}
+
+void ComputeNBody::render()
+{
+    Handle<CommandBuffer_t> commandBuffer;
+    if (m_useCachedCommandBuffers) {
+        if (m_commandBuffers.size() != m_swapchainViews.size())
+            m_commandBuffers.resize(m_swapchainViews.size());
+
+        // Record on first use of this swapchain image, replay afterwards
+        CommandBuffer &cachedCommandBuffer = m_commandBuffers.at(m_currentSwapchainImageIndex);
+        if (!cachedCommandBuffer.isValid())
+            cachedCommandBuffer = recordCommandBuffer(m_currentSwapchainImageIndex);
+        commandBuffer = cachedCommandBuffer;
+    } else {
+        m_commandBuffer = recordCommandBuffer(m_currentSwapchainImageIndex);
+        commandBuffer = m_commandBuffer;
+    }
 
     SubmitOptions submitOptions = {
-        .commandBuffers = { m_commandBuffer },
+        .commandBuffers = { commandBuffer },
         .waitSemaphores = { m_presentCompleteSemaphores[m_inFlightIndex] },
         .signalSemaphores = { m_renderCompleteSemaphores[m_inFlightIndex] }
     };
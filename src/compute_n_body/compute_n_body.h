@@ -55,12 +55,14 @@ protected:
     void updateScene() override;
     void render() override;
     void resize() override;
+    void event(KDFoundation::EventReceiver *target, KDFoundation::Event *ev) override;
 
 private:
     void initializeParticles();
     void initializeGraphicsPipeline();
     void initializeComputePipelines();
     void createRenderTarget();
+    CommandBuffer recordCommandBuffer(uint32_t swapchainImageIndex);
     Texture createTextureFromKtxFile(const std::string &filename);
 
     kdgpu_ext::graphics::camera::Camera m_camera;
@@ -87,7 +89,14 @@ private:
     PipelineLayout m_graphicsPipelineLayout;
     GraphicsPipeline m_graphicsPipeline;
     RenderPassCommandRecorderOptions m_passOptions;
-    CommandBuffer m_commandBuffer;
+
+    // The recorded commands only depend on the swapchain image (resolve target) since the
+    // per-frame data is read from the mapped UBOs. So we record one command buffer per
+    // swapchain image once and resubmit it, dropping them when the swapchain is resized.
+    // Pressing C switches to recording every frame and back, to compare both.
+    bool m_useCachedCommandBuffers{ true };
+    std::vector<CommandBuffer> m_commandBuffers; // Indexed by swapchain image
+    CommandBuffer m_commandBuffer; // Recorded this frame when not using the cache
     BindGroup m_graphicsBindGroup;
 
     PipelineLayout m_computePipelineLayout;
@@ -17,9 +17,9 @@
 #include <KDGpu/graphics_pipeline_options.h>
 #include <KDGpu/vulkan/vulkan_graphics_api.h>
 
-#include <glm/gtx/transform.hpp>
+#include <shader/embedded_shaders.h>
 
-#include <example_utility.h>
+#include <glm/gtx/transform.hpp>
 
 #include <cstring>
 
@@ -80,11 +80,9 @@ void KDGpuRenderer::initializeScene()
         m_transformBuffer.unmap();
     }
 
-    const auto vertexShaderPath = ExampleUtility::assetPath() + "/shaders/dma_buf_interop/simple.vert.spv";
-    auto vertexShader = m_device.createShaderModule(KDGpuExample::readShaderFile(vertexShaderPath));
+    auto vertexShader = m_device.createShaderModule(kdgpu_ext::graphics::shader::loadShader("shaders/dma_buf_interop/simple.vert.spv"));
 
-    const auto fragmentShaderPath = ExampleUtility::assetPath() + "/shaders/dma_buf_interop/simple.frag.spv";
-    auto fragmentShader = m_device.createShaderModule(KDGpuExample::readShaderFile(fragmentShaderPath));
+    auto fragmentShader = m_device.createShaderModule(kdgpu_ext::graphics::shader::loadShader("shaders/dma_buf_interop/simple.frag.spv"));
 
     const BindGroupLayoutOptions bindGroupLayoutOptions = {
         .bindings = { { .binding = 0,
@@ -24,6 +24,8 @@
 #include <KDGpu/texture_options.h>
 #include <KDGpu/sampler_options.h>
 
+#include <shader/embedded_shaders.h>
+
 #include <fstream>
 #include <string>
 
@@ -58,6 +60,16 @@ auto readShaderFile =
     return buffer;
 };
 
+// Prefers the shaders embedded into the examples (see cmake/EmbedShaders.cmake) over the
+// copies next to the executable
+auto loadShader =
+        [](const std::string &filename) -> std::vector<uint32_t> {
+    const auto spirv = kdgpu_ext::graphics::shader::embeddedShader("shaders/ffmpeg_video/" + filename);
+    if (!spirv.empty())
+        return { spirv.begin(), spirv.end() };
+    return readShaderFile("shaders/" + filename);
+};
+
 struct Vertex {
     std::array<float, 3> position;
     std::array<float, 2> texCoords;
@@ -372,13 +384,11 @@ void VideoRenderer::setVideoInformation(std::pair<size_t, size_t> videoResolutio
     m_textureWasInitialized = false;
 
     // Create a vertex shader and fragment shader (spir-v only for now)
-    const auto vertexShaderPath = "shaders/textured_quad.vert.spv";
     auto vertexShader =
-            m_device.createShaderModule(readShaderFile(vertexShaderPath));
+            m_device.createShaderModule(loadShader("textured_quad.vert.spv"));
 
-    const auto fragmentShaderPath = "shaders/textured_quad.frag.spv";
     auto fragmentShader =
-            m_device.createShaderModule(readShaderFile(fragmentShaderPath));
+            m_device.createShaderModule(loadShader("textured_quad.frag.spv"));
 
     // Create bind group layout consisting of a single binding holding a TextureView and Sampler
     // The Sampler since it uses a YUV Conversion needs to be set as an immutable sampler
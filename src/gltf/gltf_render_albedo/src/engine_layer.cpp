@@ -40,11 +40,11 @@ void GltfRenderAlbedoEngineLayer::initializeScene()
     auto assetDir = KDGpuExample::assetDir();
 
     // load texture
-    m_textureSet.loadAddTexture(*this, assetDir.file(baseDir + "red_green_blobs_on_white.png").path());
-    m_textureSet.loadAddTexture(*this, assetDir.file(baseDir + "small_red_blobs_on_black.png").path());
+    m_textureSet.loadAddTexture(assetDir.file(baseDir + "red_green_blobs_on_white.png").path());
+    m_textureSet.loadAddTexture(assetDir.file(baseDir + "small_red_blobs_on_black.png").path());
     m_textureSet.initializeCreateBindGroups();
 
-    m_otherChannelTextureSet.loadAddTexture(*this, assetDir.file(baseDir + "small_red_blobs_on_black.png").path());
+    m_otherChannelTextureSet.loadAddTexture(assetDir.file(baseDir + "small_red_blobs_on_black.png").path());
     m_otherChannelTextureSet.initializeCreateBindGroups();
 
     // load gltf object(s)
@@ -108,6 +108,9 @@ void GltfRenderAlbedoEngineLayer::cleanupScene()
 
     // clean up global gltf variable
     kdgpu_ext::gltf_holder::GltfHolderGlobal::instance().deinitialize();
+
+    // release the shared samplers while the device is still alive
+    kdgpu_ext::graphics::GlobalResources::instance().samplerCache().clear();
 }
 
 void GltfRenderAlbedoEngineLayer::updateScene()
@@ -38,7 +38,7 @@ private:
   TextureTarget *m_sourceOtherChannelColorTexture = nullptr;
 
   // Internal Render Pass setup
-  Sampler m_colorOutputSampler;
+  Handle<Sampler_t> m_colorOutputSampler; // owned by the sampler cache
   Buffer m_fullScreenQuad;
   PipelineLayout m_pipelineLayout;
   GraphicsPipeline m_graphicsPipeline;
@@ -18,6 +18,8 @@
 
 #include <GltfHolder/gltf_holder_global.h>
 
+#include <array>
+
 GltfRenderPbrEngineLayer::GltfRenderPbrEngineLayer()
     : SimpleExampleEngineLayer()
 {
@@ -27,6 +29,8 @@ void GltfRenderPbrEngineLayer::initializeScene()
 {
     // set up global resources (device)
     kdgpu_ext::graphics::GlobalResources::instance().setGraphicsDevice(m_device);
+    // anisotropic filtering for the trilinear material samplers, if the device supports it
+    kdgpu_ext::graphics::GlobalResources::instance().samplerCache().setMaxAnisotropy(16.0f);
 
     // initialize global gltf variables
     kdgpu_ext::gltf_holder::GltfHolderGlobal::instance().initialize();
@@ -44,59 +48,70 @@ void GltfRenderPbrEngineLayer::initializeScene()
     // imgui
     registerImGuiOverlayDrawFunction([this](ImGuiContext *ctx){drawControls(ctx);});
 
-    // load textures
+    // load textures, the files of all sets are decoded on worker threads while the model loads
     // pbr environment
     {
-        m_pbrLutAndEnvironmentTextures.loadAddTexture(*this, assetDir.file(baseDir + "environment/diffuse.ktx2"));
-        m_pbrLutAndEnvironmentTextures.loadAddTexture(*this, assetDir.file(baseDir + "environment/specular.ktx2"));
-        m_pbrLutAndEnvironmentTextures.loadAddTexture(*this,  assetDir.file(baseDir + "pbr/lut_ggx.ktx2"));
-        m_pbrLutAndEnvironmentTextures.initializeCreateBindGroups();
+        m_pbrLutAndEnvironmentTextures.loadAddTextureAsync(assetDir.file(baseDir + "environment/diffuse.ktx2"), KDGpu::ViewType::ViewTypeCube);
+        m_pbrLutAndEnvironmentTextures.loadAddTextureAsync(assetDir.file(baseDir + "environment/specular.ktx2"), KDGpu::ViewType::ViewTypeCube);
+        m_pbrLutAndEnvironmentTextures.loadAddTextureAsync(assetDir.file(baseDir + "pbr/lut_ggx.ktx2"));
     }
 
     // blue dots extra pass texture
     {
-        m_otherChannelTextureSet.loadAddTexture(*this, assetDir.file(baseDir + "small_red_blobs_on_black.png"));
-        m_otherChannelTextureSet.initializeCreateBindGroups();
+        m_otherChannelTextureSet.loadAddTextureAsync(assetDir.file(baseDir + "small_red_blobs_on_black.png"));
     }
 
     // textures for basic geometry
     {
-        m_basicGeometryTextureSet.loadAddTexture(*this, assetDir.file(baseDir + "area_light_textured_light/stained_glass.png"));
-        m_basicGeometryTextureSet.initializeCreateBindGroups();
+        m_basicGeometryTextureSet.loadAddTextureAsync(assetDir.file(baseDir + "area_light_textured_light/stained_glass.png"));
     }
 
     // area light channels
     {
-        m_areaLightChannels.loadBinaryTexture(
-            *this,
+        m_areaLightChannels.loadBinaryTextureAsync(
             assetDir.file(baseDir + "area_light/ltc_amp_rg32f_32x32.bin"),
             32,
             32,
             2,
             sizeof(float),
             KDGpu::Format::R32G32_SFLOAT);
-        m_areaLightChannels.loadBinaryTexture(
-            *this,
+        m_areaLightChannels.loadBinaryTextureAsync(
             assetDir.file(baseDir + "area_light/ltc_mat_rgba32f_32x32.bin"),
             32,
             32,
             4,
             sizeof(float),
             KDGpu::Format::R32G32B32A32_SFLOAT);
-        m_areaLightChannels.loadAddTexture(
-                *this,
+        m_areaLightChannels.loadAddTextureAsync(
                 assetDir.file(baseDir + "area_light_textured_light/stained_glass_filtered.png"));
-        m_areaLightChannels.initializeCreateBindGroups();
     }
 
     // load gltf object(s)
     {
+        // images baked with gltf_texture_baker are transcoded to a block compressed format,
+        // the others are uploaded as RGBA8
+        m_flightHelmet.setTextureCompression({ .target = kdgpu_ext::graphics::texture::selectBlockCompression(m_device) });
+        // only the mip tails are uploaded at load, finer levels follow the camera
+        m_flightHelmet.setTextureStreaming({ .enabled = true, .budgetBytes = size_t(64) << 20 });
+        // the small images share texture arrays, which the PBR shaders sample with the
+        // placements pushed per material
+        m_flightHelmet.setTexturePacking({ .enabled = true });
+        // nothing is read from the model's buffers or images once they are on the GPU
+        m_flightHelmet.setTrimAfterUpload(true);
         m_flightHelmet.load(assetDir.file(baseDir + "FlightHelmet.gltf").path(), m_queue);
 
         // set the per-node uniform buffer object binding to 0
         m_flightHelmet.setNodeTransformShaderBinding(0);
     }
 
+    // wait for the texture files and upload them, all sets in one go
+    {
+        using kdgpu_ext::graphics::texture::TextureUniformSet;
+        const std::array<TextureUniformSet *, 4> textureSets = { &m_pbrLutAndEnvironmentTextures, &m_otherChannelTextureSet,
+                                                                 &m_basicGeometryTextureSet, &m_areaLightChannels };
+        TextureUniformSet::initializeCreateBindGroups(textureSets);
+    }
+
 
 
     // set camera aspect ratio
@@ -111,6 +126,13 @@ void GltfRenderPbrEngineLayer::initializeScene()
         m_pbrPass.initialize(m_depthFormat, m_swapchainExtent, m_camera);
     }
 
+    // initialize the optional depth pre-pass, it renders into the depth texture of the pbr pass
+    {
+        m_depthPrePass.initializeShader();
+        m_depthPrePass.addGltfHolder(m_flightHelmet);
+        m_depthPrePass.initialize(m_pbrPass.resultDepthTextureTarget(), m_camera);
+    }
+
     // initialize "other channel" pass
     {
         m_otherChannelPass.m_textureSet = &m_otherChannelTextureSet;
@@ -158,6 +180,7 @@ void GltfRenderPbrEngineLayer::cleanupScene()
     m_basicGeometryTextureSet.deinitialize();
 
     // deinitialize render passes
+    m_depthPrePass.deinitialize();
     m_pbrPass.deinitialize();
     m_otherChannelPass.deinitialize();
     m_compositingPass.deinitialize();
@@ -171,6 +194,9 @@ void GltfRenderPbrEngineLayer::cleanupScene()
 
     // clean up global gltf variable
     kdgpu_ext::gltf_holder::GltfHolderGlobal::instance().deinitialize();
+
+    // release the shared samplers while the device is still alive
+    kdgpu_ext::graphics::GlobalResources::instance().samplerCache().clear();
 }
 
 void GltfRenderPbrEngineLayer::updateScene()
@@ -180,9 +206,22 @@ void GltfRenderPbrEngineLayer::updateScene()
     m_camera.update();
 
     m_flightHelmet.update();
+    m_flightHelmet.setLodView(m_camera.viewMatrix(), m_camera.projectionMatrix(), float(m_swapchainExtent.height));
 
     m_pbrPass.updateConfiguration();
 
+    // switch the pbr pass between its regular and EQUAL depth test pipelines
+    if (m_depthPrePass.enabled() != m_pbrPass.depthPrePassEnabled()) {
+        m_device.waitUntilIdle();
+        m_pbrPass.setDepthPrePassEnabled(m_depthPrePass.enabled());
+    }
+
+    // and between shading and the overdraw heat map
+    if (m_pbrPass.overdrawHeatMapRequested() != m_pbrPass.overdrawHeatMapEnabled()) {
+        m_device.waitUntilIdle();
+        m_pbrPass.setOverdrawHeatMapEnabled(m_pbrPass.overdrawHeatMapRequested());
+    }
+
     // area light pass
     {
         m_areaLightPass.setQuadVertices(m_basicGeometryPass.quadVertices());
@@ -195,6 +234,11 @@ void GltfRenderPbrEngineLayer::updateScene()
 
 void GltfRenderPbrEngineLayer::render_passes(CommandRecorder &commandRecorder)
 {
+    // (optional) Render GLTF depth only
+    if (m_pbrPass.depthPrePassEnabled()) {
+        m_depthPrePass.render(commandRecorder, m_camera);
+    }
+
     // Render GLTF Geometry using PBR shader to Texture
     {
         m_pbrPass.render(commandRecorder, m_camera);
@@ -257,10 +301,33 @@ void GltfRenderPbrEngineLayer::drawControls(ImGuiContext *ctx)
 
     // let each pass specify its controls
     {
+        m_depthPrePass.renderImgui();
         m_pbrPass.renderImgui();
         m_otherChannelPass.renderImgui();
         m_areaLightPass.renderImgui();
     }
+
+    // level of detail selection of the glTF model, shared by all passes
+    {
+        auto &lodSelection = m_flightHelmet.lodSelection();
+        ImGui::Checkbox("Mesh LODs", &lodSelection.enabled);
+        ImGui::SliderFloat("Max LOD error (pixels)", &lodSelection.maxPixelError, 0.25f, 8.0f);
+    }
+
+    // texture streaming of the glTF model
+    {
+        auto &textureStreamer = m_flightHelmet.textureStreamer();
+        int budgetMiB = static_cast<int>(textureStreamer.options().budgetBytes >> 20);
+        if (ImGui::SliderInt("Texture budget (MiB)", &budgetMiB, 1, 512))
+            textureStreamer.setBudget(size_t(budgetMiB) << 20);
+
+        const auto &streamingStats = textureStreamer.stats();
+        ImGui::Text("Textures: %.1f MiB resident, %.1f MiB wanted",
+                    double(streamingStats.residentBytes) / (1 << 20),
+                    double(streamingStats.wantedBytes) / (1 << 20));
+        ImGui::Text("%u uploads in flight, %u streamed in, %u evicted",
+                    streamingStats.uploadsInFlight, streamingStats.streamedInCount, streamingStats.evictedCount);
+    }
     ImGui::End();
 }
 void GltfRenderPbrEngineLayer::render()
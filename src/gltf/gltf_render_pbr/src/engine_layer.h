@@ -12,6 +12,7 @@
 #include <KDGpuExample/simple_example_engine_layer.h>
 
 // passes
+#include <pass/gltf_depth_pre_pass/gltf_depth_pre_pass.h>
 #include <pass/gltf_pbr/gltf_pbr_pass.h>
 #include <pass/gltf_other_channel/gltf_other_channel_pass.h>
 #include <pass/basic_geometry/basic_geometry_pass.h>
@@ -54,6 +55,7 @@ private:
     kdgpu_ext::graphics::texture::TextureUniformSet m_areaLightChannels;
 
     // render passes (in order of rendering)
+    pass::gltf_depth_pre_pass::GltfDepthPrePass m_depthPrePass; // optional
     pass::gltf_pbr::gltfPbrPass m_pbrPass;
     pass::gltf_other_channel::GltfOtherChannelPass m_otherChannelPass;
     pass::basic_geometry::BasicGeometryPass m_basicGeometryPass;
@@ -46,7 +46,7 @@ void BasicGeometryPass::initialize(TextureTarget &depthTexture, const Extent2D s
     }
 
     // Create a sampler to sample from the color texture in the input pass
-    m_colorOutputSampler = device.createSampler();
+    m_colorOutputSampler = kdgpu_ext::graphics::GlobalResources::instance().sampler();
 
     m_colorTextureTarget.initialize(swapchainExtent, Format::R8G8B8A8_UNORM, TextureUsageFlagBits::ColorAttachmentBit);
     m_depthTextureTarget = &depthTexture;
@@ -40,7 +40,7 @@ private:
     // mesh
     kdgpu_ext::graphics::vertex_buffer_object::VertexBufferObject<glm::vec3, glm::vec2> m_quad;
 
-    Sampler m_colorOutputSampler;
+    Handle<Sampler_t> m_colorOutputSampler; // owned by the sampler cache
 
     // results - textures
     TextureTarget m_colorTextureTarget;
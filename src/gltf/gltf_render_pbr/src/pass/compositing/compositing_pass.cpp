@@ -44,7 +44,7 @@ void CompositingPass::initialize(Format swapchainFormat)
     }
 
     // Create a sampler to sample from the color texture in the input pass
-    m_colorOutputSampler = device.createSampler();
+    m_colorOutputSampler = kdgpu_ext::graphics::GlobalResources::instance().sampler();
 
     // load shader
     m_shader.setBaseDirectory("gltf/gltf_render_pbr/shader");
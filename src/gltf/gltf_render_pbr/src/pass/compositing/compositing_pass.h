@@ -48,7 +48,7 @@ private:
     TextureTarget *m_areaLightTexture = nullptr;
 
     // Internal Render Pass setup
-    Sampler m_colorOutputSampler;
+    Handle<Sampler_t> m_colorOutputSampler; // owned by the sampler cache
     PipelineLayout m_pipelineLayout;
     GraphicsPipeline m_graphicsPipeline;
     BindGroup m_bindGroup;
@@ -21,10 +21,31 @@ layout(set = 4, binding = 0) uniform Configuration {
     uniform vec4 albedo_color_multiplier;
 } configuration;
 
-// PBR channels
-layout(set = 2, binding = 0) uniform sampler2D base_color_map;
-layout(set = 2, binding = 1) uniform sampler2D metallic_roughness_map;
-layout(set = 2, binding = 2) uniform sampler2D normal_map;
+// PBR channels, small images are packed into layers of arrays
+layout(set = 2, binding = 0) uniform sampler2DArray base_color_map;
+layout(set = 2, binding = 1) uniform sampler2DArray metallic_roughness_map;
+layout(set = 2, binding = 2) uniform sampler2DArray normal_map;
+
+// where the image of each channel is in its texture, as GltfShaderTexturePlacements
+const int CHANNEL_BASE_COLOR = 0;
+const int CHANNEL_METALLIC_ROUGHNESS = 1;
+const int CHANNEL_NORMAL = 2;
+layout(push_constant) uniform TexturePlacements {
+    vec4 uv_rect[5]; // xy offset, zw scale of the image in its layer
+    float layer[5];
+} placements;
+
+vec4 sampleChannel(sampler2DArray map, int channel, vec2 uv)
+{
+    vec4 rect = placements.uv_rect[channel];
+    float layer = placements.layer[channel];
+    if (rect.zw == vec2(1.0))
+        return texture(map, vec3(uv, layer));
+    // images smaller than their layer repeat inside their rectangle, the gradients of
+    // the unwrapped coordinates pick the level
+    vec2 scaled_uv = uv * rect.zw;
+    return textureGrad(map, vec3(rect.xy + fract(uv) * rect.zw, layer), dFdx(scaled_uv), dFdy(scaled_uv));
+}
 
 // Linear Cosine Transform LUTs and Textured light
 layout(set = 3, binding = 0) uniform sampler2D ltc_amplification; // ltc_amp
@@ -357,20 +378,20 @@ void main()
     mat3 tangent_space_matrix = mat3_from_columns(in_world_tangent.xyz, normal_tangent_cross, in_world_normal);
 
 
-    vec3 normal = normalize(texture(normal_map, in_tex_coord).rgb * float(2.0) - vec3(1.0,1.0,1.0));
+    vec3 normal = normalize(sampleChannel(normal_map, CHANNEL_NORMAL, in_tex_coord).rgb * float(2.0) - vec3(1.0,1.0,1.0));
     vec3 corrected_normal = normalize(normal * calcWorldSpaceToTangentSpaceMatrix(in_world_normal, in_world_tangent));
 
     // another way of getting the normal
     //vec3 fetched_normal = FetchNormal(normal_map, in_tex_coord, tangent_space_matrix);
     //vec3 corrected_normal = CorrectNormal(fetched_normal, posToEye);
 
-    vec3 metallic_roughness = texture(metallic_roughness_map, in_tex_coord).rgb;
+    vec3 metallic_roughness = sampleChannel(metallic_roughness_map, CHANNEL_METALLIC_ROUGHNESS, in_tex_coord).rgb;
 
     float metallic = metallic_roughness.r;
     float roughness = metallic_roughness.g;
 
     // material colors
-    vec3 base_color = texture(base_color_map, in_tex_coord).rgb;
+    vec3 base_color = sampleChannel(base_color_map, CHANNEL_BASE_COLOR, in_tex_coord).rgb;
     vec3 diffuse_color = base_color * (1.0 - metallic);
     vec3 specular_color = mix (vec3(specular_color_monochromatic, specular_color_monochromatic, specular_color_monochromatic), base_color, metallic);
 
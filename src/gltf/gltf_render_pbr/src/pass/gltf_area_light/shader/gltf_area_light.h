@@ -75,6 +75,8 @@ inline kdgpu_ext::gltf_holder::shader_specification::GltfShaderTextureChannels c
         .baseColorFragmentShaderBinding = fragmentUniformGltfBaseColorMapBinding,
         .normalMapFragmentShaderBinding =  fragmentUniformGltfNormalMapBinding,
         .metallicRoughnessFragmentShaderBinding = fragmentUniformGltfMetallicRoughnessMapBinding,
+        // the channels are sampled as sampler2DArray, with the placements of packed images
+        .texturePlacementPushConstantRange = texturePlacementPushConstantRange()
     };
 }
 
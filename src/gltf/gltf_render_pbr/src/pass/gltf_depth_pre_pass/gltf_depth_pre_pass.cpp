@@ -0,0 +1,96 @@
+/*
+  This file is part of KDGpu Examples.
+  SPDX-FileCopyrightText: 2025 Klarälvdalens Datakonsult AB, a KDAB Group company <info@kdab.com>
+
+  SPDX-License-Identifier: MIT
+
+  Contact KDAB at <info@kdab.com> for commercial licensing options.
+*/
+
+#include "gltf_depth_pre_pass.h"
+
+#include "shader/gltf_depth_pre_pass.h"
+
+#include <imgui.h>
+
+namespace pass::gltf_depth_pre_pass {
+void GltfDepthPrePass::addGltfHolder(kdgpu_ext::gltf_holder::GltfHolder &holder)
+{
+    m_gltfRenderPermutations.add_permutation(
+            holder,
+            m_shaderTextureChannels,
+            shader::gltf_depth_pre_pass::vertexUniformGltfNodeTransformSet);
+}
+
+void GltfDepthPrePass::initializeShader()
+{
+    // init the shader material
+    m_shaderTextureChannels = shader::gltf_depth_pre_pass::createShaderMaterial();
+    m_shaderTextureChannels.initializeBindGroupLayout();
+
+    m_shader.setBaseDirectory("gltf/gltf_render_pbr/shader");
+    m_shader.loadVertexShader("gltf_depth_pre_pass.vert.glsl.spv");
+}
+
+void GltfDepthPrePass::initialize(TextureTarget &depthTexture, const kdgpu_ext::graphics::camera::Camera &camera)
+{
+    m_depthTextureTarget = &depthTexture;
+
+    // setup render target, no color target means no color attachment in the pipelines
+    m_depthRenderTarget.setDepthTarget(m_depthTextureTarget);
+    {
+        m_depthRenderTarget.depthTestEnabled = true;
+        m_depthRenderTarget.depthWriteEnabled = true;
+        m_depthRenderTarget.depthCompareOperation = CompareOperation::Less;
+    }
+
+    // connect each custom/per-pass uniform buffer set with its layout
+    m_shaderTextureChannels.setBindGroupLayoutForBindGroup(
+        shader::gltf_depth_pre_pass::vertexUniformPassCameraSet,
+        &camera.bindGroupLayout());
+
+    // initialize pipeline layout for internal gltf and pass-specific uniform buffers
+    m_gltfRenderPermutations.initialize_pipeline_layout(m_shaderTextureChannels, {});
+    m_gltfRenderPermutations.create_pipelines(m_depthRenderTarget, m_shader.shaderStages(), shader::gltf_depth_pre_pass::createShaderVertexInput());
+}
+
+void GltfDepthPrePass::deinitialize()
+{
+    m_gltfRenderPermutations.deinitialize();
+    m_shaderTextureChannels.deinitialize();
+    m_shader.deinitialize();
+    m_depthTextureTarget = nullptr;
+}
+
+void GltfDepthPrePass::render(CommandRecorder &commandRecorder, const kdgpu_ext::graphics::camera::Camera &camera)
+{
+    // clang-format off
+    auto render_pass = commandRecorder.beginRenderPass(
+        {
+        .depthStencilAttachment =
+            {
+            .view = m_depthTextureTarget->textureView() // cleared here, loaded by the pbr pass
+            }
+        }
+    );
+    // clang-format on
+
+    // set global bind groups (descriptor set)
+    render_pass.setBindGroup(shader::gltf_depth_pre_pass::vertexUniformPassCameraSet, camera.bindGroup(), m_gltfRenderPermutations.pipelineLayout);
+
+    // render
+    m_gltfRenderPermutations.render(render_pass);
+
+    // finish render pass
+    render_pass.end();
+}
+
+void GltfDepthPrePass::renderImgui()
+{
+    ImGui::Text("gltf_depth_pre_pass:");
+    ImGui::Text("Renders the depth first so the PBR shading runs at most once per pixel (EQUAL depth test).");
+    ImGui::Checkbox("Enable depth pre-pass", &m_enabled);
+    ImGui::Text("Compare with the overdraw heat map of the gltf_pbr pass.");
+}
+
+} // namespace pass::gltf_depth_pre_pass
@@ -0,0 +1,60 @@
+/*
+  This file is part of KDGpu Examples.
+  SPDX-FileCopyrightText: 2025 Klarälvdalens Datakonsult AB, a KDAB Group company <info@kdab.com>
+
+  SPDX-License-Identifier: MIT
+
+  Contact KDAB at <info@kdab.com> for commercial licensing options.
+*/
+
+#pragma once
+
+#include <camera/camera.h>
+
+#include <texture_target/texture_target.h>
+#include <GltfHolder/render_permutation/gltf_render_permutations.h>
+
+#include <GltfHolder/material/rendering/gltf_materials_for_a_pass.h>
+
+#include <shader/shader_vertex_only.h>
+
+namespace pass::gltf_depth_pre_pass {
+/**
+ * Renders only the depth of the gltf geometry using position-only pipelines.
+ * The pbr pass then tests for EQUAL depth so its fragment shader runs at most once per pixel.
+ */
+class GltfDepthPrePass
+{
+public:
+    void addGltfHolder(kdgpu_ext::gltf_holder::GltfHolder &holder);
+    void initializeShader();
+
+    void initialize(TextureTarget &depthTexture, const kdgpu_ext::graphics::camera::Camera &camera);
+    void deinitialize();
+
+    void render(CommandRecorder &commandRecorder, const kdgpu_ext::graphics::camera::Camera &camera);
+
+    void renderImgui();
+
+    bool enabled() const { return m_enabled; }
+
+private:
+    bool m_enabled = false;
+
+    // shader
+    kdgpu_ext::graphics::shader::ShaderVertexOnly m_shader;
+
+    // material (no texture channels)
+    kdgpu_ext::gltf_holder::shader_specification::GltfShaderTextureChannels m_shaderTextureChannels;
+
+    // object render permutations
+    kdgpu_ext::gltf_holder::GltfRenderPermutations m_gltfRenderPermutations;
+
+    // depth texture shared with the pbr pass
+    TextureTarget *m_depthTextureTarget = nullptr;
+
+    // result - render target (depth only)
+    RenderTarget m_depthRenderTarget;
+};
+
+}
@@ -0,0 +1,27 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+// must be computed exactly like in gltf_pbr.vert.glsl, the pbr pass tests for EQUAL depth
+invariant gl_Position;
+
+// inputs
+layout(location = 0) in vec3 in_vertex_position;
+
+// uniforms
+layout(set = 0, binding = 0) uniform camera_t
+{
+    mat4 projection;
+    mat4 view;
+}
+camera;
+
+layout(set = 1, binding = 0) uniform node_transform_t
+{
+    mat4 model_matrix;
+}
+node_transform;
+
+void main()
+{
+    gl_Position = camera.projection * camera.view * node_transform.model_matrix * vec4(in_vertex_position, 1.0);
+}
@@ -0,0 +1,47 @@
+/*
+  This file is part of KDGpu Examples.
+  SPDX-FileCopyrightText: 2025 Klarälvdalens Datakonsult AB, a KDAB Group company <info@kdab.com>
+
+  SPDX-License-Identifier: MIT
+
+  Contact KDAB at <info@kdab.com> for commercial licensing options.
+*/
+
+#pragma once
+
+namespace pass::gltf_depth_pre_pass::shader::gltf_depth_pre_pass {
+// VERTEX SHADER
+
+// inputs
+static constexpr uint32_t vertexInGltfVertexPositionLocation = 0;
+
+// camera uniform buffer object
+static constexpr size_t vertexUniformPassCameraSet = 0;
+static constexpr size_t vertexUniformPassCameraBinding = 0;
+
+// node transform uniform buffer object
+static constexpr size_t vertexUniformGltfNodeTransformSet = 1;
+static constexpr size_t vertexUniformGltfNodeTransformBinding = 0;
+
+// no fragment shader, only depth is written
+
+// shader specification for gltf rendering
+inline kdgpu_ext::gltf_holder::shader_specification::GltfShaderVertexInput createShaderVertexInput()
+{
+    return {
+        .positionLocation = vertexInGltfVertexPositionLocation
+    };
+}
+
+inline kdgpu_ext::gltf_holder::shader_specification::GltfShaderTextureChannels createShaderMaterial()
+{
+    using namespace kdgpu_ext::gltf_holder::shader_specification;
+    return {
+        .shaderBindGroupSets = {
+                { vertexUniformPassCameraSet, GltfShaderBindGroupType::PassOwnedUniformBuffer },
+                { vertexUniformGltfNodeTransformSet, GltfShaderBindGroupType::GltfNodeTransform } },
+        .anyTextureChannelsFromGltfEnabled = false,
+    };
+}
+
+} // namespace pass::gltf_depth_pre_pass::shader::gltf_depth_pre_pass
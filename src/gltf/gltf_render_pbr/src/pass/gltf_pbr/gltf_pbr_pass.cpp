@@ -33,6 +33,10 @@ void gltfPbrPass::initializeShader()
     m_shader.setBaseDirectory("gltf/gltf_render_pbr/shader");
     m_shader.loadVertexShader("gltf_pbr.vert.glsl.spv");
     m_shader.loadFragmentShader("gltf_pbr.frag.glsl.spv");
+
+    m_overdrawShader.setBaseDirectory("gltf/gltf_render_pbr/shader");
+    m_overdrawShader.loadVertexShader("gltf_pbr.vert.glsl.spv");
+    m_overdrawShader.loadFragmentShader("gltf_pbr_overdraw.frag.glsl.spv");
 }
 
 void gltfPbrPass::initialize(Format depthFormat, Extent2D swapchainExtent, const kdgpu_ext::graphics::camera::Camera &camera)
@@ -76,6 +80,7 @@ void gltfPbrPass::deinitialize()
     m_gltfRenderPermutations.deinitialize();
     m_shaderTextureChannels.deinitialize();
     m_shader.deinitialize();
+    m_overdrawShader.deinitialize();
     m_materialUniformBufferObject = {};
     m_colorTextureTarget.deinitialize();
     m_depthTextureTarget.deinitialize();
@@ -88,6 +93,37 @@ void gltfPbrPass::updateConfiguration()
     m_materialUniformBufferObject.upload();
 }
 
+void gltfPbrPass::setDepthPrePassEnabled(bool enabled)
+{
+    if (m_depthPrePassEnabled == enabled)
+        return;
+
+    m_depthPrePassEnabled = enabled;
+    m_renderTarget.depthWriteEnabled = !enabled;
+    m_renderTarget.depthCompareOperation = enabled ? CompareOperation::Equal : CompareOperation::Less;
+
+    recreatePipelines();
+}
+
+void gltfPbrPass::setOverdrawHeatMapEnabled(bool enabled)
+{
+    m_overdrawHeatMapRequested = enabled;
+    if (m_overdrawHeatMapEnabled == enabled)
+        return;
+
+    m_overdrawHeatMapEnabled = enabled;
+    m_renderTarget.additiveBlending = enabled;
+
+    recreatePipelines();
+}
+
+void gltfPbrPass::recreatePipelines()
+{
+    // the heat map keeps the depth state, so it shows the overdraw with and without the pre-pass
+    const auto shaderStages = m_overdrawHeatMapEnabled ? m_overdrawShader.shaderStages() : m_shader.shaderStages();
+    m_gltfRenderPermutations.recreate_pipelines(m_renderTarget, shaderStages, shader::gltf_pbr::createShaderVertexInput());
+}
+
 void gltfPbrPass::render(CommandRecorder &commandRecorder, const kdgpu_ext::graphics::camera::Camera &camera)
 {
     // clang-format off
@@ -108,7 +144,10 @@ void gltfPbrPass::render(CommandRecorder &commandRecorder, const kdgpu_ext::grap
             },
         .depthStencilAttachment =
             {
-            .view = m_depthTextureTarget.textureView()
+            .view = m_depthTextureTarget.textureView(),
+            // keep the depth written by the depth pre-pass
+            .depthLoadOperation = m_depthPrePassEnabled ? AttachmentLoadOperation::Load : AttachmentLoadOperation::Clear,
+            .initialLayout = m_depthPrePassEnabled ? TextureLayout::DepthStencilAttachmentOptimal : TextureLayout::Undefined
             }
         }
     );
@@ -147,6 +186,22 @@ void gltfPbrPass::renderImgui()
     ImGui::Text("This pass renders the GLTF with Physically Based Rendering.");
     ImGui::SliderFloat("Image Based Lighting (IBL) Intensity/Contribution", &m_materialUniformBufferObject.data.iblIntensity, 0.0f, 1.0f);
     ImGui::SliderFloat("Directional Light Intensity", &m_materialUniformBufferObject.data.directionalLightIntensity, 0.0f, 10.0f);
+
+    ImGui::Checkbox("Overdraw heat map", &m_overdrawHeatMapRequested);
+    if (m_overdrawHeatMapEnabled)
+        ImGui::Text("Brightness: fragments shaded per pixel, white at 8 or more");
+
+    // state changes of the last frame's glTF draws, recorded and dropped as redundant
+    const auto &stateStats = m_gltfRenderPermutations.lastRenderStateStats;
+    ImGui::Text("Pipelines: %u set, %u filtered", stateStats.setPipelineCount, stateStats.filteredSetPipelineCount);
+    ImGui::Text("Bind groups: %u set, %u filtered", stateStats.setBindGroupCount, stateStats.filteredSetBindGroupCount);
+    ImGui::Text("Vertex buffers: %u set, %u filtered", stateStats.setVertexBufferCount, stateStats.filteredSetVertexBufferCount);
+    ImGui::Text("Index buffers: %u set, %u filtered", stateStats.setIndexBufferCount, stateStats.filteredSetIndexBufferCount);
+
+    // levels of detail picked for the draws of this pass, the other passes pick the same
+    const auto &lodStats = m_gltfRenderPermutations.lastLodStats;
+    for (size_t lod = 0; lod < lodStats.drawCounts.size(); ++lod)
+        ImGui::Text("LOD %zu: %u draws, %u triangles", lod, lodStats.drawCounts[lod], lodStats.triangleCounts[lod]);
 }
 
 } // namespace pass::gltf_pbr
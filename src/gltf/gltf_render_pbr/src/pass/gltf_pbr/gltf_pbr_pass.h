@@ -34,6 +34,18 @@ public:
 
     void updateConfiguration();
 
+    // when a depth pre-pass filled the depth texture, only shade fragments with EQUAL depth
+    // and keep the depth. Recreates the pipelines, the GPU must be idle.
+    void setDepthPrePassEnabled(bool enabled);
+    bool depthPrePassEnabled() const { return m_depthPrePassEnabled; }
+
+    // draws an additive overdraw heat map instead of the shading, the brightness counts the
+    // fragments shaded per pixel. Toggled in the ui, applied with setOverdrawHeatMapEnabled()
+    // which recreates the pipelines, the GPU must be idle.
+    void setOverdrawHeatMapEnabled(bool enabled);
+    bool overdrawHeatMapEnabled() const { return m_overdrawHeatMapEnabled; }
+    bool overdrawHeatMapRequested() const { return m_overdrawHeatMapRequested; }
+
     void render(CommandRecorder& commandRecorder, const kdgpu_ext::graphics::camera::Camera& camera);
 
     void renderImgui();
@@ -46,6 +58,7 @@ public:
 private:
     // shader
     kdgpu_ext::graphics::shader::ShaderVertexFragment m_shader;
+    kdgpu_ext::graphics::shader::ShaderVertexFragment m_overdrawShader;
 
     // material
     kdgpu_ext::gltf_holder::shader_specification::GltfShaderTextureChannels m_shaderTextureChannels;
@@ -62,6 +75,12 @@ private:
 
     // result - render target
     RenderTarget m_renderTarget;
+
+    bool m_depthPrePassEnabled = false;
+    bool m_overdrawHeatMapEnabled = false;
+    bool m_overdrawHeatMapRequested = false;
+
+    void recreatePipelines();
 };
 
 }
@@ -9,12 +9,34 @@ layout(location = 4) in mat4 in_view_matrix_inverted;
 
 layout(location = 0) out vec4 fragment_color;
 
-// comes from GLTF model
-layout(set = 2, binding = 0) uniform sampler2D base_color_map;
-layout(set = 2, binding = 1) uniform sampler2D metal_roughness_map;
-layout(set = 2, binding = 2) uniform sampler2D normal_map;
-layout(set = 2, binding = 3) uniform sampler2D ambient_occlusion_map;
-//layout(set = 2, binding = 4) uniform sampler2D emission_map;
+// comes from GLTF model, small images are packed into layers of arrays
+layout(set = 2, binding = 0) uniform sampler2DArray base_color_map;
+layout(set = 2, binding = 1) uniform sampler2DArray metal_roughness_map;
+layout(set = 2, binding = 2) uniform sampler2DArray normal_map;
+layout(set = 2, binding = 3) uniform sampler2DArray ambient_occlusion_map;
+//layout(set = 2, binding = 4) uniform sampler2DArray emission_map;
+
+// where the image of each channel is in its texture, as GltfShaderTexturePlacements
+const int CHANNEL_BASE_COLOR = 0;
+const int CHANNEL_METALLIC_ROUGHNESS = 1;
+const int CHANNEL_NORMAL = 2;
+const int CHANNEL_OCCLUSION = 3;
+layout(push_constant) uniform TexturePlacements {
+    vec4 uv_rect[5]; // xy offset, zw scale of the image in its layer
+    float layer[5];
+} placements;
+
+vec4 sampleChannel(sampler2DArray map, int channel, vec2 uv)
+{
+    vec4 rect = placements.uv_rect[channel];
+    float layer = placements.layer[channel];
+    if (rect.zw == vec2(1.0))
+        return texture(map, vec3(uv, layer));
+    // images smaller than their layer repeat inside their rectangle, the gradients of
+    // the unwrapped coordinates pick the level
+    vec2 scaled_uv = uv * rect.zw;
+    return textureGrad(map, vec3(rect.xy + fract(uv) * rect.zw, layer), dFdx(scaled_uv), dFdy(scaled_uv));
+}
 
 // static lookup tables, from environment and static BRDF calculations
 layout(set = 3, binding = 0) uniform samplerCube envLightIrradiance;
@@ -379,13 +401,13 @@ const in vec3 worldNormal)
 
 void main()
 {
-    vec4 baseColor = texture(base_color_map, in_tex_coord) * material.base_color_factor;
-    vec2 metallicRoughness = texture(metal_roughness_map, in_tex_coord).zy;
+    vec4 baseColor = sampleChannel(base_color_map, CHANNEL_BASE_COLOR, in_tex_coord) * material.base_color_factor;
+    vec2 metallicRoughness = sampleChannel(metal_roughness_map, CHANNEL_METALLIC_ROUGHNESS, in_tex_coord).zy;
     float metalness = metallicRoughness.x * material.metallic_factor;
     float roughness = metallicRoughness.y * material.roughness_factor;
-    float ambientOcclusion = texture(ambient_occlusion_map, in_tex_coord).r;
+    float ambientOcclusion = sampleChannel(ambient_occlusion_map, CHANNEL_OCCLUSION, in_tex_coord).r;
     //vec4 emissive = texture(emission_map, texCoord).rgba;// * material.emissiveFactor;
-    vec3 normal = normalize(texture(normal_map, in_tex_coord).rgb * float(2.0) - vec3(1.0,1.0,1.0));
+    vec3 normal = normalize(sampleChannel(normal_map, CHANNEL_NORMAL, in_tex_coord).rgb * float(2.0) - vec3(1.0,1.0,1.0));
     normal = normalize(normal * calcWorldSpaceToTangentSpaceMatrix(in_world_normal, in_world_tangent));
 
     mat4 inverseView = in_view_matrix_inverted;
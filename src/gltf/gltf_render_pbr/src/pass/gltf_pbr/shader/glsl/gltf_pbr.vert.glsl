@@ -1,6 +1,9 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
 
+// must match gltf_depth_pre_pass.vert.glsl for the EQUAL depth test after the depth pre-pass
+invariant gl_Position;
+
 layout(location = 0) in vec3 in_vertex_position;
 layout(location = 1) in vec3 in_vertex_normal;
 layout(location = 2) in vec2 in_vertex_tex_coord;
@@ -0,0 +1,15 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+// overdraw heat map, replaces gltf_pbr.frag.glsl. Every shaded fragment adds the same
+// amount with additive blending, so the brightness counts how often a pixel was shaded.
+
+layout(location = 0) out vec4 fragment_color;
+
+// white after 8 fragments
+const float fragment_weight = 1.0 / 8.0;
+
+void main()
+{
+    fragment_color = vec4(vec3(fragment_weight), 1.0);
+}
@@ -80,6 +80,8 @@ inline kdgpu_ext::gltf_holder::shader_specification::GltfShaderTextureChannels c
         .occlusionFragmentShaderBinding = fragmentUniformGltfOcclusionMapBinding,
         // The model in question does not have emission channels, when backend supports non-existent channels, this can be re-enabled
         // .emission_fragment_shader_binding = fragment_uniform_gltf_emission_map_binding
+        // the channels are sampled as sampler2DArray, with the placements of packed images
+        .texturePlacementPushConstantRange = texturePlacementPushConstantRange()
     };
 }
 
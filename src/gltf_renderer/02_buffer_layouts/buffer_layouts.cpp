@@ -19,6 +19,8 @@
 #include <KDGpu/buffer_options.h>
 #include <KDGpu/graphics_pipeline_options.h>
 
+#include <shader/embedded_shaders.h>
+
 #include <tinygltf_helper/tinygltf_helper.h>
 
 #include <glm/gtx/quaternion.hpp>
@@ -58,11 +60,9 @@ void BufferLayouts::initializeScene()
     };
     m_pipelineLayout = m_device.createPipelineLayout(pipelineLayoutOptions);
 
-    const auto vertexShaderPath = ExampleUtility::assetPath() + "/shaders/01_simple_gltf/simple_gltf.vert.spv";
-    m_vertexShader = m_device.createShaderModule(KDGpuExample::readShaderFile(vertexShaderPath));
+    m_vertexShader = m_device.createShaderModule(kdgpu_ext::graphics::shader::loadShader("shaders/01_simple_gltf/simple_gltf.vert.spv"));
 
-    const auto fragmentShaderPath = ExampleUtility::assetPath() + "/shaders/01_simple_gltf/simple_gltf.frag.spv";
-    m_fragmentShader = m_device.createShaderModule(KDGpuExample::readShaderFile(fragmentShaderPath));
+    m_fragmentShader = m_device.createShaderModule(kdgpu_ext::graphics::shader::loadShader("shaders/01_simple_gltf/simple_gltf.frag.spv"));
 
     // Load the model
     tinygltf::Model model;
@@ -19,7 +19,10 @@
 #include <KDGpu/buffer_options.h>
 #include <KDGpu/graphics_pipeline_options.h>
 
+#include <shader/embedded_shaders.h>
+
 #include <tinygltf_helper/tinygltf_helper.h>
+#include <tinygltf_helper/vertex_layout_analyzer.h>
 
 #include <glm/gtx/quaternion.hpp>
 #include <glm/gtc/type_ptr.hpp>
@@ -30,6 +33,10 @@
 #include <fstream>
 #include <string>
 
+namespace {
+const std::string PipelineCacheName = "03_pipeline_caching";
+}
+
 void PipelineCaching::initializeScene()
 {
     // Create bind group layout consisting of a single binding holding a UBO for the camera
@@ -57,11 +64,12 @@ void PipelineCaching::initializeScene()
                                                                                 m_nodeBindGroupLayout } };
     m_pipelineLayout = m_device.createPipelineLayout(pipelineLayoutOptions);
 
-    const auto vertexShaderPath = ExampleUtility::assetPath() + "/shaders/01_simple_gltf/simple_gltf.vert.spv";
-    m_vertexShader = m_device.createShaderModule(KDGpuExample::readShaderFile(vertexShaderPath));
+    m_vertexShader = m_device.createShaderModule(kdgpu_ext::graphics::shader::loadShader("shaders/01_simple_gltf/simple_gltf.vert.spv"));
+
+    m_fragmentShader = m_device.createShaderModule(kdgpu_ext::graphics::shader::loadShader("shaders/01_simple_gltf/simple_gltf.frag.spv"));
 
-    const auto fragmentShaderPath = ExampleUtility::assetPath() + "/shaders/01_simple_gltf/simple_gltf.frag.spv";
-    m_fragmentShader = m_device.createShaderModule(KDGpuExample::readShaderFile(fragmentShaderPath));
+    // Create the pipelines the scene needed last time before even loading the model
+    loadPipelineCache();
 
     // Load the model
     tinygltf::Model model;
@@ -116,12 +124,13 @@ void PipelineCaching::initializeScene()
     }
 
     // Loop through each primitive of each mesh and create a compatible WebGPU pipeline.
+    TinyGltfHelper::VertexLayoutAnalyzer vertexLayouts(model, { { "POSITION", 0 }, { "NORMAL", 1 } });
     uint32_t meshIndex = 0;
     for (const auto &mesh : model.meshes) {
         uint32_t primitiveIndex = 0;
         for (const auto &primitive : mesh.primitives) {
             const PrimitiveKey primitiveKey = { .meshIndex = meshIndex, .primitiveIndex = primitiveIndex };
-            setupPrimitive(model, primitive, primitiveKey, primitiveInstances);
+            setupPrimitive(model, vertexLayouts, primitive, primitiveKey, primitiveInstances);
             ++primitiveIndex;
         }
         ++meshIndex;
@@ -190,151 +199,25 @@ Buffer PipelineCaching::createBufferForBufferView(const tinygltf::Model &model,
 }
 
 void PipelineCaching::setupPrimitive(const tinygltf::Model &model,
+                                     TinyGltfHelper::VertexLayoutAnalyzer &vertexLayouts,
                                      const tinygltf::Primitive &primitive,
                                      const PrimitiveKey &primitiveKey,
                                      const PrimitiveInstances &primitiveInstances)
 {
-    std::vector<BufferAndOffset> buffers;
-    VertexOptions vertexOptions{};
-    uint32_t nextBinding{ 0 };
-    uint32_t currentBinding{ 0 };
-    uint32_t vertexCount{ 0 };
-
-    // Used to keep track of which bindings are used for each buffer view and
-    // which attributes use each vertex buffer layout
-    std::map<int, std::vector<uint32_t>> bufferViewToLayoutMap;
-    std::map<uint32_t, std::vector<uint32_t>> layoutToAttributeMap;
-
-    const std::unordered_map<std::string, uint32_t> shaderLocations{ { "POSITION", 0 }, { "NORMAL", 1 } };
-
-    // Iterate over each attribute in the primitive to build up a description of the
-    // vertex layout needed to create the pipeline.
-    for (const auto &attribute : primitive.attributes) {
-        const auto &accessor = model.accessors.at(attribute.second);
-        const uint32_t bufferIndex = accessor.bufferView;
-        const auto &bufferView = model.bufferViews.at(accessor.bufferView);
-
-        // Find the location for this attribute (if any)
-        auto locationIt = shaderLocations.find(attribute.first);
-        if (locationIt == shaderLocations.end())
-            continue;
-        const uint32_t location = locationIt->second;
-
-        // Do we already have a binding for this buffer view?
-        bool foundCompatibleLayout = false;
-        const auto layoutIt = bufferViewToLayoutMap.find(accessor.bufferView);
-        if (layoutIt != bufferViewToLayoutMap.end()) {
-            // We already have one or more bindings (buffer layouts) for this buffer view. Are any
-            // of them compatible with this use of the buffer view? Are the offsets within limits?
-            const std::vector<uint32_t> &layoutIndices = layoutIt->second;
-
-            for (const auto &layoutIndex : layoutIndices) {
-                // Loop over attributes for this buffer layout
-                VertexBufferLayout &bufferLayout = vertexOptions.buffers[layoutIndex];
-                const std::vector<uint32_t> &attributeIndices = layoutToAttributeMap.at(layoutIndex);
-
-                for (const auto &attributeIndex : attributeIndices) {
-                    const DeviceSize attributeOffsetDelta = std::abs(
-                            int32_t(accessor.byteOffset) - int32_t(vertexOptions.attributes[attributeIndex].offset));
-                    if (attributeOffsetDelta < vertexOptions.buffers[layoutIndex].stride) {
-                        // Found a compatible vertex buffer layout
-                        foundCompatibleLayout = true;
-                        currentBinding = layoutIndex;
-
-                        // Track the minimum offset across all attributes that share a buffer layout
-                        BufferAndOffset &buffer = buffers.at(layoutIndex);
-                        buffer.offset = std::min(buffer.offset, static_cast<DeviceSize>(accessor.byteOffset));
-
-                        break;
-                    }
-                }
-            }
-        }
-
-        if (!foundCompatibleLayout) {
-            // Add a buffer layout and binding for this buffer view
-            const VertexBufferLayout bufferLayout = {
-                .binding = nextBinding,
-                .stride = bufferView.byteStride ? static_cast<uint32_t>(bufferView.byteStride)
-                                                : TinyGltfHelper::packedArrayStrideForAccessor(accessor)
-            };
-            vertexOptions.buffers.push_back(bufferLayout);
-
-            // Note that this buffer view maps to this binding
-            bufferViewToLayoutMap.insert({ accessor.bufferView, { nextBinding } });
-            layoutToAttributeMap.insert({ nextBinding, {} });
-
-            // Store the buffer and offset to be used with this buffer layout.
-            // NB: The index in the vector is equal to the buffer layout binding
-            buffers.push_back({ .buffer = m_buffers.at(bufferIndex), .offset = accessor.byteOffset });
-
-            currentBinding = nextBinding;
-            ++nextBinding;
-        }
-
-        // Set up the vertex attribute using the current binding
-        const VertexAttribute vertexAttribute = { .location = location,
-                                                  .binding = currentBinding,
-                                                  .format = TinyGltfHelper::formatForAccessor(accessor),
-                                                  .offset = accessor.byteOffset };
-        vertexOptions.attributes.push_back(vertexAttribute);
-
-        uint32_t attributeIndex = static_cast<uint32_t>(vertexOptions.attributes.size() - 1);
-        layoutToAttributeMap.at(currentBinding).push_back(attributeIndex);
-
-        vertexCount = accessor.count;
-    }
+    const TinyGltfHelper::PrimitiveVertexLayout &vertexLayout = vertexLayouts.analyze(primitive);
+    const VertexOptions &vertexOptions = vertexLayouts.vertexOptions(vertexLayout.layoutId);
+    const uint32_t vertexCount = vertexLayout.vertexCount;
 
-    // Normalize attribute offsets by subtracting off the buffer layout offset. By nature of the
-    // way in which we create the buffer layouts they are already sorted by binding number.
-    const uint32_t bufferLayoutCount = vertexOptions.buffers.size();
-    for (uint32_t bufferLayoutIndex = 0; bufferLayoutIndex < bufferLayoutCount; ++bufferLayoutIndex) {
-        const BufferAndOffset &buffer = buffers.at(bufferLayoutIndex);
-        const std::vector<uint32_t> &attributeIndices = layoutToAttributeMap.at(bufferLayoutIndex);
-        for (const auto &attributeIndex : attributeIndices)
-            vertexOptions.attributes[attributeIndex].offset -= buffer.offset;
-    }
-
-    // Sort the attributes to be in order of their location. This normalizes the data so that we can
-    // compare them to remove duplicates.
-    std::sort(vertexOptions.attributes.begin(), vertexOptions.attributes.end(),
-              [](const VertexAttribute &a, const VertexAttribute &b) { return a.location < b.location; });
+    // NB: The index in the vector is equal to the buffer layout binding
+    std::vector<BufferAndOffset> buffers;
+    buffers.reserve(vertexLayout.bindings.size());
+    for (const auto &binding : vertexLayout.bindings)
+        buffers.push_back({ .buffer = m_buffers.at(binding.bufferView), .offset = binding.offset });
 
     // Find or create a pipeline that is compatible with the above vertex buffer layout and topology
-    Handle<GraphicsPipeline_t> pipelineHandle;
     const GraphicsPipelineKey key = { .topology = TinyGltfHelper::topologyForPrimitiveMode(primitive.mode),
-                                      .vertexOptions = std::move(vertexOptions) };
-
-    const auto pipelineIt = m_pipelines.find(key);
-    if (pipelineIt == m_pipelines.end()) {
-        // Create a pipeline compatible with the above vertex buffer and attribute layout
-        // clang-format off
-        GraphicsPipelineOptions pipelineOptions = {
-            .shaderStages = {
-                { .shaderModule = m_vertexShader, .stage = ShaderStageFlagBits::VertexBit },
-                { .shaderModule = m_fragmentShader, .stage = ShaderStageFlagBits::FragmentBit }
-            },
-            .layout = m_pipelineLayout,
-            .vertex = key.vertexOptions,
-            .renderTargets = {
-                { .format = m_swapchainFormat }
-            },
-            .depthStencil = {
-                .format = m_depthFormat,
-                .depthWritesEnabled = true,
-                .depthCompareOperation = CompareOperation::Less
-            },
-            .primitive = {
-                .topology = key.topology
-            }
-        };
-        // clang-format on
-        GraphicsPipeline pipeline = m_device.createGraphicsPipeline(pipelineOptions);
-        pipelineHandle = pipeline.handle();
-        m_pipelines.insert({ key, std::move(pipeline) });
-    } else {
-        pipelineHandle = pipelineIt->second.handle();
-    }
+                                      .vertexOptions = vertexOptions };
+    const Handle<GraphicsPipeline_t> pipelineHandle = findOrCreatePipeline(key);
 
     // Determine draw type and cache enough information for render time
     const auto &instances = primitiveInstances.at(primitiveKey);
@@ -438,13 +321,99 @@ void PipelineCaching::setupMeshNode(const tinygltf::Model &model,
     }
 }
 
+Handle<GraphicsPipeline_t> PipelineCaching::findOrCreatePipeline(const GraphicsPipelineKey &key)
+{
+    m_requestedPipelineKeys.insert(key);
+
+    const auto pipelineIt = m_pipelines.find(key);
+    if (pipelineIt != m_pipelines.end())
+        return pipelineIt->second.handle();
+
+    return createPipeline(key);
+}
+
+Handle<GraphicsPipeline_t> PipelineCaching::createPipeline(const GraphicsPipelineKey &key)
+{
+    // Create a pipeline compatible with the vertex buffer and attribute layout of the key
+    // clang-format off
+    GraphicsPipelineOptions pipelineOptions = {
+        .shaderStages = {
+            { .shaderModule = m_vertexShader, .stage = ShaderStageFlagBits::VertexBit },
+            { .shaderModule = m_fragmentShader, .stage = ShaderStageFlagBits::FragmentBit }
+        },
+        .layout = m_pipelineLayout,
+        .vertex = key.vertexOptions,
+        .renderTargets = {
+            { .format = m_swapchainFormat }
+        },
+        .depthStencil = {
+            .format = m_depthFormat,
+            .depthWritesEnabled = true,
+            .depthCompareOperation = CompareOperation::Less
+        },
+        .primitive = {
+            .topology = key.topology
+        }
+    };
+    // clang-format on
+    GraphicsPipeline pipeline = m_device.createGraphicsPipeline(pipelineOptions);
+    const auto pipelineHandle = pipeline.handle();
+    m_pipelines.insert({ key, std::move(pipeline) });
+    return pipelineHandle;
+}
+
+void PipelineCaching::loadPipelineCache()
+{
+    using namespace kdgpu_ext::graphics::pipeline_cache;
+
+    // The file is only valid for the device and driver that wrote it
+    const PipelineCacheFile cacheFile(PipelineCacheFile::defaultPath(PipelineCacheName), PipelineCacheFormatVersion);
+    const auto records = cacheFile.load(DeviceIdentity::fromAdapter(*m_device.adapter()));
+    if (!records)
+        return;
+
+    BinaryReader reader(*records);
+    uint32_t keyCount = 0;
+    if (!reader.read(keyCount))
+        return;
+
+    for (uint32_t keyIndex = 0; keyIndex < keyCount; ++keyIndex) {
+        GraphicsPipelineKey key;
+        if (!readPipelineKey(reader, key))
+            break;
+        if (!m_pipelines.contains(key))
+            createPipeline(key);
+    }
+    SPDLOG_INFO("Pre-created {} pipelines from {}", m_pipelines.size(), cacheFile.path().string());
+}
+
+void PipelineCaching::savePipelineCache()
+{
+    using namespace kdgpu_ext::graphics::pipeline_cache;
+
+    if (m_requestedPipelineKeys.empty())
+        return;
+
+    BinaryWriter writer;
+    writer.write(static_cast<uint32_t>(m_requestedPipelineKeys.size()));
+    for (const auto &key : m_requestedPipelineKeys)
+        writePipelineKey(writer, key);
+
+    const PipelineCacheFile cacheFile(PipelineCacheFile::defaultPath(PipelineCacheName), PipelineCacheFormatVersion);
+    if (!cacheFile.save(DeviceIdentity::fromAdapter(*m_device.adapter()), writer.data()))
+        SPDLOG_WARN("Failed to write pipeline cache {}", cacheFile.path().string());
+}
+
 void PipelineCaching::cleanupScene()
 {
+    savePipelineCache();
+
     m_cameraBindGroup = {};
     m_cameraBuffer = {};
     m_worldTransformBindGroups.clear();
     m_worldTransformBuffers.clear();
     m_pipelines.clear();
+    m_requestedPipelineKeys.clear();
     m_vertexShader = {};
     m_fragmentShader = {};
     m_nodeBindGroupLayout = {};
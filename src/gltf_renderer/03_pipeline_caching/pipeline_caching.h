@@ -27,6 +27,7 @@
 #include <glm/glm.hpp>
 
 #include <unordered_map>
+#include <unordered_set>
 
 namespace tinygltf {
 class Model;
@@ -35,6 +36,10 @@ struct Node;
 struct Primitive;
 } // namespace tinygltf
 
+namespace TinyGltfHelper {
+class VertexLayoutAnalyzer;
+} // namespace TinyGltfHelper
+
 struct BufferAndOffset {
     Handle<Buffer_t> buffer;
     DeviceSize offset{ 0 };
@@ -94,10 +99,16 @@ private:
                                      uint32_t bufferViewIndex);
 
     void setupPrimitive(const tinygltf::Model &model,
+                        TinyGltfHelper::VertexLayoutAnalyzer &vertexLayouts,
                         const tinygltf::Primitive &primitive,
                         const PrimitiveKey &primitiveKey,
                         const PrimitiveInstances &primitiveInstances);
 
+    Handle<GraphicsPipeline_t> findOrCreatePipeline(const GraphicsPipelineKey &key);
+    Handle<GraphicsPipeline_t> createPipeline(const GraphicsPipelineKey &key);
+    void loadPipelineCache();
+    void savePipelineCache();
+
     void calculateWorldTransforms(const tinygltf::Model &model);
 
     void setupMeshNode(const tinygltf::Model &model,
@@ -120,6 +131,10 @@ private:
     std::vector<BindGroup> m_worldTransformBindGroups;
 
     std::unordered_map<GraphicsPipelineKey, GraphicsPipeline> m_pipelines;
+
+    // Keys requested by the scene this run. Only these are written to the on-disk cache
+    // so that pipelines the scene no longer needs drop out of it.
+    std::unordered_set<GraphicsPipelineKey> m_requestedPipelineKeys;
     ShaderModule m_vertexShader;
     ShaderModule m_fragmentShader;
     BindGroupLayout m_nodeBindGroupLayout;
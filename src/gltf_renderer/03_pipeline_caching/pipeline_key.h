@@ -10,6 +10,8 @@
 
 #pragma once
 
+#include <pipeline_cache/pipeline_cache_file.h>
+
 #include <KDGpu/graphics_pipeline_options.h>
 #include <KDGpu/utils/hash_utils.h>
 
@@ -71,6 +73,21 @@ struct GraphicsPipelineKey {
     bool operator!=(const GraphicsPipelineKey &other) const noexcept { return !(*this == other); }
 };
 
+// Serialization of the keys into the on-disk pipeline cache. Bump the version whenever
+// the members of the key change.
+constexpr uint32_t PipelineCacheFormatVersion = 1;
+
+inline void writePipelineKey(kdgpu_ext::graphics::pipeline_cache::BinaryWriter &writer, const GraphicsPipelineKey &key)
+{
+    writer.write(key.topology);
+    kdgpu_ext::graphics::pipeline_cache::writeVertexOptions(writer, key.vertexOptions);
+}
+
+inline bool readPipelineKey(kdgpu_ext::graphics::pipeline_cache::BinaryReader &reader, GraphicsPipelineKey &key)
+{
+    return reader.read(key.topology) && kdgpu_ext::graphics::pipeline_cache::readVertexOptions(reader, key.vertexOptions);
+}
+
 namespace std {
 
 template<>
@@ -35,6 +35,10 @@ struct Node;
 struct Primitive;
 } // namespace tinygltf
 
+namespace TinyGltfHelper {
+class VertexLayoutAnalyzer;
+} // namespace TinyGltfHelper
+
 struct BufferAndOffset {
     Handle<Buffer_t> buffer;
     DeviceSize offset{ 0 };
@@ -80,6 +84,16 @@ struct RenderStats {
     uint32_t setVertexBufferCount{ 0 };
     uint32_t setBindGroupCount{ 0 };
     uint32_t drawCount{ 0 };
+    uint32_t recordedCommandBufferCount{ 0 };
+
+    // Accumulates the per-frame counters of a replayed command buffer
+    void add(const RenderStats &other)
+    {
+        setPipelineCount += other.setPipelineCount;
+        setVertexBufferCount += other.setVertexBufferCount;
+        setBindGroupCount += other.setBindGroupCount;
+        drawCount += other.drawCount;
+    }
 };
 
 class Instancing : public KDGpuExample::SimpleExampleEngineLayer
@@ -93,6 +107,7 @@ protected:
     void resize() override;
     void updateScene() override;
     void render() override;
+    void event(KDFoundation::EventReceiver *target, KDFoundation::Event *ev) override;
 
 private:
     Buffer createBufferForBufferView(const tinygltf::Model &model,
@@ -100,6 +115,7 @@ private:
                                      uint32_t bufferViewIndex);
 
     void setupPrimitive(const tinygltf::Model &model,
+                        TinyGltfHelper::VertexLayoutAnalyzer &vertexLayouts,
                         const tinygltf::Primitive &primitive,
                         const PrimitiveKey &primitiveKey,
                         const PrimitiveInstances &primitiveInstances);
@@ -114,6 +130,9 @@ private:
                        uint32_t nodeIndex,
                        PrimitiveInstances &primitiveInstances);
 
+    CommandBuffer recordCommandBuffer(uint32_t swapchainImageIndex, RenderStats &stats);
+    void invalidateCachedCommandBuffers();
+
     kdgpu_ext::graphics::camera::Camera m_camera;
     Buffer m_cameraBuffer;
     BindGroup m_cameraBindGroup;
@@ -137,5 +156,13 @@ private:
     RenderPassCommandRecorderOptions m_opaquePassOptions;
     CommandBuffer m_commandBuffer;
 
+    // The draw list never changes after initializeScene() so by default we record one
+    // command buffer per swapchain image once and just resubmit it every frame. The cache
+    // is dropped whenever the swapchain (and with it the attachments) is recreated.
+    // Pressing C switches to recording every frame and back, to compare both.
+    bool m_useCachedCommandBuffers{ true };
+    std::vector<CommandBuffer> m_cachedCommandBuffers; // Indexed by swapchain image
+    std::vector<RenderStats> m_cachedRenderStats; // Calls recorded into each cached command buffer
+
     RenderStats m_renderStats;
 };
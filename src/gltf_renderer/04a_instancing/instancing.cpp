@@ -20,7 +20,10 @@
 #include <KDGpu/graphics_pipeline_options.h>
 #include <KDGpu/texture_options.h>
 
+#include <shader/embedded_shaders.h>
+
 #include <tinygltf_helper/tinygltf_helper.h>
+#include <tinygltf_helper/vertex_layout_analyzer.h>
 
 #include <glm/gtx/quaternion.hpp>
 #include <glm/gtc/type_ptr.hpp>
@@ -67,11 +70,9 @@ void Instancing::initializeScene()
                                                                                 m_nodeBindGroupLayout } };
     m_pipelineLayout = m_device.createPipelineLayout(pipelineLayoutOptions);
 
-    const auto vertexShaderPath = ExampleUtility::assetPath() + "/shaders/04_instancing/instancing.vert.spv";
-    m_vertexShader = m_device.createShaderModule(KDGpuExample::readShaderFile(vertexShaderPath));
+    m_vertexShader = m_device.createShaderModule(kdgpu_ext::graphics::shader::loadShader("shaders/04_instancing/instancing.vert.spv"));
 
-    const auto fragmentShaderPath = ExampleUtility::assetPath() + "/shaders/04_instancing/instancing.frag.spv";
-    m_fragmentShader = m_device.createShaderModule(KDGpuExample::readShaderFile(fragmentShaderPath));
+    m_fragmentShader = m_device.createShaderModule(kdgpu_ext::graphics::shader::loadShader("shaders/04_instancing/instancing.frag.spv"));
 
     // Load the model
     tinygltf::Model model;
@@ -148,12 +149,13 @@ void Instancing::initializeScene()
     // Loop through each primitive of each mesh and create a compatible WebGPU pipeline.
     // During this process we will also populate the instances world transform SSBO.
     primitiveInstances.mappedData = static_cast<glm::mat4 *>(m_instanceTransformsBuffer.map());
+    TinyGltfHelper::VertexLayoutAnalyzer vertexLayouts(model, { { "POSITION", 0 }, { "NORMAL", 1 } });
     uint32_t meshIndex = 0;
     for (const auto &mesh : model.meshes) {
         uint32_t primitiveIndex = 0;
         for (const auto &primitive : mesh.primitives) {
             const PrimitiveKey primitiveKey = { .meshIndex = meshIndex, .primitiveIndex = primitiveIndex };
-            setupPrimitive(model, primitive, primitiveKey, primitiveInstances);
+            setupPrimitive(model, vertexLayouts, primitive, primitiveKey, primitiveInstances);
             ++primitiveIndex;
         }
         ++meshIndex;
@@ -228,120 +230,25 @@ Buffer Instancing::createBufferForBufferView(const tinygltf::Model &model,
 }
 
 void Instancing::setupPrimitive(const tinygltf::Model &model,
+                                TinyGltfHelper::VertexLayoutAnalyzer &vertexLayouts,
                                 const tinygltf::Primitive &primitive,
                                 const PrimitiveKey &primitiveKey,
                                 PrimitiveInstances &primitiveInstances)
 {
-    std::vector<BufferAndOffset> buffers;
-    VertexOptions vertexOptions{};
-    uint32_t nextBinding{ 0 };
-    uint32_t currentBinding{ 0 };
-    uint32_t vertexCount{ 0 };
-
-    // Used to keep track of which bindings are used for each buffer view and
-    // which attributes use each vertex buffer layout
-    std::map<int, std::vector<uint32_t>> bufferViewToLayoutMap;
-    std::map<uint32_t, std::vector<uint32_t>> layoutToAttributeMap;
-
-    const std::unordered_map<std::string, uint32_t> shaderLocations{ { "POSITION", 0 }, { "NORMAL", 1 } };
-
-    // Iterate over each attribute in the primitive to build up a description of the
-    // vertex layout needed to create the pipeline.
-    for (const auto &attribute : primitive.attributes) {
-        const auto &accessor = model.accessors.at(attribute.second);
-        const uint32_t bufferIndex = accessor.bufferView;
-        const auto &bufferView = model.bufferViews.at(accessor.bufferView);
-
-        // Find the location for this attribute (if any)
-        auto locationIt = shaderLocations.find(attribute.first);
-        if (locationIt == shaderLocations.end())
-            continue;
-        const uint32_t location = locationIt->second;
-
-        // Do we already have a binding for this buffer view?
-        bool foundCompatibleLayout = false;
-        const auto layoutIt = bufferViewToLayoutMap.find(accessor.bufferView);
-        if (layoutIt != bufferViewToLayoutMap.end()) {
-            // We already have one or more bindings (buffer layouts) for this buffer view. Are any
-            // of them compatible with this use of the buffer view? Are the offsets within limits?
-            const std::vector<uint32_t> &layoutIndices = layoutIt->second;
-
-            for (const auto &layoutIndex : layoutIndices) {
-                // Loop over attributes for this buffer layout
-                VertexBufferLayout &bufferLayout = vertexOptions.buffers[layoutIndex];
-                const std::vector<uint32_t> &attributeIndices = layoutToAttributeMap.at(layoutIndex);
-
-                for (const auto &attributeIndex : attributeIndices) {
-                    const DeviceSize attributeOffsetDelta = std::abs(
-                            int32_t(accessor.byteOffset) - int32_t(vertexOptions.attributes[attributeIndex].offset));
-                    if (attributeOffsetDelta < vertexOptions.buffers[layoutIndex].stride) {
-                        // Found a compatible vertex buffer layout
-                        foundCompatibleLayout = true;
-                        currentBinding = layoutIndex;
-
-                        // Track the minimum offset across all attributes that share a buffer layout
-                        BufferAndOffset &buffer = buffers.at(layoutIndex);
-                        buffer.offset = std::min(buffer.offset, static_cast<DeviceSize>(accessor.byteOffset));
-
-                        break;
-                    }
-                }
-            }
-        }
-
-        if (!foundCompatibleLayout) {
-            // Add a buffer layout and binding for this buffer view
-            const VertexBufferLayout bufferLayout = {
-                .binding = nextBinding,
-                .stride = bufferView.byteStride ? static_cast<uint32_t>(bufferView.byteStride)
-                                                : TinyGltfHelper::packedArrayStrideForAccessor(accessor)
-            };
-            vertexOptions.buffers.push_back(bufferLayout);
-
-            // Note that this buffer view maps to this binding
-            bufferViewToLayoutMap.insert({ accessor.bufferView, { nextBinding } });
-            layoutToAttributeMap.insert({ nextBinding, {} });
-
-            // Store the buffer and offset to be used with this buffer layout.
-            // NB: The index in the vector is equal to the buffer layout binding
-            buffers.push_back({ .buffer = m_buffers.at(bufferIndex), .offset = accessor.byteOffset });
-
-            currentBinding = nextBinding;
-            ++nextBinding;
-        }
-
-        // Set up the vertex attribute using the current binding
-        const VertexAttribute vertexAttribute = { .location = location,
-                                                  .binding = currentBinding,
-                                                  .format = TinyGltfHelper::formatForAccessor(accessor),
-                                                  .offset = accessor.byteOffset };
-        vertexOptions.attributes.push_back(vertexAttribute);
+    const TinyGltfHelper::PrimitiveVertexLayout &vertexLayout = vertexLayouts.analyze(primitive);
+    const VertexOptions &vertexOptions = vertexLayouts.vertexOptions(vertexLayout.layoutId);
+    const uint32_t vertexCount = vertexLayout.vertexCount;
 
-        uint32_t attributeIndex = static_cast<uint32_t>(vertexOptions.attributes.size() - 1);
-        layoutToAttributeMap.at(currentBinding).push_back(attributeIndex);
-
-        vertexCount = accessor.count;
-    }
-
-    // Normalize attribute offsets by subtracting off the buffer layout offset. By nature of the
-    // way in which we create the buffer layouts they are already sorted by binding number.
-    const uint32_t bufferLayoutCount = vertexOptions.buffers.size();
-    for (uint32_t bufferLayoutIndex = 0; bufferLayoutIndex < bufferLayoutCount; ++bufferLayoutIndex) {
-        const BufferAndOffset &buffer = buffers.at(bufferLayoutIndex);
-        const std::vector<uint32_t> &attributeIndices = layoutToAttributeMap.at(bufferLayoutIndex);
-        for (const auto &attributeIndex : attributeIndices)
-            vertexOptions.attributes[attributeIndex].offset -= buffer.offset;
-    }
-
-    // Sort the attributes to be in order of their location. This normalizes the data so that we can
-    // compare them to remove duplicates.
-    std::sort(vertexOptions.attributes.begin(), vertexOptions.attributes.end(),
-              [](const VertexAttribute &a, const VertexAttribute &b) { return a.location < b.location; });
+    // NB: The index in the vector is equal to the buffer layout binding
+    std::vector<BufferAndOffset> buffers;
+    buffers.reserve(vertexLayout.bindings.size());
+    for (const auto &binding : vertexLayout.bindings)
+        buffers.push_back({ .buffer = m_buffers.at(binding.bufferView), .offset = binding.offset });
 
     // Find or create a pipeline that is compatible with the above vertex buffer layout and topology
     Handle<GraphicsPipeline_t> pipelineHandle;
     const GraphicsPipelineKey key = { .topology = TinyGltfHelper::topologyForPrimitiveMode(primitive.mode),
-                                      .vertexOptions = std::move(vertexOptions) };
+                                      .vertexOptions = vertexOptions };
 
     const auto pipelineIt = m_pipelines.find(key);
     if (pipelineIt == m_pipelines.end()) {
@@ -37,6 +37,10 @@ struct Node;
 struct Primitive;
 } // namespace tinygltf
 
+namespace TinyGltfHelper {
+class VertexLayoutAnalyzer;
+} // namespace TinyGltfHelper
+
 struct BufferAndOffset {
     Handle<Buffer_t> buffer;
     DeviceSize offset{ 0 };
@@ -112,6 +116,7 @@ private:
                                      uint32_t bufferViewIndex);
 
     void setupPrimitive(const tinygltf::Model &model,
+                        TinyGltfHelper::VertexLayoutAnalyzer &vertexLayouts,
                         const tinygltf::Primitive &primitive,
                         const PrimitiveKey &primitiveKey,
                         PrimitiveInstances &primitiveInstances);
@@ -14,6 +14,7 @@
 #include "primitive_key.h"
 
 #include <camera/camera.h>
+#include <sampler/sampler_cache.h>
 
 #include <KDGpuExample/simple_example_engine_layer.h>
 
@@ -38,6 +39,10 @@ struct Node;
 struct Primitive;
 } // namespace tinygltf
 
+namespace TinyGltfHelper {
+class VertexLayoutAnalyzer;
+} // namespace TinyGltfHelper
+
 struct BufferAndOffset {
     Handle<Buffer_t> buffer;
     DeviceSize offset{ 0 };
@@ -129,13 +134,13 @@ private:
                                      uint32_t bufferViewIndex);
 
     TextureAndView createTextureForImage(const tinygltf::Model &model, uint32_t textureIndex);
-    Sampler createSampler(const tinygltf::Model &model, uint32_t samplerIndex);
     TextureViewAndSampler createViewSamplerForTexture(const tinygltf::Model &model, uint32_t viewSamplerIndex);
     TextureAndView createSolidColorTexture(float r, float g, float b, float a);
 
     void setupMaterial(const tinygltf::Model &model, uint32_t materialIndex);
 
     void setupPrimitive(const tinygltf::Model &model,
+                        TinyGltfHelper::VertexLayoutAnalyzer &vertexLayouts,
                         const tinygltf::Primitive &primitive,
                         const PrimitiveKey &primitiveKey,
                         PrimitiveInstances &primitiveInstances);
@@ -165,7 +170,7 @@ private:
     TextureAndView m_opaqueWhite;
     TextureAndView m_transparentBlack;
     TextureAndView m_defaultNormal;
-    Sampler m_defaultSampler;
+    Handle<Sampler_t> m_defaultSampler;
 
     // We now store a map of pipeline to the primitives that use that pipeline. Each
     // primitive may have multiple instances by way of the list of transform bind groups.
@@ -173,8 +178,9 @@ private:
 
     std::vector<Buffer> m_buffers;
     std::vector<TextureAndView> m_textures;
-    std::vector<Sampler> m_samplers;
     std::vector<TextureViewAndSampler> m_viewSamplers;
+    // Owns the samplers of m_viewSamplers and m_defaultSampler, one per distinct sampler state
+    kdgpu_ext::graphics::sampler::SamplerCache m_samplerCache;
 
     std::vector<glm::mat4> m_worldTransforms; // Indexed as per model.nodes
     Buffer m_instanceTransformsBuffer;
@@ -25,6 +25,8 @@
 #include <KDGpu/texture_options.h>
 #include <KDGpu/texture_view_options.h>
 
+#include <shader/embedded_shaders.h>
+
 // Precompiled shader bytecode
 #include "CACAOClearLoadCounter_32.h"
 #include "CACAOPrepareDownsampledDepths_32.h"
@@ -709,15 +711,6 @@ struct UBOConstants {
     float NormalsWorldToViewspaceMatrix[4][4];
 };
 
-inline std::string assetPath()
-{
-#if defined(GLTF_RENDERER_ASSET_PATH)
-    return GLTF_RENDERER_ASSET_PATH;
-#else
-    return "";
-#endif
-}
-
 const uint32_t tileSize = 8;
 
 } // namespace
@@ -777,8 +770,9 @@ FFX_Cacao::BufferSizeInfo::BufferSizeInfo(uint32_t width, uint32_t height, bool
     }
 }
 
-FFX_Cacao::FFX_Cacao(Device *device)
+FFX_Cacao::FFX_Cacao(Device *device, kdgpu_ext::graphics::sampler::SamplerCache *samplerCache)
     : m_device(device)
+    , m_samplerCache(samplerCache)
 {
 }
 
@@ -812,7 +806,7 @@ void FFX_Cacao::initializeCacaoComputePass()
         // clang-format on
 
         for (size_t i = 0; i < SamplersCount; ++i)
-            m_samplers.emplace_back(m_device->createSampler(samplerOptions[i]));
+            m_samplers.emplace_back(m_samplerCache->findOrCreate(*m_device, samplerOptions[i]));
     }
 
     // BindGroupLayouts
@@ -958,11 +952,9 @@ void FFX_Cacao::initializeCacaoFullScreenPass(KDGpu::Format colorFormat, KDGpu::
     });
 
     // Create a vertex shader and fragment shader for fullscreen quad
-    const auto vertexShaderPath = assetPath() + "/shaders/06_ffx_cacao/fullscreenquad.vert.spv";
-    auto vertexShader = m_device->createShaderModule(KDGpuExample::readShaderFile(vertexShaderPath));
+    auto vertexShader = m_device->createShaderModule(kdgpu_ext::graphics::shader::loadShader("shaders/06_ffx_cacao/fullscreenquad.vert.spv"));
 
-    const auto fragmentShaderPath = assetPath() + "/shaders/06_ffx_cacao/fullscreenquad.frag.spv";
-    auto fragmentShader = m_device->createShaderModule(KDGpuExample::readShaderFile(fragmentShaderPath));
+    auto fragmentShader = m_device->createShaderModule(kdgpu_ext::graphics::shader::loadShader("shaders/06_ffx_cacao/fullscreenquad.frag.spv"));
 
     // Create a pipeline
     m_fsqPipeline = m_device->createGraphicsPipeline(GraphicsPipelineOptions{
@@ -994,7 +986,7 @@ void FFX_Cacao::initializeCacaoFullScreenPass(KDGpu::Format colorFormat, KDGpu::
     };
 
     // Create a sampler we can use to sample from the color texture in the final pass
-    m_fsqPassSampler = m_device->createSampler();
+    m_fsqPassSampler = m_samplerCache->findOrCreate(*m_device);
 
     // Create a bindGroup to hold the CACAO Output Color Texture
     m_fsqTextureBindGroup = m_device->createBindGroup(BindGroupOptions{
@@ -20,6 +20,8 @@
 #include <KDGpu/texture_view.h>
 #include <KDGpu/command_buffer.h>
 
+#include <sampler/sampler_cache.h>
+
 #include <glm/glm.hpp>
 
 #include <array>
@@ -28,7 +30,7 @@
 class FFX_Cacao
 {
 public:
-    explicit FFX_Cacao(KDGpu::Device *device);
+    FFX_Cacao(KDGpu::Device *device, kdgpu_ext::graphics::sampler::SamplerCache *samplerCache);
     ~FFX_Cacao();
 
     enum class Quality : uint32_t {
@@ -111,7 +113,7 @@ private:
     void cacaoApplyFullScreen(KDGpu::CommandRecorder &recorder, const KDGpu::TextureView &swapchainImageView);
 
     // Compute CACAO Pass
-    std::vector<KDGpu::Sampler> m_samplers;
+    std::vector<KDGpu::Handle<KDGpu::Sampler_t>> m_samplers; // Owned by m_samplerCache
     std::vector<KDGpu::BindGroupLayout> m_bindGroupLayouts;
     std::vector<KDGpu::PipelineLayout> m_pipelineLayouts;
     std::vector<KDGpu::ShaderModule> m_shaderModules;
@@ -130,7 +132,7 @@ private:
     KDGpu::GraphicsPipeline m_fsqPipeline;
     KDGpu::RenderPassCommandRecorderOptions m_fsqPassOptions;
     KDGpu::BindGroup m_fsqTextureBindGroup;
-    KDGpu::Sampler m_fsqPassSampler;
+    KDGpu::Handle<KDGpu::Sampler_t> m_fsqPassSampler;
 
     // Common
     KDGpu::Texture m_output;
@@ -140,6 +142,7 @@ private:
     KDGpu::TextureLayout m_oldDepthTextureLayout = KDGpu::TextureLayout::DepthStencilAttachmentOptimal;
 
     KDGpu::Device *m_device{ nullptr };
+    kdgpu_ext::graphics::sampler::SamplerCache *m_samplerCache{ nullptr };
 
     Settings m_settings;
     BufferSizeInfo m_bufferSizeInfo;
@@ -21,7 +21,9 @@
 #include <KDGpu/graphics_pipeline_options.h>
 #include <KDGpu/texture_options.h>
 
+#include <shader/embedded_shaders.h>
 #include <tinygltf_helper/tinygltf_helper.h>
+#include <tinygltf_helper/vertex_layout_analyzer.h>
 
 #include <glm/gtx/quaternion.hpp>
 #include <glm/gtc/type_ptr.hpp>
@@ -48,7 +50,7 @@ void Materials::initializeScene()
     m_opaqueWhite = createSolidColorTexture(1.0f, 1.0f, 1.0f, 1.0f);
     m_transparentBlack = createSolidColorTexture(0.0f, 0.0f, 0.0f, 0.0f);
     m_defaultNormal = createSolidColorTexture(0.5f, 0.5f, 1.0f, 1.0f);
-    m_defaultSampler = m_device.createSampler();
+    m_defaultSampler = m_samplerCache.findOrCreate(m_device);
 
     // Create bind group layout consisting of a single binding holding a UBO for the camera
     // clang-format off
@@ -121,16 +123,8 @@ void Materials::initializeScene()
         m_textures.emplace_back(std::move(textureAndView));
     }
 
-    // Load any samplers needed
-    const uint32_t samplerCount = static_cast<uint32_t>(model.samplers.size());
-    SPDLOG_INFO("Model contains {} samplers.", samplerCount);
-    m_samplers.reserve(samplerCount);
-    for (uint32_t samplerIndex = 0; samplerIndex < samplerCount; ++samplerIndex) {
-        Sampler sampler = createSampler(model, samplerIndex);
-        m_samplers.emplace_back(std::move(sampler));
-    }
-
-    // Create the combined image samplers needed
+    // Create the combined image samplers needed. Samplers come from the cache, so glTF
+    // samplers with the same state share one sampler object.
     const uint32_t viewSamplerCount = static_cast<uint32_t>(model.textures.size());
     SPDLOG_INFO("Model contains {} view samplers.", viewSamplerCount);
     m_viewSamplers.reserve(viewSamplerCount);
@@ -138,6 +132,7 @@ void Materials::initializeScene()
         TextureViewAndSampler viewSampler = createViewSamplerForTexture(model, viewSamplerIndex);
         m_viewSamplers.emplace_back(std::move(viewSampler));
     }
+    SPDLOG_INFO("Model contains {} samplers, {} distinct samplers in use.", model.samplers.size(), m_samplerCache.size());
 
     // Load any materials needed
     const uint32_t materialCount = static_cast<uint32_t>(model.materials.size());
@@ -213,12 +208,13 @@ void Materials::initializeScene()
     // Loop through each primitive of each mesh and create a compatible WebGPU pipeline.
     // During this process we will also populate the instances world transform SSBO.
     primitiveInstances.mappedData = static_cast<glm::mat4 *>(m_instanceTransformsBuffer.map());
+    TinyGltfHelper::VertexLayoutAnalyzer vertexLayouts(model, { { "POSITION", 0 }, { "NORMAL", 1 }, { "TEXCOORD_0", 2 } });
     uint32_t meshIndex = 0;
     for (const auto &mesh : model.meshes) {
         uint32_t primitiveIndex = 0;
         for (const auto &primitive : mesh.primitives) {
             const PrimitiveKey primitiveKey = { .meshIndex = meshIndex, .primitiveIndex = primitiveIndex };
-            setupPrimitive(model, primitive, primitiveKey, primitiveInstances);
+            setupPrimitive(model, vertexLayouts, primitive, primitiveKey, primitiveInstances);
             ++primitiveIndex;
         }
         ++meshIndex;
@@ -267,7 +263,7 @@ void Materials::initializeScene()
     };
     // clang-format on
 
-    m_ffxCacao = std::make_unique<FFX_Cacao>(&m_device);
+    m_ffxCacao = std::make_unique<FFX_Cacao>(&m_device, &m_samplerCache);
     m_ffxCacao->initializeScene(m_swapchainFormat, m_depthFormat);
     m_ffxCacao->resize(m_window->width(), m_window->height(), m_depthTexture, m_depthTextureView);
 }
@@ -342,26 +338,12 @@ TextureAndView Materials::createTextureForImage(const tinygltf::Model &model, ui
     return textureAndView;
 }
 
-Sampler Materials::createSampler(const tinygltf::Model &model, uint32_t samplerIndex)
-{
-    const tinygltf::Sampler &gltfSampler = model.samplers.at(samplerIndex);
-    SamplerOptions samplerOptions = {
-        .magFilter = TinyGltfHelper::filterModeForSamplerFilter(gltfSampler.magFilter),
-        .minFilter = TinyGltfHelper::filterModeForSamplerFilter(gltfSampler.minFilter),
-        .mipmapFilter = TinyGltfHelper::mipmapFilterModeForSamplerFilter(gltfSampler.minFilter),
-        .u = TinyGltfHelper::addressModeForSamplerAddressMode(gltfSampler.wrapS),
-        .v = TinyGltfHelper::addressModeForSamplerAddressMode(gltfSampler.wrapT)
-    };
-    Sampler sampler = m_device.createSampler(samplerOptions);
-    return sampler;
-}
-
 TextureViewAndSampler Materials::createViewSamplerForTexture(const tinygltf::Model &model, uint32_t viewSamplerIndex)
 {
     const tinygltf::Texture &gltfTexture = model.textures.at(viewSamplerIndex);
     TextureViewAndSampler viewSampler = {
         .view = m_textures.at(gltfTexture.source).textureView,
-        .sampler = m_samplers.at(gltfTexture.sampler)
+        .sampler = m_samplerCache.findOrCreate(m_device, TinyGltfHelper::samplerOptionsForTexture(model, viewSamplerIndex))
     };
     return viewSampler;
 }
@@ -464,121 +446,24 @@ void Materials::setupMaterial(const tinygltf::Model &model, uint32_t materialInd
 }
 
 void Materials::setupPrimitive(const tinygltf::Model &model,
+                               TinyGltfHelper::VertexLayoutAnalyzer &vertexLayouts,
                                const tinygltf::Primitive &primitive,
                                const PrimitiveKey &primitiveKey,
                                PrimitiveInstances &primitiveInstances)
 {
-    std::vector<BufferAndOffset> buffers;
-    VertexOptions vertexOptions{};
-    uint32_t nextBinding{ 0 };
-    uint32_t currentBinding{ 0 };
-    uint32_t vertexCount{ 0 };
-
-    // Used to keep track of which bindings are used for each buffer view and
-    // which attributes use each vertex buffer layout
-    std::map<int, std::vector<uint32_t>> bufferViewToLayoutMap;
-    std::map<uint32_t, std::vector<uint32_t>> layoutToAttributeMap;
-
-    const std::unordered_map<std::string, uint32_t> shaderLocations{ { "POSITION", 0 }, { "NORMAL", 1 }, { "TEXCOORD_0", 2 } };
-    bool hasTexCoords{ false };
-
-    // Iterate over each attribute in the primitive to build up a description of the
-    // vertex layout needed to create the pipeline.
-    for (const auto &attribute : primitive.attributes) {
-        const auto &accessor = model.accessors.at(attribute.second);
-        const uint32_t bufferIndex = accessor.bufferView;
-        const auto &bufferView = model.bufferViews.at(accessor.bufferView);
-
-        // Find the location for this attribute (if any)
-        auto locationIt = shaderLocations.find(attribute.first);
-        if (locationIt == shaderLocations.end())
-            continue;
-        const uint32_t location = locationIt->second;
-
-        // Note if the model contains texture coordinates so that we can select a suitable
-        // shader variant below.
-        if (location == 2)
-            hasTexCoords = true;
-
-        // Do we already have a binding for this buffer view?
-        bool foundCompatibleLayout = false;
-        const auto layoutIt = bufferViewToLayoutMap.find(accessor.bufferView);
-        if (layoutIt != bufferViewToLayoutMap.end()) {
-            // We already have one or more bindings (buffer layouts) for this buffer view. Are any
-            // of them compatible with this use of the buffer view? Are the offsets within limits?
-            const std::vector<uint32_t> &layoutIndices = layoutIt->second;
-
-            for (const auto &layoutIndex : layoutIndices) {
-                // Loop over attributes for this buffer layout
-                VertexBufferLayout &bufferLayout = vertexOptions.buffers[layoutIndex];
-                const std::vector<uint32_t> &attributeIndices = layoutToAttributeMap.at(layoutIndex);
-
-                for (const auto &attributeIndex : attributeIndices) {
-                    const DeviceSize attributeOffsetDelta = std::abs(
-                            int32_t(accessor.byteOffset) - int32_t(vertexOptions.attributes[attributeIndex].offset));
-                    if (attributeOffsetDelta < vertexOptions.buffers[layoutIndex].stride) {
-                        // Found a compatible vertex buffer layout
-                        foundCompatibleLayout = true;
-                        currentBinding = layoutIndex;
-
-                        // Track the minimum offset across all attributes that share a buffer layout
-                        BufferAndOffset &buffer = buffers.at(layoutIndex);
-                        buffer.offset = std::min(buffer.offset, static_cast<DeviceSize>(accessor.byteOffset));
-
-                        break;
-                    }
-                }
-            }
-        }
-
-        if (!foundCompatibleLayout) {
-            // Add a buffer layout and binding for this buffer view
-            const VertexBufferLayout bufferLayout = {
-                .binding = nextBinding,
-                .stride = bufferView.byteStride ? static_cast<uint32_t>(bufferView.byteStride)
-                                                : TinyGltfHelper::packedArrayStrideForAccessor(accessor)
-            };
-            vertexOptions.buffers.push_back(bufferLayout);
-
-            // Note that this buffer view maps to this binding
-            bufferViewToLayoutMap.insert({ accessor.bufferView, { nextBinding } });
-            layoutToAttributeMap.insert({ nextBinding, {} });
-
-            // Store the buffer and offset to be used with this buffer layout.
-            // NB: The index in the vector is equal to the buffer layout binding
-            buffers.push_back({ .buffer = m_buffers.at(bufferIndex), .offset = accessor.byteOffset });
-
-            currentBinding = nextBinding;
-            ++nextBinding;
-        }
-
-        // Set up the vertex attribute using the current binding
-        const VertexAttribute vertexAttribute = { .location = location,
-                                                  .binding = currentBinding,
-                                                  .format = TinyGltfHelper::formatForAccessor(accessor),
-                                                  .offset = accessor.byteOffset };
-        vertexOptions.attributes.push_back(vertexAttribute);
+    const TinyGltfHelper::PrimitiveVertexLayout &vertexLayout = vertexLayouts.analyze(primitive);
+    const VertexOptions &vertexOptions = vertexLayouts.vertexOptions(vertexLayout.layoutId);
+    const uint32_t vertexCount = vertexLayout.vertexCount;
 
-        uint32_t attributeIndex = static_cast<uint32_t>(vertexOptions.attributes.size() - 1);
-        layoutToAttributeMap.at(currentBinding).push_back(attributeIndex);
+    // Note if the model contains texture coordinates so that we can select a suitable
+    // shader variant below.
+    const bool hasTexCoords = vertexLayouts.hasLocation(vertexLayout.layoutId, 2);
 
-        vertexCount = accessor.count;
-    }
-
-    // Normalize attribute offsets by subtracting off the buffer layout offset. By nature of the
-    // way in which we create the buffer layouts they are already sorted by binding number.
-    const uint32_t bufferLayoutCount = vertexOptions.buffers.size();
-    for (uint32_t bufferLayoutIndex = 0; bufferLayoutIndex < bufferLayoutCount; ++bufferLayoutIndex) {
-        const BufferAndOffset &buffer = buffers.at(bufferLayoutIndex);
-        const std::vector<uint32_t> &attributeIndices = layoutToAttributeMap.at(bufferLayoutIndex);
-        for (const auto &attributeIndex : attributeIndices)
-            vertexOptions.attributes[attributeIndex].offset -= buffer.offset;
-    }
-
-    // Sort the attributes to be in order of their location. This normalizes the data so that we can
-    // compare them to remove duplicates.
-    std::sort(vertexOptions.attributes.begin(), vertexOptions.attributes.end(),
-              [](const VertexAttribute &a, const VertexAttribute &b) { return a.location < b.location; });
+    // NB: The index in the vector is equal to the buffer layout binding
+    std::vector<BufferAndOffset> buffers;
+    buffers.reserve(vertexLayout.bindings.size());
+    for (const auto &binding : vertexLayout.bindings)
+        buffers.push_back({ .buffer = m_buffers.at(binding.bufferView), .offset = binding.offset });
 
     // Find or create a pipeline that is compatible with the above vertex buffer layout and topology
     const tinygltf::Material &gltfMaterial = model.materials.at(primitive.material);
@@ -587,7 +472,7 @@ void Materials::setupPrimitive(const tinygltf::Model &model,
     // clang-format off
     const GraphicsPipelineKey key = {
         .topology = TinyGltfHelper::topologyForPrimitiveMode(primitive.mode),
-        .vertexOptions = std::move(vertexOptions),
+        .vertexOptions = vertexOptions,
         .alphaMode = alphaMode,
         .doubleSided = gltfMaterial.doubleSided,
         .shaderOptionsKey = {
@@ -712,8 +597,8 @@ Handle<ShaderModule_t> Materials::findOrCreateShaderModule(const ShaderModuleKey
     if (shaderModuleIt != m_shaderModules.end()) {
         return shaderModuleIt->second.handle();
     } else {
-        const auto shaderPath = ExampleUtility::assetPath() + "/shaders/05_materials/" + shaderFilename(key.shaderOptionsKey, key.stage);
-        ShaderModule shader = m_device.createShaderModule(KDGpuExample::readShaderFile(shaderPath));
+        const auto shaderPath = "shaders/05_materials/" + shaderFilename(key.shaderOptionsKey, key.stage);
+        ShaderModule shader = m_device.createShaderModule(kdgpu_ext::graphics::shader::loadShader(shaderPath));
         const auto shaderHandle = shader.handle();
         m_shaderModules.insert({ key, std::move(shader) });
         return shaderHandle;
@@ -845,7 +730,7 @@ void Materials::cleanupScene()
     m_cameraBindGroupLayout = {};
     m_pipelineLayout = {};
     m_viewSamplers.clear();
-    m_samplers.clear();
+    m_samplerCache.clear();
     m_textures.clear();
     m_buffers.clear();
     m_commandBuffer = {};
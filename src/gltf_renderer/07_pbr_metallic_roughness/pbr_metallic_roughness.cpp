@@ -23,21 +23,96 @@
 #include <KDUtils/file.h>
 
 #include <example_utility.h>
+#include <pbr_metallic_roughness_variants.h>
+#include <shader/embedded_shaders.h>
+#include <texture/block_compression.h>
 #include <tinygltf_helper/tinygltf_helper.h>
+#include <tinygltf_helper/vertex_layout_analyzer.h>
 
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtx/quaternion.hpp>
 
+#include <imgui.h>
+
 #include <ktx.h>
 #include <ktxvulkan.h>
 
 #include <algorithm>
 #include <assert.h>
+#include <chrono>
 #include <cmath>
 #include <fstream>
+#include <future>
+#include <optional>
+#include <span>
 #include <string>
 
 namespace {
+const std::string PipelineCacheName = "07_pbr_metallic_roughness";
+
+// Opaque primitives are drawn by the depth pre-pass with a position only variant of
+// their pipeline...
+GraphicsPipelineKey depthPrePassKeyFor(const GraphicsPipelineKey &key)
+{
+    GraphicsPipelineKey depthPrePassKey = {
+        .topology = key.topology,
+        .vertexOptions = key.vertexOptions,
+        .alphaMode = key.alphaMode,
+        .doubleSided = key.doubleSided,
+        .shaderOptionsKey = { .hasTexCoords = false, .enableAlphaCutoff = false },
+        .depthPassMode = DepthPassMode::DepthPrePass
+    };
+
+    // Only the position is consumed by the pre-pass. The buffer layouts are kept so
+    // that the primitive's vertex buffers can be bound unchanged.
+    auto &attributes = depthPrePassKey.vertexOptions.attributes;
+    attributes.erase(std::remove_if(attributes.begin(), attributes.end(),
+                                    [](const VertexAttribute &a) { return a.location != 0; }),
+                     attributes.end());
+    depthPrePassKey.updateHash();
+    return depthPrePassKey;
+}
+
+// ...and then shaded with an EQUAL depth test variant of it
+GraphicsPipelineKey depthEqualKeyFor(const GraphicsPipelineKey &key)
+{
+    GraphicsPipelineKey depthEqualKey = key;
+    depthEqualKey.depthPassMode = DepthPassMode::EqualAfterPrePass;
+    depthEqualKey.updateHash();
+    return depthEqualKey;
+}
+
+// The overdraw heat map accumulates on black
+ColorClearValue clearColor(bool overdrawHeatMap)
+{
+    if (overdrawHeatMap)
+        return ColorClearValue{ .float32 = { 0.0f, 0.0f, 0.0f, 1.0f } };
+    return ColorClearValue{ .float32 = { 0.3f, 0.3f, 0.3f, 1.0f } };
+}
+
+// Maps the shader options onto the option bits of the variant table generated from
+// pbr-metallic-roughness-variants.json. Adding or renaming an option in there without
+// updating the key stops this from compiling.
+constexpr uint32_t shaderOptionMask(const PipelineShaderOptionsKey &key)
+{
+    using namespace pbr_metallic_roughness_variants;
+    static_assert(optionCount == 2, "PipelineShaderOptionsKey does not match the shader variant options");
+    return (key.hasTexCoords ? options::hasTexCoords : 0u) |
+            (key.enableAlphaCutoff ? options::enableAlphaCutoff : 0u);
+}
+
+std::span<const uint32_t> shaderVariant(const PipelineShaderOptionsKey &key, ShaderStageFlagBits stage)
+{
+    switch (stage) {
+    case ShaderStageFlagBits::VertexBit:
+        return pbr_metallic_roughness_variants::pbr_metallic_roughness_vert[shaderOptionMask(key)];
+    case ShaderStageFlagBits::FragmentBit:
+        return pbr_metallic_roughness_variants::pbr_metallic_roughness_frag[shaderOptionMask(key)];
+    default:
+        SPDLOG_CRITICAL("Unhandled shader type");
+        return {};
+    }
+}
 
 ktxResult loadKtxFile(const std::string &filename, ktxTexture **texture)
 {
@@ -61,12 +136,17 @@ PbrMetallicRoughness::PbrMetallicRoughness()
 
 void PbrMetallicRoughness::initializeScene()
 {
+    // The pipeline compiler starts creating pipelines as soon as the scene queues them
+    std::lock_guard<std::mutex> deviceLock(m_deviceMutex);
+    m_cancelPipelineCompilation = false;
+
     // Create our multisample render target
     createRenderTarget();
     m_opaqueWhite = createSolidColorTexture(1.0f, 1.0f, 1.0f, 1.0f);
     m_transparentBlack = createSolidColorTexture(0.0f, 0.0f, 0.0f, 0.0f);
     m_defaultNormal = createSolidColorTexture(0.5f, 0.5f, 1.0f, 1.0f);
-    m_defaultSampler = m_device.createSampler();
+    m_samplerCache.setMaxAnisotropy(16.0f);
+    m_defaultSampler = m_samplerCache.findOrCreate(m_device);
 
     m_environmentLightSpecular = createTextureFromKtxFile(ExampleUtility::assetPath() + "/textures/footprint_court/specular.ktx2");
     m_environmentLightDiffuse = createTextureFromKtxFile(ExampleUtility::assetPath() + "/textures/footprint_court/diffuse.ktx2");
@@ -162,31 +242,61 @@ void PbrMetallicRoughness::initializeScene()
     // clang-format on
     m_pipelineLayout = m_device.createPipelineLayout(pipelineLayoutOptions);
 
+    // The depth pre-pass only needs a vertex shader. It uses the camera and instance
+    // transform bind groups of the above pipeline layout.
+    m_depthPrePassShader = m_device.createShaderModule(kdgpu_ext::graphics::shader::loadShader("shaders/07_pbr_metallic_roughness/depth_pre_pass.vert.spv"));
+
+    // Draws the primitives whose pipelines are still queued for creation
+    m_fallbackVertexShader = m_device.createShaderModule(kdgpu_ext::graphics::shader::loadShader("shaders/07_pbr_metallic_roughness/fallback.vert.spv"));
+    m_fallbackFragmentShader = m_device.createShaderModule(kdgpu_ext::graphics::shader::loadShader("shaders/07_pbr_metallic_roughness/fallback.frag.spv"));
+
+    // Replaces the shading when the overdraw heat map is shown
+    m_overdrawFragmentShader = m_device.createShaderModule(kdgpu_ext::graphics::shader::loadShader("shaders/07_pbr_metallic_roughness/overdraw.frag.spv"));
+
+    // Create the shader modules and pipelines the scene needed last time before even
+    // loading the model
+    loadPipelineCache();
+
+    registerImGuiOverlayDrawFunction([this](ImGuiContext *ctx) { drawControls(ctx); });
+
     // Load the model
     tinygltf::Model model;
     const std::string modelPath("FlightHelmet/FlightHelmet.gltf");
     if (!TinyGltfHelper::loadModel(model, ExampleUtility::gltfModelPath() + modelPath))
         return;
 
-    // Load any gltf images (Textures) needed
-    const uint32_t textureCount = static_cast<uint32_t>(model.textures.size());
-    SPDLOG_INFO("Model contains {} textures.", textureCount);
-    m_textures.reserve(textureCount);
-    for (uint32_t textureIndex = 0; textureIndex < textureCount; ++textureIndex) {
-        TextureAndView textureAndView = createTextureForImage(model, textureIndex);
-        m_textures.emplace_back(std::move(textureAndView));
+    // Load any gltf images (Textures) needed. KTX2 images (KHR_texture_basisu) are first
+    // transcoded to a block compressed format of the device on the worker threads.
+    const uint32_t imageCount = static_cast<uint32_t>(model.images.size());
+    SPDLOG_INFO("Model contains {} images.", imageCount);
+    const auto blockCompression = kdgpu_ext::graphics::texture::selectBlockCompression(m_device);
+    std::vector<std::future<std::optional<kdgpu_ext::graphics::texture::CompressedImage>>> transcodedImages(imageCount);
+    for (uint32_t imageIndex = 0; imageIndex < imageCount; ++imageIndex) {
+        const tinygltf::Image &gltfImage = model.images.at(imageIndex);
+        if (TinyGltfHelper::isKtx2Image(gltfImage)) {
+            transcodedImages[imageIndex] = m_threadPool.submit([&gltfImage, blockCompression] {
+                return kdgpu_ext::graphics::texture::transcodeBasisKtx2(gltfImage.image.data(), gltfImage.image.size(), blockCompression);
+            });
+        }
     }
+    m_textures.reserve(imageCount);
+    for (uint32_t imageIndex = 0; imageIndex < imageCount; ++imageIndex) {
+        if (!transcodedImages[imageIndex].valid()) {
+            m_textures.emplace_back(createTextureForImage(model, imageIndex));
+            continue;
+        }
 
-    // Load any samplers needed
-    const uint32_t samplerCount = static_cast<uint32_t>(model.samplers.size());
-    SPDLOG_INFO("Model contains {} samplers.", samplerCount);
-    m_samplers.reserve(samplerCount);
-    for (uint32_t samplerIndex = 0; samplerIndex < samplerCount; ++samplerIndex) {
-        Sampler sampler = createSampler(model, samplerIndex);
-        m_samplers.emplace_back(std::move(sampler));
+        const auto transcodedImage = transcodedImages[imageIndex].get();
+        if (transcodedImage) {
+            m_textures.emplace_back(createTextureForCompressedImage(*transcodedImage));
+        } else {
+            SPDLOG_ERROR("Failed to transcode KTX2 image {}", imageIndex);
+            m_textures.emplace_back(createSolidColorTexture(1.0f, 1.0f, 1.0f, 1.0f));
+        }
     }
 
-    // Create the combined image samplers needed
+    // Create the combined image samplers needed. Samplers come from the cache, so glTF
+    // samplers with the same state share one sampler object.
     const uint32_t viewSamplerCount = static_cast<uint32_t>(model.textures.size());
     SPDLOG_INFO("Model contains {} view samplers.", viewSamplerCount);
     m_viewSamplers.reserve(viewSamplerCount);
@@ -194,6 +304,7 @@ void PbrMetallicRoughness::initializeScene()
         TextureViewAndSampler viewSampler = createViewSamplerForTexture(model, viewSamplerIndex);
         m_viewSamplers.emplace_back(std::move(viewSampler));
     }
+    SPDLOG_INFO("Model contains {} samplers, {} distinct samplers in use.", model.samplers.size(), m_samplerCache.size());
 
     // Load any materials needed
     const uint32_t materialCount = static_cast<uint32_t>(model.materials.size());
@@ -269,17 +380,39 @@ void PbrMetallicRoughness::initializeScene()
     // Loop through each primitive of each mesh and create a compatible WebGPU pipeline.
     // During this process we will also populate the instances world transform SSBO.
     primitiveInstances.mappedData = static_cast<glm::mat4 *>(m_instanceTransformsBuffer.map());
+    std::vector<PendingPrimitive> pendingPrimitives;
+    TinyGltfHelper::VertexLayoutAnalyzer vertexLayouts(model, { { "POSITION", 0 }, { "NORMAL", 1 }, { "TEXCOORD_0", 2 }, { "TANGENT", 3 } });
     uint32_t meshIndex = 0;
     for (const auto &mesh : model.meshes) {
         uint32_t primitiveIndex = 0;
         for (const auto &primitive : mesh.primitives) {
             const PrimitiveKey primitiveKey = { .meshIndex = meshIndex, .primitiveIndex = primitiveIndex };
-            setupPrimitive(model, primitive, primitiveKey, primitiveInstances);
+            setupPrimitive(model, vertexLayouts, primitive, primitiveKey, primitiveInstances, pendingPrimitives);
             ++primitiveIndex;
         }
         ++meshIndex;
     }
-    m_renderStats.pipelineCount = m_pipelines.size();
+    SPDLOG_INFO("Analyzed {} primitives as {} distinct attribute sets with {} vertex layouts",
+                vertexLayouts.lookupCount(), vertexLayouts.analyzedCount(), vertexLayouts.layoutCount());
+
+    // Setting up the primitives only collected the pipeline keys they need. Create each of
+    // the missing pipelines once and then hand the resulting handles to the primitives.
+    // In the asynchronous mode the missing pipelines are instead queued when the
+    // primitives are added and the scene starts out drawn with the fallback pipelines.
+    if (!m_asyncPipelineCompilation) {
+        std::vector<GraphicsPipelineKey> pipelineKeys;
+        pipelineKeys.reserve(pendingPrimitives.size());
+        for (const auto &pendingPrimitive : pendingPrimitives) {
+            pipelineKeys.push_back(pendingPrimitive.key);
+            if (pendingPrimitive.key.alphaMode == TinyGltfHelper::AlphaMode::Opaque) {
+                pipelineKeys.push_back(depthPrePassKeyFor(pendingPrimitive.key));
+                pipelineKeys.push_back(depthEqualKeyFor(pendingPrimitive.key));
+            }
+        }
+        createPipelines(pipelineKeys);
+    }
+    m_scenePrimitives = std::move(pendingPrimitives);
+    rebuildPrimitiveBuckets();
 
     // The instances transform buffer is now populated so we can unmap it
     m_instanceTransformsBuffer.unmap();
@@ -338,7 +471,7 @@ void PbrMetallicRoughness::initializeScene()
             {
                 .view = m_msaaTextureView,
                 .resolveView = {}, // Not setting the swapchain texture view just yet
-                .clearValue = { 0.3f, 0.3f, 0.3f, 1.0f },
+                .clearValue = clearColor(m_overdrawHeatMap),
                 .finalLayout = TextureLayout::PresentSrc
             }
         },
@@ -417,10 +550,10 @@ TextureAndView PbrMetallicRoughness::createTextureForImageData(uint32_t width, u
     return textureAndView;
 }
 
-TextureAndView PbrMetallicRoughness::createTextureForImage(const tinygltf::Model &model, uint32_t textureIndex)
+TextureAndView PbrMetallicRoughness::createTextureForImage(const tinygltf::Model &model, uint32_t imageIndex)
 {
     // TODO: Mip map generation
-    const tinygltf::Image &gltfImage = model.images.at(textureIndex);
+    const tinygltf::Image &gltfImage = model.images.at(imageIndex);
     return createTextureForImageData(
         static_cast<uint32_t>(gltfImage.width),
         static_cast<uint32_t>(gltfImage.height),
@@ -430,6 +563,39 @@ TextureAndView PbrMetallicRoughness::createTextureForImage(const tinygltf::Model
     );
 }
 
+TextureAndView PbrMetallicRoughness::createTextureForCompressedImage(const kdgpu_ext::graphics::texture::CompressedImage &image)
+{
+    // clang-format off
+    const TextureOptions textureOptions = {
+        .type = TextureType::TextureType2D,
+        .format = image.format,
+        .extent = image.extent,
+        .mipLevels = image.mipLevels,
+        .usage = TextureUsageFlagBits::SampledBit | TextureUsageFlagBits::TransferDstBit,
+        .memoryUsage = MemoryUsage::GpuOnly
+    };
+    // clang-format on
+    TextureAndView textureAndView{ .texture = m_device.createTexture(textureOptions) };
+
+    // Upload all levels and transition to ShaderReadOnlyOptimal
+    // clang-format off
+    const TextureUploadOptions uploadOptions = {
+        .destinationTexture = textureAndView.texture,
+        .dstStages = PipelineStageFlagBit::AllGraphicsBit,
+        .dstMask = AccessFlagBit::MemoryReadBit,
+        .data = image.data.data(),
+        .byteSize = image.data.size(),
+        .oldLayout = TextureLayout::Undefined,
+        .newLayout = TextureLayout::ShaderReadOnlyOptimal,
+        .regions = image.regions
+    };
+    // clang-format on
+    uploadTextureData(uploadOptions);
+
+    textureAndView.textureView = textureAndView.texture.createView();
+    return textureAndView;
+}
+
 TextureAndView PbrMetallicRoughness::createTextureFromKtxFile(const std::string &filename)
 {
     ktxTexture *ktxTexture{ nullptr };
@@ -507,26 +673,13 @@ TextureAndView PbrMetallicRoughness::createTextureFromKtxFile(const std::string
     return textureAndView;
 }
 
-Sampler PbrMetallicRoughness::createSampler(const tinygltf::Model &model, uint32_t samplerIndex)
-{
-    const tinygltf::Sampler &gltfSampler = model.samplers.at(samplerIndex);
-    SamplerOptions samplerOptions = {
-        .magFilter = TinyGltfHelper::filterModeForSamplerFilter(gltfSampler.magFilter),
-        .minFilter = TinyGltfHelper::filterModeForSamplerFilter(gltfSampler.minFilter),
-        .mipmapFilter = TinyGltfHelper::mipmapFilterModeForSamplerFilter(gltfSampler.minFilter),
-        .u = TinyGltfHelper::addressModeForSamplerAddressMode(gltfSampler.wrapS),
-        .v = TinyGltfHelper::addressModeForSamplerAddressMode(gltfSampler.wrapT)
-    };
-    Sampler sampler = m_device.createSampler(samplerOptions);
-    return sampler;
-}
-
 TextureViewAndSampler PbrMetallicRoughness::createViewSamplerForTexture(const tinygltf::Model &model, uint32_t viewSamplerIndex)
 {
-    const tinygltf::Texture &gltfTexture = model.textures.at(viewSamplerIndex);
+    // Textures without an image get no view, materials use their placeholders instead
+    const std::optional<int> imageIndex = TinyGltfHelper::imageIndexForTexture(model, viewSamplerIndex);
     TextureViewAndSampler viewSampler = {
-        .view = m_textures.at(gltfTexture.source).textureView,
-        .sampler = m_samplers.at(gltfTexture.sampler)
+        .view = imageIndex ? m_textures.at(*imageIndex).textureView.handle() : Handle<TextureView_t>(),
+        .sampler = m_samplerCache.findOrCreate(m_device, TinyGltfHelper::samplerOptionsForTexture(model, viewSamplerIndex))
     };
     return viewSampler;
 }
@@ -606,13 +759,16 @@ void PbrMetallicRoughness::setupMaterial(const tinygltf::Model &model, uint32_t
     };
     uploadBufferData(uploadOptions);
 
-    // Create a bind group for this material
+    // Create a bind group for this material. Textures without an image are treated as missing.
+    auto textureWithImage = [this](int textureIndex) {
+        return (textureIndex != -1 && m_viewSamplers.at(textureIndex).view.isValid()) ? textureIndex : -1;
+    };
     // clang-format off
-    const int baseColorTextureIndex = material.pbrMetallicRoughness.baseColorTexture.index;
-    const int metallicRoughnessTextureIndex = material.pbrMetallicRoughness.metallicRoughnessTexture.index;
-    const int normalTextureIndex = material.normalTexture.index;
-    const int occlusionTextureIndex = material.occlusionTexture.index;
-    const int emissiveTextureIndex = material.emissiveTexture.index;
+    const int baseColorTextureIndex = textureWithImage(material.pbrMetallicRoughness.baseColorTexture.index);
+    const int metallicRoughnessTextureIndex = textureWithImage(material.pbrMetallicRoughness.metallicRoughnessTexture.index);
+    const int normalTextureIndex = textureWithImage(material.normalTexture.index);
+    const int occlusionTextureIndex = textureWithImage(material.occlusionTexture.index);
+    const int emissiveTextureIndex = textureWithImage(material.emissiveTexture.index);
     const BindGroupOptions bindGroupOptions = {
         .layout = m_materialBindGroupLayout,
         .resources = {{
@@ -659,130 +815,32 @@ void PbrMetallicRoughness::setupMaterial(const tinygltf::Model &model, uint32_t
 }
 
 void PbrMetallicRoughness::setupPrimitive(const tinygltf::Model &model,
+                               TinyGltfHelper::VertexLayoutAnalyzer &vertexLayouts,
                                const tinygltf::Primitive &primitive,
                                const PrimitiveKey &primitiveKey,
-                               PrimitiveInstances &primitiveInstances)
+                               PrimitiveInstances &primitiveInstances,
+                               std::vector<PendingPrimitive> &pendingPrimitives)
 {
-    std::vector<BufferAndOffset> buffers;
-    VertexOptions vertexOptions{};
-    uint32_t nextBinding{ 0 };
-    uint32_t currentBinding{ 0 };
-    uint32_t vertexCount{ 0 };
-
-    // Used to keep track of which bindings are used for each buffer view and
-    // which attributes use each vertex buffer layout
-    std::map<int, std::vector<uint32_t>> bufferViewToLayoutMap;
-    std::map<uint32_t, std::vector<uint32_t>> layoutToAttributeMap;
-
-    const std::unordered_map<std::string, uint32_t> shaderLocations{ { "POSITION", 0 }, { "NORMAL", 1 }, { "TEXCOORD_0", 2 } , { "TANGENT", 3 }};
-    bool hasTexCoords{ false };
-
-    // Iterate over each attribute in the primitive to build up a description of the
-    // vertex layout needed to create the pipeline.
-    for (const auto &attribute : primitive.attributes) {
-        const auto &accessor = model.accessors.at(attribute.second);
-        const uint32_t bufferIndex = accessor.bufferView;
-        const auto &bufferView = model.bufferViews.at(accessor.bufferView);
-
-        // Find the location for this attribute (if any)
-        auto locationIt = shaderLocations.find(attribute.first);
-        if (locationIt == shaderLocations.end())
-            continue;
-        const uint32_t location = locationIt->second;
-
-        // Note if the model contains texture coordinates so that we can select a suitable
-        // shader variant below.
-        if (location == 2)
-            hasTexCoords = true;
-
-        // Do we already have a binding for this buffer view?
-        bool foundCompatibleLayout = false;
-        const auto layoutIt = bufferViewToLayoutMap.find(accessor.bufferView);
-        if (layoutIt != bufferViewToLayoutMap.end()) {
-            // We already have one or more bindings (buffer layouts) for this buffer view. Are any
-            // of them compatible with this use of the buffer view? Are the offsets within limits?
-            const std::vector<uint32_t> &layoutIndices = layoutIt->second;
-
-            for (const auto &layoutIndex : layoutIndices) {
-                // Loop over attributes for this buffer layout
-                VertexBufferLayout &bufferLayout = vertexOptions.buffers[layoutIndex];
-                const std::vector<uint32_t> &attributeIndices = layoutToAttributeMap.at(layoutIndex);
-
-                for (const auto &attributeIndex : attributeIndices) {
-                    const DeviceSize attributeOffsetDelta = std::abs(
-                            int32_t(accessor.byteOffset) - int32_t(vertexOptions.attributes[attributeIndex].offset));
-                    if (attributeOffsetDelta < vertexOptions.buffers[layoutIndex].stride) {
-                        // Found a compatible vertex buffer layout
-                        foundCompatibleLayout = true;
-                        currentBinding = layoutIndex;
-
-                        // Track the minimum offset across all attributes that share a buffer layout
-                        BufferAndOffset &buffer = buffers.at(layoutIndex);
-                        buffer.offset = std::min(buffer.offset, static_cast<DeviceSize>(accessor.byteOffset));
-
-                        break;
-                    }
-                }
-            }
-        }
-
-        if (!foundCompatibleLayout) {
-            // Add a buffer layout and binding for this buffer view
-            const VertexBufferLayout bufferLayout = {
-                .binding = nextBinding,
-                .stride = bufferView.byteStride ? static_cast<uint32_t>(bufferView.byteStride)
-                                                : TinyGltfHelper::packedArrayStrideForAccessor(accessor)
-            };
-            vertexOptions.buffers.push_back(bufferLayout);
-
-            // Note that this buffer view maps to this binding
-            bufferViewToLayoutMap.insert({ accessor.bufferView, { nextBinding } });
-            layoutToAttributeMap.insert({ nextBinding, {} });
-
-            // Store the buffer and offset to be used with this buffer layout.
-            // NB: The index in the vector is equal to the buffer layout binding
-            buffers.push_back({ .buffer = m_buffers.at(bufferIndex), .offset = accessor.byteOffset });
+    const TinyGltfHelper::PrimitiveVertexLayout &vertexLayout = vertexLayouts.analyze(primitive);
+    const uint32_t vertexCount = vertexLayout.vertexCount;
 
-            currentBinding = nextBinding;
-            ++nextBinding;
-        }
-
-        // Set up the vertex attribute using the current binding
-        const VertexAttribute vertexAttribute = { .location = location,
-                                                  .binding = currentBinding,
-                                                  .format = TinyGltfHelper::formatForAccessor(accessor),
-                                                  .offset = accessor.byteOffset };
-        vertexOptions.attributes.push_back(vertexAttribute);
-
-        uint32_t attributeIndex = static_cast<uint32_t>(vertexOptions.attributes.size() - 1);
-        layoutToAttributeMap.at(currentBinding).push_back(attributeIndex);
-
-        vertexCount = accessor.count;
-    }
+    // Note if the model contains texture coordinates so that we can select a suitable
+    // shader variant below.
+    const bool hasTexCoords = vertexLayouts.hasLocation(vertexLayout.layoutId, 2);
 
-    // Normalize attribute offsets by subtracting off the buffer layout offset. By nature of the
-    // way in which we create the buffer layouts they are already sorted by binding number.
-    const uint32_t bufferLayoutCount = vertexOptions.buffers.size();
-    for (uint32_t bufferLayoutIndex = 0; bufferLayoutIndex < bufferLayoutCount; ++bufferLayoutIndex) {
-        const BufferAndOffset &buffer = buffers.at(bufferLayoutIndex);
-        const std::vector<uint32_t> &attributeIndices = layoutToAttributeMap.at(bufferLayoutIndex);
-        for (const auto &attributeIndex : attributeIndices)
-            vertexOptions.attributes[attributeIndex].offset -= buffer.offset;
-    }
-
-    // Sort the attributes to be in order of their location. This normalizes the data so that we can
-    // compare them to remove duplicates.
-    std::sort(vertexOptions.attributes.begin(), vertexOptions.attributes.end(),
-              [](const VertexAttribute &a, const VertexAttribute &b) { return a.location < b.location; });
+    // NB: The index in the vector is equal to the buffer layout binding
+    std::vector<BufferAndOffset> buffers;
+    buffers.reserve(vertexLayout.bindings.size());
+    for (const auto &binding : vertexLayout.bindings)
+        buffers.push_back({ .buffer = m_buffers.at(binding.bufferView), .offset = binding.offset });
 
-    // Find or create a pipeline that is compatible with the above vertex buffer layout and topology
+    // Describe a pipeline that is compatible with the above vertex buffer layout and topology
     const tinygltf::Material &gltfMaterial = model.materials.at(primitive.material);
     const TinyGltfHelper::AlphaMode alphaMode = TinyGltfHelper::alphaModeForMaterialAlphaMode(gltfMaterial.alphaMode);
-    Handle<GraphicsPipeline_t> pipelineHandle;
     // clang-format off
-    const GraphicsPipelineKey key = {
+    GraphicsPipelineKey key = {
         .topology = TinyGltfHelper::topologyForPrimitiveMode(primitive.mode),
-        .vertexOptions = std::move(vertexOptions),
+        .vertexOptions = vertexLayouts.vertexOptions(vertexLayout.layoutId),
         .alphaMode = alphaMode,
         .doubleSided = gltfMaterial.doubleSided,
         .shaderOptionsKey = {
@@ -791,60 +849,7 @@ void PbrMetallicRoughness::setupPrimitive(const tinygltf::Model &model,
         }
     };
     // clang-format on
-
-    const auto pipelineIt = m_pipelines.find(key);
-    if (pipelineIt == m_pipelines.end()) {
-        // Create a pipeline compatible with the above vertex buffer and attribute layout
-        // clang-format off
-        constexpr BlendOptions opaqueBlendOptions = {};
-        constexpr BlendOptions alphaBlendOptions = {
-            .blendingEnabled = true,
-            .color = {
-                .srcFactor = BlendFactor::SrcAlpha,
-                .dstFactor = BlendFactor::OneMinusSrcAlpha
-            }
-        };
-
-        const auto vertexShader = findOrCreateShaderModule(ShaderModuleKey{
-            .shaderOptionsKey = key.shaderOptionsKey,
-            .stage = ShaderStageFlagBits::VertexBit
-        });
-        const auto fragmentShader = findOrCreateShaderModule(ShaderModuleKey{
-            .shaderOptionsKey = key.shaderOptionsKey,
-            .stage = ShaderStageFlagBits::FragmentBit
-        });
-
-        GraphicsPipelineOptions pipelineOptions = {
-            .shaderStages = {
-                { .shaderModule = vertexShader, .stage = ShaderStageFlagBits::VertexBit },
-                { .shaderModule = fragmentShader, .stage = ShaderStageFlagBits::FragmentBit }
-            },
-            .layout = m_pipelineLayout,
-            .vertex = key.vertexOptions,
-            .renderTargets = {{
-                .format = m_swapchainFormat,
-                .blending = key.alphaMode == TinyGltfHelper::AlphaMode::Blend ? alphaBlendOptions : opaqueBlendOptions
-            }},
-            .depthStencil = {
-                .format = m_depthFormat,
-                .depthWritesEnabled = true,
-                .depthCompareOperation = CompareOperation::Less
-            },
-            .primitive = {
-                .topology = key.topology,
-                .cullMode = key.doubleSided ? CullModeFlagBits::None : CullModeFlagBits::BackBit
-            },
-            .multisample = {
-                .samples = m_samples.get()
-            }
-        };
-        // clang-format on
-        GraphicsPipeline pipeline = m_device.createGraphicsPipeline(pipelineOptions);
-        pipelineHandle = pipeline.handle();
-        m_pipelines.insert({ key, std::move(pipeline) });
-    } else {
-        pipelineHandle = pipelineIt->second.handle();
-    }
+    key.updateHash();
 
     // Determine draw type and cache enough information for render time
     const auto &instances = primitiveInstances.instanceData.at(primitiveKey);
@@ -867,9 +872,39 @@ void PbrMetallicRoughness::setupPrimitive(const tinygltf::Model &model,
         primitiveData.drawData = { .indexedDraw = indexedDraw };
     }
 
+    pendingPrimitives.push_back({
+            .key = std::move(key),
+            .material = m_materialBindGroups.at(primitive.material),
+            .primitiveData = std::move(primitiveData) });
+}
+
+bool PbrMetallicRoughness::addPrimitive(const PendingPrimitive &pendingPrimitive)
+{
+    // Opaque primitives can take part in the depth pre-pass. Alpha masked primitives need
+    // the fragment shader to discard so they, like blended ones, keep the regular depth test.
+    const bool depthPrePassCapable = pendingPrimitive.key.alphaMode == TinyGltfHelper::AlphaMode::Opaque;
+
+    // Unless compiling asynchronously all pipelines have been created up front so this
+    // only looks up the handles
+    Handle<GraphicsPipeline_t> pipelineHandle = findOrRequestPipeline(pendingPrimitive.key);
+    Handle<GraphicsPipeline_t> depthPrePassPipelineHandle;
+    Handle<GraphicsPipeline_t> depthEqualPipelineHandle;
+    if (depthPrePassCapable) {
+        depthPrePassPipelineHandle = findOrRequestPipeline(depthPrePassKeyFor(pendingPrimitive.key));
+        depthEqualPipelineHandle = findOrRequestPipeline(depthEqualKeyFor(pendingPrimitive.key));
+    }
+
+    // Until all of its pipelines are ready the primitive is drawn with the fallback
+    // pipeline and stays out of the depth pre-pass
+    const bool pipelinesReady = pipelineHandle.isValid() &&
+            (!depthPrePassCapable || (depthPrePassPipelineHandle.isValid() && depthEqualPipelineHandle.isValid()));
+    if (!pipelinesReady)
+        pipelineHandle = findOrCreateFallbackPipeline(pendingPrimitive.key);
+
     // Find the pipeline in our draw data or create a new one and append this material and
     // primitive to it (including all instances)
-    const Handle<BindGroup_t> material = m_materialBindGroups.at(primitive.material);
+    const Handle<BindGroup_t> material = pendingPrimitive.material;
+    const PrimitiveData &primitiveData = pendingPrimitive.primitiveData;
     auto pipelineMaterialIt = m_pipelinePrimitiveMap.find(pipelineHandle);
     if (pipelineMaterialIt == m_pipelinePrimitiveMap.end()) {
         const MaterialPrimitives materialPrimitive{
@@ -899,6 +934,408 @@ void PbrMetallicRoughness::setupPrimitive(const tinygltf::Model &model,
             materialPrimitivesIt->primitives.push_back(primitiveData);
         }
     }
+
+    if (pipelinesReady && depthPrePassCapable) {
+        m_depthPrePassPrimitiveMap[depthPrePassPipelineHandle].push_back(primitiveData);
+        m_depthEqualPipelineMap[pipelineHandle] = depthEqualPipelineHandle;
+        if (!m_overdrawPipelineMap.contains(depthEqualPipelineHandle))
+            m_overdrawPipelineMap[depthEqualPipelineHandle] = findOrCreateOverdrawPipeline(pendingPrimitive.key, pendingPrimitive.key.doubleSided,
+                                                                                           DepthPassMode::EqualAfterPrePass);
+    }
+
+    // The heat map culls like the pipeline the primitive is drawn with, the fallback
+    // pipelines draw both faces
+    if (!m_overdrawPipelineMap.contains(pipelineHandle))
+        m_overdrawPipelineMap[pipelineHandle] = findOrCreateOverdrawPipeline(pendingPrimitive.key, !pipelinesReady || pendingPrimitive.key.doubleSided,
+                                                                             DepthPassMode::Default);
+
+    return pipelinesReady;
+}
+
+void PbrMetallicRoughness::rebuildPrimitiveBuckets()
+{
+    m_pipelinePrimitiveMap.clear();
+    m_depthPrePassPrimitiveMap.clear();
+    m_depthEqualPipelineMap.clear();
+    m_overdrawPipelineMap.clear();
+    m_fallbackPrimitiveIndices.clear();
+
+    for (size_t primitiveIndex = 0; primitiveIndex < m_scenePrimitives.size(); ++primitiveIndex) {
+        if (!addPrimitive(m_scenePrimitives[primitiveIndex]))
+            m_fallbackPrimitiveIndices.push_back(primitiveIndex);
+    }
+
+    m_renderStats.pipelineCount = m_pipelines.size();
+    buildDrawList();
+}
+
+Handle<GraphicsPipeline_t> PbrMetallicRoughness::findOrCreatePipeline(const GraphicsPipelineKey &key)
+{
+    m_requestedPipelineKeys.insert(key);
+
+    const auto pipelineIt = m_pipelines.find(key);
+    if (pipelineIt != m_pipelines.end())
+        return pipelineIt->second.handle();
+
+    return createPipeline(key);
+}
+
+Handle<GraphicsPipeline_t> PbrMetallicRoughness::findOrRequestPipeline(const GraphicsPipelineKey &key)
+{
+    if (!m_asyncPipelineCompilation)
+        return findOrCreatePipeline(key);
+
+    m_requestedPipelineKeys.insert(key);
+
+    const auto pipelineIt = m_pipelines.find(key);
+    if (pipelineIt != m_pipelines.end())
+        return pipelineIt->second.handle();
+
+    // Queue the missing pipeline to the compiler, updatePendingPipelines() picks it up in a
+    // later frame. The options and shader modules are created here, only the pipeline itself
+    // is created by the compiler.
+    if (m_pendingPipelines.insert(key).second) {
+        m_pipelineCompilations.push_back(m_pipelineCompiler.submit([this, key, options = pipelineOptionsForKey(key)]() {
+            if (m_cancelPipelineCompilation)
+                return;
+
+            GraphicsPipeline pipeline;
+            {
+                std::lock_guard<std::mutex> deviceLock(m_deviceMutex);
+                pipeline = m_device.createGraphicsPipeline(options);
+            }
+            std::lock_guard<std::mutex> lock(m_compiledPipelinesMutex);
+            m_compiledPipelines.emplace_back(key, std::move(pipeline));
+        }));
+    }
+    return {};
+}
+
+Handle<GraphicsPipeline_t> PbrMetallicRoughness::findOrCreateFallbackPipeline(const GraphicsPipelineKey &key)
+{
+    // One fallback pipeline serves every primitive with the same topology and position and
+    // normal layout. There are only a few of those and their shaders are trivial so they are
+    // created right away.
+    GraphicsPipelineKey fallbackKey = {
+        .topology = key.topology,
+        .vertexOptions = key.vertexOptions,
+        .doubleSided = true,
+        .shaderOptionsKey = { .hasTexCoords = false }
+    };
+    auto &attributes = fallbackKey.vertexOptions.attributes;
+    attributes.erase(std::remove_if(attributes.begin(), attributes.end(),
+                                    [](const VertexAttribute &a) { return a.location > 1; }),
+                     attributes.end());
+    fallbackKey.updateHash();
+
+    const auto pipelineIt = m_fallbackPipelines.find(fallbackKey);
+    if (pipelineIt != m_fallbackPipelines.end())
+        return pipelineIt->second.handle();
+
+    // clang-format off
+    const GraphicsPipelineOptions pipelineOptions = {
+        .shaderStages = {
+            { .shaderModule = m_fallbackVertexShader, .stage = ShaderStageFlagBits::VertexBit },
+            { .shaderModule = m_fallbackFragmentShader, .stage = ShaderStageFlagBits::FragmentBit }
+        },
+        .layout = m_pipelineLayout,
+        .vertex = fallbackKey.vertexOptions,
+        .renderTargets = {{ .format = m_swapchainFormat }},
+        .depthStencil = {
+            .format = m_depthFormat,
+            .depthWritesEnabled = true,
+            .depthCompareOperation = CompareOperation::Less
+        },
+        .primitive = {
+            .topology = fallbackKey.topology,
+            .cullMode = CullModeFlagBits::None
+        },
+        .multisample = {
+            .samples = m_samples.get()
+        }
+    };
+    // clang-format on
+
+    GraphicsPipeline pipeline = m_device.createGraphicsPipeline(pipelineOptions);
+    const auto pipelineHandle = pipeline.handle();
+    m_fallbackPipelines.insert({ std::move(fallbackKey), std::move(pipeline) });
+    return pipelineHandle;
+}
+
+Handle<GraphicsPipeline_t> PbrMetallicRoughness::findOrCreateOverdrawPipeline(const GraphicsPipelineKey &key, bool doubleSided,
+                                                                              DepthPassMode depthPassMode)
+{
+    // Like the fallback pipelines these only depend on the topology, the position layout
+    // and the fixed function state, so a few of them cover the whole scene
+    GraphicsPipelineKey overdrawKey = {
+        .topology = key.topology,
+        .vertexOptions = key.vertexOptions,
+        .doubleSided = doubleSided,
+        .shaderOptionsKey = { .hasTexCoords = false },
+        .depthPassMode = depthPassMode
+    };
+    auto &attributes = overdrawKey.vertexOptions.attributes;
+    attributes.erase(std::remove_if(attributes.begin(), attributes.end(),
+                                    [](const VertexAttribute &a) { return a.location != 0; }),
+                     attributes.end());
+    overdrawKey.updateHash();
+
+    const auto pipelineIt = m_overdrawPipelines.find(overdrawKey);
+    if (pipelineIt != m_overdrawPipelines.end())
+        return pipelineIt->second.handle();
+
+    const bool depthEqual = depthPassMode == DepthPassMode::EqualAfterPrePass;
+
+    // clang-format off
+    const GraphicsPipelineOptions pipelineOptions = {
+        .shaderStages = {
+            { .shaderModule = m_depthPrePassShader, .stage = ShaderStageFlagBits::VertexBit },
+            { .shaderModule = m_overdrawFragmentShader, .stage = ShaderStageFlagBits::FragmentBit }
+        },
+        .layout = m_pipelineLayout,
+        .vertex = overdrawKey.vertexOptions,
+        .renderTargets = {{
+            .format = m_swapchainFormat,
+            .blending = {
+                .blendingEnabled = true,
+                .color = {
+                    .srcFactor = BlendFactor::One,
+                    .dstFactor = BlendFactor::One
+                }
+            }
+        }},
+        .depthStencil = {
+            .format = m_depthFormat,
+            .depthWritesEnabled = !depthEqual,
+            .depthCompareOperation = depthEqual ? CompareOperation::Equal : CompareOperation::Less
+        },
+        .primitive = {
+            .topology = overdrawKey.topology,
+            .cullMode = doubleSided ? CullModeFlagBits::None : CullModeFlagBits::BackBit
+        },
+        .multisample = {
+            .samples = m_samples.get()
+        }
+    };
+    // clang-format on
+
+    GraphicsPipeline pipeline = m_device.createGraphicsPipeline(pipelineOptions);
+    const auto pipelineHandle = pipeline.handle();
+    m_overdrawPipelines.insert({ std::move(overdrawKey), std::move(pipeline) });
+    return pipelineHandle;
+}
+
+bool PbrMetallicRoughness::pipelinesReady(const GraphicsPipelineKey &key) const
+{
+    if (!m_pipelines.contains(key))
+        return false;
+    if (key.alphaMode != TinyGltfHelper::AlphaMode::Opaque)
+        return true;
+    return m_pipelines.contains(depthPrePassKeyFor(key)) && m_pipelines.contains(depthEqualKeyFor(key));
+}
+
+void PbrMetallicRoughness::updatePendingPipelines()
+{
+    // Take over the pipelines the compiler published since the last frame
+    std::vector<std::pair<GraphicsPipelineKey, GraphicsPipeline>> compiledPipelines;
+    {
+        std::lock_guard<std::mutex> lock(m_compiledPipelinesMutex);
+        compiledPipelines.swap(m_compiledPipelines);
+    }
+    if (compiledPipelines.empty())
+        return;
+
+    for (auto &[key, pipeline] : compiledPipelines) {
+        m_pendingPipelines.erase(key);
+        m_pipelines.insert({ std::move(key), std::move(pipeline) });
+    }
+    std::erase_if(m_pipelineCompilations, [](const std::future<void> &compilation) {
+        return compilation.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    });
+
+    // Swap the primitives whose pipelines are now all available over to them. This runs
+    // before any recording of the frame so every frame sees a consistent set of draws.
+    const bool primitivesReady = std::any_of(m_fallbackPrimitiveIndices.begin(), m_fallbackPrimitiveIndices.end(),
+                                             [this](size_t primitiveIndex) {
+                                                 return pipelinesReady(m_scenePrimitives[primitiveIndex].key);
+                                             });
+    if (!primitivesReady)
+        return;
+
+    // The cached command buffers reference the fallback pipelines. Rebuilding at most once
+    // per frame and retiring the old command buffers never stalls the GPU.
+    invalidateCachedCommandBuffers();
+    rebuildPrimitiveBuckets();
+    SPDLOG_INFO("Swapped primitives to their compiled pipelines, {} pipelines pending, {} primitives left on the fallback",
+                m_pendingPipelines.size(), m_fallbackPrimitiveIndices.size());
+}
+
+Handle<GraphicsPipeline_t> PbrMetallicRoughness::createPipeline(const GraphicsPipelineKey &key)
+{
+    GraphicsPipeline pipeline = m_device.createGraphicsPipeline(pipelineOptionsForKey(key));
+    const auto pipelineHandle = pipeline.handle();
+    m_pipelines.insert({ key, std::move(pipeline) });
+    return pipelineHandle;
+}
+
+void PbrMetallicRoughness::createPipelines(const std::vector<GraphicsPipelineKey> &keys)
+{
+    // Only compile each missing pipeline once
+    std::vector<const GraphicsPipelineKey *> missingKeys;
+    std::unordered_set<GraphicsPipelineKey> seenKeys;
+    for (const auto &key : keys) {
+        if (!m_pipelines.contains(key) && seenKeys.insert(key).second)
+            missingKeys.push_back(&key);
+    }
+    if (missingKeys.empty())
+        return;
+
+    const auto startTime = std::chrono::steady_clock::now();
+
+    // The pipelines are created one after the other on this thread. KDGpu devices are not
+    // thread safe, every createGraphicsPipeline call would have to hold the device lock, so
+    // spreading them over worker threads would not create them any faster. Collecting the
+    // keys first creates each pipeline once however many primitives share it.
+    for (const GraphicsPipelineKey *key : missingKeys)
+        createPipeline(*key);
+
+    const auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime);
+    SPDLOG_INFO("Created {} pipelines in {:.1f} ms", missingKeys.size(), elapsed.count());
+}
+
+GraphicsPipelineOptions PbrMetallicRoughness::pipelineOptionsForKey(const GraphicsPipelineKey &key)
+{
+    // Create a pipeline compatible with the vertex buffer and attribute layout of the key
+    // clang-format off
+    constexpr BlendOptions opaqueBlendOptions = {};
+    constexpr BlendOptions alphaBlendOptions = {
+        .blendingEnabled = true,
+        .color = {
+            .srcFactor = BlendFactor::SrcAlpha,
+            .dstFactor = BlendFactor::OneMinusSrcAlpha
+        }
+    };
+    // clang-format on
+
+    const bool depthPrePass = key.depthPassMode == DepthPassMode::DepthPrePass;
+    const bool depthEqual = key.depthPassMode == DepthPassMode::EqualAfterPrePass;
+
+    std::vector<ShaderStage> shaderStages;
+    if (depthPrePass) {
+        shaderStages = { { .shaderModule = m_depthPrePassShader, .stage = ShaderStageFlagBits::VertexBit } };
+    } else {
+        const auto vertexShader = findOrCreateShaderModule(shaderModuleKeyFor(key.shaderOptionsKey, ShaderStageFlagBits::VertexBit));
+        const ShaderModuleKey fragmentShaderKey = shaderModuleKeyFor(key.shaderOptionsKey, ShaderStageFlagBits::FragmentBit);
+        const auto fragmentShader = findOrCreateShaderModule(fragmentShaderKey);
+        shaderStages = {
+            { .shaderModule = vertexShader, .stage = ShaderStageFlagBits::VertexBit },
+            { .shaderModule = fragmentShader, .stage = ShaderStageFlagBits::FragmentBit }
+        };
+
+        // Must match the constant_ids in pbr_metallic_roughness.frag
+        if (fragmentShaderKey.specializedOptions) {
+            shaderStages[1].specializationConstants = {
+                { 0, key.shaderOptionsKey.hasTexCoords },
+                { 1, key.shaderOptionsKey.enableAlphaCutoff }
+            };
+        }
+    }
+
+    // clang-format off
+    GraphicsPipelineOptions pipelineOptions = {
+        .shaderStages = shaderStages,
+        .layout = m_pipelineLayout,
+        .vertex = key.vertexOptions,
+        .renderTargets = {{
+            .format = m_swapchainFormat,
+            .blending = key.alphaMode == TinyGltfHelper::AlphaMode::Blend ? alphaBlendOptions : opaqueBlendOptions
+        }},
+        .depthStencil = {
+            .format = m_depthFormat,
+            .depthWritesEnabled = !depthEqual,
+            .depthCompareOperation = depthEqual ? CompareOperation::Equal : CompareOperation::Less
+        },
+        .primitive = {
+            .topology = key.topology,
+            .cullMode = key.doubleSided ? CullModeFlagBits::None : CullModeFlagBits::BackBit
+        },
+        .multisample = {
+            .samples = m_samples.get()
+        }
+    };
+    // clang-format on
+
+    // The pre-pass shares the render pass (and so the color attachment) with the shading
+    // pass but must leave the color untouched.
+    if (depthPrePass)
+        pipelineOptions.renderTargets[0].writeMask = ColorComponentFlags();
+
+    return pipelineOptions;
+}
+
+void PbrMetallicRoughness::loadPipelineCache()
+{
+    using namespace kdgpu_ext::graphics::pipeline_cache;
+
+    // The file is only valid for the device and driver that wrote it
+    const PipelineCacheFile cacheFile(PipelineCacheFile::defaultPath(PipelineCacheName), PipelineCacheFormatVersion);
+    const auto records = cacheFile.load(DeviceIdentity::fromAdapter(*m_device.adapter()));
+    if (!records)
+        return;
+
+    BinaryReader reader(*records);
+    uint32_t shaderModuleKeyCount = 0;
+    if (!reader.read(shaderModuleKeyCount))
+        return;
+    for (uint32_t keyIndex = 0; keyIndex < shaderModuleKeyCount; ++keyIndex) {
+        ShaderModuleKey key;
+        if (!readShaderModuleKey(reader, key))
+            return;
+        findOrCreateShaderModule(key);
+    }
+
+    uint32_t pipelineKeyCount = 0;
+    if (!reader.read(pipelineKeyCount))
+        return;
+    std::vector<GraphicsPipelineKey> pipelineKeys;
+    for (uint32_t keyIndex = 0; keyIndex < pipelineKeyCount; ++keyIndex) {
+        GraphicsPipelineKey key;
+        if (!readPipelineKey(reader, key))
+            break;
+        pipelineKeys.push_back(std::move(key));
+    }
+    createPipelines(pipelineKeys);
+    SPDLOG_INFO("Pre-created {} shader modules and {} pipelines from {}",
+                m_shaderModules.size(), m_pipelines.size(), cacheFile.path().string());
+}
+
+void PbrMetallicRoughness::savePipelineCache()
+{
+    using namespace kdgpu_ext::graphics::pipeline_cache;
+
+    if (m_requestedPipelineKeys.empty())
+        return;
+
+    // Only keep the shader modules used by the requested pipelines
+    std::unordered_set<ShaderModuleKey> shaderModuleKeys;
+    for (const auto &key : m_requestedPipelineKeys) {
+        if (key.depthPassMode == DepthPassMode::DepthPrePass)
+            continue;
+        shaderModuleKeys.insert(shaderModuleKeyFor(key.shaderOptionsKey, ShaderStageFlagBits::VertexBit));
+        shaderModuleKeys.insert(shaderModuleKeyFor(key.shaderOptionsKey, ShaderStageFlagBits::FragmentBit));
+    }
+
+    BinaryWriter writer;
+    writer.write(static_cast<uint32_t>(shaderModuleKeys.size()));
+    for (const auto &key : shaderModuleKeys)
+        writeShaderModuleKey(writer, key);
+    writer.write(static_cast<uint32_t>(m_requestedPipelineKeys.size()));
+    for (const auto &key : m_requestedPipelineKeys)
+        writePipelineKey(writer, key);
+
+    const PipelineCacheFile cacheFile(PipelineCacheFile::defaultPath(PipelineCacheName), PipelineCacheFormatVersion);
+    if (!cacheFile.save(DeviceIdentity::fromAdapter(*m_device.adapter()), writer.data()))
+        SPDLOG_WARN("Failed to write pipeline cache {}", cacheFile.path().string());
 }
 
 Handle<ShaderModule_t> PbrMetallicRoughness::findOrCreateShaderModule(const ShaderModuleKey &key)
@@ -907,42 +1344,26 @@ Handle<ShaderModule_t> PbrMetallicRoughness::findOrCreateShaderModule(const Shad
     if (shaderModuleIt != m_shaderModules.end()) {
         return shaderModuleIt->second.handle();
     } else {
-        const auto shaderPath = ExampleUtility::assetPath() + "/shaders/07_pbr_metallic_roughness/" + shaderFilename(key.shaderOptionsKey, key.stage);
-        ShaderModule shader = m_device.createShaderModule(KDGpuExample::readShaderFile(shaderPath));
+        ShaderModule shader;
+        if (key.specializedOptions) {
+            shader = m_device.createShaderModule(kdgpu_ext::graphics::shader::loadShader("shaders/07_pbr_metallic_roughness/pbr_metallic_roughness_specialized.frag.spv"));
+        } else {
+            // The SPIR-V of all variants is embedded in the executable
+            const std::span<const uint32_t> spirv = shaderVariant(key.shaderOptionsKey, key.stage);
+            shader = m_device.createShaderModule(std::vector<uint32_t>(spirv.begin(), spirv.end()));
+        }
         const auto shaderHandle = shader.handle();
         m_shaderModules.insert({ key, std::move(shader) });
         return shaderHandle;
     }
 }
 
-// TODO: Should we make this general and use the configuration file used to generate the shader
-// at configure/build time?
-std::string PbrMetallicRoughness::shaderFilename(const PipelineShaderOptionsKey &key, ShaderStageFlagBits stage)
+ShaderModuleKey PbrMetallicRoughness::shaderModuleKeyFor(const PipelineShaderOptionsKey &optionsKey, ShaderStageFlagBits stage) const
 {
-    std::string name = "pbr_metallic_roughness";
-    switch (stage) {
-    case ShaderStageFlagBits::VertexBit: {
-        if (key.hasTexCoords)
-            name += "_texcoord_0_enabled";
-        name += ".vert.spv";
-        break;
-    }
-
-    case ShaderStageFlagBits::FragmentBit: {
-        if (key.hasTexCoords)
-            name += "_texcoord_0_enabled";
-        if (key.enableAlphaCutoff)
-            name += "_alpha_cutoff_enabled";
-        name += ".frag.spv";
-        break;
-    }
-
-    default: {
-        SPDLOG_CRITICAL("Unhandled shader type");
-        return {};
-    }
-    }
-    return name;
+    // The vertex shader variants differ in their vertex inputs which cannot be specialized
+    if (m_useSpecializationConstants && stage == ShaderStageFlagBits::FragmentBit)
+        return { .stage = stage, .specializedOptions = true };
+    return { .shaderOptionsKey = optionsKey, .stage = stage };
 }
 
 InstancedDraw PbrMetallicRoughness::setupPrimitiveInstances(const PrimitiveKey &primitiveKey,
@@ -1019,6 +1440,17 @@ void PbrMetallicRoughness::setupMeshNode(const tinygltf::Model &model,
 
 void PbrMetallicRoughness::cleanupScene()
 {
+    // Skip the queued pipelines and wait for the one being created, it needs the device lock
+    m_frameDeviceLock = {};
+    m_cancelPipelineCompilation = true;
+    for (auto &compilation : m_pipelineCompilations)
+        compilation.wait();
+    m_pipelineCompilations.clear();
+    m_compiledPipelines.clear();
+
+    std::lock_guard<std::mutex> deviceLock(m_deviceMutex);
+    savePipelineCache();
+
     m_msaaTextureView = {};
     m_msaaTexture = {};
     m_opaqueWhite = {};
@@ -1035,18 +1467,37 @@ void PbrMetallicRoughness::cleanupScene()
     m_lutGGX = {};
     m_instanceTransformsBindGroup = {};
     m_instanceTransformsBuffer = {};
+    m_depthPrePassPrimitiveMap.clear();
+    m_depthEqualPipelineMap.clear();
+    m_overdrawPipelineMap.clear();
+    m_overdrawPipelines.clear();
+    m_overdrawFragmentShader = {};
+
+    m_pendingPipelines.clear();
+    m_fallbackPipelines.clear();
+    m_fallbackVertexShader = {};
+    m_fallbackFragmentShader = {};
+    m_scenePrimitives.clear();
+    m_fallbackPrimitiveIndices.clear();
     m_pipelines.clear();
+    m_requestedPipelineKeys.clear();
     m_shaderModules.clear();
+    m_depthPrePassShader = {};
     m_materialBindGroupLayout = {};
     m_nodeBindGroupLayout = {};
     m_cameraBindGroupLayout = {};
     m_environmentLightBindGroupLayout = {};
     m_pipelineLayout = {};
     m_viewSamplers.clear();
-    m_samplers.clear();
+    m_samplerCache.clear();
     m_textures.clear();
     m_buffers.clear();
-    m_commandBuffer = {};
+    m_drawList.clear();
+    m_pipelinePrimitiveMap.clear();
+    m_commandBuffers.clear();
+    m_cachedSceneCommandBuffers.clear();
+    m_cachedSceneRenderStats.clear();
+    m_retiredCommandBuffers.clear();
 }
 
 void PbrMetallicRoughness::createRenderTarget()
@@ -1067,13 +1518,34 @@ void PbrMetallicRoughness::createRenderTarget()
 
 void PbrMetallicRoughness::resize()
 {
+    std::lock_guard<std::mutex> deviceLock(m_deviceMutex);
     createRenderTarget();
     m_opaquePassOptions.colorAttachments[0].view = m_msaaTextureView;
     m_opaquePassOptions.depthStencilAttachment.view = m_depthTextureView;
+    invalidateCachedCommandBuffers();
+}
+
+void PbrMetallicRoughness::invalidateCachedCommandBuffers()
+{
+    if (m_cachedSceneCommandBuffers.empty())
+        return;
+
+    // The cached command buffers may still be executing, keep them alive until they are done
+    for (auto &commandBuffer : m_cachedSceneCommandBuffers) {
+        if (commandBuffer.isValid())
+            m_retiredCommandBuffers.retire(std::move(commandBuffer));
+    }
+    m_cachedSceneCommandBuffers.clear();
+    m_cachedSceneRenderStats.clear();
 }
 
 void PbrMetallicRoughness::updateScene()
 {
+    // Keeps the pipeline compiler off the device for the whole frame
+    m_frameDeviceLock = std::unique_lock<std::mutex>(m_deviceMutex);
+    m_retiredCommandBuffers.nextFrame();
+    updatePendingPipelines();
+
     m_camera.update();
 
     auto cameraBufferData = static_cast<float *>(m_cameraBuffer.map());
@@ -1087,77 +1559,301 @@ void PbrMetallicRoughness::updateScene()
     if (timer > 1000.0) {
         s_lastFpsTimestamp = frameEndTime;
 
-        SPDLOG_INFO("pipelines = {}, setPipelineCount = {}, setVertexBufferCount = {}, setBindGroupCount = {}, drawCount = {}, verts = {}",
-                    m_renderStats.pipelineCount, m_renderStats.setPipelineCount, m_renderStats.setVertexBufferCount,
+        SPDLOG_INFO("pipelines = {}, shaderModules = {}, setPipelineCount = {}, setVertexBufferCount = {}, setBindGroupCount = {}, drawCount = {}, verts = {}",
+                    m_renderStats.pipelineCount, m_shaderModules.size(), m_renderStats.setPipelineCount, m_renderStats.setVertexBufferCount,
                     m_renderStats.setBindGroupCount, m_renderStats.drawCount, m_renderStats.vertexCount);
+        SPDLOG_INFO("cachedCommandBuffers = {}, recordedCommandBufferCount = {}",
+                    m_useCachedCommandBuffers, m_renderStats.recordedCommandBufferCount);
+        m_renderStats.recordedCommandBufferCount = 0;
+        SPDLOG_INFO("depthPrePass = {}, prePassDrawCount = {}, prePassVerts = {}, equalDrawCount = {}, equalVerts = {}, lessDrawCount = {}, lessVerts = {}",
+                    m_depthPrePassEnabled, m_renderStats.depthPrePassDrawCount, m_renderStats.depthPrePassVertexCount,
+                    m_renderStats.depthEqualDrawCount, m_renderStats.depthEqualVertexCount,
+                    m_renderStats.depthLessDrawCount, m_renderStats.depthLessVertexCount);
     }
 
+    // Keep the counters of the last complete frame around for the overlay
+    m_lastFrameRenderStats = m_renderStats;
+
     m_renderStats.setPipelineCount = 0;
     m_renderStats.setVertexBufferCount = 0;
     m_renderStats.setBindGroupCount = 0;
     m_renderStats.drawCount = 0;
     m_renderStats.vertexCount = 0;
+    m_renderStats.depthPrePassDrawCount = 0;
+    m_renderStats.depthPrePassVertexCount = 0;
+    m_renderStats.depthEqualDrawCount = 0;
+    m_renderStats.depthEqualVertexCount = 0;
+    m_renderStats.depthLessDrawCount = 0;
+    m_renderStats.depthLessVertexCount = 0;
 }
 
-void PbrMetallicRoughness::render()
+void PbrMetallicRoughness::drawControls(ImGuiContext *ctx)
 {
-    auto commandRecorder = m_device.createCommandRecorder();
-    m_opaquePassOptions.colorAttachments[0].resolveView = m_swapchainViews.at(m_currentSwapchainImageIndex);
-    auto opaquePass = commandRecorder.beginRenderPass(m_opaquePassOptions);
-
-    // Bind the frame (camera bind group) which does not change during the frame
-    opaquePass.setBindGroup(0, m_cameraBindGroup, m_pipelineLayout);
-    opaquePass.setBindGroup(1, m_instanceTransformsBindGroup, m_pipelineLayout);
-    opaquePass.setBindGroup(3, m_environmentLightBindGroup, m_pipelineLayout);
-    m_renderStats.setBindGroupCount+= 3;
+    ImGui::SetCurrentContext(ctx);
+    ImGui::SetNextWindowPos(ImVec2(10, 170), ImGuiCond_FirstUseEver);
+    ImGui::SetNextWindowSize(ImVec2(0, 0), ImGuiCond_FirstUseEver);
+    ImGui::Begin(
+            "Renderer Options",
+            nullptr,
+            ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoResize);
+
+    ImGui::Checkbox("Cached command buffers", &m_useCachedCommandBuffers);
+    if (m_useCachedCommandBuffers)
+        ImGui::Text("Cached scene command buffers: %zu", m_cachedSceneCommandBuffers.size());
+
+    ImGui::Checkbox("Enable depth pre-pass", &m_depthPrePassEnabled);
+    ImGui::Checkbox("Overdraw heat map", &m_overdrawHeatMap);
+    if (m_overdrawHeatMap)
+        ImGui::Text("Brightness: fragments shaded per pixel, white at 8 or more");
+
+    if (m_asyncPipelineCompilation)
+        ImGui::Text("Pipelines compiling: %zu, primitives on fallback: %zu", m_pendingPipelines.size(), m_fallbackPrimitiveIndices.size());
+
+    const RenderStats &stats = m_lastFrameRenderStats;
+    ImGui::Text("Pre-pass: %u draws, %u vertices", stats.depthPrePassDrawCount, stats.depthPrePassVertexCount);
+    ImGui::Text("Shaded with EQUAL depth test: %u draws, %u vertices", stats.depthEqualDrawCount, stats.depthEqualVertexCount);
+    ImGui::Text("Shaded with LESS depth test: %u draws, %u vertices", stats.depthLessDrawCount, stats.depthLessVertexCount);
+    const uint32_t shadedVertexCount = stats.depthEqualVertexCount + stats.depthLessVertexCount;
+    if (shadedVertexCount > 0)
+        ImGui::Text("Vertices shaded with EQUAL depth test: %.1f%%", 100.0f * float(stats.depthEqualVertexCount) / float(shadedVertexCount));
+
+    ImGui::End();
+}
 
+void PbrMetallicRoughness::buildDrawList()
+{
+    // Flatten the pipeline -> material -> primitive hierarchy in its sorted order, so that
+    // recording only has to compare each draw with the previous one. The draws are recorded
+    // on the render thread, into the one command buffer of the scene pass.
+    m_drawList.clear();
     for (const auto &[pipeline, materialPrimitives] : m_pipelinePrimitiveMap) {
-        opaquePass.setPipeline(pipeline);
-        ++m_renderStats.setPipelineCount;
+        const auto depthEqualIt = m_depthEqualPipelineMap.find(pipeline);
+        const Handle<GraphicsPipeline_t> depthEqualPipeline =
+                depthEqualIt != m_depthEqualPipelineMap.end() ? depthEqualIt->second : Handle<GraphicsPipeline_t>();
+        const Handle<GraphicsPipeline_t> overdrawPipeline = m_overdrawPipelineMap.at(pipeline);
+        const Handle<GraphicsPipeline_t> overdrawDepthEqualPipeline =
+                depthEqualPipeline.isValid() ? m_overdrawPipelineMap.at(depthEqualPipeline) : Handle<GraphicsPipeline_t>();
 
-        // Iterate over each material primitives using this pipeline
         for (const auto &materialPrimitiveData : materialPrimitives) {
-            opaquePass.setBindGroup(2, materialPrimitiveData.material);
-            ++m_renderStats.setBindGroupCount;
-
-            // Iterate over each primitive using this pipeline
             for (const auto &primitiveData : materialPrimitiveData.primitives) {
+                m_drawList.push_back(DrawItem{
+                        .pipeline = pipeline,
+                        .depthEqualPipeline = depthEqualPipeline,
+                        .overdrawPipeline = overdrawPipeline,
+                        .overdrawDepthEqualPipeline = overdrawDepthEqualPipeline,
+                        .material = materialPrimitiveData.material,
+                        .primitive = &primitiveData });
+            }
+        }
+    }
+}
 
-                // Bind the vertex buffers for this primitive
-                uint32_t vertexBufferBinding = 0;
-                for (const auto &vertexBuffer : primitiveData.vertexBuffers) {
-                    opaquePass.setVertexBuffer(vertexBufferBinding, vertexBuffer.buffer, vertexBuffer.offset);
-                    ++m_renderStats.setVertexBufferCount;
-                    ++vertexBufferBinding;
-                }
+uint32_t PbrMetallicRoughness::recordPrimitive(RenderPassCommandRecorder &pass, const PrimitiveData &primitiveData, RenderStats &stats)
+{
+    // Bind the vertex buffers for this primitive
+    uint32_t vertexBufferBinding = 0;
+    for (const auto &vertexBuffer : primitiveData.vertexBuffers) {
+        pass.setVertexBuffer(vertexBufferBinding, vertexBuffer.buffer, vertexBuffer.offset);
+        ++stats.setVertexBufferCount;
+        ++vertexBufferBinding;
+    }
 
-                // Render every instance of this primitive in a single call.
-                if (primitiveData.drawType == PrimitiveData::DrawType::NonIndexed) {
-                    opaquePass.draw(DrawCommand{
-                            .vertexCount = primitiveData.drawData.vertexCount,
-                            .instanceCount = primitiveData.instances.instanceCount,
-                            .firstInstance = primitiveData.instances.firstInstance });
-                    m_renderStats.vertexCount += primitiveData.drawData.vertexCount * primitiveData.instances.instanceCount;
-                } else {
-                    const IndexedDraw &indexedDraw = primitiveData.drawData.indexedDraw;
-                    opaquePass.setIndexBuffer(indexedDraw.indexBuffer, indexedDraw.offset, indexedDraw.indexType);
-                    opaquePass.drawIndexed(DrawIndexedCommand{
-                            .indexCount = indexedDraw.indexCount,
-                            .instanceCount = primitiveData.instances.instanceCount,
-                            .firstInstance = primitiveData.instances.firstInstance });
-                    m_renderStats.vertexCount += indexedDraw.indexCount * primitiveData.instances.instanceCount;
-                }
-                ++m_renderStats.drawCount;
-            }
+    // Render every instance of this primitive in a single call.
+    uint32_t drawVertexCount = 0;
+    if (primitiveData.drawType == PrimitiveData::DrawType::NonIndexed) {
+        pass.draw(DrawCommand{
+                .vertexCount = primitiveData.drawData.vertexCount,
+                .instanceCount = primitiveData.instances.instanceCount,
+                .firstInstance = primitiveData.instances.firstInstance });
+        drawVertexCount = primitiveData.drawData.vertexCount * primitiveData.instances.instanceCount;
+    } else {
+        const IndexedDraw &indexedDraw = primitiveData.drawData.indexedDraw;
+        pass.setIndexBuffer(indexedDraw.indexBuffer, indexedDraw.offset, indexedDraw.indexType);
+        pass.drawIndexed(DrawIndexedCommand{
+                .indexCount = indexedDraw.indexCount,
+                .instanceCount = primitiveData.instances.instanceCount,
+                .firstInstance = primitiveData.instances.firstInstance });
+        drawVertexCount = indexedDraw.indexCount * primitiveData.instances.instanceCount;
+    }
+    stats.vertexCount += drawVertexCount;
+    ++stats.drawCount;
+    return drawVertexCount;
+}
+
+void PbrMetallicRoughness::bindFrameBindGroups(RenderPassCommandRecorder &pass, RenderStats &stats)
+{
+    // Bind the frame (camera bind group) which does not change during the frame
+    pass.setBindGroup(0, m_cameraBindGroup, m_pipelineLayout);
+    pass.setBindGroup(1, m_instanceTransformsBindGroup, m_pipelineLayout);
+    pass.setBindGroup(3, m_environmentLightBindGroup, m_pipelineLayout);
+    stats.setBindGroupCount += 3;
+}
+
+void PbrMetallicRoughness::recordDepthPrePass(RenderPassCommandRecorder &pass, RenderStats &stats)
+{
+    // The camera and instance transform bind groups are already bound and the pre-pass
+    // pipelines share the pipeline layout so they remain valid here.
+    for (const auto &[pipeline, primitives] : m_depthPrePassPrimitiveMap) {
+        pass.setPipeline(pipeline);
+        ++stats.setPipelineCount;
+
+        for (const auto &primitiveData : primitives) {
+            const uint32_t drawVertexCount = recordPrimitive(pass, primitiveData, stats);
+            ++stats.depthPrePassDrawCount;
+            stats.depthPrePassVertexCount += drawVertexCount;
         }
     }
+}
+
+void PbrMetallicRoughness::recordDraws(RenderPassCommandRecorder &pass, bool depthPrePassEnabled, bool overdrawHeatMap, RenderStats &stats)
+{
+    // The draw list is sorted by pipeline and material so we only need to switch them
+    // when they differ from the previous draw
+    Handle<GraphicsPipeline_t> currentPipeline;
+    Handle<BindGroup_t> currentMaterial;
+
+    for (const DrawItem &item : m_drawList) {
+
+        // Switch to the EQUAL depth test variant when the pre-pass provided the depth
+        const bool depthEqual = depthPrePassEnabled && item.depthEqualPipeline.isValid();
+        Handle<GraphicsPipeline_t> pipeline = depthEqual ? item.depthEqualPipeline : item.pipeline;
+        if (overdrawHeatMap)
+            pipeline = depthEqual ? item.overdrawDepthEqualPipeline : item.overdrawPipeline;
+        if (pipeline != currentPipeline) {
+            pass.setPipeline(pipeline);
+            ++stats.setPipelineCount;
+            currentPipeline = pipeline;
+            currentMaterial = {};
+        }
+
+        if (item.material != currentMaterial) {
+            pass.setBindGroup(2, item.material);
+            ++stats.setBindGroupCount;
+            currentMaterial = item.material;
+        }
+
+        const uint32_t drawVertexCount = recordPrimitive(pass, *item.primitive, stats);
+        if (depthEqual) {
+            ++stats.depthEqualDrawCount;
+            stats.depthEqualVertexCount += drawVertexCount;
+        } else {
+            ++stats.depthLessDrawCount;
+            stats.depthLessVertexCount += drawVertexCount;
+        }
+    }
+}
+
+RenderPassCommandRecorderOptions PbrMetallicRoughness::headPassOptions() const
+{
+    // Clears the attachments but leaves the MSAA color target unresolved for later passes
+    RenderPassCommandRecorderOptions options = m_opaquePassOptions;
+    options.colorAttachments[0].resolveView = {};
+    options.colorAttachments[0].finalLayout = TextureLayout::ColorAttachmentOptimal;
+    return options;
+}
+
+RenderPassCommandRecorderOptions PbrMetallicRoughness::loadPassOptions() const
+{
+    // Continues rendering into the attachments written by a previous pass
+    RenderPassCommandRecorderOptions options = headPassOptions();
+    options.colorAttachments[0].loadOperation = AttachmentLoadOperation::Load;
+    options.colorAttachments[0].initialLayout = TextureLayout::ColorAttachmentOptimal;
+    options.depthStencilAttachment.depthLoadOperation = AttachmentLoadOperation::Load;
+    options.depthStencilAttachment.initialLayout = TextureLayout::DepthStencilAttachmentOptimal;
+    return options;
+}
+
+CommandBuffer PbrMetallicRoughness::recordTailCommandBuffer(const RenderPassCommandRecorderOptions &loadOptions)
+{
+    // ImGui needs the main thread, then resolve into the swapchain image
+    RenderPassCommandRecorderOptions tailPassOptions = loadOptions;
+    tailPassOptions.colorAttachments[0].resolveView = m_swapchainViews.at(m_currentSwapchainImageIndex);
+    tailPassOptions.colorAttachments[0].finalLayout = TextureLayout::PresentSrc;
+
+    auto commandRecorder = m_device.createCommandRecorder();
+    auto tailPass = commandRecorder.beginRenderPass(tailPassOptions);
+    renderImGuiOverlay(&tailPass);
+    tailPass.end();
+    return commandRecorder.finish();
+}
+
+void PbrMetallicRoughness::render()
+{
+    // Released once the frame is submitted
+    std::unique_lock<std::mutex> deviceLock = std::move(m_frameDeviceLock);
+    if (!deviceLock.owns_lock())
+        deviceLock = std::unique_lock<std::mutex>(m_deviceMutex);
+
+    if (m_useCachedCommandBuffers) {
+        renderCached();
+        return;
+    }
+
+    auto commandRecorder = m_device.createCommandRecorder();
+    m_opaquePassOptions.colorAttachments[0].resolveView = m_swapchainViews.at(m_currentSwapchainImageIndex);
+    m_opaquePassOptions.colorAttachments[0].clearValue = clearColor(m_overdrawHeatMap);
+    auto opaquePass = commandRecorder.beginRenderPass(m_opaquePassOptions);
+
+    bindFrameBindGroups(opaquePass, m_renderStats);
+
+    // Lay down the depth of all opaque primitives first so that the shading pass below
+    // only runs the expensive fragment shader for the visible samples.
+    if (m_depthPrePassEnabled)
+        recordDepthPrePass(opaquePass, m_renderStats);
+
+    recordDraws(opaquePass, m_depthPrePassEnabled, m_overdrawHeatMap, m_renderStats);
 
     renderImGuiOverlay(&opaquePass);
 
     opaquePass.end();
-    m_commandBuffer = commandRecorder.finish();
+    m_commandBuffers.clear();
+    m_commandBuffers.emplace_back(commandRecorder.finish());
+
+    SubmitOptions submitOptions = { .commandBuffers = { m_commandBuffers.front() },
+                                    .waitSemaphores = { m_presentCompleteSemaphores[m_inFlightIndex] },
+                                    .signalSemaphores = { m_renderCompleteSemaphores[m_inFlightIndex] } };
+    m_queue.submit(submitOptions);
+}
+
+void PbrMetallicRoughness::renderCached()
+{
+    // Toggling the depth pre-pass or the heat map changes the recorded draws
+    if (m_cachedDepthPrePassEnabled != m_depthPrePassEnabled || m_cachedOverdrawHeatMap != m_overdrawHeatMap) {
+        invalidateCachedCommandBuffers();
+        m_cachedDepthPrePassEnabled = m_depthPrePassEnabled;
+        m_cachedOverdrawHeatMap = m_overdrawHeatMap;
+        m_opaquePassOptions.colorAttachments[0].clearValue = clearColor(m_overdrawHeatMap);
+    }
+
+    if (m_cachedSceneCommandBuffers.size() != m_swapchainViews.size()) {
+        invalidateCachedCommandBuffers();
+        m_cachedSceneCommandBuffers.resize(m_swapchainViews.size());
+        m_cachedSceneRenderStats.resize(m_swapchainViews.size());
+    }
+
+    // The scene pass does not reference the swapchain image. We still keep one copy per
+    // image so that a command buffer is never resubmitted while a previous submission of it
+    // may be pending, which would otherwise require simultaneous use.
+    CommandBuffer &sceneCommandBuffer = m_cachedSceneCommandBuffers.at(m_currentSwapchainImageIndex);
+    RenderStats &sceneRenderStats = m_cachedSceneRenderStats.at(m_currentSwapchainImageIndex);
+    if (!sceneCommandBuffer.isValid()) {
+        sceneRenderStats = {};
+        auto commandRecorder = m_device.createCommandRecorder();
+        auto scenePass = commandRecorder.beginRenderPass(headPassOptions());
+        bindFrameBindGroups(scenePass, sceneRenderStats);
+        if (m_cachedDepthPrePassEnabled)
+            recordDepthPrePass(scenePass, sceneRenderStats);
+        recordDraws(scenePass, m_cachedDepthPrePassEnabled, m_cachedOverdrawHeatMap, sceneRenderStats);
+        scenePass.end();
+        sceneCommandBuffer = commandRecorder.finish();
+        ++m_renderStats.recordedCommandBufferCount;
+    }
+    m_renderStats.add(sceneRenderStats);
+
+    m_commandBuffers.clear();
+    m_commandBuffers.emplace_back(recordTailCommandBuffer(loadPassOptions()));
 
-    SubmitOptions submitOptions = { .commandBuffers = { m_commandBuffer },
+    SubmitOptions submitOptions = { .commandBuffers = { sceneCommandBuffer, m_commandBuffers.front() },
                                     .waitSemaphores = { m_presentCompleteSemaphores[m_inFlightIndex] },
                                     .signalSemaphores = { m_renderCompleteSemaphores[m_inFlightIndex] } };
     m_queue.submit(submitOptions);
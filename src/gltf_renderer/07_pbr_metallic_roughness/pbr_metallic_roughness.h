@@ -14,6 +14,11 @@
 #include "primitive_key.h"
 
 #include <camera/camera.h>
+#include <container/flat_hash_map.h>
+#include <resource/deferred_release.h>
+#include <sampler/sampler_cache.h>
+#include <texture/block_compression.h>
+#include <threading/thread_pool.h>
 
 #include <KDGpuExample/simple_example_engine_layer.h>
 
@@ -21,6 +26,7 @@
 #include <KDGpu/bind_group_layout.h>
 #include <KDGpu/buffer.h>
 #include <KDGpu/graphics_pipeline.h>
+#include <KDGpu/graphics_pipeline_options.h>
 #include <KDGpu/render_pass_command_recorder_options.h>
 #include <KDGpu/sampler.h>
 #include <KDGpu/shader_module.h>
@@ -29,7 +35,12 @@
 
 #include <glm/glm.hpp>
 
+#include <atomic>
+#include <future>
+#include <mutex>
 #include <unordered_map>
+#include <unordered_set>
+#include <utility>
 
 namespace tinygltf {
 class Model;
@@ -38,6 +49,12 @@ struct Node;
 struct Primitive;
 } // namespace tinygltf
 
+namespace TinyGltfHelper {
+class VertexLayoutAnalyzer;
+} // namespace TinyGltfHelper
+
+struct ImGuiContext;
+
 struct BufferAndOffset {
     Handle<Buffer_t> buffer;
     DeviceSize offset{ 0 };
@@ -61,7 +78,7 @@ struct InstancedDraw {
 };
 
 struct PrimitiveInstances {
-    std::unordered_map<PrimitiveKey, std::vector<InstanceData>> instanceData;
+    kdgpu_ext::graphics::container::FlatHashMap<PrimitiveKey, std::vector<InstanceData>> instanceData;
     uint32_t totalInstanceCount{ 0 };
 
     // Data used to populate the buffer contents
@@ -102,6 +119,14 @@ struct MaterialData {
     float alphaCutoff{ 0.5f };
 };
 
+// A primitive whose pipeline has not been created yet. Scene setup first collects these
+// so that all missing pipelines can be created in one go.
+struct PendingPrimitive {
+    GraphicsPipelineKey key;
+    Handle<BindGroup_t> material;
+    PrimitiveData primitiveData;
+};
+
 struct MaterialPrimitives {
     Handle<BindGroup_t> material;
     std::vector<PrimitiveData> primitives;
@@ -114,6 +139,47 @@ struct RenderStats {
     uint32_t setBindGroupCount{ 0 };
     uint32_t drawCount{ 0 };
     uint32_t vertexCount{ 0 };
+
+    // Draws per depth test of the optional depth pre-pass. Draws in the shading pass that
+    // use an EQUAL depth test shade each covered sample at most once, the remaining draws
+    // (alpha masked/blended or pre-pass disabled) use a LESS test and may shade a sample
+    // several times. These only count geometry, the overdraw heat map shows the fragments.
+    uint32_t depthPrePassDrawCount{ 0 };
+    uint32_t depthPrePassVertexCount{ 0 };
+    uint32_t depthEqualDrawCount{ 0 };
+    uint32_t depthEqualVertexCount{ 0 };
+    uint32_t depthLessDrawCount{ 0 };
+    uint32_t depthLessVertexCount{ 0 };
+
+    // Number of scene command buffers (re-)recorded in the cached command buffer mode
+    uint32_t recordedCommandBufferCount{ 0 };
+
+    // Accumulates the per-frame counters of a separately recorded command buffer
+    void add(const RenderStats &other)
+    {
+        setPipelineCount += other.setPipelineCount;
+        setVertexBufferCount += other.setVertexBufferCount;
+        setBindGroupCount += other.setBindGroupCount;
+        drawCount += other.drawCount;
+        vertexCount += other.vertexCount;
+        depthPrePassDrawCount += other.depthPrePassDrawCount;
+        depthPrePassVertexCount += other.depthPrePassVertexCount;
+        depthEqualDrawCount += other.depthEqualDrawCount;
+        depthEqualVertexCount += other.depthEqualVertexCount;
+        depthLessDrawCount += other.depthLessDrawCount;
+        depthLessVertexCount += other.depthLessVertexCount;
+    }
+};
+
+// One entry of the flattened draw list, sorted by pipeline and then material
+struct DrawItem {
+    Handle<GraphicsPipeline_t> pipeline;
+    Handle<GraphicsPipeline_t> depthEqualPipeline; // Invalid if not part of the depth pre-pass
+    // Overdraw heat map variants of the two pipelines above
+    Handle<GraphicsPipeline_t> overdrawPipeline;
+    Handle<GraphicsPipeline_t> overdrawDepthEqualPipeline;
+    Handle<BindGroup_t> material;
+    const PrimitiveData *primitive{ nullptr };
 };
 
 class PbrMetallicRoughness : public KDGpuExample::SimpleExampleEngineLayer
@@ -135,22 +201,37 @@ private:
                                      const std::vector<KDGpu::BufferUsageFlags> &bufferViewUsages,
                                      uint32_t bufferViewIndex);
 
-    TextureAndView createTextureForImage(const tinygltf::Model &model, uint32_t textureIndex);
+    TextureAndView createTextureForImage(const tinygltf::Model &model, uint32_t imageIndex);
+    TextureAndView createTextureForCompressedImage(const kdgpu_ext::graphics::texture::CompressedImage &image);
     TextureAndView createTextureForImageData(uint32_t width, uint32_t height, const void *data, size_t byteCount, Format format);
     TextureAndView createTextureFromKtxFile(const std::string &filename);
-    Sampler createSampler(const tinygltf::Model &model, uint32_t samplerIndex);
     TextureViewAndSampler createViewSamplerForTexture(const tinygltf::Model &model, uint32_t viewSamplerIndex);
     TextureAndView createSolidColorTexture(float r, float g, float b, float a);
 
     void setupMaterial(const tinygltf::Model &model, uint32_t materialIndex);
 
     void setupPrimitive(const tinygltf::Model &model,
+                        TinyGltfHelper::VertexLayoutAnalyzer &vertexLayouts,
                         const tinygltf::Primitive &primitive,
                         const PrimitiveKey &primitiveKey,
-                        PrimitiveInstances &primitiveInstances);
-
+                        PrimitiveInstances &primitiveInstances,
+                        std::vector<PendingPrimitive> &pendingPrimitives);
+    bool addPrimitive(const PendingPrimitive &pendingPrimitive);
+    void rebuildPrimitiveBuckets();
+
+    Handle<GraphicsPipeline_t> findOrCreatePipeline(const GraphicsPipelineKey &key);
+    Handle<GraphicsPipeline_t> findOrRequestPipeline(const GraphicsPipelineKey &key);
+    Handle<GraphicsPipeline_t> findOrCreateFallbackPipeline(const GraphicsPipelineKey &key);
+    Handle<GraphicsPipeline_t> findOrCreateOverdrawPipeline(const GraphicsPipelineKey &key, bool doubleSided, DepthPassMode depthPassMode);
+    bool pipelinesReady(const GraphicsPipelineKey &key) const;
+    void updatePendingPipelines();
+    Handle<GraphicsPipeline_t> createPipeline(const GraphicsPipelineKey &key);
+    void createPipelines(const std::vector<GraphicsPipelineKey> &keys);
+    GraphicsPipelineOptions pipelineOptionsForKey(const GraphicsPipelineKey &key);
+    void loadPipelineCache();
+    void savePipelineCache();
     Handle<ShaderModule_t> findOrCreateShaderModule(const ShaderModuleKey &key);
-    std::string shaderFilename(const PipelineShaderOptionsKey &key, ShaderStageFlagBits stage);
+    ShaderModuleKey shaderModuleKeyFor(const PipelineShaderOptionsKey &optionsKey, ShaderStageFlagBits stage) const;
 
     InstancedDraw setupPrimitiveInstances(const PrimitiveKey &primitiveKey,
                                           PrimitiveInstances &primitiveInstances);
@@ -164,6 +245,18 @@ private:
 
     void createRenderTarget();
 
+    void buildDrawList();
+    void bindFrameBindGroups(RenderPassCommandRecorder &pass, RenderStats &stats);
+    uint32_t recordPrimitive(RenderPassCommandRecorder &pass, const PrimitiveData &primitiveData, RenderStats &stats);
+    void recordDepthPrePass(RenderPassCommandRecorder &pass, RenderStats &stats);
+    void recordDraws(RenderPassCommandRecorder &pass, bool depthPrePassEnabled, bool overdrawHeatMap, RenderStats &stats);
+    void renderCached();
+    void invalidateCachedCommandBuffers();
+    RenderPassCommandRecorderOptions headPassOptions() const;
+    RenderPassCommandRecorderOptions loadPassOptions() const;
+    CommandBuffer recordTailCommandBuffer(const RenderPassCommandRecorderOptions &loadOptions);
+    void drawControls(ImGuiContext *ctx);
+
     kdgpu_ext::graphics::camera::Camera m_camera;
     Buffer m_cameraBuffer;
     BindGroup m_cameraBindGroup;
@@ -174,7 +267,7 @@ private:
     TextureAndView m_opaqueWhite;
     TextureAndView m_transparentBlack;
     TextureAndView m_defaultNormal;
-    Sampler m_defaultSampler;
+    Handle<Sampler_t> m_defaultSampler;
 
     TextureAndView m_environmentLightSpecular;
     TextureAndView m_environmentLightDiffuse;
@@ -183,10 +276,45 @@ private:
 
     std::map<Handle<GraphicsPipeline_t>, std::vector<MaterialPrimitives>> m_pipelinePrimitiveMap;
 
+    // Optional depth pre-pass. Opaque primitives are drawn once with position-only
+    // pipelines and then shaded with the EQUAL variant of their regular pipeline.
+    bool m_depthPrePassEnabled{ false };
+    ShaderModule m_depthPrePassShader;
+    std::map<Handle<GraphicsPipeline_t>, std::vector<PrimitiveData>> m_depthPrePassPrimitiveMap;
+    std::map<Handle<GraphicsPipeline_t>, Handle<GraphicsPipeline_t>> m_depthEqualPipelineMap;
+
+    // Overdraw heat map. Draws every primitive with the depth state and culling of its
+    // pipeline but an additive constant color instead of the shading, so that the image
+    // shows how many fragments were shaded per pixel, with and without the depth pre-pass.
+    // Alpha masked primitives are counted without their discarded fragments.
+    bool m_overdrawHeatMap{ false };
+    ShaderModule m_overdrawFragmentShader;
+    std::unordered_map<GraphicsPipelineKey, GraphicsPipeline> m_overdrawPipelines;
+    std::map<Handle<GraphicsPipeline_t>, Handle<GraphicsPipeline_t>> m_overdrawPipelineMap; // Shading -> heat map pipeline
+
+    // Flattened m_pipelinePrimitiveMap
+    std::vector<DrawItem> m_drawList;
+
+    // Worker threads for transcoding images
+    kdgpu_ext::graphics::threading::ThreadPool m_threadPool;
+
+    // Cached command buffer mode. The scene pass only references buffers whose contents
+    // change (camera) but never the set of draws, so it is recorded once per swapchain image
+    // and replayed. Only the small ImGui/resolve tail pass is recorded every frame. The cache
+    // is dropped on resize and when the depth pre-pass or the overdraw heat map is toggled.
+    bool m_useCachedCommandBuffers{ true };
+    bool m_cachedDepthPrePassEnabled{ false };
+    bool m_cachedOverdrawHeatMap{ false };
+    std::vector<CommandBuffer> m_cachedSceneCommandBuffers; // Indexed by swapchain image
+    // Invalidated cached command buffers, kept until the frames submitting them have finished
+    kdgpu_ext::graphics::resource::DeferredRelease m_retiredCommandBuffers;
+    std::vector<RenderStats> m_cachedSceneRenderStats;
+
     std::vector<Buffer> m_buffers;
     std::vector<TextureAndView> m_textures;
-    std::vector<Sampler> m_samplers;
     std::vector<TextureViewAndSampler> m_viewSamplers;
+    // Owns the samplers of m_viewSamplers and m_defaultSampler, one per distinct sampler state
+    kdgpu_ext::graphics::sampler::SamplerCache m_samplerCache;
 
     std::vector<glm::mat4> m_worldTransforms; // Indexed as per model.nodes
     Buffer m_instanceTransformsBuffer;
@@ -195,15 +323,47 @@ private:
     std::vector<Buffer> m_materialBuffers; // Indexed as per model.materials
     std::vector<BindGroup> m_materialBindGroups;
 
-    std::unordered_map<GraphicsPipelineKey, GraphicsPipeline> m_pipelines;
-    std::unordered_map<ShaderModuleKey, ShaderModule> m_shaderModules;
+    kdgpu_ext::graphics::container::FlatHashMap<GraphicsPipelineKey, GraphicsPipeline> m_pipelines;
+    kdgpu_ext::graphics::container::FlatHashMap<ShaderModuleKey, ShaderModule> m_shaderModules;
+
+    // Use a single fragment shader module taking the shader options as specialization
+    // constants instead of one precompiled variant per combination of options
+    bool m_useSpecializationConstants{ true };
+
+    // Asynchronous pipeline compilation. Missing pipelines are queued to a compiler thread
+    // and their primitives are drawn with a generic position/normal-only fallback pipeline
+    // meanwhile. The compiler publishes the pipelines it created, updateScene() picks them up
+    // and, once all pipelines of a primitive are ready, rebuilds the draw buckets between two
+    // frames. KDGpu devices are not thread safe, so the compiler only creates a pipeline while
+    // holding m_deviceMutex, which the render thread holds while it uses the device. Pipelines
+    // are then compiled while the render thread waits for the GPU and presents.
+    bool m_asyncPipelineCompilation{ true };
+    std::mutex m_deviceMutex;
+    std::unique_lock<std::mutex> m_frameDeviceLock; // From updateScene() until render() has submitted
+    std::atomic<bool> m_cancelPipelineCompilation{ false };
+    std::unordered_set<GraphicsPipelineKey> m_pendingPipelines; // Queued to the compiler
+    std::mutex m_compiledPipelinesMutex;
+    std::vector<std::pair<GraphicsPipelineKey, GraphicsPipeline>> m_compiledPipelines; // Published by the compiler
+    // Declared after what its jobs use so that it is joined before those are destroyed
+    kdgpu_ext::graphics::threading::ThreadPool m_pipelineCompiler{ 1 };
+    std::vector<std::future<void>> m_pipelineCompilations;
+    std::unordered_map<GraphicsPipelineKey, GraphicsPipeline> m_fallbackPipelines;
+    ShaderModule m_fallbackVertexShader;
+    ShaderModule m_fallbackFragmentShader;
+    std::vector<PendingPrimitive> m_scenePrimitives; // Every primitive of the scene to rebuild the buckets from
+    std::vector<size_t> m_fallbackPrimitiveIndices; // Into m_scenePrimitives
+
+    // Keys requested by the scene this run. Only these are written to the on-disk cache
+    // so that pipelines the scene no longer needs drop out of it.
+    std::unordered_set<GraphicsPipelineKey> m_requestedPipelineKeys;
     BindGroupLayout m_nodeBindGroupLayout;
     BindGroupLayout m_cameraBindGroupLayout;
     BindGroupLayout m_materialBindGroupLayout;
     BindGroupLayout m_environmentLightBindGroupLayout;
     PipelineLayout m_pipelineLayout;
     RenderPassCommandRecorderOptions m_opaquePassOptions;
-    CommandBuffer m_commandBuffer;
+    std::vector<CommandBuffer> m_commandBuffers;
 
     RenderStats m_renderStats;
+    RenderStats m_lastFrameRenderStats;
 };
@@ -11,11 +11,13 @@
 #pragma once
 
 #include <tinygltf_helper/tinygltf_helper.h>
+#include <pipeline_cache/pipeline_cache_file.h>
 
 #include <KDGpu/gpu_core.h>
 #include <KDGpu/graphics_pipeline_options.h>
 #include <KDGpu/utils/hash_utils.h>
 
+#include <assert.h>
 #include <vector>
 
 // This will be used to act as a key in a map for caching and reusing
@@ -42,13 +44,28 @@ struct PipelineShaderOptionsKey {
     }
 };
 
+// Which role a pipeline plays when the optional depth pre-pass is used. Pre-pass
+// pipelines only write depth from vertex positions. The shading pipelines used after
+// a pre-pass test for EQUAL depth and do not write depth so that every covered sample
+// is shaded at most once.
+enum class DepthPassMode : uint8_t {
+    Default = 0,
+    DepthPrePass = 1,
+    EqualAfterPrePass = 2
+};
+
 struct ShaderModuleKey {
     PipelineShaderOptionsKey shaderOptionsKey;
     ShaderStageFlagBits stage{ ShaderStageFlagBits::MaxEnum };
 
+    // The module takes the options as specialization constants at pipeline creation
+    // instead of having them compiled in. shaderOptionsKey is left at its defaults then.
+    bool specializedOptions{ false };
+
     bool operator==(const ShaderModuleKey &other) const noexcept
     {
-        return shaderOptionsKey == other.shaderOptionsKey && stage == other.stage;
+        return shaderOptionsKey == other.shaderOptionsKey && stage == other.stage &&
+                specializedOptions == other.specializedOptions;
     }
 };
 
@@ -58,9 +75,21 @@ struct GraphicsPipelineKey {
     TinyGltfHelper::AlphaMode alphaMode{ TinyGltfHelper::AlphaMode::Opaque };
     bool doubleSided{ false };
     PipelineShaderOptionsKey shaderOptionsKey{};
+    DepthPassMode depthPassMode{ DepthPassMode::Default };
+
+    // Hashing walks all buffer layouts and attributes so it is done once, by updateHash(),
+    // after the key has been filled in or modified. Lookups then only use this value and
+    // can reject most unequal keys without comparing the vectors.
+    uint64_t hash{ 0 };
+
+    uint64_t computeHash() const;
+    void updateHash() { hash = computeHash(); }
 
     bool operator==(const GraphicsPipelineKey &other) const noexcept
     {
+        if (hash != other.hash)
+            return false;
+
         if (topology != other.topology)
             return false;
 
@@ -102,12 +131,59 @@ struct GraphicsPipelineKey {
         if (shaderOptionsKey != other.shaderOptionsKey)
             return false;
 
+        if (depthPassMode != other.depthPassMode)
+            return false;
+
         return true;
     }
 
     bool operator!=(const GraphicsPipelineKey &other) const noexcept { return !(*this == other); }
 };
 
+// Serialization of the keys into the on-disk pipeline cache. Bump the version whenever
+// the members of the keys change.
+constexpr uint32_t PipelineCacheFormatVersion = 2;
+
+inline void writeShaderModuleKey(kdgpu_ext::graphics::pipeline_cache::BinaryWriter &writer, const ShaderModuleKey &key)
+{
+    writer.write(key.shaderOptionsKey.hasTexCoords);
+    writer.write(key.shaderOptionsKey.enableAlphaCutoff);
+    writer.write(key.stage);
+    writer.write(key.specializedOptions);
+}
+
+inline bool readShaderModuleKey(kdgpu_ext::graphics::pipeline_cache::BinaryReader &reader, ShaderModuleKey &key)
+{
+    return reader.read(key.shaderOptionsKey.hasTexCoords) &&
+            reader.read(key.shaderOptionsKey.enableAlphaCutoff) &&
+            reader.read(key.stage) &&
+            reader.read(key.specializedOptions);
+}
+
+inline void writePipelineKey(kdgpu_ext::graphics::pipeline_cache::BinaryWriter &writer, const GraphicsPipelineKey &key)
+{
+    writer.write(key.topology);
+    kdgpu_ext::graphics::pipeline_cache::writeVertexOptions(writer, key.vertexOptions);
+    writer.write(key.alphaMode);
+    writer.write(key.doubleSided);
+    writer.write(key.shaderOptionsKey.hasTexCoords);
+    writer.write(key.shaderOptionsKey.enableAlphaCutoff);
+    writer.write(key.depthPassMode);
+}
+
+inline bool readPipelineKey(kdgpu_ext::graphics::pipeline_cache::BinaryReader &reader, GraphicsPipelineKey &key)
+{
+    const bool result = reader.read(key.topology) &&
+            kdgpu_ext::graphics::pipeline_cache::readVertexOptions(reader, key.vertexOptions) &&
+            reader.read(key.alphaMode) &&
+            reader.read(key.doubleSided) &&
+            reader.read(key.shaderOptionsKey.hasTexCoords) &&
+            reader.read(key.shaderOptionsKey.enableAlphaCutoff) &&
+            reader.read(key.depthPassMode);
+    key.updateHash();
+    return result;
+}
+
 namespace std {
 
 template<>
@@ -153,6 +229,7 @@ struct hash<ShaderModuleKey> {
         uint64_t hash = 0;
         KDGpu::hash_combine(hash, key.shaderOptionsKey);
         KDGpu::hash_combine(hash, key.stage);
+        KDGpu::hash_combine(hash, key.specializedOptions);
         return hash;
     }
 };
@@ -161,23 +238,30 @@ template<>
 struct hash<GraphicsPipelineKey> {
     size_t operator()(const GraphicsPipelineKey &key) const
     {
-        uint64_t hash = 0;
+        assert(key.hash == key.computeHash() && "GraphicsPipelineKey modified without updateHash()");
+        return key.hash;
+    }
+};
 
-        KDGpu::hash_combine(hash, key.topology);
+} // namespace std
 
-        for (const auto &buffer : key.vertexOptions.buffers)
-            KDGpu::hash_combine(hash, buffer);
+inline uint64_t GraphicsPipelineKey::computeHash() const
+{
+    uint64_t hash = 0;
 
-        for (const auto &attribute : key.vertexOptions.attributes)
-            KDGpu::hash_combine(hash, attribute);
+    KDGpu::hash_combine(hash, topology);
 
-        KDGpu::hash_combine(hash, key.alphaMode);
-        KDGpu::hash_combine(hash, key.doubleSided);
+    for (const auto &buffer : vertexOptions.buffers)
+        KDGpu::hash_combine(hash, buffer);
 
-        KDGpu::hash_combine(hash, key.shaderOptionsKey);
+    for (const auto &attribute : vertexOptions.attributes)
+        KDGpu::hash_combine(hash, attribute);
 
-        return hash;
-    }
-};
+    KDGpu::hash_combine(hash, alphaMode);
+    KDGpu::hash_combine(hash, doubleSided);
 
-} // namespace std
+    KDGpu::hash_combine(hash, shaderOptionsKey);
+    KDGpu::hash_combine(hash, depthPassMode);
+
+    return hash;
+}
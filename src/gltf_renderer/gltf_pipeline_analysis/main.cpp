@@ -0,0 +1,201 @@
+/*
+  This file is part of KDGpu Examples.
+
+  SPDX-FileCopyrightText: 2023 Klarälvdalens Datakonsult AB, a KDAB Group company <info@kdab.com>
+
+  SPDX-License-Identifier: MIT
+
+  Contact KDAB at <info@kdab.com> for commercial licensing options.
+*/
+
+#include "pipeline_analysis.h"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <string>
+
+using namespace PipelineAnalysis;
+
+namespace {
+
+void printUsage(const char *executable)
+{
+    std::cerr << "Usage: " << executable << " <model.gltf|model.glb> [options]\n"
+              << "\n"
+              << "Reports the pipeline keys, vertex layouts and the pipeline and draw call counts of\n"
+              << "every gltf_renderer strategy for a glTF asset. Does not need a GPU.\n"
+              << "\n"
+              << "Options:\n"
+              << "  --strategy <name>      Strategy the limits apply to (default: the last one listed)\n"
+              << "  --max-pipelines <n>    Fail if the strategy needs more than n pipelines\n"
+              << "  --max-draws <n>        Fail if the strategy needs more than n draw calls\n"
+              << "  --top <n>              Number of pipeline keys to list (default: 20)\n"
+              << "\n"
+              << "Exit status is 0 on success, 1 on usage or load errors and 2 if a limit is exceeded.\n";
+}
+
+const char *topologyName(PrimitiveTopology topology)
+{
+    switch (topology) {
+    case PrimitiveTopology::PointList:
+        return "points";
+    case PrimitiveTopology::LineList:
+        return "lines";
+    case PrimitiveTopology::LineStrip:
+        return "line strip";
+    case PrimitiveTopology::TriangleList:
+        return "triangles";
+    case PrimitiveTopology::TriangleStrip:
+        return "triangle strip";
+    case PrimitiveTopology::TriangleFan:
+        return "triangle fan";
+    default:
+        return "other";
+    }
+}
+
+const char *alphaModeName(TinyGltfHelper::AlphaMode alphaMode)
+{
+    switch (alphaMode) {
+    case TinyGltfHelper::AlphaMode::Opaque:
+        return "OPAQUE";
+    case TinyGltfHelper::AlphaMode::Mask:
+        return "MASK";
+    case TinyGltfHelper::AlphaMode::Blend:
+        return "BLEND";
+    }
+    return "?";
+}
+
+// e.g. "triangles, BLEND, double sided, texcoords | b0:32 b1:8 | l0:b0+0 l1:b0+12 l2:b1+0"
+std::string describeKey(const PipelineKey &key)
+{
+    std::string description = topologyName(key.topology);
+    description += std::string(", ") + alphaModeName(key.alphaMode);
+    if (key.doubleSided)
+        description += ", double sided";
+    if (key.hasTexCoords)
+        description += ", texcoords";
+
+    description += " |";
+    for (const auto &buffer : key.vertexOptions.buffers)
+        description += " b" + std::to_string(buffer.binding) + ":" + std::to_string(buffer.stride);
+    description += " |";
+    for (const auto &attribute : key.vertexOptions.attributes) {
+        description += " l" + std::to_string(attribute.location) + ":b" + std::to_string(attribute.binding) +
+                "+" + std::to_string(attribute.offset);
+    }
+    return description;
+}
+
+std::optional<uint32_t> parseCount(const std::string &value)
+{
+    try {
+        size_t end = 0;
+        const unsigned long count = std::stoul(value, &end);
+        if (end == value.size())
+            return static_cast<uint32_t>(count);
+    } catch (...) {
+    }
+    return std::nullopt;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    std::string filename;
+    std::string strategyName(rendererStrategies().back().name);
+    std::optional<uint32_t> maxPipelines;
+    std::optional<uint32_t> maxDraws;
+    uint32_t topKeyCount = 20;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string argument = argv[i];
+        const bool hasValue = i + 1 < argc;
+        std::optional<uint32_t> count;
+        if (argument == "--strategy" && hasValue) {
+            strategyName = argv[++i];
+        } else if (argument == "--max-pipelines" && hasValue && (count = parseCount(argv[++i]))) {
+            maxPipelines = count;
+        } else if (argument == "--max-draws" && hasValue && (count = parseCount(argv[++i]))) {
+            maxDraws = count;
+        } else if (argument == "--top" && hasValue && (count = parseCount(argv[++i]))) {
+            topKeyCount = count.value();
+        } else if (argument.starts_with("-") || !filename.empty()) {
+            printUsage(argv[0]);
+            return 1;
+        } else {
+            filename = argument;
+        }
+    }
+
+    if (filename.empty()) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    const auto &strategies = rendererStrategies();
+    const auto strategyIt = std::find_if(strategies.begin(), strategies.end(),
+                                         [&](const RendererStrategy &strategy) { return strategy.name == strategyName; });
+    if (strategyIt == strategies.end()) {
+        spdlog::error("Unknown strategy {}", strategyName);
+        return 1;
+    }
+
+    tinygltf::Model model;
+    if (!TinyGltfHelper::loadModel(model, filename))
+        return 1;
+
+    const ModelAnalysis analysis = analyzeModel(model);
+    const StrategyEstimate &limitedEstimate = analysis.estimates.at(std::distance(strategies.begin(), strategyIt));
+
+    std::cout << filename << "\n"
+              << "  meshes: " << model.meshes.size() << ", nodes: " << model.nodes.size()
+              << ", materials: " << model.materials.size() << "\n"
+              << "  mesh primitives: " << analysis.meshPrimitiveCount
+              << ", primitive instances: " << analysis.primitiveInstanceCount << "\n"
+              << "  unique pipeline keys: " << analysis.keyUsages.size()
+              << ", unique vertex layouts: " << analysis.vertexLayoutCount << "\n\n";
+
+    std::cout << "Estimates per renderer strategy:\n"
+              << "  " << std::left << std::setw(28) << "strategy" << std::right << std::setw(10) << "pipelines"
+              << std::setw(12) << "draw calls" << "\n";
+    for (const auto &estimate : analysis.estimates) {
+        std::cout << "  " << std::left << std::setw(28) << estimate.strategy->name << std::right
+                  << std::setw(10) << estimate.pipelineCount << std::setw(12) << estimate.drawCallCount;
+        if (estimate.strategy->depthPrePass)
+            std::cout << " (" << estimate.drawCallCountWithDepthPrePass << " with depth pre-pass)";
+        std::cout << "  " << estimate.strategy->description << "\n";
+    }
+
+    std::cout << "\nPrimitives per pipeline key (" << rendererStrategies().back().name << "):\n"
+              << "  " << std::setw(10) << "primitives" << std::setw(11) << "instances" << "  key\n";
+    uint32_t listedKeyCount = 0;
+    for (const auto &usage : analysis.keyUsages) {
+        if (listedKeyCount++ == topKeyCount) {
+            std::cout << "  ... " << analysis.keyUsages.size() - topKeyCount << " more\n";
+            break;
+        }
+        std::cout << "  " << std::setw(10) << usage.primitiveCount << std::setw(11) << usage.instanceCount
+                  << "  " << describeKey(usage.key) << "\n";
+    }
+    std::cout << std::endl;
+
+    int result = 0;
+    if (maxPipelines && limitedEstimate.pipelineCount > maxPipelines.value()) {
+        spdlog::error("{} needs {} pipelines for {}, the limit is {}", strategyName,
+                      limitedEstimate.pipelineCount, filename, maxPipelines.value());
+        result = 2;
+    }
+    if (maxDraws && limitedEstimate.drawCallCount > maxDraws.value()) {
+        spdlog::error("{} needs {} draw calls for {}, the limit is {}", strategyName,
+                      limitedEstimate.drawCallCount, filename, maxDraws.value());
+        result = 2;
+    }
+    return result;
+}
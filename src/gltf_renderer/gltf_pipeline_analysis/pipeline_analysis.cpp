@@ -0,0 +1,278 @@
+/*
+  This file is part of KDGpu Examples.
+
+  SPDX-FileCopyrightText: 2023 Klarälvdalens Datakonsult AB, a KDAB Group company <info@kdab.com>
+
+  SPDX-License-Identifier: MIT
+
+  Contact KDAB at <info@kdab.com> for commercial licensing options.
+*/
+
+#include "pipeline_analysis.h"
+
+#include <KDGpu/utils/hash_utils.h>
+
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace PipelineAnalysis {
+
+namespace {
+
+struct VertexOptionsHash {
+    size_t operator()(const VertexOptions &vertexOptions) const
+    {
+        uint64_t hash = 0;
+        for (const auto &buffer : vertexOptions.buffers) {
+            KDGpu::hash_combine(hash, buffer.binding);
+            KDGpu::hash_combine(hash, buffer.stride);
+            KDGpu::hash_combine(hash, buffer.inputRate);
+        }
+        for (const auto &attribute : vertexOptions.attributes) {
+            KDGpu::hash_combine(hash, attribute.location);
+            KDGpu::hash_combine(hash, attribute.binding);
+            KDGpu::hash_combine(hash, attribute.format);
+            KDGpu::hash_combine(hash, attribute.offset);
+        }
+        return hash;
+    }
+};
+
+struct PipelineKeyHash {
+    size_t operator()(const PipelineKey &key) const
+    {
+        uint64_t hash = VertexOptionsHash{}(key.vertexOptions);
+        KDGpu::hash_combine(hash, key.topology);
+        KDGpu::hash_combine(hash, key.alphaMode);
+        KDGpu::hash_combine(hash, key.doubleSided);
+        KDGpu::hash_combine(hash, key.hasTexCoords);
+        KDGpu::hash_combine(hash, key.enableAlphaCutoff);
+        return hash;
+    }
+};
+
+// Mirrors depthPrePassKeyFor() of the 07_pbr_metallic_roughness example. The pre-pass
+// only consumes the position but keeps the buffer layouts of the primitive.
+PipelineKey depthPrePassKeyFor(const PipelineKey &key)
+{
+    PipelineKey depthPrePassKey = key;
+    depthPrePassKey.hasTexCoords = false;
+    depthPrePassKey.enableAlphaCutoff = false;
+
+    auto &attributes = depthPrePassKey.vertexOptions.attributes;
+    attributes.erase(std::remove_if(attributes.begin(), attributes.end(),
+                                    [](const VertexAttribute &a) { return a.location != 0; }),
+                     attributes.end());
+    return depthPrePassKey;
+}
+
+} // namespace
+
+bool vertexOptionsEqual(const VertexOptions &a, const VertexOptions &b) noexcept
+{
+    if (a.buffers.size() != b.buffers.size() || a.attributes.size() != b.attributes.size())
+        return false;
+
+    for (size_t i = 0; i < a.buffers.size(); ++i) {
+        const auto &buffer = a.buffers[i];
+        const auto &otherBuffer = b.buffers[i];
+        if (buffer.binding != otherBuffer.binding || buffer.stride != otherBuffer.stride ||
+            buffer.inputRate != otherBuffer.inputRate)
+            return false;
+    }
+
+    for (size_t i = 0; i < a.attributes.size(); ++i) {
+        const auto &attribute = a.attributes[i];
+        const auto &otherAttribute = b.attributes[i];
+        if (attribute.location != otherAttribute.location || attribute.binding != otherAttribute.binding ||
+            attribute.format != otherAttribute.format || attribute.offset != otherAttribute.offset)
+            return false;
+    }
+
+    return true;
+}
+
+bool PipelineKey::operator==(const PipelineKey &other) const noexcept
+{
+    return topology == other.topology && vertexOptionsEqual(vertexOptions, other.vertexOptions) &&
+            alphaMode == other.alphaMode && doubleSided == other.doubleSided &&
+            hasTexCoords == other.hasTexCoords && enableAlphaCutoff == other.enableAlphaCutoff;
+}
+
+const std::vector<RendererStrategy> &rendererStrategies()
+{
+    // 05a_materials and 06_ffx_cacao key their pipelines like 05_materials and 04a_instancing
+    // like 04_instancing so they are not listed separately.
+    // clang-format off
+    static const std::vector<RendererStrategy> strategies = {
+        {
+            .name = "01_simple_gltf",
+            .description = "pipeline per primitive, draw per node primitive",
+            .vertexInput = { .positionLocation = 0, .normalLocation = 1 },
+            .pipelinePerPrimitive = true
+        },
+        {
+            .name = "02_buffer_layouts",
+            .description = "pipeline per primitive with shared buffer layouts, draw per node primitive",
+            .vertexInput = { .positionLocation = 0, .normalLocation = 1 },
+            .pipelinePerPrimitive = true
+        },
+        {
+            .name = "03_pipeline_caching",
+            .description = "pipelines cached by vertex layout, draw per node primitive",
+            .vertexInput = { .positionLocation = 0, .normalLocation = 1 }
+        },
+        {
+            .name = "04_instancing",
+            .description = "pipelines cached by vertex layout, instanced draw per primitive",
+            .vertexInput = { .positionLocation = 0, .normalLocation = 1 },
+            .instanced = true
+        },
+        {
+            .name = "05_materials",
+            .description = "pipelines cached by vertex layout and material, instanced draw per primitive",
+            .vertexInput = { .positionLocation = 0, .normalLocation = 1, .textureCoord0Location = 2 },
+            .materialInKey = true,
+            .instanced = true
+        },
+        {
+            .name = "07_pbr_metallic_roughness",
+            .description = "as 05_materials sorted by material, with depth pre-pass pipelines",
+            .vertexInput = { .positionLocation = 0, .normalLocation = 1, .textureCoord0Location = 2, .tangentLocation = 3 },
+            .materialInKey = true,
+            .instanced = true,
+            .depthPrePass = true
+        }
+    };
+    // clang-format on
+    return strategies;
+}
+
+std::unordered_map<std::string, uint32_t> shaderLocationsFor(const RendererStrategy &strategy)
+{
+    const auto &vertexInput = strategy.vertexInput;
+    std::unordered_map<std::string, uint32_t> shaderLocations;
+    if (vertexInput.positionLocation.has_value())
+        shaderLocations.insert({ "POSITION", vertexInput.positionLocation.value() });
+    if (vertexInput.normalLocation.has_value())
+        shaderLocations.insert({ "NORMAL", vertexInput.normalLocation.value() });
+    if (vertexInput.textureCoord0Location.has_value())
+        shaderLocations.insert({ "TEXCOORD_0", vertexInput.textureCoord0Location.value() });
+    if (vertexInput.tangentLocation.has_value())
+        shaderLocations.insert({ "TANGENT", vertexInput.tangentLocation.value() });
+    return shaderLocations;
+}
+
+PipelineKey pipelineKeyForPrimitive(const tinygltf::Model &model,
+                                    const tinygltf::Primitive &primitive,
+                                    const RendererStrategy &strategy,
+                                    TinyGltfHelper::VertexLayoutAnalyzer &vertexLayouts)
+{
+    // The same analysis GltfHolder::setupPrimitive() and the examples use
+    const TinyGltfHelper::PrimitiveVertexLayout &vertexLayout = vertexLayouts.analyze(primitive);
+
+    PipelineKey key = {
+        .topology = TinyGltfHelper::topologyForPrimitiveMode(primitive.mode),
+        .vertexOptions = vertexLayouts.vertexOptions(vertexLayout.layoutId)
+    };
+
+    if (strategy.materialInKey) {
+        // The examples require a material. Treat primitives without one like the glTF
+        // default material so that such assets can still be analyzed.
+        if (primitive.material != -1) {
+            const tinygltf::Material &material = model.materials.at(primitive.material);
+            key.alphaMode = TinyGltfHelper::alphaModeForMaterialAlphaMode(material.alphaMode);
+            key.doubleSided = material.doubleSided;
+        }
+        key.hasTexCoords = strategy.vertexInput.textureCoord0Location.has_value() &&
+                vertexLayouts.hasLocation(vertexLayout.layoutId, strategy.vertexInput.textureCoord0Location.value());
+        key.enableAlphaCutoff = key.alphaMode == TinyGltfHelper::AlphaMode::Mask;
+    }
+
+    return key;
+}
+
+ModelAnalysis analyzeModel(const tinygltf::Model &model)
+{
+    ModelAnalysis analysis;
+
+    // Every node referencing a mesh instances all of its primitives
+    std::vector<uint32_t> meshInstanceCounts(model.meshes.size(), 0);
+    for (const auto &node : model.nodes) {
+        if (node.mesh != -1)
+            ++meshInstanceCounts.at(node.mesh);
+    }
+
+    for (uint32_t meshIndex = 0; meshIndex < model.meshes.size(); ++meshIndex) {
+        const uint32_t primitiveCount = model.meshes[meshIndex].primitives.size();
+        analysis.meshPrimitiveCount += primitiveCount;
+        analysis.primitiveInstanceCount += primitiveCount * meshInstanceCounts[meshIndex];
+    }
+
+    for (const auto &strategy : rendererStrategies()) {
+        TinyGltfHelper::VertexLayoutAnalyzer vertexLayouts(model, shaderLocationsFor(strategy));
+        std::unordered_map<PipelineKey, KeyUsage, PipelineKeyHash> keyUsages;
+        std::unordered_set<PipelineKey, PipelineKeyHash> depthPrePassKeys;
+        uint32_t usedPrimitiveCount = 0;
+        uint32_t usedOpaquePrimitiveCount = 0;
+        uint32_t opaqueKeyCount = 0;
+
+        for (uint32_t meshIndex = 0; meshIndex < model.meshes.size(); ++meshIndex) {
+            const uint32_t instanceCount = meshInstanceCounts[meshIndex];
+            for (const auto &primitive : model.meshes[meshIndex].primitives) {
+                PipelineKey key = pipelineKeyForPrimitive(model, primitive, strategy, vertexLayouts);
+                const bool opaque = key.alphaMode == TinyGltfHelper::AlphaMode::Opaque;
+
+                if (strategy.depthPrePass && opaque)
+                    depthPrePassKeys.insert(depthPrePassKeyFor(key));
+
+                auto [it, inserted] = keyUsages.try_emplace(key, KeyUsage{ .key = key });
+                ++it->second.primitiveCount;
+                it->second.instanceCount += instanceCount;
+                if (inserted && opaque)
+                    ++opaqueKeyCount;
+
+                if (instanceCount > 0) {
+                    ++usedPrimitiveCount;
+                    if (opaque)
+                        ++usedOpaquePrimitiveCount;
+                }
+            }
+        }
+
+        StrategyEstimate estimate = { .strategy = &strategy };
+        if (strategy.pipelinePerPrimitive)
+            estimate.pipelineCount = analysis.meshPrimitiveCount;
+        else
+            estimate.pipelineCount = keyUsages.size();
+
+        // Opaque keys get a pre-pass and an equal depth variant
+        if (strategy.depthPrePass)
+            estimate.pipelineCount += depthPrePassKeys.size() + opaqueKeyCount;
+
+        estimate.drawCallCount = strategy.instanced ? usedPrimitiveCount : analysis.primitiveInstanceCount;
+        if (strategy.depthPrePass)
+            estimate.drawCallCountWithDepthPrePass = estimate.drawCallCount + usedOpaquePrimitiveCount;
+        analysis.estimates.push_back(estimate);
+
+        // Report the keys of the most complete renderer
+        if (&strategy == &rendererStrategies().back()) {
+            analysis.keyUsages.reserve(keyUsages.size());
+            for (auto &[key, usage] : keyUsages)
+                analysis.keyUsages.push_back(std::move(usage));
+            analysis.vertexLayoutCount = vertexLayouts.layoutCount();
+
+            std::sort(analysis.keyUsages.begin(), analysis.keyUsages.end(),
+                      [](const KeyUsage &a, const KeyUsage &b) {
+                          if (a.instanceCount != b.instanceCount)
+                              return a.instanceCount > b.instanceCount;
+                          return a.primitiveCount > b.primitiveCount;
+                      });
+        }
+    }
+
+    return analysis;
+}
+
+} // namespace PipelineAnalysis
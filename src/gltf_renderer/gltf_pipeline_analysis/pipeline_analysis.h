@@ -0,0 +1,110 @@
+/*
+  This file is part of KDGpu Examples.
+
+  SPDX-FileCopyrightText: 2023 Klarälvdalens Datakonsult AB, a KDAB Group company <info@kdab.com>
+
+  SPDX-License-Identifier: MIT
+
+  Contact KDAB at <info@kdab.com> for commercial licensing options.
+*/
+
+#pragma once
+
+#include <tinygltf_helper/tinygltf_helper.h>
+#include <tinygltf_helper/vertex_layout_analyzer.h>
+#include <GltfHolder/shader_specification/gltf_shader_vertex_input.h>
+
+#include <KDGpu/gpu_core.h>
+#include <KDGpu/graphics_pipeline_options.h>
+
+#include <tiny_gltf.h>
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Headless analysis of how many pipelines and draw calls the gltf_renderer examples
+// would need for a glTF asset. No device is created, the vertex layouts come from the
+// same TinyGltfHelper::VertexLayoutAnalyzer the renderers use so the counts match what
+// they would create.
+
+using namespace KDGpu;
+
+namespace PipelineAnalysis {
+
+// The vertex layout and pipeline state of one primitive as seen by a renderer. Only
+// the members the renderer keys its pipelines on are filled in.
+struct PipelineKey {
+    PrimitiveTopology topology{ PrimitiveTopology::TriangleList };
+    VertexOptions vertexOptions;
+    TinyGltfHelper::AlphaMode alphaMode{ TinyGltfHelper::AlphaMode::Opaque };
+    bool doubleSided{ false };
+    bool hasTexCoords{ false };
+    bool enableAlphaCutoff{ false };
+
+    bool operator==(const PipelineKey &other) const noexcept;
+};
+
+bool vertexOptionsEqual(const VertexOptions &a, const VertexOptions &b) noexcept;
+
+// How one of the gltf_renderer examples turns primitives into pipelines and draws
+struct RendererStrategy {
+    std::string_view name;
+    std::string_view description;
+
+    // Which glTF attributes the shaders consume and at which locations
+    kdgpu_ext::gltf_holder::shader_specification::GltfShaderVertexInput vertexInput;
+
+    // A pipeline is created for every mesh primitive instead of looking it up in a cache
+    bool pipelinePerPrimitive{ false };
+    // Alpha mode, double sidedness and shader options are part of the pipeline key
+    bool materialInKey{ false };
+    // All nodes referencing a primitive are drawn with one instanced draw
+    bool instanced{ false };
+    // Opaque primitives additionally get a depth-only and an equal-depth pipeline and
+    // are drawn twice when the depth pre-pass is enabled
+    bool depthPrePass{ false };
+};
+
+const std::vector<RendererStrategy> &rendererStrategies();
+
+// Maps the glTF attributes consumed by the shaders of strategy to their locations
+std::unordered_map<std::string, uint32_t> shaderLocationsFor(const RendererStrategy &strategy);
+
+// The pipeline key of primitive under strategy. vertexLayouts has to be set up with the
+// shader locations of strategy.
+PipelineKey pipelineKeyForPrimitive(const tinygltf::Model &model,
+                                    const tinygltf::Primitive &primitive,
+                                    const RendererStrategy &strategy,
+                                    TinyGltfHelper::VertexLayoutAnalyzer &vertexLayouts);
+
+struct KeyUsage {
+    PipelineKey key;
+    uint32_t primitiveCount{ 0 }; // mesh primitives using the key
+    uint32_t instanceCount{ 0 }; // node references to those primitives
+};
+
+struct StrategyEstimate {
+    const RendererStrategy *strategy{ nullptr };
+    uint32_t pipelineCount{ 0 };
+    uint32_t drawCallCount{ 0 };
+    // Only set for strategies with a depth pre-pass
+    uint32_t drawCallCountWithDepthPrePass{ 0 };
+};
+
+struct ModelAnalysis {
+    uint32_t meshPrimitiveCount{ 0 };
+    uint32_t primitiveInstanceCount{ 0 };
+
+    // Keys and layouts of the most complete renderer (the last strategy), sorted by
+    // descending instance count
+    std::vector<KeyUsage> keyUsages;
+    uint32_t vertexLayoutCount{ 0 };
+
+    std::vector<StrategyEstimate> estimates;
+};
+
+ModelAnalysis analyzeModel(const tinygltf::Model &model);
+
+} // namespace PipelineAnalysis
@@ -0,0 +1,126 @@
+/*
+  This file is part of KDGpu Examples.
+
+  SPDX-FileCopyrightText: 2023 Klarälvdalens Datakonsult AB, a KDAB Group company <info@kdab.com>
+
+  SPDX-License-Identifier: MIT
+
+  Contact KDAB at <info@kdab.com> for commercial licensing options.
+*/
+
+#include <GltfHolder/gltf_holder.h>
+#include <texture/block_compression.h>
+#include <tinygltf_helper/tinygltf_helper.h>
+
+#include <spdlog/spdlog.h>
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <string>
+
+// Encodes the images of a glTF asset to Basis Universal KTX2 files where GltfHolder looks
+// for them, so that loading with a GltfTextureCompression target only has to transcode.
+
+using kdgpu_ext::gltf_holder::GltfHolder;
+using namespace kdgpu_ext::graphics::texture;
+
+namespace {
+
+void printUsage(const char *executable)
+{
+    std::cerr << "Usage: " << executable << " <model.gltf|model.glb> [options]\n"
+              << "\n"
+              << "Bakes every image of a glTF asset to a Basis Universal KTX2 file next to it, which\n"
+              << "GltfHolder transcodes to BC7, ASTC or ETC2 at load time. Does not need a GPU.\n"
+              << "\n"
+              << "Options:\n"
+              << "  --etc1s                Encode ETC1S instead of UASTC, smaller files but lower quality\n"
+              << "  --quality <n>          ETC1S quality from 1 to 255 (default: 128)\n"
+              << "  --threads <n>          Encoder threads (default: all cores)\n"
+              << "  --force                Re-encode images that already have a baked file\n";
+}
+
+std::optional<uint32_t> parseCount(const std::string &value)
+{
+    try {
+        size_t end = 0;
+        const unsigned long count = std::stoul(value, &end);
+        if (end == value.size() && count > 0)
+            return static_cast<uint32_t>(count);
+    } catch (...) {
+    }
+    return std::nullopt;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    if (argc < 2) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    const std::string filename = argv[1];
+    BasisEncodeOptions options;
+    bool force = false;
+
+    for (int i = 2; i < argc; ++i) {
+        const std::string argument = argv[i];
+        const bool hasValue = i + 1 < argc;
+        std::optional<uint32_t> count;
+        if (argument == "--etc1s") {
+            options.uastc = false;
+        } else if (argument == "--quality" && hasValue && (count = parseCount(argv[++i])) && count.value() <= 255) {
+            options.etc1sQuality = count.value();
+        } else if (argument == "--threads" && hasValue && (count = parseCount(argv[++i]))) {
+            options.threadCount = count.value();
+        } else if (argument == "--force") {
+            force = true;
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    tinygltf::Model model;
+    if (!TinyGltfHelper::loadModel(model, filename)) {
+        spdlog::error("Failed to load {}", filename);
+        return 1;
+    }
+
+    int failedCount = 0;
+    for (size_t imageIndex = 0; imageIndex < model.images.size(); ++imageIndex) {
+        const auto &image = model.images[imageIndex];
+        const std::string bakedPath = GltfHolder::bakedImagePath(filename, model, imageIndex);
+
+        if (!force && std::filesystem::exists(bakedPath)) {
+            std::cout << bakedPath << ": already baked\n";
+            continue;
+        }
+        if (image.component != 4 || image.bits != 8) {
+            std::cout << bakedPath << ": skipped, only 8 bit RGBA images are supported\n";
+            continue;
+        }
+
+        const auto startTime = std::chrono::steady_clock::now();
+        const std::vector<uint8_t> basisKtx2 = encodeBasisKtx2(image.image.data(), image.width, image.height, options);
+        const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime);
+
+        std::ofstream bakedFile(bakedPath, std::ios::binary);
+        if (basisKtx2.empty() || !bakedFile.write(reinterpret_cast<const char *>(basisKtx2.data()), basisKtx2.size())) {
+            spdlog::error("Failed to bake image {} to {}", imageIndex, bakedPath);
+            ++failedCount;
+            continue;
+        }
+
+        std::cout << bakedPath << ": " << image.width << "x" << image.height << ", "
+                  << image.image.size() / 1024 << " KiB RGBA to " << basisKtx2.size() / 1024 << " KiB in "
+                  << elapsed.count() << " s\n";
+    }
+
+    return failedCount == 0 ? 0 : 1;
+}
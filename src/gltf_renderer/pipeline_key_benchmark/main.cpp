@@ -0,0 +1,284 @@
+/*
+  This file is part of KDGpu Examples.
+
+  SPDX-FileCopyrightText: 2023 Klarälvdalens Datakonsult AB, a KDAB Group company <info@kdab.com>
+
+  SPDX-License-Identifier: MIT
+
+  Contact KDAB at <info@kdab.com> for commercial licensing options.
+*/
+
+#include "pipeline_key.h"
+#include "primitive_key.h"
+
+#include <container/flat_hash_map.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <optional>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Measures the scene setup lookups of 07_pbr_metallic_roughness on a synthetic scene: every
+// primitive hashes its pipeline key and looks it up in the pipeline map, and every node
+// appends to and later reads the instance list of its primitives. Compares the previous
+// std::unordered_map with a hash recomputed on every lookup against the cached key hash
+// and the open addressing FlatHashMap. Only meaningful in release builds as debug builds
+// recompute every cached hash to verify it.
+
+using kdgpu_ext::graphics::container::FlatHashMap;
+
+namespace {
+
+struct SyntheticPrimitive {
+    PrimitiveKey primitiveKey;
+    GraphicsPipelineKey pipelineKey;
+};
+
+struct InstanceData {
+    uint32_t worldTransformIndex;
+};
+
+// What the pipeline maps looked up before the hash was cached in the key
+struct RecomputedKeyHash {
+    size_t operator()(const GraphicsPipelineKey &key) const { return key.computeHash(); }
+};
+
+void printUsage(const char *executable)
+{
+    std::cerr << "Usage: " << executable << " [options]\n"
+              << "\n"
+              << "Times pipeline key hashing and the pipeline and instance map lookups of a\n"
+              << "synthetic scene with std::unordered_map and FlatHashMap. Does not need a GPU.\n"
+              << "\n"
+              << "Options:\n"
+              << "  --primitives <n>     Number of mesh primitives (default: 100000)\n"
+              << "  --layouts <n>        Number of distinct vertex layouts (default: 2000)\n"
+              << "  --instances <n>      Average node instances per primitive (default: 2)\n"
+              << "  --repetitions <n>    Runs per measurement, the fastest is reported (default: 5)\n";
+}
+
+std::optional<uint32_t> parseCount(const std::string &value)
+{
+    try {
+        size_t end = 0;
+        const unsigned long count = std::stoul(value, &end);
+        if (end == value.size() && count > 0)
+            return static_cast<uint32_t>(count);
+    } catch (...) {
+    }
+    return std::nullopt;
+}
+
+// Interleaved or split position, normal, tangent and texcoord streams with varying strides,
+// offsets and formats, similar to what glTF exporters produce
+VertexOptions syntheticVertexOptions(std::mt19937 &random)
+{
+    const uint32_t attributeCount = 2 + random() % 3;
+    const uint32_t bufferCount = 1 + random() % attributeCount;
+    const uint32_t padding = 4 * (random() % 8);
+
+    VertexOptions vertexOptions;
+    std::vector<uint32_t> bufferStrides(bufferCount, 0);
+    for (uint32_t location = 0; location < attributeCount; ++location) {
+        const uint32_t binding = location % bufferCount;
+        const Format format = location == 3 ? Format::R32G32_SFLOAT
+                : (location == 2 ? Format::R32G32B32A32_SFLOAT : Format::R32G32B32_SFLOAT);
+        const uint32_t size = location == 3 ? 8 : (location == 2 ? 16 : 12);
+        vertexOptions.attributes.push_back({ .location = location, .binding = binding, .format = format, .offset = bufferStrides[binding] });
+        bufferStrides[binding] += size;
+    }
+    for (uint32_t binding = 0; binding < bufferCount; ++binding)
+        vertexOptions.buffers.push_back({ .binding = binding, .stride = bufferStrides[binding] + padding });
+    return vertexOptions;
+}
+
+std::vector<SyntheticPrimitive> syntheticPrimitives(uint32_t primitiveCount, uint32_t layoutCount)
+{
+    std::mt19937 random(42);
+
+    std::vector<VertexOptions> layouts;
+    layouts.reserve(layoutCount);
+    for (uint32_t layoutIndex = 0; layoutIndex < layoutCount; ++layoutIndex)
+        layouts.push_back(syntheticVertexOptions(random));
+
+    // Every primitive owns a copy of its key as setupPrimitive() builds one per primitive
+    std::vector<SyntheticPrimitive> primitives;
+    primitives.reserve(primitiveCount);
+    for (uint32_t primitiveIndex = 0; primitiveIndex < primitiveCount; ++primitiveIndex) {
+        const VertexOptions &vertexOptions = layouts[random() % layouts.size()];
+        const auto alphaMode = static_cast<TinyGltfHelper::AlphaMode>(random() % 3);
+        // clang-format off
+        GraphicsPipelineKey key = {
+            .topology = random() % 16 == 0 ? PrimitiveTopology::TriangleStrip : PrimitiveTopology::TriangleList,
+            .vertexOptions = vertexOptions,
+            .alphaMode = alphaMode,
+            .doubleSided = random() % 4 == 0,
+            .shaderOptionsKey = {
+                .hasTexCoords = vertexOptions.attributes.size() > 3,
+                .enableAlphaCutoff = alphaMode == TinyGltfHelper::AlphaMode::Mask
+            }
+        };
+        // clang-format on
+        key.updateHash();
+
+        // Up to 8 primitives per mesh
+        primitives.push_back({ .primitiveKey = { .meshIndex = primitiveIndex / 8, .primitiveIndex = primitiveIndex % 8 },
+                               .pipelineKey = std::move(key) });
+    }
+    return primitives;
+}
+
+// Returns the fastest of repetitions runs in milliseconds. The results of the runs are
+// summed into checksum so that the work can not be optimized away.
+template<typename Function>
+double fastestRun(uint32_t repetitions, uint64_t &checksum, Function &&function)
+{
+    double fastest = std::numeric_limits<double>::max();
+    for (uint32_t run = 0; run < repetitions; ++run) {
+        const auto startTime = std::chrono::steady_clock::now();
+        checksum += function();
+        const auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime);
+        fastest = std::min(fastest, elapsed.count());
+    }
+    return fastest;
+}
+
+// Find or insert of every primitive's pipeline key, as findOrCreatePipeline() does
+template<typename PipelineMap>
+uint64_t lookupPipelines(const std::vector<SyntheticPrimitive> &primitives)
+{
+    PipelineMap pipelines;
+    uint64_t pipelineIds = 0;
+    for (const auto &primitive : primitives) {
+        const auto pipelineIt = pipelines.find(primitive.pipelineKey);
+        if (pipelineIt != pipelines.end()) {
+            pipelineIds += pipelineIt->second;
+        } else {
+            const uint32_t pipelineId = static_cast<uint32_t>(pipelines.size());
+            pipelines.insert({ primitive.pipelineKey, pipelineId });
+            pipelineIds += pipelineId;
+        }
+    }
+    return pipelineIds + pipelines.size();
+}
+
+// Appends every node instance to its primitive as setupMeshNode() does and then reads the
+// instance lists back per primitive as setupPrimitiveInstances() does
+template<typename InstanceMap>
+uint64_t buildInstanceData(const std::vector<SyntheticPrimitive> &primitives, const std::vector<uint32_t> &nodePrimitives)
+{
+    InstanceMap instanceData;
+    for (uint32_t nodeIndex = 0; nodeIndex < nodePrimitives.size(); ++nodeIndex) {
+        const PrimitiveKey &primitiveKey = primitives[nodePrimitives[nodeIndex]].primitiveKey;
+        const auto instancesIt = instanceData.find(primitiveKey);
+        if (instancesIt != instanceData.end()) {
+            instancesIt->second.push_back(InstanceData{ .worldTransformIndex = nodeIndex });
+        } else {
+            const std::vector<InstanceData> instances{ InstanceData{ .worldTransformIndex = nodeIndex } };
+            instanceData.insert({ primitiveKey, instances });
+        }
+    }
+
+    uint64_t instanceCount = 0;
+    for (const auto &primitive : primitives) {
+        const auto instancesIt = instanceData.find(primitive.primitiveKey);
+        if (instancesIt != instanceData.end())
+            instanceCount += instancesIt->second.size();
+    }
+    return instanceCount;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    uint32_t primitiveCount = 100000;
+    uint32_t layoutCount = 2000;
+    uint32_t instancesPerPrimitive = 2;
+    uint32_t repetitions = 5;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string argument = argv[i];
+        const bool hasValue = i + 1 < argc;
+        std::optional<uint32_t> count;
+        if (argument == "--primitives" && hasValue && (count = parseCount(argv[++i]))) {
+            primitiveCount = count.value();
+        } else if (argument == "--layouts" && hasValue && (count = parseCount(argv[++i]))) {
+            layoutCount = count.value();
+        } else if (argument == "--instances" && hasValue && (count = parseCount(argv[++i]))) {
+            instancesPerPrimitive = count.value();
+        } else if (argument == "--repetitions" && hasValue && (count = parseCount(argv[++i]))) {
+            repetitions = count.value();
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    const std::vector<SyntheticPrimitive> primitives = syntheticPrimitives(primitiveCount, layoutCount);
+
+    std::mt19937 random(7);
+    std::vector<uint32_t> nodePrimitives(static_cast<size_t>(primitiveCount) * instancesPerPrimitive);
+    for (auto &primitiveIndex : nodePrimitives)
+        primitiveIndex = random() % primitiveCount;
+
+    uint64_t checksum = 0;
+    const double recomputedHashTime = fastestRun(repetitions, checksum, [&] {
+        uint64_t hashes = 0;
+        for (const auto &primitive : primitives)
+            hashes ^= primitive.pipelineKey.computeHash();
+        return hashes;
+    });
+    const double cachedHashTime = fastestRun(repetitions, checksum, [&] {
+        uint64_t hashes = 0;
+        for (const auto &primitive : primitives)
+            hashes ^= std::hash<GraphicsPipelineKey>{}(primitive.pipelineKey);
+        return hashes;
+    });
+
+    const double unorderedPipelineTime = fastestRun(repetitions, checksum, [&] {
+        return lookupPipelines<std::unordered_map<GraphicsPipelineKey, uint32_t, RecomputedKeyHash>>(primitives);
+    });
+    const double cachedUnorderedPipelineTime = fastestRun(repetitions, checksum, [&] {
+        return lookupPipelines<std::unordered_map<GraphicsPipelineKey, uint32_t>>(primitives);
+    });
+    const double flatPipelineTime = fastestRun(repetitions, checksum, [&] {
+        return lookupPipelines<FlatHashMap<GraphicsPipelineKey, uint32_t>>(primitives);
+    });
+
+    const double unorderedInstanceTime = fastestRun(repetitions, checksum, [&] {
+        return buildInstanceData<std::unordered_map<PrimitiveKey, std::vector<InstanceData>>>(primitives, nodePrimitives);
+    });
+    const double flatInstanceTime = fastestRun(repetitions, checksum, [&] {
+        return buildInstanceData<FlatHashMap<PrimitiveKey, std::vector<InstanceData>>>(primitives, nodePrimitives);
+    });
+
+    const auto printRow = [](const char *name, double time, double baseline) {
+        std::cout << "  " << std::left << std::setw(44) << name << std::right << std::fixed << std::setprecision(2)
+                  << std::setw(10) << time << " ms" << std::setw(8) << baseline / time << "x\n";
+    };
+
+    std::cout << primitives.size() << " primitives, " << layoutCount << " vertex layouts, "
+              << nodePrimitives.size() << " node instances, fastest of " << repetitions << " runs\n\n"
+              << "Pipeline key hashing:\n";
+    printRow("recomputed", recomputedHashTime, recomputedHashTime);
+    printRow("cached", cachedHashTime, recomputedHashTime);
+
+    std::cout << "\nPipeline find or insert per primitive:\n";
+    printRow("std::unordered_map, recomputed hash", unorderedPipelineTime, unorderedPipelineTime);
+    printRow("std::unordered_map, cached hash", cachedUnorderedPipelineTime, unorderedPipelineTime);
+    printRow("FlatHashMap, cached hash", flatPipelineTime, unorderedPipelineTime);
+
+    std::cout << "\nInstance data build and lookup:\n";
+    printRow("std::unordered_map", unorderedInstanceTime, unorderedInstanceTime);
+    printRow("FlatHashMap", flatInstanceTime, unorderedInstanceTime);
+
+    std::cout << "\n(checksum " << checksum << ")" << std::endl;
+    return 0;
+}
@@ -17,9 +17,9 @@
 #include <KDGpu/graphics_pipeline_options.h>
 #include <KDGpu/vulkan/vulkan_graphics_api.h>
 
-#include <glm/gtx/transform.hpp>
+#include <shader/embedded_shaders.h>
 
-#include <example_utility.h>
+#include <glm/gtx/transform.hpp>
 
 KDGpuRenderer::KDGpuRenderer(uint32_t width, uint32_t height)
     : m_width(width)
@@ -78,11 +78,9 @@ void KDGpuRenderer::initializeScene()
         m_transformBuffer.unmap();
     }
 
-    const auto vertexShaderPath = ExampleUtility::assetPath() + "/shaders/slint/simple.vert.spv";
-    auto vertexShader = m_device.createShaderModule(KDGpuExample::readShaderFile(vertexShaderPath));
+    auto vertexShader = m_device.createShaderModule(kdgpu_ext::graphics::shader::loadShader("shaders/slint/simple.vert.spv"));
 
-    const auto fragmentShaderPath = ExampleUtility::assetPath() + "/shaders/slint/simple.frag.spv";
-    auto fragmentShader = m_device.createShaderModule(KDGpuExample::readShaderFile(fragmentShaderPath));
+    auto fragmentShader = m_device.createShaderModule(kdgpu_ext::graphics::shader::loadShader("shaders/slint/simple.frag.spv"));
 
     const BindGroupLayoutOptions bindGroupLayoutOptions = {
         .bindings = { { .binding = 0,
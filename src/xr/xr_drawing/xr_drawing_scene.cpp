@@ -23,6 +23,8 @@
 #include <KDGui/gui_application.h>
 #include <KDUtils/dir.h>
 
+#include <shader/embedded_shaders.h>
+
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtx/quaternion.hpp>
 #include <glm/gtx/transform.hpp>
@@ -258,11 +260,9 @@ void XrDrawingScene::initializeScene()
     m_identityTransformBindGroup = m_device->createBindGroup(identityTransformBindGroupOptions);
 
     // Load the shaders for drawing the instanced shapes
-    auto vertexShaderPath = KDGpuExample::assetDir().file("shaders/xr_drawing/xr_drawing.vert.spv");
-    auto vertexShader = m_device->createShaderModule(KDGpuExample::readShaderFile(vertexShaderPath));
+    auto vertexShader = m_device->createShaderModule(kdgpu_ext::graphics::shader::loadShader("shaders/xr_drawing/xr_drawing.vert.spv"));
 
-    auto fragmentShaderPath = KDGpuExample::assetDir().file("shaders/xr_drawing/xr_drawing.frag.spv");
-    auto fragmentShader = m_device->createShaderModule(KDGpuExample::readShaderFile(fragmentShaderPath));
+    auto fragmentShader = m_device->createShaderModule(kdgpu_ext::graphics::shader::loadShader("shaders/xr_drawing/xr_drawing.frag.spv"));
 
     // Create a pipeline layout (array of bind group layouts)
     const PipelineLayoutOptions pipelineLayoutOptions = { .bindGroupLayouts = { m_cameraBindGroupLayout,
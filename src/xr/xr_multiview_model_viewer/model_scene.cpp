@@ -26,7 +26,10 @@
 #include <KDGpu/graphics_pipeline_options.h>
 #include <KDGpu/texture_options.h>
 
+#include <shader/embedded_shaders.h>
+
 #include <tinygltf_helper/tinygltf_helper.h>
+#include <tinygltf_helper/vertex_layout_analyzer.h>
 
 #include <glm/gtx/quaternion.hpp>
 #include <glm/gtc/type_ptr.hpp>
@@ -123,7 +126,7 @@ void ModelScene::initializeScene()
     m_opaqueWhite = createSolidColorTexture(1.0f, 1.0f, 1.0f, 1.0f);
     m_transparentBlack = createSolidColorTexture(0.0f, 0.0f, 0.0f, 0.0f);
     m_defaultNormal = createSolidColorTexture(0.5f, 0.5f, 1.0f, 1.0f);
-    m_defaultSampler = m_device->createSampler();
+    m_defaultSampler = m_samplerCache.findOrCreate(*m_device);
 
     // Create bind group layout consisting of a single binding holding a UBO for the camera
     // clang-format off
@@ -198,16 +201,8 @@ void ModelScene::initializeScene()
         m_textures.emplace_back(std::move(textureAndView));
     }
 
-    // Load any samplers needed
-    const uint32_t samplerCount = static_cast<uint32_t>(model.samplers.size());
-    SPDLOG_INFO("Model contains {} samplers.", samplerCount);
-    m_samplers.reserve(samplerCount);
-    for (uint32_t samplerIndex = 0; samplerIndex < samplerCount; ++samplerIndex) {
-        Sampler sampler = createSampler(model, samplerIndex);
-        m_samplers.emplace_back(std::move(sampler));
-    }
-
-    // Create the combined image samplers needed
+    // Create the combined image samplers needed. Samplers come from the cache, so glTF
+    // samplers with the same state share one sampler object.
     const uint32_t viewSamplerCount = static_cast<uint32_t>(model.textures.size());
     SPDLOG_INFO("Model contains {} view samplers.", viewSamplerCount);
     m_viewSamplers.reserve(viewSamplerCount);
@@ -290,12 +285,13 @@ void ModelScene::initializeScene()
     // Loop through each primitive of each mesh and create a compatible WebGPU pipeline.
     // During this process we will also populate the instances world transform SSBO.
     primitiveInstances.mappedData = static_cast<glm::mat4 *>(m_instanceTransformsBuffer.map());
+    TinyGltfHelper::VertexLayoutAnalyzer vertexLayouts(model, { { "POSITION", 0 }, { "NORMAL", 1 }, { "TEXCOORD_0", 2 } });
     uint32_t meshIndex = 0;
     for (const auto &mesh : model.meshes) {
         uint32_t primitiveIndex = 0;
         for (const auto &primitive : mesh.primitives) {
             const PrimitiveKey primitiveKey = { .meshIndex = meshIndex, .primitiveIndex = primitiveIndex };
-            setupPrimitive(model, primitive, primitiveKey, primitiveInstances);
+            setupPrimitive(model, vertexLayouts, primitive, primitiveKey, primitiveInstances);
             ++primitiveIndex;
         }
         ++meshIndex;
@@ -483,7 +479,7 @@ void ModelScene::initializeFloor()
             .anisotropyEnabled = true,
             .maxAnisotropy = 16.0f
         };
-        m_floorSampler = m_device->createSampler(samplerOptions);
+        m_floorSampler = m_samplerCache.findOrCreate(*m_device, samplerOptions);
     }
 
     const BindGroupLayoutOptions floorBindGroupLayoutOptions = {
@@ -522,11 +518,9 @@ void ModelScene::initializeFloor()
     m_floorBindGroup = m_device->createBindGroup(floorBindGroupOptions);
 
     // Create a pipeline to draw the floor texture
-    const auto vertexShaderPath = ExampleUtility::assetPath() + "/shaders/xr_multiview_model_viewer/texture.vert.spv";
-    auto vertexShader = m_device->createShaderModule(KDGpuExample::readShaderFile(vertexShaderPath));
+    auto vertexShader = m_device->createShaderModule(kdgpu_ext::graphics::shader::loadShader("shaders/xr_multiview_model_viewer/texture.vert.spv"));
 
-    const auto fragmentShaderPath = ExampleUtility::assetPath() + "/shaders/xr_multiview_model_viewer/texture.frag.spv";
-    auto fragmentShader = m_device->createShaderModule(KDGpuExample::readShaderFile(fragmentShaderPath));
+    auto fragmentShader = m_device->createShaderModule(kdgpu_ext::graphics::shader::loadShader("shaders/xr_multiview_model_viewer/texture.frag.spv"));
 
     const PipelineLayoutOptions pipelineLayoutOptions = {
         .label = "Floor Pipeline Layout",
@@ -700,11 +694,9 @@ void ModelScene::initializeHands()
     m_rightHandTransformBindGroup = m_device->createBindGroup(rightHandBindGroupOptions);
 
     // Create a pipeline to draw the hands with a solid color
-    const auto vertexShaderPath = ExampleUtility::assetPath() + "/shaders/xr_multiview_model_viewer/solid.vert.spv";
-    auto vertexShader = m_device->createShaderModule(KDGpuExample::readShaderFile(vertexShaderPath));
+    auto vertexShader = m_device->createShaderModule(kdgpu_ext::graphics::shader::loadShader("shaders/xr_multiview_model_viewer/solid.vert.spv"));
 
-    const auto fragmentShaderPath = ExampleUtility::assetPath() + "/shaders/xr_multiview_model_viewer/solid.frag.spv";
-    auto fragmentShader = m_device->createShaderModule(KDGpuExample::readShaderFile(fragmentShaderPath));
+    auto fragmentShader = m_device->createShaderModule(kdgpu_ext::graphics::shader::loadShader("shaders/xr_multiview_model_viewer/solid.frag.spv"));
 
     const PipelineLayoutOptions pipelineLayoutOptions = {
         .label = "Hand Pipeline Layout",
@@ -935,26 +927,12 @@ TextureAndView ModelScene::createTextureForImage(const tinygltf::Model &model, u
     return textureAndView;
 }
 
-Sampler ModelScene::createSampler(const tinygltf::Model &model, uint32_t samplerIndex)
-{
-    const tinygltf::Sampler &gltfSampler = model.samplers.at(samplerIndex);
-    SamplerOptions samplerOptions = {
-        .magFilter = TinyGltfHelper::filterModeForSamplerFilter(gltfSampler.magFilter),
-        .minFilter = TinyGltfHelper::filterModeForSamplerFilter(gltfSampler.minFilter),
-        .mipmapFilter = TinyGltfHelper::mipmapFilterModeForSamplerFilter(gltfSampler.minFilter),
-        .u = TinyGltfHelper::addressModeForSamplerAddressMode(gltfSampler.wrapS),
-        .v = TinyGltfHelper::addressModeForSamplerAddressMode(gltfSampler.wrapT)
-    };
-    Sampler sampler = m_device->createSampler(samplerOptions);
-    return sampler;
-}
-
 TextureViewAndSampler ModelScene::createViewSamplerForTexture(const tinygltf::Model &model, uint32_t viewSamplerIndex)
 {
     const tinygltf::Texture &gltfTexture = model.textures.at(viewSamplerIndex);
     TextureViewAndSampler viewSampler = {
         .view = m_textures.at(gltfTexture.source).textureView,
-        .sampler = m_samplers.at(gltfTexture.sampler)
+        .sampler = m_samplerCache.findOrCreate(*m_device, TinyGltfHelper::samplerOptionsForTexture(model, viewSamplerIndex))
     };
     return viewSampler;
 }
@@ -1057,121 +1035,24 @@ void ModelScene::setupMaterial(const tinygltf::Model &model, uint32_t materialIn
 }
 
 void ModelScene::setupPrimitive(const tinygltf::Model &model,
+                                TinyGltfHelper::VertexLayoutAnalyzer &vertexLayouts,
                                 const tinygltf::Primitive &primitive,
                                 const PrimitiveKey &primitiveKey,
                                 PrimitiveInstances &primitiveInstances)
 {
-    std::vector<BufferAndOffset> buffers;
-    VertexOptions vertexOptions{};
-    uint32_t nextBinding{ 0 };
-    uint32_t currentBinding{ 0 };
-    uint32_t vertexCount{ 0 };
-
-    // Used to keep track of which bindings are used for each buffer view and
-    // which attributes use each vertex buffer layout
-    std::map<int, std::vector<uint32_t>> bufferViewToLayoutMap;
-    std::map<uint32_t, std::vector<uint32_t>> layoutToAttributeMap;
-
-    const std::unordered_map<std::string, uint32_t> shaderLocations{ { "POSITION", 0 }, { "NORMAL", 1 }, { "TEXCOORD_0", 2 } };
-    bool hasTexCoords{ false };
-
-    // Iterate over each attribute in the primitive to build up a description of the
-    // vertex layout needed to create the pipeline.
-    for (const auto &attribute : primitive.attributes) {
-        const auto &accessor = model.accessors.at(attribute.second);
-        const uint32_t bufferIndex = accessor.bufferView;
-        const auto &bufferView = model.bufferViews.at(accessor.bufferView);
-
-        // Find the location for this attribute (if any)
-        auto locationIt = shaderLocations.find(attribute.first);
-        if (locationIt == shaderLocations.end())
-            continue;
-        const uint32_t location = locationIt->second;
-
-        // Note if the model contains texture coordinates so that we can select a suitable
-        // shader variant below.
-        if (location == 2)
-            hasTexCoords = true;
-
-        // Do we already have a binding for this buffer view?
-        bool foundCompatibleLayout = false;
-        const auto layoutIt = bufferViewToLayoutMap.find(accessor.bufferView);
-        if (layoutIt != bufferViewToLayoutMap.end()) {
-            // We already have one or more bindings (buffer layouts) for this buffer view. Are any
-            // of them compatible with this use of the buffer view? Are the offsets within limits?
-            const std::vector<uint32_t> &layoutIndices = layoutIt->second;
-
-            for (const auto &layoutIndex : layoutIndices) {
-                // Loop over attributes for this buffer layout
-                VertexBufferLayout &bufferLayout = vertexOptions.buffers[layoutIndex];
-                const std::vector<uint32_t> &attributeIndices = layoutToAttributeMap.at(layoutIndex);
-
-                for (const auto &attributeIndex : attributeIndices) {
-                    const DeviceSize attributeOffsetDelta = std::abs(
-                            int32_t(accessor.byteOffset) - int32_t(vertexOptions.attributes[attributeIndex].offset));
-                    if (attributeOffsetDelta < vertexOptions.buffers[layoutIndex].stride) {
-                        // Found a compatible vertex buffer layout
-                        foundCompatibleLayout = true;
-                        currentBinding = layoutIndex;
-
-                        // Track the minimum offset across all attributes that share a buffer layout
-                        BufferAndOffset &buffer = buffers.at(layoutIndex);
-                        buffer.offset = std::min(buffer.offset, static_cast<DeviceSize>(accessor.byteOffset));
-
-                        break;
-                    }
-                }
-            }
-        }
+    const TinyGltfHelper::PrimitiveVertexLayout &vertexLayout = vertexLayouts.analyze(primitive);
+    const VertexOptions &vertexOptions = vertexLayouts.vertexOptions(vertexLayout.layoutId);
+    const uint32_t vertexCount = vertexLayout.vertexCount;
 
-        if (!foundCompatibleLayout) {
-            // Add a buffer layout and binding for this buffer view
-            const VertexBufferLayout bufferLayout = {
-                .binding = nextBinding,
-                .stride = bufferView.byteStride ? static_cast<uint32_t>(bufferView.byteStride)
-                                                : TinyGltfHelper::packedArrayStrideForAccessor(accessor)
-            };
-            vertexOptions.buffers.push_back(bufferLayout);
+    // Note if the model contains texture coordinates so that we can select a suitable
+    // shader variant below.
+    const bool hasTexCoords = vertexLayouts.hasLocation(vertexLayout.layoutId, 2);
 
-            // Note that this buffer view maps to this binding
-            bufferViewToLayoutMap.insert({ accessor.bufferView, { nextBinding } });
-            layoutToAttributeMap.insert({ nextBinding, {} });
-
-            // Store the buffer and offset to be used with this buffer layout.
-            // NB: The index in the vector is equal to the buffer layout binding
-            buffers.push_back({ .buffer = m_buffers.at(bufferIndex), .offset = accessor.byteOffset });
-
-            currentBinding = nextBinding;
-            ++nextBinding;
-        }
-
-        // Set up the vertex attribute using the current binding
-        const VertexAttribute vertexAttribute = { .location = location,
-                                                  .binding = currentBinding,
-                                                  .format = TinyGltfHelper::formatForAccessor(accessor),
-                                                  .offset = accessor.byteOffset };
-        vertexOptions.attributes.push_back(vertexAttribute);
-
-        uint32_t attributeIndex = static_cast<uint32_t>(vertexOptions.attributes.size() - 1);
-        layoutToAttributeMap.at(currentBinding).push_back(attributeIndex);
-
-        vertexCount = accessor.count;
-    }
-
-    // Normalize attribute offsets by subtracting off the buffer layout offset. By nature of the
-    // way in which we create the buffer layouts they are already sorted by binding number.
-    const uint32_t bufferLayoutCount = vertexOptions.buffers.size();
-    for (uint32_t bufferLayoutIndex = 0; bufferLayoutIndex < bufferLayoutCount; ++bufferLayoutIndex) {
-        const BufferAndOffset &buffer = buffers.at(bufferLayoutIndex);
-        const std::vector<uint32_t> &attributeIndices = layoutToAttributeMap.at(bufferLayoutIndex);
-        for (const auto &attributeIndex : attributeIndices)
-            vertexOptions.attributes[attributeIndex].offset -= buffer.offset;
-    }
-
-    // Sort the attributes to be in order of their location. This normalizes the data so that we can
-    // compare them to remove duplicates.
-    std::sort(vertexOptions.attributes.begin(), vertexOptions.attributes.end(),
-              [](const VertexAttribute &a, const VertexAttribute &b) { return a.location < b.location; });
+    // NB: The index in the vector is equal to the buffer layout binding
+    std::vector<BufferAndOffset> buffers;
+    buffers.reserve(vertexLayout.bindings.size());
+    for (const auto &binding : vertexLayout.bindings)
+        buffers.push_back({ .buffer = m_buffers.at(binding.bufferView), .offset = binding.offset });
 
     // Find or create a pipeline that is compatible with the above vertex buffer layout and topology
     const tinygltf::Material &gltfMaterial = model.materials.at(primitive.material);
@@ -1180,7 +1061,7 @@ void ModelScene::setupPrimitive(const tinygltf::Model &model,
     // clang-format off
     const GraphicsPipelineKey key = {
         .topology = TinyGltfHelper::topologyForPrimitiveMode(primitive.mode),
-        .vertexOptions = std::move(vertexOptions),
+        .vertexOptions = vertexOptions,
         .alphaMode = alphaMode,
         .doubleSided = gltfMaterial.doubleSided,
         .shaderOptionsKey = {
@@ -1303,8 +1184,8 @@ Handle<ShaderModule_t> ModelScene::findOrCreateShaderModule(const ShaderModuleKe
     if (shaderModuleIt != m_shaderModules.end()) {
         return shaderModuleIt->second.handle();
     } else {
-        const auto shaderPath = ExampleUtility::assetPath() + "/shaders/xr_multiview_model_viewer/" + shaderFilename(key.shaderOptionsKey, key.stage);
-        ShaderModule shader = m_device->createShaderModule(KDGpuExample::readShaderFile(shaderPath));
+        const auto shaderPath = "shaders/xr_multiview_model_viewer/" + shaderFilename(key.shaderOptionsKey, key.stage);
+        ShaderModule shader = m_device->createShaderModule(kdgpu_ext::graphics::shader::loadShader(shaderPath));
         const auto shaderHandle = shader.handle();
         m_shaderModules.insert({ key, std::move(shader) });
         return shaderHandle;
@@ -1444,7 +1325,7 @@ void ModelScene::cleanupScene()
     m_cameraBindGroupLayout = {};
     m_pipelineLayout = {};
     m_viewSamplers.clear();
-    m_samplers.clear();
+    m_samplerCache.clear();
     m_textures.clear();
     m_buffers.clear();
     m_commandBuffer = {};
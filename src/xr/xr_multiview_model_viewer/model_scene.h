@@ -15,6 +15,8 @@
 
 #include <tinygltf_helper/camera.h>
 
+#include <sampler/sampler_cache.h>
+
 #include <KDGpuExample/engine.h>
 #include <KDGpuExample/xr_compositor/xr_projection_layer.h>
 
@@ -42,6 +44,10 @@ struct Node;
 struct Primitive;
 } // namespace tinygltf
 
+namespace TinyGltfHelper {
+class VertexLayoutAnalyzer;
+} // namespace TinyGltfHelper
+
 struct BufferAndOffset {
     Handle<Buffer_t> buffer;
     DeviceSize offset{ 0 };
@@ -151,13 +157,13 @@ private:
                                      uint32_t bufferViewIndex);
 
     TextureAndView createTextureForImage(const tinygltf::Model &model, uint32_t textureIndex);
-    Sampler createSampler(const tinygltf::Model &model, uint32_t samplerIndex);
     TextureViewAndSampler createViewSamplerForTexture(const tinygltf::Model &model, uint32_t viewSamplerIndex);
     TextureAndView createSolidColorTexture(float r, float g, float b, float a);
 
     void setupMaterial(const tinygltf::Model &model, uint32_t materialIndex);
 
     void setupPrimitive(const tinygltf::Model &model,
+                        TinyGltfHelper::VertexLayoutAnalyzer &vertexLayouts,
                         const tinygltf::Primitive &primitive,
                         const PrimitiveKey &primitiveKey,
                         PrimitiveInstances &primitiveInstances);
@@ -193,14 +199,15 @@ private:
     TextureAndView m_opaqueWhite;
     TextureAndView m_transparentBlack;
     TextureAndView m_defaultNormal;
-    Sampler m_defaultSampler;
+    Handle<Sampler_t> m_defaultSampler;
 
     std::unordered_map<Handle<GraphicsPipeline_t>, std::vector<MaterialPrimitives>> m_pipelinePrimitiveMap;
 
     std::vector<Buffer> m_buffers;
     std::vector<TextureAndView> m_textures;
-    std::vector<Sampler> m_samplers;
     std::vector<TextureViewAndSampler> m_viewSamplers;
+    // Owns all samplers of the scene, one per distinct sampler state
+    kdgpu_ext::graphics::sampler::SamplerCache m_samplerCache;
 
     std::vector<glm::mat4> m_worldTransforms; // Indexed as per model.nodes
     Buffer m_instanceTransformsBuffer;
@@ -264,7 +271,7 @@ private:
     BindGroup m_floorBindGroup;
     glm::vec3 m_floorColor{ 0.1f, 0.7f, 0.2f };
     TextureAndView m_floorTexture;
-    Sampler m_floorSampler;
+    Handle<Sampler_t> m_floorSampler;
     const PushConstantRange m_floorPushConstantRange{
         .offset = 0,
         .size = sizeof(float),